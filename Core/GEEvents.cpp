@@ -40,6 +40,7 @@ const ObjectName Events::RenderableColorChanged = ObjectName("RenderableColorCha
 //
 const ObjectName Events::ActiveSceneSet = ObjectName("ActiveSceneSet");
 const ObjectName Events::EntityAdded = ObjectName("EntityAdded");
+const ObjectName Events::EntitiesAdded = ObjectName("EntitiesAdded");
 const ObjectName Events::EntityRenamed = ObjectName("EntityRenamed");
 const ObjectName Events::EntityRemoved = ObjectName("EntityRemoved");
 const ObjectName Events::EntityParentChanged = ObjectName("EntityParentChanged");
@@ -33,6 +33,9 @@ namespace GE { namespace Core
       // Scene
       static const ObjectName ActiveSceneSet;
       static const ObjectName EntityAdded;
+      // entities added as a batch (Scene::instantiatePrefabBatch, Scene::cloneEntityBatch), with a
+      // GESTLVector(Entity*) as data. EntityAdded is not triggered for them
+      static const ObjectName EntitiesAdded;
       static const ObjectName EntityRenamed;
       static const ObjectName EntityRemoved;
       static const ObjectName EntityParentChanged;
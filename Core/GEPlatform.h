@@ -55,9 +55,22 @@
 #endif
 
 
+//
+//  SIMD
+//
+#if defined (_M_X64) || defined (__x86_64__) || defined (__SSE__) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+# define GE_SIMD_SSE
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+# define GE_SIMD_NEON
+#endif
+
+
 //
 //  Rendering API
 //
+//  Defining GE_RENDERING_API_NULL in the build settings replaces the DX11 or GL ES render system with
+//  RenderSystemNull, which needs no graphics device. The conventions of the platform API are kept
+//
 #if (defined(GE_PLATFORM_WINDOWS) || defined(GE_PLATFORM_WP8)) && !defined(GE_WINDOWS_OPENGL)
 # define GE_RENDERING_API_DIRECTX
 #else
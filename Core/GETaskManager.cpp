@@ -24,6 +24,9 @@ using namespace GE::Core;
 using namespace GE::Input;
 using namespace GE::Entities;
 
+// time per frame given to the instantiation of scenes being loaded asynchronously, in microseconds
+static const double kSceneLoadingTimeBudget = 4000.0;
+
 TaskManager::TaskManager()
    : iFrameCounter(0)
    , cCurrentState(0)
@@ -59,6 +62,16 @@ void TaskManager::queueJob(const JobDesc& sJobDesc, JobType eType)
       cFrameThreadPool->queueJob(sJobDesc);
 }
 
+void TaskManager::kickFrameJobs()
+{
+   cFrameThreadPool->kickJobs();
+}
+
+void TaskManager::waitForFrameJobs()
+{
+   cFrameThreadPool->waitForJobsCompletion();
+}
+
 uint TaskManager::getFrameCounter() const
 {
    return iFrameCounter;
@@ -114,6 +127,9 @@ void TaskManager::update()
       cCurrentState = cActiveState;
    }
 
+   // instantiate entities of scenes being loaded, which might activate one of them
+   Scene::updateAsyncLoading(kSceneLoadingTimeBudget);
+
    // process input event
    InputSystem::getInstance()->processEvents();
 
@@ -123,35 +139,22 @@ void TaskManager::update()
       cCurrentState->update();
    }
 
-   // queue scene update jobs
    Scene* cDebuggingScene = Scene::getDebuggingScene();
    Scene* cPermanentScene = Scene::getPermanentScene();
    Scene* cActiveScene = Scene::getActiveScene();
 
-   cDebuggingScene->queueUpdateJobs();
-   cPermanentScene->queueUpdateJobs();
+   // update world transforms modified by the state update
+   updateTransforms();
 
-   if(cActiveScene)
-   {
-      cActiveScene->queueUpdateJobs();
-   }
+   // update scenes, with the update systems of all of them sharing the stages
+   Scene* cScenes[] = { cDebuggingScene, cPermanentScene, cActiveScene };
+   Scene::updateScenes(cScenes, cActiveScene ? 3u : 2u);
 
-   // kick scene update jobs
-   cFrameThreadPool->kickJobs();
-
-   // update scene
-   cDebuggingScene->update();
-   cPermanentScene->update();
-
-   if(cActiveScene)
-   {
-      cActiveScene->update();
-   }
-
-   // wait for scene update jobs completion
-   cFrameThreadPool->waitForJobsCompletion();
+   // update world transforms modified during the scene update
+   updateTransforms();
 
    // queue scene objects for rendering
+   cRender->updateCullingFrustums();
    cDebuggingScene->queueForRendering();
    cPermanentScene->queueForRendering();
 
@@ -176,6 +179,27 @@ void TaskManager::update()
    iFrameCounter++;
 }
 
+void TaskManager::updateTransforms()
+{
+   Scene* cDebuggingScene = Scene::getDebuggingScene();
+   Scene* cPermanentScene = Scene::getPermanentScene();
+   Scene* cActiveScene = Scene::getActiveScene();
+
+   uint32_t iJobsCount = cDebuggingScene->queueTransformUpdateJobs();
+   iJobsCount += cPermanentScene->queueTransformUpdateJobs();
+
+   if(cActiveScene)
+   {
+      iJobsCount += cActiveScene->queueTransformUpdateJobs();
+   }
+
+   if(iJobsCount > 0u)
+   {
+      cFrameThreadPool->kickJobs();
+      cFrameThreadPool->waitForJobsCompletion();
+   }
+}
+
 void TaskManager::render()
 {
    GEProfilerMarker("TaskManager::render()");
@@ -46,6 +46,8 @@ namespace GE { namespace Core
       ThreadPoolSync* cFrameThreadPool;
       ThreadPoolAsync* cGeneralThreadPool;
 
+      void updateTransforms();
+
    public:
       TaskManager();
       ~TaskManager();
@@ -54,6 +56,8 @@ namespace GE { namespace Core
       void render();
 
       void queueJob(const JobDesc& sJobDesc, JobType eType = JobType::General);
+      void kickFrameJobs();
+      void waitForFrameJobs();
 
       uint getFrameCounter() const;
 
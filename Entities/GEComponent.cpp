@@ -21,15 +21,23 @@ using namespace GE::Core;
 //
 static const ObjectName kClassName("Component");
 
+HandleTable<Component> Component::smHandleTable;
+
 Component::Component(Entity* Owner)
    : Serializable(kClassName)
+   , mSceneIndex(0u)
+   , mSceneClassIndex(0u)
+   , mSortKey(0u)
+   , mUpdateLODDeltaTime(0.0f)
    , cOwner(Owner)
 {
    GEAssert(Owner);
+   mHandle = smHandleTable.add(this);
 }
 
 Component::~Component()
 {
+   smHandleTable.remove(mHandle);
 }
 
 Entity* Component::getOwner() const
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include "GEHandle.h"
 #include "Types/GETypes.h"
 #include "Core/GESerializable.h"
 
@@ -21,6 +22,21 @@ namespace GE { namespace Entities
 
    class Component : public Core::Serializable
    {
+   private:
+      friend class Scene;
+
+      static HandleTable<Component> smHandleTable;
+
+      // positions in the type and class lists of the scene, and key that defines the order of those lists
+      uint32_t mSceneIndex;
+      uint32_t mSceneClassIndex;
+      uint32_t mSortKey;
+
+      ComponentHandle mHandle;
+
+      // time accumulated over the frames skipped by the update LOD
+      float mUpdateLODDeltaTime;
+
    protected:
       Entity* cOwner;
 
@@ -30,5 +46,9 @@ namespace GE { namespace Entities
       virtual ~Component();
 
       Entity* getOwner() const;
+
+      ComponentHandle getHandle() const { return mHandle; }
+      // returns null if the component has been removed
+      static Component* fromHandle(ComponentHandle pHandle) { return smHandleTable.resolve(pHandle); }
    };
 }}
@@ -13,6 +13,7 @@
 #include "GEComponentAudio.h"
 #include "GEComponentTransform.h"
 #include "GEEntity.h"
+#include "GEUpdateScheduler.h"
 
 #include "Audio/GEAudioSystem.h"
 
@@ -52,6 +53,8 @@ void ComponentAudioListener::update()
    if(!mActive)
       return;
 
+   GEValidateUpdateWriteAccess(UpdateResource::Audio);
+
    ComponentTransform* transform = cOwner->getComponent<ComponentTransform>();
    AudioSystem* audioSystem = AudioSystem::getInstance();
 
@@ -121,6 +124,8 @@ void ComponentAudioSource::setAudioBusName(const ObjectName& pName)
 
 AudioEventInstance* ComponentAudioSource::playAudioEvent(const ObjectName& pAudioEventName)
 {
+   GEValidateUpdateWriteAccess(UpdateResource::Audio);
+
    AudioSystem* audioSystem = AudioSystem::getInstance();
    AudioEventInstance* audioEventInstance =
       audioSystem->playAudioEvent(mAudioBankName, pAudioEventName, mAudioBus);
@@ -167,6 +172,8 @@ void ComponentAudioSource::stopAllAudioEvents()
 
 void ComponentAudioSource::update()
 {
+   GEValidateUpdateWriteAccess(UpdateResource::Audio);
+
    for(size_t i = 0u; i < mAudioEventInstances.size(); )
    {
       if(mAudioEventInstances[i]->State == AudioEventInstanceState::Free)
@@ -832,6 +832,8 @@ void ComponentLabel::generateText()
       sGeometryData.Indices = nullptr;
    }
 
+   invalidateLocalBounds();
+
    mTextLength = iCurrentCharIndex;
 }
 
@@ -94,6 +94,8 @@ void ComponentMesh::loadMesh(Mesh* M)
       sGeometryData.VertexData = Allocator::alloc<float>(iVertexDataFloats);
       memcpy(sGeometryData.VertexData, cMesh->getGeometryData().VertexData, iVertexDataFloats * sizeof(float));
    }
+
+   invalidateLocalBounds();
 }
 
 void ComponentMesh::unload()
@@ -106,6 +108,7 @@ void ComponentMesh::unload()
 
    cMesh = 0;
    sGeometryData = GeometryData();
+   invalidateLocalBounds();
 }
 
 Content::Mesh* ComponentMesh::getMesh() const
@@ -171,4 +174,6 @@ void ComponentMesh::updateSkinning()
       fVertexDataPtr += iFloatsPerVertex;
       fOriginalVertexDataPtr += iFloatsPerVertex;
    }
+
+   invalidateLocalBounds();
 }
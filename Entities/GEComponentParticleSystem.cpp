@@ -14,6 +14,7 @@
 #include "GEComponentTransform.h"
 #include "GEComponentCamera.h"
 #include "GEEntity.h"
+#include "GEUpdateScheduler.h"
 #include "Core/GEAllocator.h"
 #include "Core/GETime.h"
 #include "Core/GERand.h"
@@ -22,6 +23,7 @@
 #include "Rendering/GERenderSystem.h"
 
 #include <algorithm>
+#include <cfloat>
 
 using namespace GE;
 using namespace GE::Core;
@@ -433,6 +435,8 @@ void ComponentParticleSystem::emitParticle()
 
 void ComponentParticleSystem::burst(uint NumParticles)
 {
+   GEValidateUpdateWriteAccess(UpdateResource::Particles);
+
    for(uint i = 0; i < NumParticles; i++)
    {
       emitParticle();
@@ -440,8 +444,14 @@ void ComponentParticleSystem::burst(uint NumParticles)
 }
 
 void ComponentParticleSystem::update()
+{
+   update(cOwner->getClock()->getDelta());
+}
+
+void ComponentParticleSystem::update(float pDeltaTime)
 {
    GEProfilerMarker("ComponentParticleSystem::update()");
+   GEValidateUpdateWriteAccess(UpdateResource::Particles);
 
    if(bVertexDataReallocationPending)
    {
@@ -460,8 +470,7 @@ void ComponentParticleSystem::update()
       mBurstPending = false;
    }
 
-   const float deltaTime = cOwner->getClock()->getDelta();
-   simulate(deltaTime);
+   simulate(pDeltaTime);
 
    if(eRenderingMode == RenderingMode::_3D)
    {
@@ -484,6 +493,54 @@ void ComponentParticleSystem::update()
    }
 
    composeVertexData();
+   updateParticleBounds();
+}
+
+void ComponentParticleSystem::updateParticleBounds()
+{
+   if(lParticles.empty())
+   {
+      mParticleBounds = BoundingBox(cTransform->getWorldPosition(), Vector3::Zero);
+      return;
+   }
+
+   // meshes and text are bounded by the composed vertices, which are already in world space
+   if(mParticleType != ParticleType::Billboard)
+   {
+      mParticleBounds = BoundingBox::fromVertexData(sGeometryData.VertexData, sGeometryData.NumVertices, (uint32_t)sGeometryData.VertexStride);
+      return;
+   }
+
+   // billboards face the camera, so each particle is bounded by the half diagonal of its quad
+   Vector3 min(FLT_MAX);
+   Vector3 max(-FLT_MAX);
+
+   for(ParticleList::const_iterator it = lParticles.begin(); it != lParticles.end(); it++)
+   {
+      const Particle& particle = *it;
+
+      const float particleHalfSizeX = particle.Size * particle.Scale.X * 0.5f;
+      const float particleHalfSizeY = particle.Size * particle.Scale.Y * 0.5f;
+      const float particleRadius = sqrtf(particleHalfSizeX * particleHalfSizeX + particleHalfSizeY * particleHalfSizeY);
+
+      min.X = std::min(min.X, particle.Position.X - particleRadius);
+      min.Y = std::min(min.Y, particle.Position.Y - particleRadius);
+      min.Z = std::min(min.Z, particle.Position.Z - particleRadius);
+
+      max.X = std::max(max.X, particle.Position.X + particleRadius);
+      max.Y = std::max(max.Y, particle.Position.Y + particleRadius);
+      max.Z = std::max(max.Z, particle.Position.Z + particleRadius);
+   }
+
+   mParticleBounds = BoundingBox::fromMinMax(min, max);
+}
+
+bool ComponentParticleSystem::getWorldBounds(BoundingBox* pOutBounds)
+{
+   GEAssert(pOutBounds);
+   *pOutBounds = mParticleBounds;
+
+   return true;
 }
 
 void ComponentParticleSystem::simulate(float pDeltaTime)
@@ -270,6 +270,8 @@ namespace GE { namespace Entities
       Vector3 mTurbulenceFactor;
       float mFrictionFactor;
 
+      Rendering::BoundingBox mParticleBounds;
+
       void simulate(float pDeltaTime);
       void prewarm();
 
@@ -279,6 +281,8 @@ namespace GE { namespace Entities
       void composeMeshVertexData();
       void composeTextVertexData();
 
+      void updateParticleBounds();
+
       uint32_t getParticleTextLength() const;
       float getParticleTextCharWidth(size_t pCharIndex) const;
 
@@ -326,6 +330,9 @@ namespace GE { namespace Entities
       void burst(uint NumParticles);
 
       void update();
+      void update(float pDeltaTime);
+
+      virtual bool getWorldBounds(Rendering::BoundingBox* pOutBounds) override;
 
       GEDefaultGetter(ParticleType, ParticleType, m);
       ParticleEmitterType getEmitterType() const { return eEmitterType; }
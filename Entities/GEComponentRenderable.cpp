@@ -36,6 +36,7 @@ ComponentRenderable::ComponentRenderable(Entity* Owner)
    , mRenderPass(RenderPass::None)
    , iInternalFlags((uint8_t)InternalFlags::Visible)
    , cColor(1.0f, 1.0f, 1.0f)
+   , mLocalBoundsDirty(true)
 {
    mClassNames.push_back(ClassName);
 
@@ -106,6 +107,30 @@ const GeometryData& ComponentRenderable::getGeometryData() const
    return sGeometryData;
 }
 
+void ComponentRenderable::invalidateLocalBounds()
+{
+   mLocalBoundsDirty = true;
+}
+
+bool ComponentRenderable::getWorldBounds(BoundingBox* pOutBounds)
+{
+   GEAssert(pOutBounds);
+
+   // without vertices there is nothing to bound the renderable with
+   if(sGeometryData.NumVertices == 0u || !sGeometryData.VertexData)
+      return false;
+
+   if(mLocalBoundsDirty)
+   {
+      mLocalBounds = BoundingBox::fromVertexData(sGeometryData.VertexData, sGeometryData.NumVertices, (uint32_t)sGeometryData.VertexStride);
+      mLocalBoundsDirty = false;
+   }
+
+   mLocalBounds.transform(cTransform->getGlobalWorldMatrix(), pOutBounds);
+
+   return true;
+}
+
 void ComponentRenderable::setGeometryType(GeometryType Type)
 {
    eGeometryType = Type;
@@ -15,6 +15,7 @@
 #include "GEComponentTransform.h"
 #include "Rendering/GERenderingObjects.h"
 #include "Rendering/GEMaterial.h"
+#include "Rendering/GEFrustum.h"
 #include "Content/GEGeometryData.h"
 
 namespace GE { namespace Entities
@@ -37,8 +38,10 @@ namespace GE { namespace Entities
    public:
       enum class InternalFlags
       {
-         Visible        =  1 << 0,
-         DebugGeometry  =  1 << 1,
+         Visible            =  1 << 0,
+         DebugGeometry      =  1 << 1,
+         StaticBatched      =  1 << 2,
+         StaticBatchMember  =  1 << 3,
       };
 
    protected:
@@ -54,9 +57,14 @@ namespace GE { namespace Entities
     
       Content::GeometryData sGeometryData;
 
+      Rendering::BoundingBox mLocalBounds;
+      bool mLocalBoundsDirty;
+
       ComponentRenderable(Entity* Owner);
       ~ComponentRenderable();
 
+      void invalidateLocalBounds();
+
    public:
       static const Core::ObjectName ClassName;
 
@@ -77,6 +85,9 @@ namespace GE { namespace Entities
 
       const Content::GeometryData& getGeometryData() const;
 
+      // returns false when the renderable cannot be bounded and therefore must never be culled
+      virtual bool getWorldBounds(Rendering::BoundingBox* pOutBounds);
+
       void setGeometryType(GeometryType Type);
       void setRenderingMode(RenderingMode Mode);
       void setRenderPriority(uint8_t Priority);
@@ -35,6 +35,8 @@ const ObjectName cDebugActionName = ObjectName("Debug");
 
 const ObjectName cThisVariableName = ObjectName("this");
 const ObjectName cEntityVariableName = ObjectName("entity");
+const ObjectName cUpdateReadsVariableName = ObjectName("updateReads");
+const ObjectName cUpdateWritesVariableName = ObjectName("updateWrites");
 
 const ObjectName cInitFunctionName = ObjectName("init");
 const ObjectName cUpdateFunctionName = ObjectName("update");
@@ -75,6 +77,8 @@ ScriptInstance::ScriptInstance()
    , mNamespace(0)
    , mScriptSettings((uint8_t)ScriptSettingsBitMask::Active)
    , mInitialized(false)
+   , mUpdateReadMask((uint32_t)UpdateResource::All)
+   , mUpdateWriteMask((uint32_t)UpdateResource::All)
 #if defined (GE_EDITOR_SUPPORT)
    , mDebugBreakpointLine(0)
 #endif
@@ -110,6 +114,11 @@ ScriptInstance::ScriptInstance()
 }
 
 ScriptInstance::~ScriptInstance()
+{
+   releaseNamespace();
+}
+
+void ScriptInstance::releaseNamespace()
 {
    if(mNamespace)
    {
@@ -121,6 +130,11 @@ ScriptInstance::~ScriptInstance()
       mNamespace->getParent()->removeNamespace(mNamespaceName);
       mNamespace = 0;
    }
+
+   mInitialized = false;
+
+   mUpdateReadMask = (uint32_t)UpdateResource::All;
+   mUpdateWriteMask = (uint32_t)UpdateResource::All;
 }
 
 void ScriptInstance::setScriptName(const ObjectName& pName)
@@ -159,6 +173,7 @@ void ScriptInstance::setScriptName(const ObjectName& pName)
       mNamespace->setVariable(cThisVariableName, this);
       mNamespace->setVariable(cEntityVariableName, owner->getOwner());
 
+      readUpdateAccess();
       registerScriptProperties();
       registerScriptActions();
    }
@@ -236,6 +251,16 @@ bool ScriptInstance::getThreadSafe() const
    return GEHasFlag(mScriptSettings, ScriptSettingsBitMask::ThreadSafe);
 }
 
+uint32_t ScriptInstance::getUpdateReadMask() const
+{
+   return mUpdateReadMask;
+}
+
+uint32_t ScriptInstance::getUpdateWriteMask() const
+{
+   return mUpdateWriteMask;
+}
+
 Environment* ScriptInstance::getEnvironment() const
 {
    ComponentScript* owner = static_cast<ComponentScript*>(cOwner);
@@ -243,6 +268,17 @@ Environment* ScriptInstance::getEnvironment() const
    return Application::getScriptingEnvironment(envIndex);
 }
 
+void ScriptInstance::readUpdateAccess()
+{
+   // scripts that do not declare what their update function accesses might access anything
+   mUpdateReadMask = mNamespace->getVariableType(cUpdateReadsVariableName) == ValueType::Int
+      ? mNamespace->getVariable<uint32_t>(cUpdateReadsVariableName)
+      : (uint32_t)UpdateResource::All;
+   mUpdateWriteMask = mNamespace->getVariableType(cUpdateWritesVariableName) == ValueType::Int
+      ? mNamespace->getVariable<uint32_t>(cUpdateWritesVariableName)
+      : (uint32_t)UpdateResource::All;
+}
+
 void ScriptInstance::registerScriptProperties()
 {
    const GESTLVector(ObjectName)& vGlobalVariableNames = mNamespace->getGlobalVariableNames();
@@ -256,6 +292,9 @@ void ScriptInstance::registerScriptProperties()
       if(ePropertyType == ValueType::Count)
          continue;
 
+      if(cGlobalVariableName == cUpdateReadsVariableName || cGlobalVariableName == cUpdateWritesVariableName)
+         continue;
+
       PropertySetter setter = [this, cGlobalVariableName](const Value& cValue)
       {
          setScriptProperty(cGlobalVariableName, cValue);
@@ -390,6 +429,12 @@ void ScriptInstance::cachePropertyValues()
 }
 
 void ScriptInstance::update()
+{
+   Entity* entity = static_cast<ComponentScript*>(cOwner)->getOwner();
+   update(entity->getClock()->getDelta());
+}
+
+void ScriptInstance::update(float pDeltaTime)
 {
    GEProfilerMarker("ScriptInstance::update()");
 
@@ -425,9 +470,7 @@ void ScriptInstance::update()
 
    if(mNamespace->isFunctionDefined(cUpdateFunctionName))
    {
-      Entity* entity = static_cast<ComponentScript*>(cOwner)->getOwner();
-      const float deltaTime = entity->getClock()->getDelta();
-      mNamespace->runFunction<void>(cUpdateFunctionName, deltaTime);
+      mNamespace->runFunction<void>(cUpdateFunctionName, pDeltaTime);
    }
 }
 
@@ -46,6 +46,10 @@ namespace GE { namespace Entities
 
       bool mInitialized;
 
+      // resources the update function accesses, as declared by the script
+      uint32_t mUpdateReadMask;
+      uint32_t mUpdateWriteMask;
+
 #if defined (GE_EDITOR_SUPPORT)
       struct CachedPropertyValue
       {
@@ -62,6 +66,7 @@ namespace GE { namespace Entities
 
       void registerScriptProperties();
       void registerScriptActions();
+      void readUpdateAccess();
 
       void setScriptProperty(const Core::ObjectName& pName, const Core::Value& pValue);
       Core::Value getScriptProperty(const Core::ObjectName& pName, Core::ValueType pType);
@@ -75,6 +80,10 @@ namespace GE { namespace Entities
       void setScriptName(const Core::ObjectName& pName);
       const Core::ObjectName& getScriptName() const;
 
+      // runs the shutdown function of an initialized script and drops its namespace, so that setting
+      // the script name again starts it from scratch
+      void releaseNamespace();
+
       void setScriptSettings(uint8_t pBitMask);
       uint8_t getScriptSettings() const;
 
@@ -85,7 +94,11 @@ namespace GE { namespace Entities
       bool getActive() const;
       bool getThreadSafe() const;
 
+      uint32_t getUpdateReadMask() const;
+      uint32_t getUpdateWriteMask() const;
+
       void update();
+      void update(float pDeltaTime);
 
       bool inputKeyPress(char pKey);
       bool inputKeyRelease(char pKey);
@@ -18,6 +18,7 @@
 #include "Core/GETime.h"
 #include "Core/GEEvents.h"
 #include "Core/GEProfiler.h"
+#include "GEUpdateScheduler.h"
 
 using namespace GE;
 using namespace GE::Content;
@@ -317,6 +318,8 @@ void ComponentSkeleton::playAnimation(const AnimationPlayInfo& PlayInfo)
    if(!cAnimationSet)
       return;
 
+   GEValidateUpdateWriteAccess(UpdateResource::SkeletonPoses);
+
    Animation* cAnimation = cAnimationSet->getAnimation(PlayInfo.AnimationName);
    
    if(!cAnimation)
@@ -608,14 +611,20 @@ void ComponentSkeleton::releaseSkeletonData()
 }
 
 void ComponentSkeleton::update()
+{
+   update(cOwner->getClock()->getDelta());
+}
+
+void ComponentSkeleton::update(float pDeltaTime)
 {
    if(!cSkeleton)
       return;
 
+   GEValidateUpdateWriteAccess(UpdateResource::SkeletonPoses);
+
    GEProfilerMarker("ComponentSkeleton::update()");
 
-   const float fDeltaTime = cOwner->getClock()->getDelta();
-   updateAnimationInstances(fDeltaTime);
+   updateAnimationInstances(pDeltaTime);
 
    if(onAnimationInstancesUpdated)
    {
@@ -163,5 +163,6 @@ namespace GE { namespace Entities
       void setCallbackOnAnimationInstancesUpdated(Callback fCallback);
 
       void update();
+      void update(float pDeltaTime);
    };
 }}
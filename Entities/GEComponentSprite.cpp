@@ -211,6 +211,8 @@ void ComponentSprite::updateVertexData()
    fVertexData[10] = -fHalfSizeX - fCenterX;  fVertexData[11] =  fHalfSizeY - fCenterY;  fVertexData[12] = 0.0f;
    fVertexData[15] =  fHalfSizeX - fCenterX;  fVertexData[16] =  fHalfSizeY - fCenterY;  fVertexData[17] = 0.0f;
 
+   invalidateLocalBounds();
+
    // texture coordinates
    if(vMaterialPassList.empty() || !getMaterialPass(0))
       return;
@@ -20,12 +20,12 @@ const ObjectName ResetActionName = ObjectName("Reset");
 
 ComponentTransform::ComponentTransform(Entity* Owner)
    : Component(Owner)
-   , vPosition(Vector3::Zero)
-   , vScale(Vector3::One)
+   , mStore(&Owner->getOwner()->getTransformStore())
+   , mStoreIndex(TransformStore::InvalidIndex)
 {
    mClassNames.push_back(ObjectName("Transform"));
 
-   updateWorldMatrix();
+   mStoreIndex = mStore->add(this);
 
    GERegisterProperty(Vector3, Position);
    GERegisterProperty(Vector3, Orientation);
@@ -40,4 +40,5 @@ ComponentTransform::ComponentTransform(Entity* Owner)
 
 ComponentTransform::~ComponentTransform()
 {
+   mStore->remove(mStoreIndex);
 }
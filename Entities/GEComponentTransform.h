@@ -15,6 +15,7 @@
 #include "GEComponent.h"
 #include "GEComponentType.h"
 #include "GEEntity.h"
+#include "GETransformStore.h"
 #include "Core/GEGeometry.h"
 #include "Core/GESerializable.h"
 
@@ -23,14 +24,8 @@ namespace GE { namespace Entities
    class ComponentTransform : public Component
    {
    protected:
-      friend class Scene;
-
-      Vector3 vPosition;
-      Rotation cRotation;
-      Vector3 vScale;
-
-      Matrix4 mLocalWorldMatrix;
-      Matrix4 mGlobalWorldMatrix;
+      TransformStore* mStore;
+      uint32_t mStoreIndex;
 
    public:
       static ComponentType getType() { return ComponentType::Transform; }
@@ -38,9 +33,14 @@ namespace GE { namespace Entities
       ComponentTransform(Entity* Owner);
       virtual ~ComponentTransform();
 
+      inline uint32_t getStoreIndex() const
+      {
+         return mStoreIndex;
+      }
+
       inline void move(const Vector3& Move)
       {
-         setPosition(vPosition + Move);
+         setPosition(mStore->getPosition(mStoreIndex) + Move);
       }
       inline void move(float DX, float DY, float DZ)
       {
@@ -48,71 +48,48 @@ namespace GE { namespace Entities
       }
       inline void rotate(const Rotation& Rotate)
       {
-         setRotation(Rotate * cRotation);
+         setRotation(Rotate * mStore->getRotation(mStoreIndex));
       }
       inline void scale(const Vector3& Scale)
       {
+         const Vector3& vScale = mStore->getScale(mStoreIndex);
          setScale(Vector3(vScale.X * Scale.X, vScale.Y * Scale.Y, vScale.Z * Scale.Z));
       }
       inline void scale(float SX, float SY, float SZ)
       {
-         setScale(Vector3(vScale.X * SX, vScale.Y * SY, vScale.Z * SZ));
+         scale(Vector3(SX, SY, SZ));
       }
       inline void scale(float ScaleFactor)
       {
-         setScale(Vector3(vScale.X * ScaleFactor, vScale.Y * ScaleFactor, vScale.Z * ScaleFactor));
+         scale(Vector3(ScaleFactor, ScaleFactor, ScaleFactor));
       }
 
       inline void reset()
       {
-         vPosition = Vector3::Zero;
-         cRotation = Rotation(Quaternion());
-         vScale = Vector3::One;
-
-         updateWorldMatrix();
-      }
-      inline void updateWorldMatrix()
-      {
-         Core::Geometry::createTRSMatrix(vPosition, cRotation, vScale, &mLocalWorldMatrix);
-         mGlobalWorldMatrix = mLocalWorldMatrix;
-
-         Entity* cParent = cOwner->getParent();
-
-         if(cParent)
-         {
-            Matrix4 mCurrentWorldMatrix = mGlobalWorldMatrix;
-            ComponentTransform* cParentTransform = cParent->getComponent<ComponentTransform>();
-            GEAssert(cParentTransform);
-            Matrix4Multiply(cParentTransform->mGlobalWorldMatrix, mCurrentWorldMatrix, &mGlobalWorldMatrix);
-         }
-
-         for(uint i = 0; i < cOwner->getChildrenCount(); i++)
-         {
-            Entity* cChild = cOwner->getChildByIndex(i);
-            ComponentTransform* cChildTransform = cChild->getComponent<ComponentTransform>();
-            cChildTransform->updateWorldMatrix();
-         }
+         mStore->reset(mStoreIndex);
       }
 
       inline Vector3& getPosition()
       {
-         return vPosition;
+         return mStore->getPosition(mStoreIndex);
       }
       inline Rotation& getRotation()
       {
-         return cRotation;
+         return mStore->getRotation(mStoreIndex);
       }
       inline Vector3 getOrientation()
       {
-         return cRotation.getEulerAngles() * GE_RAD2DEG;
+         return mStore->getRotation(mStoreIndex).getEulerAngles() * GE_RAD2DEG;
       }
       inline Vector3& getScale()
       {
-         return vScale;
+         return mStore->getScale(mStoreIndex);
       }
 
       inline Vector3 getWorldPosition() const
       {
+         const Matrix4 mGlobalWorldMatrix = getGlobalWorldMatrix();
+
          return Vector3(
             mGlobalWorldMatrix.m[GE_M4_1_4],
             mGlobalWorldMatrix.m[GE_M4_2_4],
@@ -120,65 +97,48 @@ namespace GE { namespace Entities
       }
       inline Rotation getWorldRotation() const
       {
-         Vector3 vWorldInverseScale = getWorldScale();
-         vWorldInverseScale.X = 1.0f / vWorldInverseScale.X;
-         vWorldInverseScale.Y = 1.0f / vWorldInverseScale.Y;
-         vWorldInverseScale.Z = 1.0f / vWorldInverseScale.Z;
-
-         Matrix4 mWorldRotation = mGlobalWorldMatrix;
-         mWorldRotation.m[GE_M4_1_4] = 0.0f;
-         mWorldRotation.m[GE_M4_2_4] = 0.0f;
-         mWorldRotation.m[GE_M4_3_4] = 0.0f;
-         Matrix4Scale(&mWorldRotation, vWorldInverseScale);
-
-         return Rotation(mWorldRotation);
+         return mStore->getWorldRotation(mStoreIndex);
       }
       inline Vector3 getWorldOrientation() const
       {
-         Rotation worldRotation = getWorldRotation();
-         return worldRotation.getEulerAngles() * GE_RAD2DEG;
+         return mStore->getWorldRotation(mStoreIndex).getEulerAngles() * GE_RAD2DEG;
       }
       inline Vector3 getWorldScale() const
       {
-         Vector3 vScalingFactorX = Vector3(mGlobalWorldMatrix.m[GE_M4_1_1], mGlobalWorldMatrix.m[GE_M4_2_1], mGlobalWorldMatrix.m[GE_M4_3_1]);
-         Vector3 vScalingFactorY = Vector3(mGlobalWorldMatrix.m[GE_M4_1_2], mGlobalWorldMatrix.m[GE_M4_2_2], mGlobalWorldMatrix.m[GE_M4_3_2]);
-         Vector3 vScalingFactorZ = Vector3(mGlobalWorldMatrix.m[GE_M4_1_3], mGlobalWorldMatrix.m[GE_M4_2_3], mGlobalWorldMatrix.m[GE_M4_3_3]);
-
-         return Vector3(vScalingFactorX.getLength(), vScalingFactorY.getLength(), vScalingFactorZ.getLength());
+         return mStore->getWorldScale(mStoreIndex);
       }
 
-      inline const Matrix4& getLocalWorldMatrix() const
+      inline Matrix4 getLocalWorldMatrix() const
       {
-         return mLocalWorldMatrix;
+         return mStore->getLocalMatrix(mStoreIndex);
       }
-      inline const Matrix4& getGlobalWorldMatrix() const
+      inline Matrix4 getGlobalWorldMatrix() const
       {
-         return mGlobalWorldMatrix;
+         return mStore->getWorldMatrix(mStoreIndex);
       }
 
       inline Vector3 getForwardVector() const
       {
          Vector3 forward;
-         Matrix4Transform(cRotation.getRotationMatrix(), Vector3::UnitZ, &forward);
+         Matrix4Transform(mStore->getRotation(mStoreIndex).getRotationMatrix(), Vector3::UnitZ, &forward);
          return forward;
       }
       inline Vector3 getUpVector() const
       {
          Vector3 up;
-         Matrix4Transform(cRotation.getRotationMatrix(), Vector3::UnitY, &up);
+         Matrix4Transform(mStore->getRotation(mStoreIndex).getRotationMatrix(), Vector3::UnitY, &up);
          return up;
       }
       inline Vector3 getRightVector() const
       {
          Vector3 right;
-         Matrix4Transform(cRotation.getRotationMatrix(), -Vector3::UnitX, &right);
+         Matrix4Transform(mStore->getRotation(mStoreIndex).getRotationMatrix(), -Vector3::UnitX, &right);
          return right;
       }
 
       inline void setPosition(const Vector3& Position)
       {
-         vPosition = Position;
-         updateWorldMatrix();
+         mStore->setPosition(mStoreIndex, Position);
       }
       inline void setPosition(float X, float Y, float Z)
       {
@@ -186,8 +146,7 @@ namespace GE { namespace Entities
       }
       inline void setRotation(const Rotation& R)
       {
-         cRotation = R;
-         updateWorldMatrix();
+         mStore->setRotation(mStoreIndex, R);
       }
       inline void setOrientation(const Vector3& EulerAnglesInDegrees)
       {
@@ -195,8 +154,7 @@ namespace GE { namespace Entities
       }
       inline void setScale(const Vector3& Scale)
       {
-         vScale = Scale;
-         updateWorldMatrix();
+         mStore->setScale(mStoreIndex, Scale);
       }
       inline void setScale(float X, float Y, float Z)
       {
@@ -213,8 +171,7 @@ namespace GE { namespace Entities
 
       inline void setLocalWorldMatrix(const Matrix4& LocalWorldMatrix)
       {
-         Core::Geometry::extractTRSFromMatrix(LocalWorldMatrix, &vPosition, &cRotation, &vScale);
-         updateWorldMatrix();
+         mStore->setLocalMatrix(mStoreIndex, LocalWorldMatrix);
       }
 
       inline void setWorldPosition(const Vector3& pWorldPosition)
@@ -223,22 +180,17 @@ namespace GE { namespace Entities
 
          if(parent)
          {
-            mGlobalWorldMatrix.m[GE_M4_1_4] = pWorldPosition.X;
-            mGlobalWorldMatrix.m[GE_M4_2_4] = pWorldPosition.Y;
-            mGlobalWorldMatrix.m[GE_M4_3_4] = pWorldPosition.Z;
+            Matrix4 worldMatrix = getGlobalWorldMatrix();
+            worldMatrix.m[GE_M4_1_4] = pWorldPosition.X;
+            worldMatrix.m[GE_M4_2_4] = pWorldPosition.Y;
+            worldMatrix.m[GE_M4_3_4] = pWorldPosition.Z;
 
-            Matrix4 parentInverseWorldMatrix = parent->getComponent<ComponentTransform>()->mGlobalWorldMatrix;
+            Matrix4 parentInverseWorldMatrix = parent->getComponent<ComponentTransform>()->getGlobalWorldMatrix();
             Matrix4Invert(&parentInverseWorldMatrix);
-            Matrix4Multiply(parentInverseWorldMatrix, mGlobalWorldMatrix, &mLocalWorldMatrix);
-
-            Core::Geometry::extractTRSFromMatrix(mLocalWorldMatrix, &vPosition, &cRotation, &vScale);
 
-            for(uint32_t i = 0u; i < cOwner->getChildrenCount(); i++)
-            {
-               Entity* child = cOwner->getChildByIndex(i);
-               ComponentTransform* childTransform = child->getComponent<ComponentTransform>();
-               childTransform->updateWorldMatrix();
-            }
+            Matrix4 localMatrix;
+            Matrix4Multiply(parentInverseWorldMatrix, worldMatrix, &localMatrix);
+            setLocalWorldMatrix(localMatrix);
          }
          else
          {
@@ -27,6 +27,7 @@ const ObjectName ComponentUIElement::ClassName = ObjectName("UIElement");
 ComponentUIElement::ComponentUIElement(Entity* Owner)
    : Component(Owner)
    , fAlpha(1.0f)
+   , mAlphaInHierarchy(getInheritedAlpha(Owner))
    , mInputEnabled(false)
    , mInputTabOrder(0u)
 {
@@ -34,6 +35,12 @@ ComponentUIElement::ComponentUIElement(Entity* Owner)
 
    GEAssert(cOwner->getComponent<ComponentTransform>());
 
+   // descendants created before this element have to inherit its alpha as well
+   for(uint32_t i = 0u; i < cOwner->getChildrenCount(); i++)
+   {
+      propagateAlphaInHierarchy(cOwner->getChildByIndex(i), mAlphaInHierarchy);
+   }
+
    GERegisterProperty(Float, Alpha);
    GERegisterPropertyReadonly(Float, AlphaInHierarchy);
    GERegisterProperty(Bool, InputEnabled);
@@ -51,25 +58,53 @@ float ComponentUIElement::getAlpha() const
 
 float ComponentUIElement::getAlphaInHierarchy() const
 {
-   float fAlphaInHierarchy = fAlpha;   
-   Entity* cParent = cOwner->getParent();
+   return mAlphaInHierarchy;
+}
+
+void ComponentUIElement::setAlpha(float Alpha)
+{
+   if(Alpha == fAlpha)
+      return;
+
+   fAlpha = Alpha;
+   propagateAlphaInHierarchy(cOwner, getInheritedAlpha(cOwner));
+}
 
-   while(cParent)
+float ComponentUIElement::getInheritedAlpha(const Entity* pEntity)
+{
+   // the closest UI element up in the hierarchy already includes the alpha of its own ancestors
+   for(Entity* parent = pEntity->getParent(); parent; parent = parent->getParent())
    {
-      ComponentUIElement* cUIElement = cParent->getComponent<ComponentUIElement>();
+      ComponentUIElement* uiElement = parent->getComponent<ComponentUIElement>();
 
-      if(cUIElement)
-         fAlphaInHierarchy *= cUIElement->getAlpha();
+      if(uiElement)
+      {
+         return uiElement->mAlphaInHierarchy;
+      }
+   }
+
+   return 1.0f;
+}
+
+void ComponentUIElement::propagateAlphaInHierarchy(Entity* pEntity, float pInheritedAlpha)
+{
+   ComponentUIElement* uiElement = pEntity->getComponent<ComponentUIElement>();
 
-      cParent = cParent->getParent();
+   if(uiElement)
+   {
+      uiElement->mAlphaInHierarchy = uiElement->fAlpha * pInheritedAlpha;
+      pInheritedAlpha = uiElement->mAlphaInHierarchy;
    }
 
-   return fAlphaInHierarchy;
+   for(uint32_t i = 0u; i < pEntity->getChildrenCount(); i++)
+   {
+      propagateAlphaInHierarchy(pEntity->getChildByIndex(i), pInheritedAlpha);
+   }
 }
 
-void ComponentUIElement::setAlpha(float Alpha)
+void ComponentUIElement::updateAlphaInHierarchy(Entity* pEntity)
 {
-   fAlpha = Alpha;
+   propagateAlphaInHierarchy(pEntity, getInheritedAlpha(pEntity));
 }
 
 
@@ -20,11 +20,15 @@ namespace GE { namespace Entities
    {
    protected:
       float fAlpha;
+      float mAlphaInHierarchy;
       bool mInputEnabled;
       uint8_t mInputTabOrder;
 
       ComponentUIElement(Entity* Owner);
 
+      static float getInheritedAlpha(const Entity* pEntity);
+      static void propagateAlphaInHierarchy(Entity* pEntity, float pInheritedAlpha);
+
    public:
       static const Core::ObjectName ClassName;
 
@@ -37,6 +41,8 @@ namespace GE { namespace Entities
 
       void setAlpha(float Alpha);
 
+      static void updateAlphaInHierarchy(Entity* pEntity);
+
       GEDefaultGetter(bool, InputEnabled, m);
       GEDefaultSetter(bool, InputEnabled, m);
 
@@ -12,6 +12,7 @@
 
 #include "GEEntity.h"
 #include "GEComponent.h"
+#include "GEComponentUIElement.h"
 #include "Core/GEAllocator.h"
 #include "Core/GETime.h"
 
@@ -23,6 +24,7 @@ using namespace GE::Entities;
 //  Entity
 //
 ComponentFactoryList Entity::vComponentFactories;
+HandleTable<Entity> Entity::smHandleTable;
 
 Entity::Entity(const ObjectName& Name, Entity* Parent, Scene* Owner)
    : EventHandlingObject(Name)
@@ -30,15 +32,19 @@ Entity::Entity(const ObjectName& Name, Entity* Parent, Scene* Owner)
    , cParent(Parent)
    , cOwner(Owner)
    , bActive(true)
+   , bActiveInHierarchy(!Parent || Parent->bActiveInHierarchy)
    , bInitialized(false)
    , mClock(0)
    , iInternalFlags(0)
+   , mSceneIndex(0u)
+   , mSortKey(0u)
 {
    GEAssert(Owner);
    updateFullName();
    memset(vComponents, 0, sizeof(Component*) * (uint)ComponentType::Count);
 
    mClock = cParent ? cParent->getClock() : Time::getDefaultClock();
+   mHandle = smHandleTable.add(this);
 
    GERegisterProperty(Bool, Active);
    GERegisterProperty(ObjectName, ClockName);
@@ -47,6 +53,8 @@ Entity::Entity(const ObjectName& Name, Entity* Parent, Scene* Owner)
 
 Entity::~Entity()
 {
+   smHandleTable.remove(mHandle);
+
    for(uint i = 0; i < (uint)ComponentType::Count; i++)
    {
       if(vComponents[i])
@@ -135,6 +143,12 @@ void Entity::removeComponent(const Core::ObjectName& ComponentName)
    cOwner->removeComponent(eComponentType, cComponent);
    GEInvokeDtor(Component, cComponent);
    Allocator::free(cComponent);
+
+   // the descendants no longer inherit the alpha of the removed element
+   if(eComponentType == ComponentType::UIElement)
+   {
+      ComponentUIElement::updateAlphaInHierarchy(this);
+   }
 }
 
 const ObjectName& Entity::getFullName() const
@@ -151,22 +165,17 @@ void Entity::addChild(Entity* Child)
 {
    vChildren.push_back(Child);
    Child->cParent = this;
+   Child->updateActiveInHierarchy();
 }
 
 void Entity::init()
 {
    GEAssert(!bInitialized);
 
-   for(uint i = 0; i < (uint)ComponentType::Count; i++)
-   {
-      if(vComponents[i])
-         cOwner->registerComponent((ComponentType)i, vComponents[i]);
-   }
+   cOwner->registerEntityComponents(this);
 
    for(uint i = 0; i < vChildren.size(); i++)
       vChildren[i]->init();
-
-   bInitialized = true;
 }
 
 uint Entity::getChildrenCount() const
@@ -230,12 +239,28 @@ bool Entity::isActive() const
 
 bool Entity::isActiveInHierarchy() const
 {
-   return bActive && (!cParent || cParent->isActiveInHierarchy());
+   return bActiveInHierarchy;
 }
 
 void Entity::setActive(bool Active)
 {
    bActive = Active;
+   updateActiveInHierarchy();
+}
+
+void Entity::updateActiveInHierarchy()
+{
+   const bool bNewActiveInHierarchy = bActive && (!cParent || cParent->bActiveInHierarchy);
+
+   if(bNewActiveInHierarchy == bActiveInHierarchy)
+      return;
+
+   bActiveInHierarchy = bNewActiveInHierarchy;
+
+   for(uint i = 0; i < vChildren.size(); i++)
+   {
+      vChildren[i]->updateActiveInHierarchy();
+   }
 }
 
 bool Entity::getActive() const
@@ -13,6 +13,7 @@
 #pragma once
 
 #include "GEScene.h"
+#include "GEHandle.h"
 #include "Core/GEObject.h"
 #include "Core/GEUtils.h"
 #include "Core/GEAllocator.h"
@@ -72,6 +73,7 @@ namespace GE { namespace Entities
       friend class Scene;
 
       static ComponentFactoryList vComponentFactories;
+      static HandleTable<Entity> smHandleTable;
 
       Core::ObjectName cFullName;
       Component* vComponents[(uint)ComponentType::Count];
@@ -79,10 +81,14 @@ namespace GE { namespace Entities
       Entity* cParent;
       Scene* cOwner;
       bool bActive;
+      bool bActiveInHierarchy;
       bool bInitialized;
       Core::Clock* mClock;
       Core::ObjectName cPrefabName;
       uint8_t iInternalFlags;
+      uint32_t mSceneIndex;
+      uint32_t mSortKey;
+      EntityHandle mHandle;
 
       template<typename T>
       void registerComponent(Component* cComponent)
@@ -91,12 +97,15 @@ namespace GE { namespace Entities
       }
 
       void updateFullName();
+      void updateActiveInHierarchy();
 
    public:
       enum class InternalFlags
       {
          // Generated: the entity must not be saved in scenes or prefabs
          Generated = 1 << 0,
+         // Pooled: the entity is waiting in the pool of its scene to be acquired again
+         Pooled = 1 << 1,
       };
 
       Entity(const Core::ObjectName& Name, Entity* Parent, Scene* Owner);
@@ -191,6 +200,10 @@ namespace GE { namespace Entities
       uint8_t getInternalFlags() const;
       void setInternalFlags(uint8_t Flags);
 
+      EntityHandle getHandle() const { return mHandle; }
+      // returns null if the entity has been removed
+      static Entity* fromHandle(EntityHandle pHandle) { return smHandleTable.resolve(pHandle); }
+
       static void mergeXmlDescription(pugi::xml_node& pXmlBase, const pugi::xml_node& pXmlDerived);
    };
 }}
@@ -0,0 +1,239 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Entities
+//
+//  --- GEEntityRegistry.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "GEEntityRegistry.h"
+#include "Core/GEAllocator.h"
+#include "Core/GEProfiler.h"
+
+#include <algorithm>
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+
+//
+//  EntityRegistry
+//
+EntityRegistry::EntityRegistry()
+   : mTable(createTable(InitialCapacity))
+   , mEntriesCount(0u)
+{
+}
+
+EntityRegistry::~EntityRegistry()
+{
+   for(size_t i = 0u; i < mRetiredTables.size(); i++)
+   {
+      destroyTable(mRetiredTables[i]);
+   }
+
+   destroyTable(mTable.load());
+}
+
+EntityRegistry::Table* EntityRegistry::createTable(uint32_t pCapacity)
+{
+   GEAssert((pCapacity & (pCapacity - 1u)) == 0u);
+
+   Table* table = Allocator::alloc<Table>();
+   table->Slots = Allocator::alloc<Slot>(pCapacity);
+   table->Capacity = pCapacity;
+   table->UsedSlots = 0u;
+
+   for(uint32_t i = 0u; i < pCapacity; i++)
+   {
+      GEInvokeCtor(Slot, &table->Slots[i])();
+   }
+
+   return table;
+}
+
+void EntityRegistry::destroyTable(Table* pTable)
+{
+   Allocator::free(pTable->Slots);
+   Allocator::free(pTable);
+}
+
+void EntityRegistry::insert(Table* pTable, uint32_t pKey, Entity* pEntity)
+{
+   const uint32_t mask = pTable->Capacity - 1u;
+   uint32_t slotIndex = getFirstSlot(pTable, pKey);
+
+   while(true)
+   {
+      Slot& slot = pTable->Slots[slotIndex];
+      const uint32_t slotKey = slot.Key.load(std::memory_order_relaxed);
+
+      if(slotKey == pKey)
+      {
+         // the slot already belongs to this key, so readers can never see it bound to another entity
+         slot.Value.store(pEntity, std::memory_order_release);
+         return;
+      }
+
+      if(slotKey == 0u)
+      {
+         // publish the value before the key, so that readers matching the key always see the value
+         slot.Value.store(pEntity, std::memory_order_relaxed);
+         slot.Key.store(pKey, std::memory_order_release);
+         pTable->UsedSlots++;
+         return;
+      }
+
+      slotIndex = (slotIndex + 1u) & mask;
+   }
+}
+
+void EntityRegistry::rebuild(uint32_t pCapacity)
+{
+   GEProfilerMarker("EntityRegistry::rebuild()");
+
+   Table* currentTable = mTable.load(std::memory_order_relaxed);
+   Table* newTable = createTable(pCapacity);
+
+   for(uint32_t i = 0u; i < currentTable->Capacity; i++)
+   {
+      const Slot& slot = currentTable->Slots[i];
+      Entity* entity = slot.Value.load(std::memory_order_relaxed);
+
+      if(entity)
+      {
+         insert(newTable, slot.Key.load(std::memory_order_relaxed), entity);
+      }
+   }
+
+   mTable.store(newTable, std::memory_order_release);
+   mRetiredTables.push_back(currentTable);
+}
+
+Entity* EntityRegistry::find(uint32_t pKey) const
+{
+   const uint32_t key = getStoredKey(pKey);
+   const Table* table = mTable.load(std::memory_order_acquire);
+   const uint32_t mask = table->Capacity - 1u;
+   uint32_t slotIndex = getFirstSlot(table, key);
+
+   while(true)
+   {
+      const Slot& slot = table->Slots[slotIndex];
+      const uint32_t slotKey = slot.Key.load(std::memory_order_acquire);
+
+      if(slotKey == key)
+      {
+         return slot.Value.load(std::memory_order_acquire);
+      }
+
+      if(slotKey == 0u)
+      {
+         return nullptr;
+      }
+
+      slotIndex = (slotIndex + 1u) & mask;
+   }
+}
+
+void EntityRegistry::add(uint32_t pKey, Entity* pEntity)
+{
+   GEAssert(pEntity);
+
+   Table* table = mTable.load(std::memory_order_relaxed);
+
+   // keep the load factor (live entries plus released slots) under 50%
+   if((table->UsedSlots + 1u) * 2u > table->Capacity)
+   {
+      const uint32_t requiredCapacity = (mEntriesCount + 1u) * 2u;
+      uint32_t newCapacity = table->Capacity;
+
+      while(newCapacity < requiredCapacity * 2u)
+      {
+         newCapacity <<= 1;
+      }
+
+      rebuild(newCapacity);
+      table = mTable.load(std::memory_order_relaxed);
+   }
+
+   insert(table, getStoredKey(pKey), pEntity);
+   mEntriesCount++;
+}
+
+void EntityRegistry::reserve(uint32_t pEntriesCount)
+{
+   Table* table = mTable.load(std::memory_order_relaxed);
+   const uint32_t newEntriesCount = pEntriesCount > mEntriesCount ? pEntriesCount - mEntriesCount : 0u;
+
+   if((table->UsedSlots + newEntriesCount) * 2u <= table->Capacity)
+   {
+      return;
+   }
+
+   // released slots are dropped by the rebuild, so only live entries have to fit
+   const uint32_t requiredCapacity = std::max(pEntriesCount, mEntriesCount) * 2u;
+   uint32_t newCapacity = table->Capacity;
+
+   while(newCapacity < requiredCapacity)
+   {
+      newCapacity <<= 1;
+   }
+
+   rebuild(newCapacity);
+}
+
+bool EntityRegistry::remove(uint32_t pKey)
+{
+   const uint32_t key = getStoredKey(pKey);
+   Table* table = mTable.load(std::memory_order_relaxed);
+   const uint32_t mask = table->Capacity - 1u;
+   uint32_t slotIndex = getFirstSlot(table, key);
+
+   while(true)
+   {
+      Slot& slot = table->Slots[slotIndex];
+      const uint32_t slotKey = slot.Key.load(std::memory_order_relaxed);
+
+      if(slotKey == key)
+      {
+         // an entry that has already been removed must not be counted twice
+         if(!slot.Value.load(std::memory_order_relaxed))
+            return false;
+
+         // the key stays in the slot, which keeps probe sequences intact until the next rebuild
+         slot.Value.store(nullptr, std::memory_order_release);
+         mEntriesCount--;
+         return true;
+      }
+
+      // the key is not in the table
+      if(slotKey == 0u)
+         return false;
+
+      slotIndex = (slotIndex + 1u) & mask;
+   }
+}
+
+void EntityRegistry::collectGarbage()
+{
+   for(size_t i = 0u; i < mRetiredTables.size(); i++)
+   {
+      destroyTable(mRetiredTables[i]);
+   }
+
+   mRetiredTables.clear();
+
+   // reclaim the released slots when they take up a significant part of the table
+   Table* table = mTable.load(std::memory_order_relaxed);
+   const uint32_t releasedSlots = table->UsedSlots - mEntriesCount;
+
+   if(releasedSlots > (table->Capacity >> 2))
+   {
+      rebuild(table->Capacity);
+   }
+}
@@ -0,0 +1,95 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Entities
+//
+//  --- GEEntityRegistry.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Types/GETypes.h"
+#include "Types/GESTLTypes.h"
+#include "Core/GEUtils.h"
+
+#include <atomic>
+
+namespace GE { namespace Entities
+{
+   class Entity;
+
+
+   //
+   //  EntityRegistry
+   //
+   //  Open-addressing hash table that maps full name hashes to entities. Lookups are lock-free and can
+   //  run concurrently with a single writer: slots are never reassigned to a different key and replaced
+   //  tables are retired instead of released, so both slot reclamation and memory release are deferred
+   //  to collectGarbage(), which must be called at a point where no readers are running
+   //
+   class EntityRegistry : private Core::NonCopyable
+   {
+   private:
+      static const uint32_t InitialCapacity = 256u;
+
+      // zero marks empty slots, so a name hashing to zero is stored under this key instead. Both names
+      // then share an entry, the same as any other pair of colliding hashes
+      static const uint32_t ZeroKeyReplacement = 0x9e3779b9u;
+
+      struct Slot
+      {
+         std::atomic<uint32_t> Key;
+         std::atomic<Entity*> Value;
+
+         Slot() : Key(0u), Value(nullptr) {}
+      };
+
+      struct Table
+      {
+         Slot* Slots;
+         uint32_t Capacity;
+         uint32_t UsedSlots;
+      };
+
+      std::atomic<Table*> mTable;
+      GESTLVector(Table*) mRetiredTables;
+      uint32_t mEntriesCount;
+
+      static Table* createTable(uint32_t pCapacity);
+      static void destroyTable(Table* pTable);
+      static void insert(Table* pTable, uint32_t pKey, Entity* pEntity);
+
+      static inline uint32_t getStoredKey(uint32_t pKey)
+      {
+         return pKey != 0u ? pKey : ZeroKeyReplacement;
+      }
+
+      static inline uint32_t getFirstSlot(const Table* pTable, uint32_t pKey)
+      {
+         return (pKey * 0x9e3779b1u) & (pTable->Capacity - 1u);
+      }
+
+      void rebuild(uint32_t pCapacity);
+
+   public:
+      EntityRegistry();
+      ~EntityRegistry();
+
+      Entity* find(uint32_t pKey) const;
+
+      // writers must be serialized by the caller
+      void add(uint32_t pKey, Entity* pEntity);
+      // returns false if the key has no live entry
+      bool remove(uint32_t pKey);
+      // makes room for the given number of live entries, so that adding up to that many does not rebuild the table
+      void reserve(uint32_t pEntriesCount);
+
+      void collectGarbage();
+
+      uint32_t getEntriesCount() const { return mEntriesCount; }
+   };
+}}
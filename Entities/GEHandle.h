@@ -0,0 +1,255 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Entities
+//
+//  --- GEHandle.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Types/GETypes.h"
+#include "Core/GEAllocator.h"
+#include "Core/GEThreads.h"
+#include "Core/GEUtils.h"
+
+#include <atomic>
+
+namespace GE { namespace Entities
+{
+   //
+   //  Handle
+   //
+   //  32-bit reference made of a slot index and the generation of the slot at the time the handle
+   //  was created. The generation is never zero, so a zero value is always an invalid handle
+   //
+   template<typename T>
+   class Handle
+   {
+   public:
+      static const uint32_t IndexBits = 20u;
+      static const uint32_t IndexMask = (1u << IndexBits) - 1u;
+      static const uint32_t GenerationBits = 32u - IndexBits;
+      static const uint32_t GenerationMask = (1u << GenerationBits) - 1u;
+
+   private:
+      uint32_t mValue;
+
+   public:
+      Handle() : mValue(0u) {}
+      explicit Handle(uint32_t pValue) : mValue(pValue) {}
+      Handle(uint32_t pIndex, uint32_t pGeneration)
+         : mValue((pGeneration << IndexBits) | (pIndex & IndexMask))
+      {
+         GEAssert(pIndex <= IndexMask);
+         GEAssert(pGeneration > 0u && pGeneration <= GenerationMask);
+      }
+
+      inline uint32_t getIndex() const { return mValue & IndexMask; }
+      inline uint32_t getGeneration() const { return mValue >> IndexBits; }
+      inline uint32_t getValue() const { return mValue; }
+      inline bool isValid() const { return mValue != 0u; }
+
+      inline bool operator==(const Handle& pOther) const { return mValue == pOther.mValue; }
+      inline bool operator!=(const Handle& pOther) const { return mValue != pOther.mValue; }
+   };
+
+
+   //
+   //  HandleTable
+   //
+   //  Flat table that resolves handles in O(1). Slots live in fixed-size pages that are never moved,
+   //  so resolving is lock-free, and releasing a slot bumps its generation so that all the handles
+   //  that point to it become stale. Adding and releasing are serialized by the table.
+   //
+   //  Released slots are reused in FIFO order, and only once enough of them are waiting, so that the
+   //  same slot goes through all its generations only after millions of releases instead of 4096
+   //
+   template<typename T>
+   class HandleTable : private Core::NonCopyable
+   {
+   private:
+      static const uint32_t PageSizeBits = 10u;
+      static const uint32_t PageSize = 1u << PageSizeBits;
+      static const uint32_t PageIndexMask = PageSize - 1u;
+      static const uint32_t MaxPages = (Handle<T>::IndexMask + 1u) >> PageSizeBits;
+      static const uint32_t MinFreeSlots = 1024u;
+      static const uint32_t InvalidIndex = 0xffffffffu;
+
+      struct Slot
+      {
+         std::atomic<T*> Object;
+         std::atomic<uint32_t> Generation;
+         uint32_t NextFree;
+
+         Slot() : Object(nullptr), Generation(1u), NextFree(InvalidIndex) {}
+      };
+
+      struct Page
+      {
+         Slot Slots[PageSize];
+      };
+
+      std::atomic<Page*> mPages[MaxPages];
+      uint32_t mSlotsCount;
+      uint32_t mFirstFree;
+      uint32_t mLastFree;
+      uint32_t mFreeSlotsCount;
+      uint32_t mObjectsCount;
+      GEMutex mMutex;
+
+      inline Slot* getSlot(uint32_t pIndex) const
+      {
+         Page* page = mPages[pIndex >> PageSizeBits].load(std::memory_order_acquire);
+         return page ? &page->Slots[pIndex & PageIndexMask] : nullptr;
+      }
+
+   public:
+      HandleTable()
+         : mSlotsCount(0u)
+         , mFirstFree(InvalidIndex)
+         , mLastFree(InvalidIndex)
+         , mFreeSlotsCount(0u)
+         , mObjectsCount(0u)
+      {
+         for(uint32_t i = 0u; i < MaxPages; i++)
+         {
+            mPages[i].store(nullptr, std::memory_order_relaxed);
+         }
+
+         GEMutexInit(mMutex);
+      }
+
+      ~HandleTable()
+      {
+         for(uint32_t i = 0u; i < MaxPages; i++)
+         {
+            Page* page = mPages[i].load(std::memory_order_relaxed);
+
+            if(page)
+            {
+               GEInvokeDtor(Page, page);
+               Core::Allocator::free(page);
+            }
+         }
+
+         GEMutexDestroy(mMutex);
+      }
+
+      Handle<T> add(T* pObject)
+      {
+         GEAssert(pObject);
+         GEMutexLock(mMutex);
+
+         uint32_t index = InvalidIndex;
+
+         // new slots are taken until enough released ones are waiting, or when there is no room left
+         if(mFreeSlotsCount > MinFreeSlots || (mFreeSlotsCount > 0u && mSlotsCount > Handle<T>::IndexMask))
+         {
+            index = mFirstFree;
+            mFirstFree = getSlot(index)->NextFree;
+            mFreeSlotsCount--;
+
+            if(mFirstFree == InvalidIndex)
+            {
+               mLastFree = InvalidIndex;
+            }
+         }
+         else
+         {
+            index = mSlotsCount++;
+            GEAssert(index <= Handle<T>::IndexMask);
+
+            if((index & PageIndexMask) == 0u)
+            {
+               Page* page = Core::Allocator::alloc<Page>();
+               GEInvokeCtor(Page, page)();
+               mPages[index >> PageSizeBits].store(page, std::memory_order_release);
+            }
+         }
+
+         Slot* slot = getSlot(index);
+         slot->Object.store(pObject, std::memory_order_release);
+         mObjectsCount++;
+
+         const Handle<T> handle(index, slot->Generation.load(std::memory_order_relaxed));
+
+         GEMutexUnlock(mMutex);
+
+         return handle;
+      }
+
+      void remove(Handle<T> pHandle)
+      {
+         GEAssert(pHandle.isValid());
+         GEMutexLock(mMutex);
+
+         Slot* slot = getSlot(pHandle.getIndex());
+         GEAssert(slot);
+         GEAssert(slot->Generation.load(std::memory_order_relaxed) == pHandle.getGeneration());
+
+         // bump the generation before clearing the object, skipping zero when it wraps around
+         uint32_t generation = (pHandle.getGeneration() + 1u) & Handle<T>::GenerationMask;
+         slot->Generation.store(generation ? generation : 1u, std::memory_order_release);
+         slot->Object.store(nullptr, std::memory_order_release);
+
+         // the slot goes to the back of the free list
+         slot->NextFree = InvalidIndex;
+
+         if(mLastFree != InvalidIndex)
+         {
+            getSlot(mLastFree)->NextFree = pHandle.getIndex();
+         }
+         else
+         {
+            mFirstFree = pHandle.getIndex();
+         }
+
+         mLastFree = pHandle.getIndex();
+         mFreeSlotsCount++;
+         mObjectsCount--;
+
+         GEMutexUnlock(mMutex);
+      }
+
+      T* resolve(Handle<T> pHandle) const
+      {
+         if(!pHandle.isValid())
+         {
+            return nullptr;
+         }
+
+         const Slot* slot = getSlot(pHandle.getIndex());
+
+         if(!slot || slot->Generation.load(std::memory_order_acquire) != pHandle.getGeneration())
+         {
+            return nullptr;
+         }
+
+         T* object = slot->Object.load(std::memory_order_acquire);
+
+         // the slot might have been released and reused between both loads, in which case the object
+         // belongs to a newer generation. Releasing always bumps the generation, so checking it again
+         // after reading the object is enough to tell
+         if(slot->Generation.load(std::memory_order_acquire) != pHandle.getGeneration())
+         {
+            return nullptr;
+         }
+
+         return object;
+      }
+
+      uint32_t getObjectsCount() const { return mObjectsCount; }
+   };
+
+
+   class Entity;
+   class Component;
+
+   typedef Handle<Entity> EntityHandle;
+   typedef Handle<Component> ComponentHandle;
+}}
@@ -28,6 +28,8 @@
 #include "Core/GEPlatform.h"
 #include "Core/GEApplication.h"
 #include "Core/GEEvents.h"
+#include "Core/GELog.h"
+#include "Core/GETime.h"
 
 #include <algorithm>
 
@@ -49,18 +51,37 @@ const ObjectName BackgroundEntityName = ObjectName("Background");
 Scene* Scene::cActiveScene = nullptr;
 Scene* Scene::cPermanentScene = nullptr;
 Scene* Scene::cDebuggingScene = nullptr;
-
-GESTLMap(uint32_t, ContentData) Scene::smPrefabData;
+Scene* Scene::cPrefabTemplatesScene = nullptr;
+
+GESTLMap(uint32_t, Scene::PrefabData) Scene::smPrefabData;
+uint32_t Scene::smPrefabDataUseCounter = 0u;
+uint32_t Scene::smPrefabDataResidentSize = 0u;
+uint32_t Scene::smPrefabDataBudget = 16u * 1024u * 1024u;
+GEMutex Scene::smPrefabDataMutex;
+const GESTLVector(Component*) Scene::smEmptyComponentList;
+GESTLVector(Scene*) Scene::smLoadingScenes;
+bool Scene::smStaticBatchingEnabled = false;
+bool Scene::smPrefabTemplatesEnabled = true;
 
 Scene::Scene(const ObjectName& Name)
    : EventHandlingObject(Name)
    , Serializable("Scene")
+   , mFirstSortKey(0x80000000u)
+   , mLastSortKey(0x80000000u)
+   , mEntitiesOrderDirty(false)
+   , mComponentTypesOrderDirty(0u)
+   , mUpdateLODViewAvailable(false)
+   , mBatchInstancesCount(0u)
    , mRemovingEntities(false)
    , eBackgroundMode(SceneBackgroundMode::SolidColor)
    , cBackgroundEntity(0)
    , fShadowsMaxDistance(20.0f)
+   , mLoadingState(SceneLoadingState::None)
+   , mAsyncLoadingData(nullptr)
+   , mStaticBatchesPending(false)
 {
    GEMutexInit(mSceneMutex);
+   registerUpdateSystems();
 
    GERegisterPropertyEnum(SceneBackgroundMode, BackgroundMode);
    GERegisterProperty(String, BackgroundMaterialName);
@@ -73,6 +94,23 @@ Scene::~Scene()
    if(cActiveScene == this)
       setActiveScene(0);
 
+   if(mAsyncLoadingData)
+   {
+      // the reading job holds a pointer to the scene, so it has to be done before anything is released.
+      // Cancelling makes it skip the parsing when the file has not been read yet
+      mAsyncLoadingData->Cancelled.store(true, std::memory_order_relaxed);
+
+      GEMutexLock(mAsyncLoadingData->ReadingMutex);
+      GEConditionVariableWait(mAsyncLoadingData->ReadingDone, mAsyncLoadingData->ReadingMutex,
+         mLoadingState.load(std::memory_order_acquire) != SceneLoadingState::Reading);
+      GEMutexUnlock(mAsyncLoadingData->ReadingMutex);
+
+      smLoadingScenes.erase(std::find(smLoadingScenes.begin(), smLoadingScenes.end(), this));
+      releaseAsyncLoadingData();
+   }
+
+   mStaticBatches.clear();
+
    for(GESTLVector(Entity*)::iterator it = vEntities.begin(); it != vEntities.end(); it++)
    {
       GEInvokeDtor(Entity, (*it));
@@ -84,6 +122,8 @@ Scene::~Scene()
 
 void Scene::loadPrefabData()
 {
+   GEMutexInit(smPrefabDataMutex);
+
    if(Application::ContentType == ApplicationContentType::Bin)
    {
       FileNamesList prefabNames;
@@ -102,22 +142,216 @@ void Scene::loadPrefabData()
             prefabNameHash = hash(prefabNames[i].c_str());
          }
 
-         smPrefabData[prefabNameHash] = ContentData();
-         ContentData& contentData = smPrefabData.find(prefabNameHash)->second;
-         Device::readContentFile(
-            ContentType::GenericBinaryData, "Prefabs", prefabNames[i].c_str(), "prefab.ge", &contentData);
+         // the contents are read on first use
+         smPrefabData[prefabNameHash].FileName = prefabNames[i];
       }
    }
 }
 
 void Scene::unloadPrefabData()
 {
-   for(GESTLMap(uint32_t, ContentData)::iterator it = smPrefabData.begin(); it != smPrefabData.end(); it++)
+   releasePrefabTemplates();
+
+   for(GESTLMap(uint32_t, PrefabData)::iterator it = smPrefabData.begin(); it != smPrefabData.end(); it++)
    {
-      it->second.unload();
+      it->second.Content.unload();
    }
 
    smPrefabData.clear();
+   smPrefabDataResidentSize = 0u;
+
+   GEMutexDestroy(smPrefabDataMutex);
+}
+
+const ContentData& Scene::getPrefabData(const char* pPrefabName)
+{
+   return getPrefabData(hash(pPrefabName));
+}
+
+const ContentData& Scene::getPrefabData(uint32_t pPrefabNameHash)
+{
+   // called with the prefab data mutex locked
+   GESTLMap(uint32_t, PrefabData)::iterator it = smPrefabData.find(pPrefabNameHash);
+   GEAssert(it != smPrefabData.end());
+
+   PrefabData& prefabData = it->second;
+   prefabData.LastUse = ++smPrefabDataUseCounter;
+
+   if(prefabData.Content.getDataSize() == 0u)
+   {
+      GEProfilerMarker("Scene::getPrefabData()");
+
+      Timer timer;
+      timer.start();
+
+      Device::readContentFile(
+         ContentType::GenericBinaryData, "Prefabs", prefabData.FileName.c_str(), "prefab.ge", &prefabData.Content);
+      prefabData.ResidentSize += prefabData.Content.getDataSize();
+      smPrefabDataResidentSize += prefabData.Content.getDataSize();
+
+      Log::log(LogType::Info, "Prefab data loaded: '%s' (%u bytes, %.2f ms, %u bytes resident)",
+         prefabData.FileName.c_str(), prefabData.Content.getDataSize(), (float)(timer.getTime() * 0.001), smPrefabDataResidentSize);
+
+      evictPrefabData(pPrefabNameHash);
+   }
+
+   return prefabData.Content;
+}
+
+void Scene::evictPrefabData(uint32_t pPrefabNameHashToKeep)
+{
+   while(smPrefabDataResidentSize > smPrefabDataBudget)
+   {
+      PrefabData* leastRecentlyUsed = nullptr;
+
+      for(GESTLMap(uint32_t, PrefabData)::iterator it = smPrefabData.begin(); it != smPrefabData.end(); it++)
+      {
+         // templates being copied from cannot be released, and registered data cannot be read again
+         if(it->first == pPrefabNameHashToKeep || it->second.ResidentSize == 0u || it->second.TemplateUsers > 0u ||
+            it->second.Registered)
+            continue;
+
+         if(!leastRecentlyUsed || it->second.LastUse < leastRecentlyUsed->LastUse)
+         {
+            leastRecentlyUsed = &it->second;
+         }
+      }
+
+      if(!leastRecentlyUsed)
+         break;
+
+      releasePrefabEntry(leastRecentlyUsed);
+   }
+}
+
+void Scene::releasePrefabEntry(PrefabData* pPrefabData)
+{
+   GEAssert(pPrefabData->TemplateUsers == 0u);
+
+   if(pPrefabData->Template)
+   {
+      if(cPrefabTemplatesScene)
+      {
+         cPrefabTemplatesScene->removeEntity(pPrefabData->Template);
+      }
+
+      pPrefabData->Template = nullptr;
+   }
+
+   pPrefabData->Content.unload();
+
+   smPrefabDataResidentSize -= pPrefabData->ResidentSize;
+   pPrefabData->ResidentSize = 0u;
+}
+
+void Scene::prefetchPrefabData(const char* pPrefabName)
+{
+   prefetchPrefabEntry(hash(pPrefabName));
+}
+
+void Scene::prefetchPrefabEntry(uint32_t pPrefabNameHash)
+{
+   if(Application::ContentType != ApplicationContentType::Bin)
+      return;
+
+   GEMutexLock(smPrefabDataMutex);
+
+   GESTLMap(uint32_t, PrefabData)::iterator it = smPrefabData.find(pPrefabNameHash);
+
+   if(it == smPrefabData.end())
+   {
+      Log::log(LogType::Warning, "The prefab data cannot be prefetched: no prefab with the 0x%08x hash", pPrefabNameHash);
+   }
+   // with the template already built, the raw data would only be read to be dropped again
+   else if(it->second.Template)
+   {
+      it->second.LastUse = ++smPrefabDataUseCounter;
+   }
+   else
+   {
+      getPrefabData(pPrefabNameHash);
+   }
+
+   GEMutexUnlock(smPrefabDataMutex);
+}
+
+void Scene::prefetchScenePrefabData()
+{
+   GEProfilerMarker("Scene::prefetchScenePrefabData()");
+
+   // instances saved in the scene tell which prefabs are likely to be instantiated again at runtime
+   GESTLVector(uint32_t) prefabNameHashes;
+
+   for(size_t i = 0u; i < vEntities.size(); i++)
+   {
+      const uint32_t prefabNameHash = vEntities[i]->getPrefabName().getID();
+
+      if(prefabNameHash != 0u &&
+         std::find(prefabNameHashes.begin(), prefabNameHashes.end(), prefabNameHash) == prefabNameHashes.end())
+      {
+         prefabNameHashes.push_back(prefabNameHash);
+      }
+   }
+
+   for(size_t i = 0u; i < prefabNameHashes.size(); i++)
+   {
+      prefetchPrefabEntry(prefabNameHashes[i]);
+   }
+}
+
+void Scene::setPrefabDataBudget(uint32_t pBytes)
+{
+   GEMutexLock(smPrefabDataMutex);
+
+   smPrefabDataBudget = pBytes;
+   evictPrefabData(0u);
+
+   GEMutexUnlock(smPrefabDataMutex);
+}
+
+void Scene::registerPrefabData(const char* pPrefabName, const char* pData, uint32_t pDataSize)
+{
+   GEMutexLock(smPrefabDataMutex);
+
+   PrefabData& prefabData = smPrefabData[hash(pPrefabName)];
+   GEAssert(prefabData.TemplateUsers == 0u);
+
+   // the previous data and its template are replaced
+   releasePrefabEntry(&prefabData);
+
+   prefabData.Content.load(pDataSize, pData);
+   prefabData.Registered = true;
+   prefabData.ResidentSize = pDataSize;
+   smPrefabDataResidentSize += pDataSize;
+
+   GEMutexUnlock(smPrefabDataMutex);
+}
+
+void Scene::releasePrefabTemplates()
+{
+   GEMutexLock(smPrefabDataMutex);
+
+   for(GESTLMap(uint32_t, PrefabData)::iterator it = smPrefabData.begin(); it != smPrefabData.end(); it++)
+   {
+      PrefabData& prefabData = it->second;
+
+      if(prefabData.Template && prefabData.TemplateUsers == 0u)
+      {
+         if(cPrefabTemplatesScene)
+         {
+            cPrefabTemplatesScene->removeEntity(prefabData.Template);
+         }
+
+         prefabData.Template = nullptr;
+
+         // raw data that is still resident keeps being accounted for
+         const uint32_t templateSize = prefabData.ResidentSize - prefabData.Content.getDataSize();
+         prefabData.ResidentSize -= templateSize;
+         smPrefabDataResidentSize -= templateSize;
+      }
+   }
+
+   GEMutexUnlock(smPrefabDataMutex);
 }
 
 void Scene::initStaticScenes()
@@ -127,10 +361,20 @@ void Scene::initStaticScenes()
 
    cDebuggingScene = Allocator::alloc<Scene>();
    GEInvokeCtor(Scene, cDebuggingScene)("Debugging");
+
+   cPrefabTemplatesScene = Allocator::alloc<Scene>();
+   GEInvokeCtor(Scene, cPrefabTemplatesScene)("PrefabTemplates");
 }
 
 void Scene::releaseStaticScenes()
 {
+   // the template entities are owned by the scene
+   releasePrefabTemplates();
+
+   GEInvokeDtor(Scene, cPrefabTemplatesScene);
+   Allocator::free(cPrefabTemplatesScene);
+   cPrefabTemplatesScene = 0;
+
    GEInvokeDtor(Scene, cDebuggingScene);
    Allocator::free(cDebuggingScene);
    cDebuggingScene = 0;
@@ -189,8 +433,9 @@ void Scene::registerEntity(Entity* cEntity)
       cParent->addChild(cEntity);
    }
 
-   vEntities.push_back(cEntity);
-   mRegistry[cEntity->getFullName().getID()] = cEntity;
+   cEntity->mSortKey = getBackSortKey();
+   addToList(vEntities, cEntity, &Entity::mSceneIndex);
+   mRegistry.add(cEntity->getFullName().getID(), cEntity);
 
    GEMutexUnlock(mSceneMutex);
 }
@@ -218,11 +463,11 @@ void Scene::removeEntityRecursively(Entity* cEntity)
    triggerEvent(Events::EntityRemoved, &sEventArgs);
 
    // remove the entity from the registry
-   GESTLMap(uint, Entity*)::iterator it = mRegistry.find(cEntity->getFullName().getID());
-   mRegistry.erase(it);
+   mRegistry.remove(cEntity->getFullName().getID());
 
    // remove the entity from the list of entities
-   vEntities.erase(std::find(vEntities.begin(), vEntities.end(), cEntity));
+   removeFromList(vEntities, cEntity, &Entity::mSceneIndex);
+   mEntitiesOrderDirty = true;
 
    // remove the components from the lists of component
    if(cEntity->bInitialized)
@@ -233,7 +478,14 @@ void Scene::removeEntityRecursively(Entity* cEntity)
 
          if(cComponent)
          {
-            vComponents[i].erase(std::find(vComponents[i].begin(), vComponents[i].end(), cComponent));
+            if((ComponentType)i == ComponentType::Renderable)
+            {
+               releaseRenderable(static_cast<ComponentRenderable*>(cComponent));
+            }
+
+            removeFromList(vComponents[i], cComponent, &Component::mSceneIndex);
+            removeFromList(mComponentsByClass[cComponent->getClassName().getID()], cComponent, &Component::mSceneClassIndex);
+            setComponentOrderDirty((ComponentType)i, cComponent);
          }
       }
    }
@@ -299,32 +551,23 @@ Entity* Scene::addEntity(const ObjectName& Name, Entity* cParent)
 
 Entity* Scene::getEntity(const ObjectName& FullName)
 {
-   GEMutexLock(mSceneMutex);
-
-   Entity* cEntity = 0;
-   GESTLMap(uint, Entity*)::iterator it = mRegistry.find(FullName.getID());
-
-   if(it != mRegistry.end())
-      cEntity = it->second;
-
-   GEMutexUnlock(mSceneMutex);
-
-   return cEntity;
+   // lock-free: entries are never rebound to a different entity and memory is released at safe points
+   return mRegistry.find(FullName.getID());
 }
 
 bool Scene::removeEntity(const ObjectName& FullName)
 {
    GEMutexLock(mSceneMutex);
 
-   GESTLMap(uint, Entity*)::iterator it = mRegistry.find(FullName.getID());
+   Entity* cEntity = mRegistry.find(FullName.getID());
 
-   if(it == mRegistry.end())
+   if(!cEntity)
    {
       GEMutexUnlock(mSceneMutex);
       return false;
    }
 
-   mEntitiesToRemove.push_back(it->second);
+   mEntitiesToRemove.push_back(cEntity);
 
    GEMutexUnlock(mSceneMutex);
 
@@ -335,15 +578,15 @@ bool Scene::removeEntityImmediately(const Core::ObjectName& FullName)
 {
    GEMutexLock(mSceneMutex);
 
-   GESTLMap(uint, Entity*)::iterator it = mRegistry.find(FullName.getID());
+   Entity* cEntity = mRegistry.find(FullName.getID());
 
-   if(it == mRegistry.end())
+   if(!cEntity)
    {
       GEMutexUnlock(mSceneMutex);
       return false;
    }
 
-   removeEntity(it->second);
+   removeEntity(cEntity);
 
    GEMutexUnlock(mSceneMutex);
 
@@ -360,13 +603,12 @@ bool Scene::renameEntity(Entity* cEntity, const Core::ObjectName& NewName)
    cEntity->cName = NewName;
    cEntity->updateFullName();
    
-   bool bNewNameIsUnique = mRegistry.find(cEntity->getFullName().getID()) == mRegistry.end();
+   bool bNewNameIsUnique = !mRegistry.find(cEntity->getFullName().getID());
    
    if(bNewNameIsUnique)
    {
-      GESTLMap(uint, Entity*)::const_iterator it = mRegistry.find(cOriginalFullName.getID());
-      mRegistry.erase(it);
-      mRegistry[cEntity->cFullName.getID()] = cEntity;
+      mRegistry.remove(cOriginalFullName.getID());
+      mRegistry.add(cEntity->cFullName.getID(), cEntity);
 
       EventArgs sEventArgs;
       sEventArgs.Sender = this;
@@ -437,12 +679,14 @@ Entity* Scene::cloneEntity(Entity* cEntity, const Core::ObjectName& CloneName, E
 
 void Scene::setEntityParent(Entity* cEntity, Entity* cNewParent)
 {
+   ComponentTransform* cTransform = cEntity->getComponent<ComponentTransform>();
+   const Matrix4 mWorldMatrix = cTransform->getGlobalWorldMatrix();
+
    GEMutexLock(mSceneMutex);
 
    // remove the current entry in the registry
-   GESTLMap(uint, Entity*)::const_iterator it = mRegistry.find(cEntity->getFullName().getID());
-   GEAssert(it != mRegistry.end());
-   mRegistry.erase(it);
+   GEAssert(mRegistry.find(cEntity->getFullName().getID()) == cEntity);
+   mRegistry.remove(cEntity->getFullName().getID());
 
    // remove this entity from the parent's children list
    if(cEntity->cParent)
@@ -462,36 +706,36 @@ void Scene::setEntityParent(Entity* cEntity, Entity* cNewParent)
    // set the new parent
    cEntity->cParent = cNewParent;
    cEntity->updateFullName();
+   cEntity->updateActiveInHierarchy();
 
    if(cNewParent)
    {
       cNewParent->vChildren.push_back(cEntity);
    }
 
-   mRegistry[cEntity->getFullName().getID()] = cEntity;
+   mRegistry.add(cEntity->getFullName().getID(), cEntity);
 
    // update the local transform matrix
-   ComponentTransform* cTransform = cEntity->getComponent<ComponentTransform>();
-
    if(cNewParent)
    {
-      Matrix4 mNewParentInverseWorldMatrix = cNewParent->getComponent<ComponentTransform>()->mGlobalWorldMatrix;
+      ComponentTransform* cNewParentTransform = cNewParent->getComponent<ComponentTransform>();
+      mTransformStore.setParent(cTransform->getStoreIndex(), cNewParentTransform->getStoreIndex());
+
+      Matrix4 mNewParentInverseWorldMatrix = cNewParentTransform->getGlobalWorldMatrix();
       Matrix4Invert(&mNewParentInverseWorldMatrix);
-      Matrix4Multiply(mNewParentInverseWorldMatrix, cTransform->mGlobalWorldMatrix, &cTransform->mLocalWorldMatrix);
+
+      Matrix4 mLocalWorldMatrix;
+      Matrix4Multiply(mNewParentInverseWorldMatrix, mWorldMatrix, &mLocalWorldMatrix);
+      cTransform->setLocalWorldMatrix(mLocalWorldMatrix);
    }
    else
    {
-      cTransform->mLocalWorldMatrix = cTransform->mGlobalWorldMatrix;
+      mTransformStore.setParent(cTransform->getStoreIndex(), TransformStore::InvalidIndex);
+      cTransform->setLocalWorldMatrix(mWorldMatrix);
    }
 
-   Vector3 vLocalPosition;
-   Rotation cLocalRotation;
-   Vector3 vLocalScale;
-   Geometry::extractTRSFromMatrix(cTransform->mLocalWorldMatrix, &vLocalPosition, &cLocalRotation, &vLocalScale);
-
-   cTransform->setPosition(vLocalPosition);
-   cTransform->setRotation(cLocalRotation);
-   cTransform->setScale(vLocalScale);
+   // update the alpha inherited by the UI elements
+   ComponentUIElement::updateAlphaInHierarchy(cEntity);
 
    GEMutexUnlock(mSceneMutex);
 
@@ -538,68 +782,101 @@ void Scene::registerComponent(ComponentType pType, Component* pComponent)
    GEAssert(pType < ComponentType::Count);
    GEAssert(pComponent);
    GEMutexLock(mSceneMutex);
-   vComponents[(uint32_t)pType].push_back(pComponent);
+   addComponentToLists(pType, pComponent);
    GEMutexUnlock(mSceneMutex);
 }
 
-void Scene::removeComponent(ComponentType pType, Component* pComponent)
+void Scene::registerEntityComponents(Entity* pEntity)
 {
-   GEAssert(pType < ComponentType::Count);
-   GEAssert(pComponent);
+   GEAssert(pEntity);
    GEMutexLock(mSceneMutex);
+   addEntityComponentsToLists(pEntity);
+   GEMutexUnlock(mSceneMutex);
+}
+
+void Scene::addComponentToLists(ComponentType pType, Component* pComponent)
+{
+   // called with the scene mutex locked
+   pComponent->mSortKey = getBackSortKey();
+   addToList(vComponents[(uint32_t)pType], pComponent, &Component::mSceneIndex);
+   addToList(mComponentsByClass[pComponent->getClassName().getID()], pComponent, &Component::mSceneClassIndex);
+}
 
-   GESTLVector(Component*)& vComponentList = vComponents[(uint32_t)pType];
+void Scene::addEntityComponentsToLists(Entity* pEntity)
+{
+   // called with the scene mutex locked
+   GEAssert(!pEntity->bInitialized);
 
-   for(uint32_t i = 0u; i < vComponentList.size(); i++)
+   for(uint i = 0; i < (uint)ComponentType::Count; i++)
    {
-      if(vComponentList[i] == pComponent)
+      Component* cComponent = pEntity->getComponent((ComponentType)i);
+
+      if(cComponent)
       {
-         vComponentList.erase(vComponentList.begin() + i);
-         break;
+         addComponentToLists((ComponentType)i, cComponent);
       }
    }
 
-   GEMutexUnlock(mSceneMutex);
+   pEntity->bInitialized = true;
 }
 
-void Scene::bringComponentToFront(ComponentType pType, Component* pComponent)
+void Scene::releaseRenderable(ComponentRenderable* pRenderable)
+{
+   // members of dissolved batches are still referenced by them, since the batches can be formed again
+   if(GEHasFlag(pRenderable->getInternalFlags(), ComponentRenderable::InternalFlags::StaticBatchMember))
+   {
+      mStaticBatches.remove(pRenderable);
+   }
+
+   // static geometry stays in the GPU buffers until its space is explicitly given back
+   if(pRenderable->getGeometryType() == GeometryType::Static)
+   {
+      RenderSystem::getInstance()->releaseStaticGeometry(pRenderable->getOwner()->getFullName().getID());
+   }
+}
+
+void Scene::removeComponent(ComponentType pType, Component* pComponent)
 {
    GEAssert(pType < ComponentType::Count);
    GEAssert(pComponent);
    GEMutexLock(mSceneMutex);
 
-   GESTLVector(Component*)& vComponentList = vComponents[(uint)pType];
+   if(pType == ComponentType::Renderable)
+   {
+      releaseRenderable(static_cast<ComponentRenderable*>(pComponent));
+   }
 
-   for(uint32_t i = 0u; i < vComponentList.size(); i++)
+   if(removeFromList(vComponents[(uint32_t)pType], pComponent, &Component::mSceneIndex))
    {
-      if(vComponentList[i] == pComponent)
-      {
-         vComponentList.erase(vComponentList.begin() + i);
-         vComponentList.insert(vComponentList.begin(), pComponent);
-         break;
-      }
+      removeFromList(mComponentsByClass[pComponent->getClassName().getID()], pComponent, &Component::mSceneClassIndex);
+      setComponentOrderDirty(pType, pComponent);
    }
 
    GEMutexUnlock(mSceneMutex);
 }
 
-void Scene::sendComponentToBack(ComponentType pType, Component* pComponent)
+void Scene::bringComponentToFront(ComponentType pType, Component* pComponent)
 {
    GEAssert(pType < ComponentType::Count);
    GEAssert(pComponent);
    GEMutexLock(mSceneMutex);
 
-   GESTLVector(Component*)& vComponentList = vComponents[(uint)pType];
+   pComponent->mSortKey = getFrontSortKey();
+   sortList(vComponents[(uint)pType], &Component::mSceneIndex);
+   sortList(mComponentsByClass[pComponent->getClassName().getID()], &Component::mSceneClassIndex);
 
-   for(uint32_t i = 0u; i < vComponentList.size(); i++)
-   {
-      if(vComponentList[i] == pComponent)
-      {
-         vComponentList.erase(vComponentList.begin() + i);
-         vComponentList.push_back(pComponent);
-         break;
-      }
-   }
+   GEMutexUnlock(mSceneMutex);
+}
+
+void Scene::sendComponentToBack(ComponentType pType, Component* pComponent)
+{
+   GEAssert(pType < ComponentType::Count);
+   GEAssert(pComponent);
+   GEMutexLock(mSceneMutex);
+
+   pComponent->mSortKey = getBackSortKey();
+   sortList(vComponents[(uint)pType], &Component::mSceneIndex);
+   sortList(mComponentsByClass[pComponent->getClassName().getID()], &Component::mSceneClassIndex);
 
    GEMutexUnlock(mSceneMutex);
 }
@@ -610,106 +887,714 @@ const GESTLVector(Component*)& Scene::getComponents(ComponentType pType)
    return vComponents[(uint)pType];
 }
 
-Entity* Scene::addPrefab(const char* PrefabName, const ObjectName& EntityName, Entity* cParent)
+const GESTLVector(Component*)& Scene::getComponentsOfClass(const ObjectName& pClassName)
 {
-   Entity* cEntity = addEntity(EntityName, cParent);
-   setupEntityFromPrefab(cEntity, PrefabName);
-   cEntity->init();
-
-   return cEntity;
+   GESTLMap(uint32_t, GESTLVector(Component*))::const_iterator it = mComponentsByClass.find(pClassName.getID());
+   return it != mComponentsByClass.end() ? it->second : smEmptyComponentList;
 }
 
-void Scene::setupEntityFromPrefab(Entity* pEntity, const char* pPrefabName, bool pIncludeRootTransform)
+uint32_t Scene::getFrontSortKey()
 {
-   Vector3 cachedPosition;
-   Rotation cachedRotation;
-   Vector3 cachedScale;
-
-   if(!pIncludeRootTransform)
+   if(mFirstSortKey == 0u)
    {
-      cachedPosition = pEntity->getComponent<ComponentTransform>()->getPosition();
-      cachedRotation = pEntity->getComponent<ComponentTransform>()->getRotation();
-      cachedScale = pEntity->getComponent<ComponentTransform>()->getScale();
+      renumberSortKeys();
    }
 
-   char sFilename[64];
-   sprintf(sFilename, "%s.prefab", pPrefabName);
+   return --mFirstSortKey;
+}
 
-   if(Application::ContentType == ApplicationContentType::Xml)
+uint32_t Scene::getBackSortKey()
+{
+   if(mLastSortKey == 0xffffffffu)
    {
-      ContentData content;
-      Device::readContentFile(ContentType::GenericTextData, "Prefabs", sFilename, "xml", &content);
-      pugi::xml_document xml;
-      xml.load_buffer(content.getData(), content.getDataSize());
-      pugi::xml_node xmlRoot = xml.child("Prefab");
-
-      pugi::xml_attribute xmlPrefabBase = xmlRoot.attribute("base");
-
-      while(!xmlPrefabBase.empty())
-      {
-         pugi::xml_document xmlDerived;
-         xmlDerived.append_copy(xmlRoot);
-         pugi::xml_node xmlDerivedRoot = xmlDerived.child("Prefab");
-
-         const char* prefabBaseName = xmlPrefabBase.value();
-         sprintf(sFilename, "%s.prefab", prefabBaseName);
+      renumberSortKeys();
+   }
 
-         xml.remove_child(xmlRoot);
+   return ++mLastSortKey;
+}
 
-         Device::readContentFile(ContentType::GenericTextData, "Prefabs", sFilename, "xml", &content);
-         xml.load_buffer(content.getData(), content.getDataSize());
-         xmlRoot = xml.child("Prefab");
+void Scene::renumberSortKeys()
+{
+   GEProfilerMarker("Scene::renumberSortKeys()");
 
-         Entity::mergeXmlDescription(xmlRoot, xmlDerivedRoot);
+   // only the relative order matters, so the keys are packed again in the middle of the range. Each
+   // component class belongs to a single type, so renumbering the type lists keeps the class lists sorted
+   sortLists();
 
-         xmlPrefabBase = xmlRoot.attribute("base");
-      }
+   const uint32_t firstKey = 0x80000000u;
+   uint32_t keysCount = (uint32_t)vEntities.size();
 
-      setupEntity(xmlRoot, pEntity);
-   }
-   else
+   for(uint32_t i = 0u; i < (uint32_t)vEntities.size(); i++)
    {
-      const uint32_t prefabNameHash = hash(pPrefabName);
-      const ContentData& content = smPrefabData.find(prefabNameHash)->second;
-
-      ContentDataMemoryBuffer memoryBuffer(content);
-      std::istream stream(&memoryBuffer);
-      Value::fromStream(ValueType::ObjectName, stream);
-
-      setupEntity(stream, pEntity);
+      vEntities[i]->mSortKey = firstKey + i;
    }
 
-   if(!pIncludeRootTransform)
+   for(uint32_t i = 0u; i < (uint32_t)ComponentType::Count; i++)
    {
-      pEntity->getComponent<ComponentTransform>()->setPosition(cachedPosition);
-      pEntity->getComponent<ComponentTransform>()->setRotation(cachedRotation);
-      pEntity->getComponent<ComponentTransform>()->setScale(cachedScale);
+      for(uint32_t j = 0u; j < (uint32_t)vComponents[i].size(); j++)
+      {
+         vComponents[i][j]->mSortKey = firstKey + j;
+      }
+
+      keysCount = GEMax(keysCount, (uint32_t)vComponents[i].size());
    }
 
-   pEntity->setPrefabName(ObjectName(pPrefabName));
+   mFirstSortKey = firstKey;
+   mLastSortKey = firstKey + keysCount;
 }
 
-SceneBackgroundMode Scene::getBackgroundMode() const
+void Scene::setComponentOrderDirty(ComponentType pType, Component* pComponent)
 {
-   return eBackgroundMode;
-}
+   static_assert((uint32_t)ComponentType::Count <= 32u, "component types must fit in the dirty mask");
 
-const char* Scene::getBackgroundMaterialName() const
-{
-   return cBackgroundMaterialName.getString();
-}
+   GESetFlag(mComponentTypesOrderDirty, 1u << (uint32_t)pType);
 
-Color Scene::getAmbientLightColor() const
-{
-   return RenderSystem::getInstance()
-      ? RenderSystem::getInstance()->getAmbientLightColor()
-      : Color();
+   const uint32_t classNameID = pComponent->getClassName().getID();
+
+   if(std::find(mComponentClassesOrderDirty.begin(), mComponentClassesOrderDirty.end(), classNameID) == mComponentClassesOrderDirty.end())
+   {
+      mComponentClassesOrderDirty.push_back(classNameID);
+   }
 }
 
-float Scene::getShadowsMaxDistance() const
+void Scene::sortLists()
 {
-   return fShadowsMaxDistance;
-}
+   GEProfilerMarker("Scene::sortLists()");
+
+   if(mEntitiesOrderDirty)
+   {
+      sortList(vEntities, &Entity::mSceneIndex);
+      mEntitiesOrderDirty = false;
+   }
+
+   for(uint32_t i = 0u; mComponentTypesOrderDirty != 0u; i++)
+   {
+      if(GEHasFlag(mComponentTypesOrderDirty, 1u << i))
+      {
+         sortList(vComponents[i], &Component::mSceneIndex);
+         GEResetFlag(mComponentTypesOrderDirty, 1u << i);
+      }
+   }
+
+   for(size_t i = 0u; i < mComponentClassesOrderDirty.size(); i++)
+   {
+      GESTLMap(uint32_t, GESTLVector(Component*))::iterator it = mComponentsByClass.find(mComponentClassesOrderDirty[i]);
+
+      if(it != mComponentsByClass.end())
+      {
+         sortList(it->second, &Component::mSceneClassIndex);
+      }
+   }
+
+   mComponentClassesOrderDirty.clear();
+}
+
+Entity* Scene::addPrefab(const char* PrefabName, const ObjectName& EntityName, Entity* cParent)
+{
+   Entity* cEntity = addEntity(EntityName, cParent);
+   setupEntityFromPrefab(cEntity, PrefabName);
+   cEntity->init();
+
+   return cEntity;
+}
+
+Entity* Scene::acquirePrefabTemplate(const char* pPrefabName)
+{
+   const uint32_t prefabNameHash = hash(pPrefabName);
+
+   GEMutexLock(smPrefabDataMutex);
+
+   GESTLMap(uint32_t, PrefabData)::iterator it = smPrefabData.find(prefabNameHash);
+
+   if(it == smPrefabData.end())
+   {
+      // prefabs in XML format are not listed at startup, so their entries are created on first use
+      if(Application::ContentType == ApplicationContentType::Bin)
+      {
+         GEMutexUnlock(smPrefabDataMutex);
+         Log::log(LogType::Error, "The '%s' prefab does not exist", pPrefabName);
+         GEAssert(false);
+         return nullptr;
+      }
+
+      it = smPrefabData.insert(std::make_pair(prefabNameHash, PrefabData())).first;
+   }
+
+   PrefabData& prefabData = it->second;
+
+   if(!prefabData.Template)
+   {
+      GEProfilerMarker("Scene::acquirePrefabTemplate()");
+
+      // template entities are never initialized, so their components are not registered in the scene
+      prefabData.Template = cPrefabTemplatesScene->addEntity(ObjectName(pPrefabName));
+      const uint32_t dataSize = cPrefabTemplatesScene->setupEntityFromPrefabData(prefabData.Template, pPrefabName);
+
+      if(prefabData.Registered)
+      {
+         // the data stays resident, and the template is accounted for with its size
+      }
+      else if(Application::ContentType == ApplicationContentType::Xml)
+      {
+         prefabData.ResidentSize += dataSize;
+         smPrefabDataResidentSize += dataSize;
+         evictPrefabData(prefabNameHash);
+      }
+      else
+      {
+         // instances are copied from the template from now on, so the raw data is not needed anymore.
+         // The template keeps being accounted for with the size of the data it was built from
+         prefabData.Content.unload();
+      }
+   }
+
+   prefabData.LastUse = ++smPrefabDataUseCounter;
+
+   // the template cannot be evicted until it is released
+   prefabData.TemplateUsers++;
+
+   GEMutexUnlock(smPrefabDataMutex);
+
+   return prefabData.Template;
+}
+
+void Scene::releasePrefabTemplate(const char* pPrefabName)
+{
+   GEMutexLock(smPrefabDataMutex);
+
+   GESTLMap(uint32_t, PrefabData)::iterator it = smPrefabData.find(hash(pPrefabName));
+   GEAssert(it != smPrefabData.end());
+   GEAssert(it->second.TemplateUsers > 0u);
+   it->second.TemplateUsers--;
+
+   GEMutexUnlock(smPrefabDataMutex);
+}
+
+void Scene::setupEntityFromPrefab(Entity* pEntity, const char* pPrefabName, bool pIncludeRootTransform)
+{
+   Entity* prefabTemplate = nullptr;
+
+   if(smPrefabTemplatesEnabled)
+   {
+      prefabTemplate = acquirePrefabTemplate(pPrefabName);
+
+      if(!prefabTemplate)
+         return;
+   }
+
+   Vector3 cachedPosition;
+   Rotation cachedRotation;
+   Vector3 cachedScale;
+
+   if(!pIncludeRootTransform)
+   {
+      cachedPosition = pEntity->getComponent<ComponentTransform>()->getPosition();
+      cachedRotation = pEntity->getComponent<ComponentTransform>()->getRotation();
+      cachedScale = pEntity->getComponent<ComponentTransform>()->getScale();
+   }
+
+   if(prefabTemplate)
+   {
+      setupEntityFromTemplate(pEntity, prefabTemplate);
+      releasePrefabTemplate(pPrefabName);
+   }
+   else
+   {
+      GEMutexLock(smPrefabDataMutex);
+      setupEntityFromPrefabData(pEntity, pPrefabName);
+      GEMutexUnlock(smPrefabDataMutex);
+   }
+
+   if(!pIncludeRootTransform)
+   {
+      pEntity->getComponent<ComponentTransform>()->setPosition(cachedPosition);
+      pEntity->getComponent<ComponentTransform>()->setRotation(cachedRotation);
+      pEntity->getComponent<ComponentTransform>()->setScale(cachedScale);
+   }
+
+   pEntity->setPrefabName(ObjectName(pPrefabName));
+}
+
+uint32_t Scene::setupEntityFromPrefabData(Entity* pEntity, const char* pPrefabName)
+{
+   // called with the prefab data mutex locked
+   char sFilename[64];
+   sprintf(sFilename, "%s.prefab", pPrefabName);
+
+   GESTLMap(uint32_t, PrefabData)::const_iterator it = smPrefabData.find(hash(pPrefabName));
+   const bool registered = it != smPrefabData.end() && it->second.Registered;
+
+   uint32_t dataSize = 0u;
+
+   if(Application::ContentType == ApplicationContentType::Xml && !registered)
+   {
+      ContentData content;
+      Device::readContentFile(ContentType::GenericTextData, "Prefabs", sFilename, "xml", &content);
+      dataSize += content.getDataSize();
+      pugi::xml_document xml;
+      xml.load_buffer(content.getData(), content.getDataSize());
+      pugi::xml_node xmlRoot = xml.child("Prefab");
+
+      pugi::xml_attribute xmlPrefabBase = xmlRoot.attribute("base");
+
+      while(!xmlPrefabBase.empty())
+      {
+         pugi::xml_document xmlDerived;
+         xmlDerived.append_copy(xmlRoot);
+         pugi::xml_node xmlDerivedRoot = xmlDerived.child("Prefab");
+
+         const char* prefabBaseName = xmlPrefabBase.value();
+         sprintf(sFilename, "%s.prefab", prefabBaseName);
+
+         xml.remove_child(xmlRoot);
+
+         Device::readContentFile(ContentType::GenericTextData, "Prefabs", sFilename, "xml", &content);
+         dataSize += content.getDataSize();
+         xml.load_buffer(content.getData(), content.getDataSize());
+         xmlRoot = xml.child("Prefab");
+
+         Entity::mergeXmlDescription(xmlRoot, xmlDerivedRoot);
+
+         xmlPrefabBase = xmlRoot.attribute("base");
+      }
+
+      setupEntity(xmlRoot, pEntity);
+   }
+   else
+   {
+      const ContentData& content = getPrefabData(pPrefabName);
+      dataSize = content.getDataSize();
+
+      ContentDataMemoryBuffer memoryBuffer(content);
+      std::istream stream(&memoryBuffer);
+      Value::fromStream(ValueType::ObjectName, stream);
+
+      setupEntity(stream, pEntity);
+   }
+
+   return dataSize;
+}
+
+void Scene::setupEntityFromTemplate(Entity* pEntity, Entity* pTemplate, GESTLVector(Entity*)* pBatchEntities)
+{
+   for(uint i = 0; i < pTemplate->getPropertiesCount(); i++)
+   {
+      const Property& sSourceProperty = pTemplate->getProperty(i);
+
+      if(!sSourceProperty.Setter || sSourceProperty.Name == Name)
+         continue;
+
+      const Property& sTargetProperty = pEntity->getProperty(i);
+      Value cSourcePropertyValue = sSourceProperty.Getter();
+      sTargetProperty.Setter(cSourcePropertyValue);
+   }
+
+   for(uint i = 0; i < (uint)ComponentType::Count; i++)
+   {
+      Component* cTemplateComponent = pTemplate->getComponent((ComponentType)i);
+
+      if(cTemplateComponent)
+      {
+         Component* cComponent = pEntity->getOrAddComponent(cTemplateComponent->getClassName());
+         cComponent->copy(cTemplateComponent);
+      }
+   }
+
+   for(uint i = 0; i < pTemplate->getChildrenCount(); i++)
+   {
+      Entity* cTemplateChild = pTemplate->getChildByIndex(i);
+
+      if(GEHasFlag(cTemplateChild->getInternalFlags(), Entity::InternalFlags::Generated))
+         continue;
+
+      Entity* cChild = pEntity->getChildByName(cTemplateChild->getName());
+
+      if(!cChild)
+      {
+         cChild = pBatchEntities
+            ? createBatchEntity(cTemplateChild->getName(), pEntity, pBatchEntities)
+            : addEntity(cTemplateChild->getName(), pEntity);
+      }
+
+      setupEntityFromTemplate(cChild, cTemplateChild, pBatchEntities);
+   }
+}
+
+ObjectName Scene::getInstanceName(const char* pPrefabName, Entity* pParent)
+{
+   char sEntityName[64];
+   ObjectName cEntityName;
+
+   do
+   {
+      sprintf(sEntityName, "%s_%u", pPrefabName, mBatchInstancesCount++);
+      cEntityName = ObjectName(sEntityName);
+   }
+   while(pParent ? pParent->getChildByName(cEntityName) != nullptr : getEntity(cEntityName) != nullptr);
+
+   return cEntityName;
+}
+
+Entity* Scene::acquirePooledPrefab(const char* pPrefabName, Entity* pParent)
+{
+   EntityPool& sPool = mEntityPools[ObjectName(pPrefabName).getID()];
+
+   while(!sPool.FreeEntities.empty())
+   {
+      // the entity might have been removed from the scene while it was in the pool
+      Entity* cEntity = Entity::fromHandle(sPool.FreeEntities.back());
+      sPool.FreeEntities.pop_back();
+
+      if(!cEntity)
+         continue;
+
+      sPool.Hits++;
+
+      if(cEntity->getParent() != pParent)
+      {
+         setEntityParent(cEntity, pParent);
+      }
+
+      // bring the entity back to the prefab state: what was added at runtime goes away, what was removed
+      // is added again, and the prefab values are restored, including the active flag of the prefab
+      Entity* prefabTemplate = acquirePrefabTemplate(pPrefabName);
+      stripEntityToTemplate(cEntity, prefabTemplate);
+      setupEntityFromTemplate(cEntity, prefabTemplate);
+      releasePrefabTemplate(pPrefabName);
+
+      initEntityTree(cEntity);
+      cEntity->setInternalFlags(cEntity->getInternalFlags() & ~(uint8_t)Entity::InternalFlags::Pooled);
+
+      return cEntity;
+   }
+
+   sPool.Misses++;
+
+   Entity* cEntity = addEntity(getInstanceName(pPrefabName, pParent), pParent);
+   setupEntityFromPrefab(cEntity, pPrefabName);
+   cEntity->init();
+
+   return cEntity;
+}
+
+bool Scene::releasePooledEntity(Entity* pEntity)
+{
+   if(pEntity->getOwner() != this || pEntity->getPrefabName().isEmpty())
+   {
+      Log::log(LogType::Error, "The '%s' entity cannot be released to the pool of the '%s' scene",
+         pEntity->getFullName().getString(), cName.getString());
+      return false;
+   }
+
+   // releasing twice would hand the same entity out to two owners
+   if(GEHasFlag(pEntity->getInternalFlags(), Entity::InternalFlags::Pooled))
+   {
+      Log::log(LogType::Warning, "The '%s' entity has already been released to the pool", pEntity->getFullName().getString());
+      return false;
+   }
+
+   pEntity->setActive(false);
+   pEntity->setInternalFlags(pEntity->getInternalFlags() | (uint8_t)Entity::InternalFlags::Pooled);
+   mEntityPools[pEntity->getPrefabName().getID()].FreeEntities.push_back(pEntity->getHandle());
+
+   return true;
+}
+
+void Scene::stripEntityToTemplate(Entity* pEntity, Entity* pTemplate)
+{
+   for(uint i = 0; i < (uint)ComponentType::Count; i++)
+   {
+      Component* cComponent = pEntity->getComponent((ComponentType)i);
+
+      if(!cComponent)
+         continue;
+
+      Component* cTemplateComponent = pTemplate->getComponent((ComponentType)i);
+
+      if(!cTemplateComponent || cTemplateComponent->getClassName() != cComponent->getClassName())
+      {
+         pEntity->removeComponent(cComponent->getClassName());
+      }
+   }
+
+   // the scripts that are kept start again from the prefab values, so they get to release what they set up
+   ComponentScript* cScript = pEntity->getComponent<ComponentScript>();
+
+   if(cScript)
+   {
+      for(uint32_t i = 0u; i < cScript->getScriptInstanceCount(); i++)
+      {
+         cScript->getScriptInstance(i)->releaseNamespace();
+      }
+   }
+
+   for(uint i = 0; i < pEntity->getChildrenCount(); i++)
+   {
+      Entity* cChild = pEntity->getChildByIndex(i);
+
+      if(GEHasFlag(cChild->getInternalFlags(), Entity::InternalFlags::Generated))
+         continue;
+
+      Entity* cTemplateChild = pTemplate->getChildByName(cChild->getName());
+
+      if(cTemplateChild)
+      {
+         stripEntityToTemplate(cChild, cTemplateChild);
+         continue;
+      }
+
+      // removed at the next safe point, like any other entity, and hidden until then
+      GEMutexLock(mSceneMutex);
+
+      if(std::find(mEntitiesToRemove.begin(), mEntitiesToRemove.end(), cChild) == mEntitiesToRemove.end())
+      {
+         mEntitiesToRemove.push_back(cChild);
+      }
+
+      GEMutexUnlock(mSceneMutex);
+
+      cChild->setActive(false);
+   }
+}
+
+void Scene::initEntityTree(Entity* pEntity)
+{
+   // entities added back from the template are not initialized yet
+   if(!pEntity->bInitialized)
+   {
+      pEntity->init();
+      return;
+   }
+
+   for(uint i = 0; i < pEntity->getChildrenCount(); i++)
+   {
+      initEntityTree(pEntity->getChildByIndex(i));
+   }
+}
+
+void Scene::prewarmEntityPool(const char* pPrefabName, uint32_t pCount)
+{
+   GEProfilerMarker("Scene::prewarmEntityPool()");
+
+   EntityPool& sPool = mEntityPools[ObjectName(pPrefabName).getID()];
+   sPool.FreeEntities.reserve(sPool.FreeEntities.size() + pCount);
+
+   for(uint32_t i = 0u; i < pCount; i++)
+   {
+      Entity* cEntity = addEntity(getInstanceName(pPrefabName, nullptr));
+      setupEntityFromPrefab(cEntity, pPrefabName);
+      cEntity->init();
+      cEntity->setActive(false);
+      cEntity->setInternalFlags(cEntity->getInternalFlags() | (uint8_t)Entity::InternalFlags::Pooled);
+
+      sPool.FreeEntities.push_back(cEntity->getHandle());
+   }
+}
+
+void Scene::setEntityPoolPrewarmCount(const char* pPrefabName, uint32_t pCount)
+{
+   EntityPool& sPool = mEntityPools[ObjectName(pPrefabName).getID()];
+   sPool.PrefabName = ObjectName(pPrefabName);
+   sPool.PrewarmCount = pCount;
+}
+
+void Scene::prewarmEntityPools()
+{
+   for(GESTLMap(uint32_t, EntityPool)::iterator it = mEntityPools.begin(); it != mEntityPools.end(); it++)
+   {
+      const EntityPool& sPool = it->second;
+      const uint32_t iAvailableCount = (uint32_t)sPool.FreeEntities.size();
+
+      if(sPool.PrewarmCount > iAvailableCount)
+      {
+         prewarmEntityPool(sPool.PrefabName.getString(), sPool.PrewarmCount - iAvailableCount);
+      }
+   }
+}
+
+EntityPoolStats Scene::getEntityPoolStats(const char* pPrefabName) const
+{
+   EntityPoolStats sStats;
+   GESTLMap(uint32_t, EntityPool)::const_iterator it = mEntityPools.find(ObjectName(pPrefabName).getID());
+
+   if(it != mEntityPools.end())
+   {
+      sStats.Hits = it->second.Hits;
+      sStats.Misses = it->second.Misses;
+      sStats.Available = (uint32_t)it->second.FreeEntities.size();
+   }
+
+   return sStats;
+}
+
+void Scene::countTemplateContents(Entity* pTemplate, uint32_t* pOutEntitiesCount,
+   uint32_t* pOutComponentsCount, GESTLMap(uint32_t, uint32_t)* pOutComponentsCountByClass)
+{
+   (*pOutEntitiesCount)++;
+
+   for(uint i = 0; i < (uint)ComponentType::Count; i++)
+   {
+      Component* cTemplateComponent = pTemplate->getComponent((ComponentType)i);
+
+      if(cTemplateComponent)
+      {
+         pOutComponentsCount[i]++;
+         (*pOutComponentsCountByClass)[cTemplateComponent->getClassName().getID()]++;
+      }
+   }
+
+   for(uint i = 0; i < pTemplate->getChildrenCount(); i++)
+   {
+      Entity* cTemplateChild = pTemplate->getChildByIndex(i);
+
+      if(!GEHasFlag(cTemplateChild->getInternalFlags(), Entity::InternalFlags::Generated))
+      {
+         countTemplateContents(cTemplateChild, pOutEntitiesCount, pOutComponentsCount, pOutComponentsCountByClass);
+      }
+   }
+}
+
+Entity* Scene::createBatchEntity(const ObjectName& pName, Entity* pParent, GESTLVector(Entity*)* pBatchEntities)
+{
+   // registered in the scene when the whole batch is set up
+   Entity* cEntity = Allocator::alloc<Entity>();
+   GEInvokeCtor(Entity, cEntity)(pName, pParent, this);
+   GEAssert(!getEntity(cEntity->getFullName()));
+
+   pBatchEntities->push_back(cEntity);
+
+   return cEntity;
+}
+
+void Scene::instantiatePrefabBatch(const char* pPrefabName, uint32_t pCount, const Matrix4* pTransforms,
+   Entity* pParent, GESTLVector(Entity*)* pOutEntities)
+{
+   GEProfilerMarker("Scene::instantiatePrefabBatch()");
+
+   Entity* prefabTemplate = acquirePrefabTemplate(pPrefabName);
+
+   if(!prefabTemplate)
+      return;
+
+   instantiateBatch(prefabTemplate, pPrefabName, ObjectName(pPrefabName), pCount, pTransforms, pParent, pOutEntities);
+   releasePrefabTemplate(pPrefabName);
+}
+
+void Scene::cloneEntityBatch(Entity* pEntity, uint32_t pCount, const Matrix4* pTransforms,
+   Entity* pParent, GESTLVector(Entity*)* pOutEntities)
+{
+   GEProfilerMarker("Scene::cloneEntityBatch()");
+
+   instantiateBatch(pEntity, pEntity->getName().getString(), pEntity->getPrefabName(), pCount, pTransforms, pParent, pOutEntities);
+}
+
+void Scene::instantiateBatch(Entity* pTemplate, const char* pNamePrefix, const ObjectName& pPrefabName, uint32_t pCount,
+   const Matrix4* pTransforms, Entity* pParent, GESTLVector(Entity*)* pOutEntities)
+{
+   uint32_t entitiesPerInstance = 0u;
+   uint32_t componentsPerInstance[(uint)ComponentType::Count];
+   GESTLMap(uint32_t, uint32_t) componentsPerInstanceByClass;
+   memset(componentsPerInstance, 0, sizeof(componentsPerInstance));
+   countTemplateContents(pTemplate, &entitiesPerInstance, componentsPerInstance, &componentsPerInstanceByClass);
+
+   // the instances are set up outside the scene, so neither other threads adding entities nor
+   // any listener can see them before they are complete
+   GESTLVector(Entity*) entities;
+   entities.reserve(entitiesPerInstance * pCount);
+
+   for(uint32_t i = 0u; i < pCount; i++)
+   {
+      Entity* cEntity = createBatchEntity(getInstanceName(pNamePrefix, pParent), pParent, &entities);
+      setupEntityFromTemplate(cEntity, pTemplate, &entities);
+
+      if(!pPrefabName.isEmpty())
+      {
+         cEntity->setPrefabName(pPrefabName);
+      }
+
+      if(pTransforms)
+      {
+         cEntity->getComponent<ComponentTransform>()->setLocalWorldMatrix(pTransforms[i]);
+      }
+
+      if(pOutEntities)
+      {
+         pOutEntities->push_back(cEntity);
+      }
+   }
+
+   // then the whole batch goes into the scene lists and the registry under a single lock, with the
+   // same order registerEntity and Entity::init would give one by one
+   GEMutexLock(mSceneMutex);
+
+   vEntities.reserve(vEntities.size() + entities.size());
+   mRegistry.reserve(mRegistry.getEntriesCount() + (uint32_t)entities.size());
+
+   for(uint i = 0; i < (uint)ComponentType::Count; i++)
+   {
+      if(componentsPerInstance[i] > 0u)
+      {
+         vComponents[i].reserve(vComponents[i].size() + componentsPerInstance[i] * pCount);
+      }
+   }
+
+   for(GESTLMap(uint32_t, uint32_t)::const_iterator it = componentsPerInstanceByClass.begin();
+      it != componentsPerInstanceByClass.end(); it++)
+   {
+      GESTLVector(Component*)& classList = mComponentsByClass[it->first];
+      classList.reserve(classList.size() + it->second * pCount);
+   }
+
+   for(size_t i = 0u; i < entities.size(); i++)
+   {
+      Entity* cEntity = entities[i];
+
+      if(cEntity->getParent())
+      {
+         cEntity->getParent()->addChild(cEntity);
+      }
+
+      cEntity->mSortKey = getBackSortKey();
+      addToList(vEntities, cEntity, &Entity::mSceneIndex);
+      mRegistry.add(cEntity->getFullName().getID(), cEntity);
+   }
+
+   for(size_t i = 0u; i < entities.size(); i++)
+   {
+      addEntityComponentsToLists(entities[i]);
+   }
+
+   GEMutexUnlock(mSceneMutex);
+
+   // a single notification for every entity of the batch, children included. EntityAdded is not
+   // triggered for the entities of a batch
+   EventArgs sEventArgs;
+   sEventArgs.Sender = this;
+   sEventArgs.Data = &entities;
+   triggerEvent(Events::EntitiesAdded, &sEventArgs);
+}
+
+SceneBackgroundMode Scene::getBackgroundMode() const
+{
+   return eBackgroundMode;
+}
+
+const char* Scene::getBackgroundMaterialName() const
+{
+   return cBackgroundMaterialName.getString();
+}
+
+Color Scene::getAmbientLightColor() const
+{
+   return RenderSystem::getInstance()
+      ? RenderSystem::getInstance()->getAmbientLightColor()
+      : Color();
+}
+
+float Scene::getShadowsMaxDistance() const
+{
+   return fShadowsMaxDistance;
+}
 
 void Scene::setBackgroundMode(SceneBackgroundMode BackgroundMode)
 {
@@ -845,10 +1730,150 @@ void Scene::setupSkyBox(const char* MaterialName)
    cBackgroundEntity->init();
 }
 
-void Scene::queueUpdateJobs()
+uint32_t Scene::queueTransformUpdateJobs()
+{
+   return mTransformStore.queueUpdateJobs();
+}
+
+void Scene::setUpdateLODSettings(UpdateLODGroup pGroup, const UpdateLODSettings& pSettings)
+{
+   GEAssert(pGroup < UpdateLODGroup::Count);
+   mUpdateLODSettings[(uint)pGroup] = pSettings;
+}
+
+const UpdateLODSettings& Scene::getUpdateLODSettings(UpdateLODGroup pGroup) const
+{
+   GEAssert(pGroup < UpdateLODGroup::Count);
+   return mUpdateLODSettings[(uint)pGroup];
+}
+
+bool Scene::updateLOD(UpdateLODGroup pGroup, Component* pComponent, float* pOutDeltaTime)
+{
+   const float fDeltaTime = pComponent->getOwner()->getClock()->getDelta();
+   const UpdateLODSettings& sSettings = mUpdateLODSettings[(uint)pGroup];
+   ComponentTransform* cTransform = pComponent->getOwner()->getComponent<ComponentTransform>();
+
+   if(!sSettings.Enabled || !mUpdateLODViewAvailable || !cTransform)
+   {
+      *pOutDeltaTime = fDeltaTime + pComponent->mUpdateLODDeltaTime;
+      pComponent->mUpdateLODDeltaTime = 0.0f;
+      return true;
+   }
+
+   const float fDistanceSquared = (cTransform->getWorldPosition() - mUpdateLODViewPosition).getSquaredLength();
+   uint32_t iTier = 0u;
+
+   while(iTier + 1u < UpdateLODSettings::TiersCount &&
+      fDistanceSquared >= sSettings.TierDistances[iTier + 1u] * sSettings.TierDistances[iTier + 1u])
+   {
+      iTier++;
+   }
+
+   pComponent->mUpdateLODDeltaTime += fDeltaTime;
+
+   uint32_t iFrameInterval = std::max(sSettings.TierFrameIntervals[iTier], 1u);
+
+   if(sSettings.OffscreenFrameInterval > iFrameInterval && !isVisibleForUpdateLOD(pComponent))
+   {
+      iFrameInterval = sSettings.OffscreenFrameInterval;
+   }
+
+   // the scene index staggers the components of the same tier across frames
+
+   if((TaskManager::getInstance()->getFrameCounter() + pComponent->mSceneIndex) % iFrameInterval != 0u)
+   {
+      return false;
+   }
+
+   *pOutDeltaTime = pComponent->mUpdateLODDeltaTime;
+   pComponent->mUpdateLODDeltaTime = 0.0f;
+   return true;
+}
+
+bool Scene::isVisibleForUpdateLOD(Component* pComponent) const
+{
+   // components without anything to render on their entity cannot be told to be off screen
+   ComponentRenderable* cRenderable = pComponent->getOwner()->getComponent<ComponentRenderable>();
+   BoundingBox sWorldBounds;
+
+   if(!cRenderable || !cRenderable->getWorldBounds(&sWorldBounds))
+      return true;
+
+   return mUpdateLODFrustum.intersects(sWorldBounds);
+}
+
+void Scene::registerUpdateSystems()
+{
+   const uint32_t transforms = (uint32_t)UpdateResource::Transforms;
+   const uint32_t cameras = (uint32_t)UpdateResource::Cameras;
+
+   mUpdateScheduler.registerSystem(ObjectName("Skeletons"),
+      transforms, transforms | (uint32_t)UpdateResource::SkeletonPoses,
+      UpdateExecution::Jobs, [this] { return updateSkeletons(); });
+   mUpdateScheduler.registerSystem(ObjectName("ParticleSystems"),
+      transforms | cameras, (uint32_t)UpdateResource::Particles,
+      UpdateExecution::Jobs, [this] { return updateParticleSystems(); });
+   mUpdateScheduler.registerSystem(ObjectName("AudioComponents"),
+      transforms, (uint32_t)UpdateResource::Audio,
+      UpdateExecution::Jobs, [this] { return updateAudioComponents(); });
+#if defined (GE_SCENE_JOBIFIED_UPDATE) && defined (GE_SCRIPT_INSTANCE_JOBIFIED_UPDATE)
+   mUpdateScheduler.registerSystem(ObjectName("ThreadSafeScripts"),
+      transforms, (uint32_t)UpdateResource::Scripts,
+      UpdateExecution::Jobs, [this] { return updateThreadSafeScripts(); });
+#endif
+   mUpdateScheduler.registerSystem(ObjectName("Background"),
+      cameras, transforms,
+      UpdateExecution::MainThread, [this] { return updateBackground(); });
+   mUpdateScheduler.registerSystem(ObjectName("Lights"),
+      0u, (uint32_t)UpdateResource::RenderQueues,
+      UpdateExecution::MainThread, [this] { return updateLights(); });
+   // non thread-safe scripts can access anything, unless all of them declare what they access
+   mScriptsSystemIndex = mUpdateScheduler.registerSystem(ObjectName("Scripts"),
+      (uint32_t)UpdateResource::All, (uint32_t)UpdateResource::All,
+      UpdateExecution::MainThread, [this] { return updateScripts(); });
+   mUpdateScheduler.registerSystem(ObjectName("Sprites"),
+      0u, (uint32_t)UpdateResource::Sprites,
+      UpdateExecution::MainThread, [this] { return updateSprites(); });
+   mUpdateScheduler.registerSystem(ObjectName("Cameras"),
+      transforms, cameras,
+      UpdateExecution::MainThread, [this] { return updateCameras(); });
+}
+
+void Scene::updateScriptsAccess()
 {
-   GEProfilerMarker("Scene::queueUpdateJobs()");
+   GESTLVector(Component*)& vScripts = vComponents[(uint)ComponentType::Script];
+   uint32_t iReadMask = 0u;
+   uint32_t iWriteMask = (uint32_t)UpdateResource::Scripts;
+
+   for(uint i = 0; i < vScripts.size(); i++)
+   {
+      ComponentScript* cScript = static_cast<ComponentScript*>(vScripts[i]);
+
+      if(!cScript->getOwner()->isActiveInHierarchy())
+         continue;
+
+      for(uint j = 0; j < cScript->getScriptInstanceCount(); j++)
+      {
+         ScriptInstance* cScriptInstance = cScript->getScriptInstance(j);
+
+#if defined (GE_SCENE_JOBIFIED_UPDATE) && defined (GE_SCRIPT_INSTANCE_JOBIFIED_UPDATE)
+         if(cScriptInstance->getThreadSafe())
+            continue;
+#endif
+         if(cScriptInstance->getActive())
+         {
+            iReadMask |= cScriptInstance->getUpdateReadMask();
+            iWriteMask |= cScriptInstance->getUpdateWriteMask();
+         }
+      }
+   }
+
+   // the stages are only rebuilt when the access changes
+   mUpdateScheduler.setSystemAccess(mScriptsSystemIndex, iReadMask, iWriteMask);
+}
 
+void Scene::flushPendingRemovals()
+{
    GEMutexLock(mSceneMutex);
 
    if(!mEntitiesToRemove.empty())
@@ -863,70 +1888,101 @@ void Scene::queueUpdateJobs()
       mRemovingEntities = false;
    }
 
+   // restore the iteration order after swap-and-pop removals
+   sortLists();
+
+   // no entity lookups are running at this point, so the registry can release memory
+   mRegistry.collectGarbage();
+
    GEMutexUnlock(mSceneMutex);
+}
 
-   // skeletons
+uint32_t Scene::updateSkeletons()
+{
    GESTLVector(Component*)& vSkeletons = vComponents[(uint)ComponentType::Skeleton];
+   uint32_t iJobsCount = 0u;
 
    for(uint i = 0; i < vSkeletons.size(); i++)
    {
       ComponentSkeleton* cSkeleton = static_cast<ComponentSkeleton*>(vSkeletons[i]);
+      float fDeltaTime = 0.0f;
 
-      if(cSkeleton->getOwner()->isActiveInHierarchy())
+      if(cSkeleton->getOwner()->isActiveInHierarchy() && updateLOD(UpdateLODGroup::Skeletons, cSkeleton, &fDeltaTime))
       {
 #if defined (GE_SCENE_JOBIFIED_UPDATE)
          JobDesc sJobDesc("UpdateSkeleton");
-         sJobDesc.Task = [cSkeleton] { cSkeleton->update(); };
-         TaskManager::getInstance()->queueJob(sJobDesc, JobType::Frame);
+         sJobDesc.Task = [cSkeleton, fDeltaTime] { cSkeleton->update(fDeltaTime); };
+         UpdateScheduler::queueJob(sJobDesc);
+         iJobsCount++;
 #else
-         cSkeleton->update();
+         cSkeleton->update(fDeltaTime);
 #endif
       }
    }
 
-   // particle systems
-   GESTLVector(Component*)& vRenderables = vComponents[(uint)ComponentType::Renderable];
+   return iJobsCount;
+}
+
+uint32_t Scene::updateParticleSystems()
+{
+   const GESTLVector(Component*)& vParticleSystems = getComponentsOfClass<ComponentParticleSystem>();
+   uint32_t iJobsCount = 0u;
 
-   for(uint i = 0; i < vRenderables.size(); i++)
+   for(uint i = 0; i < vParticleSystems.size(); i++)
    {
-      ComponentRenderable* cRenderable = static_cast<ComponentRenderable*>(vRenderables[i]);
+      ComponentParticleSystem* cParticleSystem = static_cast<ComponentParticleSystem*>(vParticleSystems[i]);
+      float fDeltaTime = 0.0f;
 
-      if(cRenderable->getVisible() &&
-         cRenderable->getClassName() == ComponentParticleSystem::ClassName &&
-         cRenderable->getOwner()->isActiveInHierarchy())
+      if(cParticleSystem->getVisible() &&
+         cParticleSystem->getOwner()->isActiveInHierarchy() &&
+         updateLOD(UpdateLODGroup::ParticleSystems, cParticleSystem, &fDeltaTime))
       {
-         ComponentParticleSystem* cParticleSystem = static_cast<ComponentParticleSystem*>(cRenderable);
 #if defined (GE_SCENE_JOBIFIED_UPDATE)
          JobDesc sJobDesc("UpdateParticleSystem");
-         sJobDesc.Task = [cParticleSystem] { cParticleSystem->update(); };
-         TaskManager::getInstance()->queueJob(sJobDesc, JobType::Frame);
+         sJobDesc.Task = [cParticleSystem, fDeltaTime] { cParticleSystem->update(fDeltaTime); };
+         UpdateScheduler::queueJob(sJobDesc);
+         iJobsCount++;
 #else
-         cParticleSystem->update();
+         cParticleSystem->update(fDeltaTime);
 #endif
       }
    }
 
-   // audio components
+   return iJobsCount;
+}
+
+uint32_t Scene::updateAudioComponents()
+{
    GESTLVector(Component*)& vAudioComponents = vComponents[(uint)ComponentType::Audio];
+   uint32_t iJobsCount = 0u;
 
    for(uint i = 0; i < vAudioComponents.size(); i++)
    {
       ComponentAudio* cAudioComponent = static_cast<ComponentAudio*>(vAudioComponents[i]);
+      float fDeltaTime = 0.0f;
 
-      if(cAudioComponent->getOwner()->isActiveInHierarchy())
+      // audio components work out their state from the audio system, so the accumulated time is not needed
+      if(cAudioComponent->getOwner()->isActiveInHierarchy() &&
+         updateLOD(UpdateLODGroup::AudioComponents, cAudioComponent, &fDeltaTime))
       {
 #if defined (GE_SCENE_JOBIFIED_UPDATE)
          JobDesc sJobDesc("UpdateAudioComponent");
          sJobDesc.Task = [cAudioComponent] { cAudioComponent->update(); };
-         TaskManager::getInstance()->queueJob(sJobDesc, JobType::Frame);
+         UpdateScheduler::queueJob(sJobDesc);
+         iJobsCount++;
 #else
          cAudioComponent->update();
 #endif
       }
    }
 
-#if defined (GE_SCENE_JOBIFIED_UPDATE) && defined (GE_SCRIPT_INSTANCE_JOBIFIED_UPDATE)
-   // thread-safe script instances
+   return iJobsCount;
+}
+
+uint32_t Scene::updateThreadSafeScripts()
+{
+   uint32_t iJobsCount = 0u;
+
    for(uint32_t jobIndex = 1u; jobIndex < Application::ScriptingEnvironmentsCount; jobIndex++)
    {
       JobDesc sJobDesc("UpdateScriptInstance");
@@ -953,16 +2009,15 @@ void Scene::queueUpdateJobs()
          }
       };
 
-      TaskManager::getInstance()->queueJob(sJobDesc, JobType::Frame);
+      UpdateScheduler::queueJob(sJobDesc);
+      iJobsCount++;
    }
-#endif
+
+   return iJobsCount;
 }
 
-void Scene::update()
+uint32_t Scene::updateBackground()
 {
-   GEProfilerMarker("Scene::update()");
-
-   // background
    if(cBackgroundEntity && RenderSystem::getInstance()->getActiveCamera())
    {
       ComponentCamera* cActiveCamera = RenderSystem::getInstance()->getActiveCamera();
@@ -970,7 +2025,11 @@ void Scene::update()
       cBackgroundEntity->getComponent<ComponentTransform>()->setPosition(vActiveCameraPosition);
    }
 
-   // lights
+   return 0u;
+}
+
+uint32_t Scene::updateLights()
+{
    GESTLVector(Component*)& vLights = vComponents[(uint)ComponentType::Light];
 
    for(uint i = 0; i < vLights.size(); i++)
@@ -978,14 +2037,20 @@ void Scene::update()
       RenderSystem::getInstance()->queueForRendering(static_cast<ComponentLight*>(vLights[i]));
    }
 
-   // non thread-safe script instances
+   return 0u;
+}
+
+uint32_t Scene::updateScripts()
+{
    GESTLVector(Component*)& vScripts = vComponents[(uint)ComponentType::Script];
 
    for(uint i = 0; i < vScripts.size(); i++)
    {
       ComponentScript* cScript = static_cast<ComponentScript*>(vScripts[i]);
+      float fDeltaTime = 0.0f;
 
-      if(cScript->getOwner()->isActiveInHierarchy())
+      // thread-safe script instances updated in jobs are not affected by the update LOD
+      if(cScript->getOwner()->isActiveInHierarchy() && updateLOD(UpdateLODGroup::Scripts, cScript, &fDeltaTime))
       {
          for(uint j = 0; j < cScript->getScriptInstanceCount(); j++)
          {
@@ -995,27 +2060,30 @@ void Scene::update()
             if(!cScriptInstance->getThreadSafe())
 #endif
             {
-               cScriptInstance->update();
+               cScriptInstance->update(fDeltaTime);
             }
          }
       }
    }
 
-   // sprites
-   GESTLVector(Component*)& vRenderables = vComponents[(uint)ComponentType::Renderable];
+   return 0u;
+}
 
-   for(uint i = 0; i < vRenderables.size(); i++)
-   {
-      ComponentRenderable* cRenderable = static_cast<ComponentRenderable*>(vRenderables[i]);
+uint32_t Scene::updateSprites()
+{
+   const GESTLVector(Component*)& vSprites = getComponentsOfClass<ComponentSprite>();
 
-      if(cRenderable->getClassName() == ComponentSprite::ClassName)
-      {
-         ComponentSprite* cSprite = static_cast<ComponentSprite*>(cRenderable);
-         cSprite->update();
-      }
+   for(uint i = 0; i < vSprites.size(); i++)
+   {
+      ComponentSprite* cSprite = static_cast<ComponentSprite*>(vSprites[i]);
+      cSprite->update();
    }
 
-   // cameras
+   return 0u;
+}
+
+uint32_t Scene::updateCameras()
+{
    GESTLVector(Component*)& vCameras = vComponents[(uint)ComponentType::Camera];
 
    for(uint i = 0; i < vCameras.size(); i++)
@@ -1027,40 +2095,105 @@ void Scene::update()
          cCamera->update();
       }
    }
+
+   return 0u;
+}
+
+void Scene::prepareUpdate()
+{
+   flushPendingRemovals();
+
+   // update LOD reference point
+   ComponentCamera* cActiveCamera = RenderSystem::getInstance()->getActiveCamera();
+   mUpdateLODViewAvailable = cActiveCamera != nullptr;
+
+   if(cActiveCamera)
+   {
+      mUpdateLODViewPosition = cActiveCamera->getTransform()->getWorldPosition();
+      mUpdateLODFrustum.extractPlanes(cActiveCamera->getViewProjectionMatrix());
+   }
+
+   updateScriptsAccess();
+}
+
+void Scene::update()
+{
+   Scene* cScene = this;
+   updateScenes(&cScene, 1u);
+}
+
+void Scene::updateScenes(Scene* const* pScenes, uint32_t pScenesCount)
+{
+   GEProfilerMarker("Scene::updateScenes()");
+
+   const uint32_t kMaxScenesCount = 8u;
+   GEAssert(pScenesCount <= kMaxScenesCount);
+
+   UpdateScheduler* cSchedulers[kMaxScenesCount];
+
+   for(uint32_t i = 0u; i < pScenesCount; i++)
+   {
+      pScenes[i]->prepareUpdate();
+      cSchedulers[i] = &pScenes[i]->mUpdateScheduler;
+   }
+
+   UpdateScheduler::execute(cSchedulers, pScenesCount);
 }
 
 void Scene::queueForRendering()
 {
    GEProfilerMarker("Scene::queueForRendering()");
 
-   GESTLVector(Component*)& uiElements = vComponents[(uint32_t)ComponentType::UIElement];
+   // immediate removals during the update may have altered the rendering order
+   GEMutexLock(mSceneMutex);
+   sortLists();
+   GEMutexUnlock(mSceneMutex);
 
-   for(size_t i = 0u; i < uiElements.size(); i++)
+   if(mStaticBatchesPending)
    {
-      if(uiElements[i]->getClassName() == ComponentUI3DCanvas::ClassName)
-      {
-         ComponentUI3DCanvas* canvas = static_cast<ComponentUI3DCanvas*>(uiElements[i]);
+      buildStaticBatches();
+      mStaticBatchesPending = false;
+   }
+   else
+   {
+      mStaticBatches.validate();
+   }
 
-         const uint32_t canvasIndex = (uint32_t)canvas->getCanvasIndex();
-         const Vector3& canvasWorldPosition =
-            canvas->getOwner()->getComponent<ComponentTransform>()->getWorldPosition();
-         const uint16_t canvasSettings = (uint16_t)canvas->getSettings();
+   const GESTLVector(Component*)& canvases = getComponentsOfClass<ComponentUI3DCanvas>();
 
-         RenderSystem::getInstance()->setup3DUICanvas(canvasIndex, canvasWorldPosition, canvasSettings);
-      }
+   for(size_t i = 0u; i < canvases.size(); i++)
+   {
+      ComponentUI3DCanvas* canvas = static_cast<ComponentUI3DCanvas*>(canvases[i]);
+
+      const uint32_t canvasIndex = (uint32_t)canvas->getCanvasIndex();
+      const Vector3& canvasWorldPosition =
+         canvas->getOwner()->getComponent<ComponentTransform>()->getWorldPosition();
+      const uint16_t canvasSettings = (uint16_t)canvas->getSettings();
+
+      RenderSystem::getInstance()->setup3DUICanvas(canvasIndex, canvasWorldPosition, canvasSettings);
    }
 
-   GESTLVector(Component*)& renderables = vComponents[(uint32_t)ComponentType::Renderable];
+   RenderSystem::getInstance()->queueForRendering(mStaticBatches);
+   RenderSystem::getInstance()->queueForRendering(vComponents[(uint32_t)ComponentType::Renderable]);
+}
+
+void Scene::buildStaticBatches()
+{
+   mStaticBatches.build(vComponents[(uint32_t)ComponentType::Renderable]);
+
+   const StaticBatchingReport& report = mStaticBatches.getReport();
 
-   for(size_t i = 0u; i < renderables.size(); i++)
+   if(report.BatchesCreated > 0u)
    {
-      ComponentRenderable* renderable = static_cast<ComponentRenderable*>(renderables[i]);
-      RenderSystem::getInstance()->queueForRendering(renderable, (uint32_t)i);
+      Log::log(LogType::Info, "Scene '%s': %u static batches built from %u renderables (%u vertices), %u draw calls saved",
+         getName().getString(), report.BatchesCreated, report.RenderablesBatched, report.VerticesBatched, report.DrawCallsSaved);
    }
 }
 
 void Scene::load(const char* Name)
 {
+   GEAssert(!mAsyncLoadingData);
+
    ContentData cContent;
 
    if(Application::ContentType == ApplicationContentType::Xml)
@@ -1094,6 +2227,205 @@ void Scene::load(const char* Name)
          cEntity->init();
       }
    }
+
+   prefetchScenePrefabData();
+   prewarmEntityPools();
+
+   mLoadingState = SceneLoadingState::Loaded;
+   mStaticBatchesPending = smStaticBatchingEnabled;
+}
+
+void Scene::loadAsync(const char* Name, bool pActivateWhenLoaded)
+{
+   GEAssert(!mAsyncLoadingData);
+
+   mAsyncLoadingData = Allocator::alloc<AsyncLoadingData>();
+   GEInvokeCtor(AsyncLoadingData, mAsyncLoadingData)();
+   mAsyncLoadingData->SceneName = Name;
+   mAsyncLoadingData->ActivateWhenLoaded = pActivateWhenLoaded;
+
+   mLoadingState = SceneLoadingState::Reading;
+   smLoadingScenes.push_back(this);
+
+   JobDesc sJobDesc("LoadScene");
+   sJobDesc.Task = [this] { readAsyncLoadingData(); };
+   TaskManager::getInstance()->queueJob(sJobDesc, JobType::General);
+}
+
+void Scene::readAsyncLoadingData()
+{
+   GEProfilerMarker("Scene::readAsyncLoadingData()");
+
+   AsyncLoadingData* sData = mAsyncLoadingData;
+   const char* sName = sData->SceneName.c_str();
+
+   if(sData->Cancelled.load(std::memory_order_relaxed))
+   {
+      // the scene is being destroyed and waits for this job to finish
+      finishReadingAsyncLoadingData();
+      return;
+   }
+
+   if(Application::ContentType == ApplicationContentType::Xml)
+   {
+      Device::readContentFile(ContentType::GenericTextData, "Scenes", sName, "scene.xml", &sData->Content);
+      sData->Xml.load_buffer(sData->Content.getData(), sData->Content.getDataSize());
+
+      const pugi::xml_node& xmlRoot = sData->Xml.child("Scene");
+      sData->NextXmlEntity = xmlRoot.child("Entity");
+
+      for(pugi::xml_node xmlEntity = sData->NextXmlEntity; xmlEntity; xmlEntity = xmlEntity.next_sibling("Entity"))
+      {
+         sData->RootEntitiesCount++;
+      }
+   }
+   else
+   {
+      Device::readContentFile(ContentType::GenericBinaryData, "Scenes", sName, "scene.ge", &sData->Content);
+
+      sData->MemoryBuffer = Allocator::alloc<ContentDataMemoryBuffer>();
+      GEInvokeCtor(ContentDataMemoryBuffer, sData->MemoryBuffer)(sData->Content);
+      sData->Stream.rdbuf(sData->MemoryBuffer);
+   }
+
+   // hand the data over to the main thread
+   finishReadingAsyncLoadingData();
+}
+
+void Scene::finishReadingAsyncLoadingData()
+{
+   // the state changes under the lock, so that a scene being destroyed cannot miss the signal. The
+   // scene may be released as soon as the lock is given back, so nothing is touched after that
+   AsyncLoadingData* sData = mAsyncLoadingData;
+
+   GEMutexLock(sData->ReadingMutex);
+   mLoadingState.store(SceneLoadingState::Instantiating, std::memory_order_release);
+   GEConditionVariableSignal(sData->ReadingDone);
+   GEMutexUnlock(sData->ReadingMutex);
+}
+
+bool Scene::instantiateAsyncLoadingData(Timer& pTimer, double pTimeBudget)
+{
+   AsyncLoadingData* sData = mAsyncLoadingData;
+   const bool bXml = Application::ContentType == ApplicationContentType::Xml;
+
+   if(!sData->PropertiesLoaded)
+   {
+      if(bXml)
+      {
+         loadFromXml(sData->Xml.child("Scene"));
+      }
+      else
+      {
+         loadFromStream(sData->Stream);
+         sData->RootEntitiesCount = (uint32_t)Value::fromStream(ValueType::Byte, sData->Stream).getAsByte();
+      }
+
+      sData->PropertiesLoaded = true;
+   }
+
+   // root entities are the unit of work, so at least one of them is instantiated per call
+   while(sData->RootEntitiesLoaded < sData->RootEntitiesCount)
+   {
+      Entity* cEntity = nullptr;
+
+      if(bXml)
+      {
+         cEntity = addEntity(sData->NextXmlEntity, 0);
+         sData->NextXmlEntity = sData->NextXmlEntity.next_sibling("Entity");
+      }
+      else
+      {
+         cEntity = addEntity(sData->Stream, 0);
+      }
+
+      cEntity->init();
+      sData->RootEntitiesLoaded++;
+
+      if(pTimer.getTime() >= pTimeBudget)
+      {
+         break;
+      }
+   }
+
+   return sData->RootEntitiesLoaded == sData->RootEntitiesCount;
+}
+
+void Scene::releaseAsyncLoadingData()
+{
+   if(mAsyncLoadingData->MemoryBuffer)
+   {
+      mAsyncLoadingData->Stream.rdbuf(nullptr);
+      GEInvokeDtor(ContentDataMemoryBuffer, mAsyncLoadingData->MemoryBuffer);
+      Allocator::free(mAsyncLoadingData->MemoryBuffer);
+   }
+
+   GEInvokeDtor(AsyncLoadingData, mAsyncLoadingData);
+   Allocator::free(mAsyncLoadingData);
+   mAsyncLoadingData = nullptr;
+}
+
+float Scene::getLoadingProgress() const
+{
+   const SceneLoadingState eLoadingState = mLoadingState;
+
+   if(eLoadingState == SceneLoadingState::Loaded)
+      return 1.0f;
+
+   if(eLoadingState != SceneLoadingState::Instantiating || !mAsyncLoadingData->PropertiesLoaded)
+      return 0.0f;
+
+   return mAsyncLoadingData->RootEntitiesCount > 0u
+      ? (float)mAsyncLoadingData->RootEntitiesLoaded / (float)mAsyncLoadingData->RootEntitiesCount
+      : 1.0f;
+}
+
+void Scene::updateAsyncLoading(double pTimeBudget)
+{
+   if(smLoadingScenes.empty())
+      return;
+
+   GEProfilerMarker("Scene::updateAsyncLoading()");
+
+   Timer cTimer;
+   cTimer.start();
+
+   for(size_t i = 0u; i < smLoadingScenes.size(); )
+   {
+      Scene* cScene = smLoadingScenes[i];
+
+      if(cScene->mLoadingState.load(std::memory_order_acquire) != SceneLoadingState::Instantiating)
+      {
+         i++;
+         continue;
+      }
+
+      if(!cScene->instantiateAsyncLoadingData(cTimer, pTimeBudget))
+      {
+         // out of time for this frame
+         break;
+      }
+
+      const bool bActivate = cScene->mAsyncLoadingData->ActivateWhenLoaded;
+
+      cScene->releaseAsyncLoadingData();
+      cScene->prefetchScenePrefabData();
+      cScene->prewarmEntityPools();
+      cScene->mLoadingState = SceneLoadingState::Loaded;
+      cScene->mStaticBatchesPending = smStaticBatchingEnabled;
+      smLoadingScenes.erase(smLoadingScenes.begin() + i);
+
+      // the scene becomes active in one step, once all its entities are in place
+      if(bActivate)
+      {
+         setActiveScene(cScene);
+      }
+
+      if(cTimer.getTime() >= pTimeBudget)
+      {
+         break;
+      }
+   }
 }
 
 Entity* Scene::addEntity(const pugi::xml_node& xmlEntity, Entity* cParent)
@@ -1113,8 +2445,6 @@ Entity* Scene::addEntity(const pugi::xml_node& xmlEntity, Entity* cParent)
 
    setupEntity(xmlEntity, cEntity);
 
-   cEntity->getComponent<ComponentTransform>()->updateWorldMatrix();
-
    return cEntity;
 }
 
@@ -1178,7 +2508,5 @@ Entity* Scene::addEntity(std::istream& Stream, Entity* cParent)
 
    setupEntity(Stream, cEntity);
 
-   cEntity->getComponent<ComponentTransform>()->updateWorldMatrix();
-
    return cEntity;
 }
@@ -15,16 +15,24 @@
 #include "Core/GEObject.h"
 #include "Core/GESerializable.h"
 #include "Core/GEThreads.h"
+#include "Core/GETimer.h"
 #include "Content/GEContentData.h"
 #include "GEComponentType.h"
+#include "GETransformStore.h"
+#include "GEEntityRegistry.h"
+#include "GEHandle.h"
+#include "GEUpdateScheduler.h"
+#include "Rendering/GEStaticBatching.h"
 #include "Externals/pugixml/pugixml.hpp"
 
 #include <atomic>
+#include <algorithm>
 
 namespace GE { namespace Entities
 {
    class Entity;
    class Component;
+   class ComponentRenderable;
 
 
    GESerializableEnum(SceneBackgroundMode)
@@ -36,20 +44,184 @@ namespace GE { namespace Entities
    };
 
 
+   enum class UpdateLODGroup
+   {
+      Skeletons,
+      ParticleSystems,
+      AudioComponents,
+      Scripts,
+
+      Count
+   };
+
+
+   struct UpdateLODSettings
+   {
+      static const uint32_t TiersCount = 4u;
+
+      // distance to the active camera where each tier begins, and number of frames between updates in the tier
+      float TierDistances[TiersCount];
+      uint32_t TierFrameIntervals[TiersCount];
+      // number of frames between updates for components whose renderable is outside the view frustum, when
+      // that is less often than their distance tier (0 leaves visibility out)
+      uint32_t OffscreenFrameInterval;
+      bool Enabled;
+
+      UpdateLODSettings()
+         : OffscreenFrameInterval(0u)
+         , Enabled(false)
+      {
+         for(uint32_t i = 0u; i < TiersCount; i++)
+         {
+            TierDistances[i] = i == 0u ? 0.0f : 20.0f * (float)(1u << (i - 1u));
+            TierFrameIntervals[i] = 1u << i;
+         }
+      }
+   };
+
+
+   struct EntityPoolStats
+   {
+      uint32_t Hits;
+      uint32_t Misses;
+      uint32_t Available;
+
+      EntityPoolStats() : Hits(0u), Misses(0u), Available(0u) {}
+   };
+
+
+   enum class SceneLoadingState
+   {
+      None,
+      Reading,
+      Instantiating,
+      Loaded
+   };
+
+
    class Scene : public Core::EventHandlingObject, public Core::Serializable
    {
    private:
       static Scene* cActiveScene;
       static Scene* cPermanentScene;
       static Scene* cDebuggingScene;
+      static Scene* cPrefabTemplatesScene;
 
-      static GESTLMap(uint32_t, Content::ContentData) smPrefabData;
+      struct PrefabData
+      {
+         GESTLString FileName;
+         Content::ContentData Content;
+         // prefab set up once from the data (with the base chain already merged), which instances are copied from
+         Entity* Template;
+         uint32_t TemplateUsers;
+         uint32_t ResidentSize;
+         uint32_t LastUse;
+         // data registered by the application instead of read from a file, which is never evicted
+         bool Registered;
+
+         PrefabData()
+            : Template(nullptr)
+            , TemplateUsers(0u)
+            , ResidentSize(0u)
+            , LastUse(0u)
+            , Registered(false)
+         {
+         }
+      };
+
+      // prefab files are listed at startup, loaded on first use and evicted in LRU order to stay under the budget,
+      // along with their templates. Once the template is built, it replaces the raw data in the budget. Instances
+      // can be set up from any thread, so the entries are guarded by a mutex
+      static GESTLMap(uint32_t, PrefabData) smPrefabData;
+      static uint32_t smPrefabDataUseCounter;
+      static uint32_t smPrefabDataResidentSize;
+      static uint32_t smPrefabDataBudget;
+      static GEMutex smPrefabDataMutex;
+      static const GESTLVector(Component*) smEmptyComponentList;
+
+      struct AsyncLoadingData
+      {
+         GESTLString SceneName;
+         Content::ContentData Content;
+         pugi::xml_document Xml;
+         pugi::xml_node NextXmlEntity;
+         Content::ContentDataMemoryBuffer* MemoryBuffer;
+         std::istream Stream;
+         uint32_t RootEntitiesCount;
+         uint32_t RootEntitiesLoaded;
+         bool PropertiesLoaded;
+         bool ActivateWhenLoaded;
+         std::atomic<bool> Cancelled;
+         // signaled by the reading job once it is done with the scene
+         GEMutex ReadingMutex;
+         GEConditionVariable ReadingDone;
+
+         AsyncLoadingData()
+            : MemoryBuffer(nullptr)
+            , Stream(nullptr)
+            , RootEntitiesCount(0u)
+            , RootEntitiesLoaded(0u)
+            , PropertiesLoaded(false)
+            , ActivateWhenLoaded(false)
+            , Cancelled(false)
+         {
+            GEMutexInit(ReadingMutex);
+            GEConditionVariableInit(ReadingDone);
+         }
+         ~AsyncLoadingData()
+         {
+            GEConditionVariableDestroy(ReadingDone);
+            GEMutexDestroy(ReadingMutex);
+         }
+      };
+
+      static GESTLVector(Scene*) smLoadingScenes;
+      static bool smStaticBatchingEnabled;
+      static bool smPrefabTemplatesEnabled;
 
       GESTLVector(Entity*) vEntities;
-      GESTLMap(uint, Entity*) mRegistry;
+      EntityRegistry mRegistry;
       GESTLVector(Component*) vComponents[(uint)ComponentType::Count];
+      GESTLMap(uint32_t, GESTLVector(Component*)) mComponentsByClass;
+      TransformStore mTransformStore;
+      UpdateScheduler mUpdateScheduler;
+      uint32_t mScriptsSystemIndex;
+
+      // lists are kept in ascending sort key order, which removals break until the next sort. Only the
+      // lists that lost an element are sorted again: component types are tracked with one bit each, and
+      // component classes by name ID
+      uint32_t mFirstSortKey;
+      uint32_t mLastSortKey;
+      bool mEntitiesOrderDirty;
+      uint32_t mComponentTypesOrderDirty;
+      GESTLVector(uint32_t) mComponentClassesOrderDirty;
 
       GESTLVector(Entity*) mEntitiesToRemove;
+
+      // each scene has its own settings, since the right distances depend on the scale of its content. The
+      // reference point and the frustum are taken from the active camera at the beginning of the update
+      UpdateLODSettings mUpdateLODSettings[(uint)UpdateLODGroup::Count];
+      Vector3 mUpdateLODViewPosition;
+      Rendering::Frustum mUpdateLODFrustum;
+      bool mUpdateLODViewAvailable;
+
+      // inactive prefab instances ready to be reused, keyed by prefab name
+      struct EntityPool
+      {
+         GESTLVector(EntityHandle) FreeEntities;
+         Core::ObjectName PrefabName;
+         // entities the pool is filled up to once the scene is loaded
+         uint32_t PrewarmCount;
+         uint32_t Hits;
+         uint32_t Misses;
+
+         EntityPool() : PrewarmCount(0u), Hits(0u), Misses(0u) {}
+      };
+
+      GESTLMap(uint32_t, EntityPool) mEntityPools;
+
+      // counter for the names of the instances created by batches and pools
+      uint32_t mBatchInstancesCount;
       std::atomic<bool> mRemovingEntities;
 
       SceneBackgroundMode eBackgroundMode;
@@ -60,11 +232,86 @@ namespace GE { namespace Entities
 
       GEMutex mSceneMutex;
 
+      // asynchronous loading: the scene file is read and parsed by a general job, then the root entities
+      // are instantiated on the main thread across as many frames as the time budget requires
+      std::atomic<SceneLoadingState> mLoadingState;
+      AsyncLoadingData* mAsyncLoadingData;
+
+      // static meshes merged once the scene is loaded, built on the first frame it is rendered,
+      // when the world transforms of its entities are up to date
+      Rendering::StaticBatchSet mStaticBatches;
+      bool mStaticBatchesPending;
+
       static void saveEntityContents(std::ostream& pStream, Entity* pEntity);
 
       void registerEntity(Entity* cEntity);
       void removeEntity(Entity* cEntity);
       void removeEntityRecursively(Entity* cEntity);
+      void releaseRenderable(ComponentRenderable* pRenderable);
+
+      uint32_t getFrontSortKey();
+      uint32_t getBackSortKey();
+      void renumberSortKeys();
+      void setComponentOrderDirty(ComponentType pType, Component* pComponent);
+      void sortLists();
+      void buildStaticBatches();
+
+      bool updateLOD(UpdateLODGroup pGroup, Component* pComponent, float* pOutDeltaTime);
+      bool isVisibleForUpdateLOD(Component* pComponent) const;
+
+      // update systems, which return the number of frame jobs they have queued
+      void registerUpdateSystems();
+      void updateScriptsAccess();
+      void prepareUpdate();
+      uint32_t updateSkeletons();
+      uint32_t updateParticleSystems();
+      uint32_t updateAudioComponents();
+      uint32_t updateThreadSafeScripts();
+      uint32_t updateBackground();
+      uint32_t updateLights();
+      uint32_t updateScripts();
+      uint32_t updateSprites();
+      uint32_t updateCameras();
+
+      template<typename T>
+      static void addToList(GESTLVector(T*)& pList, T* pElement, uint32_t T::* pIndex)
+      {
+         pElement->*pIndex = (uint32_t)pList.size();
+         pList.push_back(pElement);
+      }
+
+      template<typename T>
+      static bool removeFromList(GESTLVector(T*)& pList, T* pElement, uint32_t T::* pIndex)
+      {
+         const uint32_t index = pElement->*pIndex;
+
+         if(index >= pList.size() || pList[index] != pElement)
+            return false;
+
+         // swap and pop
+         T* lastElement = pList.back();
+         pList[index] = lastElement;
+         lastElement->*pIndex = index;
+         pList.pop_back();
+
+         return true;
+      }
+
+      template<typename T>
+      static void sortList(GESTLVector(T*)& pList, uint32_t T::* pIndex)
+      {
+         const auto compareSortKeys = [](const T* pA, const T* pB) { return pA->mSortKey < pB->mSortKey; };
+
+         if(std::is_sorted(pList.begin(), pList.end(), compareSortKeys))
+            return;
+
+         std::sort(pList.begin(), pList.end(), compareSortKeys);
+
+         for(uint32_t i = 0u; i < (uint32_t)pList.size(); i++)
+         {
+            pList[i]->*pIndex = i;
+         }
+      }
 
       Entity* addEntity(const pugi::xml_node& xmlEntity, Entity* cParent);
       void setupEntity(const pugi::xml_node& xmlEntity, Entity* cEntity);
@@ -72,12 +319,46 @@ namespace GE { namespace Entities
 
       Entity* addEntity(std::istream& Stream, Entity* cParent);
 
+      static const Content::ContentData& getPrefabData(const char* pPrefabName);
+      static const Content::ContentData& getPrefabData(uint32_t pPrefabNameHash);
+      static void prefetchPrefabEntry(uint32_t pPrefabNameHash);
+      void prefetchScenePrefabData();
+      void prewarmEntityPools();
+      static void evictPrefabData(uint32_t pPrefabNameHashToKeep);
+      static void releasePrefabEntry(PrefabData* pPrefabData);
+      static Entity* acquirePrefabTemplate(const char* pPrefabName);
+      static void releasePrefabTemplate(const char* pPrefabName);
+      uint32_t setupEntityFromPrefabData(Entity* pEntity, const char* pPrefabName);
+      void setupEntityFromTemplate(Entity* pEntity, Entity* pTemplate, GESTLVector(Entity*)* pBatchEntities = nullptr);
+      Core::ObjectName getInstanceName(const char* pPrefabName, Entity* pParent);
+      static void countTemplateContents(Entity* pTemplate, uint32_t* pOutEntitiesCount,
+         uint32_t* pOutComponentsCount, GESTLMap(uint32_t, uint32_t)* pOutComponentsCountByClass);
+      void stripEntityToTemplate(Entity* pEntity, Entity* pTemplate);
+      static void initEntityTree(Entity* pEntity);
+      Entity* createBatchEntity(const Core::ObjectName& pName, Entity* pParent, GESTLVector(Entity*)* pBatchEntities);
+      void instantiateBatch(Entity* pTemplate, const char* pNamePrefix, const Core::ObjectName& pPrefabName, uint32_t pCount,
+         const Matrix4* pTransforms, Entity* pParent, GESTLVector(Entity*)* pOutEntities);
+
+      void addComponentToLists(ComponentType pType, Component* pComponent);
+      void addEntityComponentsToLists(Entity* pEntity);
+
+      void readAsyncLoadingData();
+      void finishReadingAsyncLoadingData();
+      bool instantiateAsyncLoadingData(Core::Timer& pTimer, double pTimeBudget);
+      void releaseAsyncLoadingData();
+
    public:
       Scene(const Core::ObjectName& Name);
       ~Scene();
 
       static void loadPrefabData();
       static void unloadPrefabData();
+      static void releasePrefabTemplates();
+      static void prefetchPrefabData(const char* pPrefabName);
+      static void setPrefabDataBudget(uint32_t pBytes);
+      // registered data is in the binary format, whatever the content type of the application
+      static void registerPrefabData(const char* pPrefabName, const char* pData, uint32_t pDataSize);
+      static uint32_t getPrefabDataResidentSize() { return smPrefabDataResidentSize; }
 
       static void initStaticScenes();
       static void releaseStaticScenes();
@@ -90,6 +371,16 @@ namespace GE { namespace Entities
 
       static void saveEntity(std::ostream& pStream, Entity* pEntity);
 
+      void setUpdateLODSettings(UpdateLODGroup pGroup, const UpdateLODSettings& pSettings);
+      const UpdateLODSettings& getUpdateLODSettings(UpdateLODGroup pGroup) const;
+
+      static void setStaticBatchingEnabled(bool pEnabled) { smStaticBatchingEnabled = pEnabled; }
+      static bool getStaticBatchingEnabled() { return smStaticBatchingEnabled; }
+
+      // with templates disabled, setupEntityFromPrefab parses the prefab data for every instance
+      static void setPrefabTemplatesEnabled(bool pEnabled) { smPrefabTemplatesEnabled = pEnabled; }
+      static bool getPrefabTemplatesEnabled() { return smPrefabTemplatesEnabled; }
+
       Entity* addEntity(const Core::ObjectName& Name, Entity* cParent = 0);
       Entity* getEntity(const Core::ObjectName& FullName);
       bool removeEntity(const Core::ObjectName& FullName);
@@ -106,13 +397,12 @@ namespace GE { namespace Entities
       template<typename T>
       void registerComponent(Component* cComponent)
       {
-         GEAssert(cComponent);
-         GEMutexLock(mSceneMutex);
-         vComponents[(uint)T::getType()].push_back(cComponent);
-         GEMutexUnlock(mSceneMutex);
+         registerComponent(T::getType(), cComponent);
       }
 
       void registerComponent(ComponentType pType, Component* pComponent);
+      // registers every component of the entity under a single lock, and marks the entity as initialized
+      void registerEntityComponents(Entity* pEntity);
       void removeComponent(ComponentType pType, Component* pComponent);
       void bringComponentToFront(ComponentType pType, Component* pComponent);
       void sendComponentToBack(ComponentType pType, Component* pComponent);
@@ -125,8 +415,28 @@ namespace GE { namespace Entities
 
       const GESTLVector(Component*)& getComponents(ComponentType pType);
 
+      template<typename T>
+      const GESTLVector(Component*)& getComponentsOfClass()
+      {
+         return getComponentsOfClass(T::ClassName);
+      }
+
+      const GESTLVector(Component*)& getComponentsOfClass(const Core::ObjectName& pClassName);
+
+      TransformStore& getTransformStore() { return mTransformStore; }
+
       Entity* addPrefab(const char* PrefabName, const Core::ObjectName& EntityName, Entity* cParent = 0);
       void setupEntityFromPrefab(Entity* pEntity, const char* pPrefabName, bool pIncludeRootTransform = true);
+      Entity* acquirePooledPrefab(const char* pPrefabName, Entity* pParent = nullptr);
+      bool releasePooledEntity(Entity* pEntity);
+      void prewarmEntityPool(const char* pPrefabName, uint32_t pCount);
+      void setEntityPoolPrewarmCount(const char* pPrefabName, uint32_t pCount);
+      EntityPoolStats getEntityPoolStats(const char* pPrefabName) const;
+
+      void instantiatePrefabBatch(const char* pPrefabName, uint32_t pCount, const Matrix4* pTransforms = nullptr,
+         Entity* pParent = nullptr, GESTLVector(Entity*)* pOutEntities = nullptr);
+      void cloneEntityBatch(Entity* pEntity, uint32_t pCount, const Matrix4* pTransforms = nullptr,
+         Entity* pParent = nullptr, GESTLVector(Entity*)* pOutEntities = nullptr);
 
       SceneBackgroundMode getBackgroundMode() const;
       const char* getBackgroundMaterialName() const;
@@ -143,10 +453,24 @@ namespace GE { namespace Entities
 
       bool isRemovingEntities() const { return mRemovingEntities; }
 
-      void queueUpdateJobs();
+      uint32_t queueTransformUpdateJobs();
+      void flushPendingRemovals();
       void update();
       void queueForRendering();
 
+      // runs the update systems of several scenes together, so that they share the stages
+      static void updateScenes(Scene* const* pScenes, uint32_t pScenesCount);
+
       void load(const char* FileName);
+      void loadAsync(const char* FileName, bool pActivateWhenLoaded = true);
+
+      SceneLoadingState getLoadingState() const { return mLoadingState; }
+      const Rendering::StaticBatchingReport& getStaticBatchingReport() const { return mStaticBatches.getReport(); }
+      // builds the static batches before the scene is next queued for rendering, for scenes not loaded from content
+      void requestStaticBatchesBuild() { mStaticBatchesPending = smStaticBatchingEnabled; }
+      float getLoadingProgress() const;
+
+      // instantiates entities of scenes being loaded asynchronously for up to the given time (in microseconds)
+      static void updateAsyncLoading(double pTimeBudget);
    };
 }}
@@ -0,0 +1,467 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Entities
+//
+//  --- GETransformStore.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "GETransformStore.h"
+#include "GEComponentTransform.h"
+#include "GEEntity.h"
+#include "GEUpdateScheduler.h"
+#include "Core/GEAllocator.h"
+#include "Core/GEDevice.h"
+#include "Core/GEProfiler.h"
+#include "Core/GETaskManager.h"
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+
+//
+//  TransformStore
+//
+TransformStore::TransformStore()
+   : mPagesCount(0u)
+   , mEntriesCount(0u)
+   , mUpdateOrderDirty(false)
+{
+   memset(mPages, 0, sizeof(mPages));
+   GEMutexInit(mMutex);
+}
+
+TransformStore::~TransformStore()
+{
+   for(uint32_t i = 0u; i < mPagesCount; i++)
+   {
+      GEInvokeDtor(Page, mPages[i]);
+      Allocator::free(mPages[i]);
+   }
+
+   GEMutexDestroy(mMutex);
+}
+
+uint32_t TransformStore::getTransformIndex(ComponentTransform* pTransform) const
+{
+   return pTransform ? pTransform->getStoreIndex() : InvalidIndex;
+}
+
+uint32_t TransformStore::add(ComponentTransform* pOwner)
+{
+   GEAssert(pOwner);
+
+   Entity* entity = pOwner->getOwner();
+   Entity* parent = entity->getParent();
+   const uint32_t parentIndex = parent ? getTransformIndex(parent->getComponent<ComponentTransform>()) : InvalidIndex;
+
+   GEMutexLock(mMutex);
+
+   uint32_t index = InvalidIndex;
+
+   if(!mFreeEntries.empty())
+   {
+      index = mFreeEntries.back();
+      mFreeEntries.pop_back();
+      mUpdateOrderDirty = true;
+   }
+   else
+   {
+      if((mEntriesCount >> PageSizeBits) == mPagesCount)
+      {
+         GEAssert(mPagesCount < MaxPages);
+         mPages[mPagesCount] = Allocator::alloc<Page>();
+         GEInvokeCtor(Page, mPages[mPagesCount]);
+         mPagesCount++;
+      }
+
+      index = mEntriesCount++;
+
+      // a new root at the end of the store keeps the update order valid
+      if(!mUpdateOrderDirty && parentIndex == InvalidIndex)
+      {
+         mRootOffsets.push_back((uint32_t)mUpdateOrder.size());
+         mUpdateOrder.push_back(index);
+      }
+      else
+      {
+         mUpdateOrderDirty = true;
+      }
+   }
+
+   Page* page = getPage(index);
+   const uint32_t entry = index & PageIndexMask;
+
+   page->Positions[entry] = Vector3::Zero;
+   page->Rotations[entry] = Rotation();
+   page->Scales[entry] = Vector3::One;
+   page->Owners[entry] = pOwner;
+   page->Parents[entry] = parentIndex;
+   page->ChildrenCounts[entry] = 0u;
+   page->Flags[entry] = 0u;
+   GESetFlag(page->Flags[entry], EntryFlags::LocalDirty);
+   GESetFlag(page->Flags[entry], EntryFlags::WorldDirty);
+   GESetFlag(page->Flags[entry], EntryFlags::WorldTRSDirty);
+
+   if(parentIndex != InvalidIndex)
+   {
+      getPage(parentIndex)->ChildrenCounts[parentIndex & PageIndexMask]++;
+   }
+
+   GEMutexUnlock(mMutex);
+
+   // children whose transforms were added before this one
+   for(uint32_t i = 0u; i < entity->getChildrenCount(); i++)
+   {
+      ComponentTransform* childTransform = entity->getChildByIndex(i)->getComponent<ComponentTransform>();
+
+      if(childTransform)
+      {
+         setParent(childTransform->getStoreIndex(), index);
+      }
+   }
+
+   return index;
+}
+
+void TransformStore::remove(uint32_t pIndex)
+{
+   GEMutexLock(mMutex);
+
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   const uint32_t parentIndex = page->Parents[entry];
+
+   if(parentIndex != InvalidIndex)
+   {
+      getPage(parentIndex)->ChildrenCounts[parentIndex & PageIndexMask]--;
+   }
+
+   // children still registered become roots, since the released entry can be handed out again.
+   // Entities remove their children first, so this only happens when the transform alone goes away
+   GESTLVector(uint32_t) orphanedEntries;
+
+   for(uint32_t i = 0u; i < mEntriesCount && page->ChildrenCounts[entry] > 0u; i++)
+   {
+      Page* childPage = getPage(i);
+      const uint32_t childEntry = i & PageIndexMask;
+
+      if(childPage->Owners[childEntry] && childPage->Parents[childEntry] == pIndex)
+      {
+         childPage->Parents[childEntry] = InvalidIndex;
+         page->ChildrenCounts[entry]--;
+         orphanedEntries.push_back(i);
+         mUpdateOrderDirty = true;
+      }
+   }
+
+   // the update order stays valid, since released entries are never dirty and get skipped
+   page->Owners[entry] = nullptr;
+   page->Parents[entry] = InvalidIndex;
+   page->ChildrenCounts[entry] = 0u;
+   page->Flags[entry] = 0u;
+
+   mFreeEntries.push_back(pIndex);
+
+   GEMutexUnlock(mMutex);
+
+   for(size_t i = 0u; i < orphanedEntries.size(); i++)
+   {
+      Page* childPage = getPage(orphanedEntries[i]);
+      GEResetFlag(childPage->Flags[orphanedEntries[i] & PageIndexMask], EntryFlags::WorldDirty);
+      invalidateWorldMatrix(orphanedEntries[i]);
+   }
+}
+
+void TransformStore::setParent(uint32_t pIndex, uint32_t pParentIndex)
+{
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   GEMutexLock(mMutex);
+
+   const uint32_t previousParentIndex = page->Parents[entry];
+
+   if(previousParentIndex != InvalidIndex)
+   {
+      getPage(previousParentIndex)->ChildrenCounts[previousParentIndex & PageIndexMask]--;
+   }
+
+   if(pParentIndex != InvalidIndex)
+   {
+      getPage(pParentIndex)->ChildrenCounts[pParentIndex & PageIndexMask]++;
+   }
+
+   page->Parents[entry] = pParentIndex;
+   mUpdateOrderDirty = true;
+
+   GEMutexUnlock(mMutex);
+
+   GEResetFlag(page->Flags[entry], EntryFlags::WorldDirty);
+   invalidateWorldMatrix(pIndex);
+}
+
+void TransformStore::invalidateWorldMatrix(uint32_t pIndex)
+{
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   // if the entry is already dirty, all its descendants are dirty as well
+   if(GEHasFlag(page->Flags[entry], EntryFlags::WorldDirty))
+      return;
+
+   GESetFlag(page->Flags[entry], EntryFlags::WorldDirty);
+   GESetFlag(page->Flags[entry], EntryFlags::WorldTRSDirty);
+
+   Entity* entity = page->Owners[entry]->getOwner();
+
+   for(uint32_t i = 0u; i < entity->getChildrenCount(); i++)
+   {
+      ComponentTransform* childTransform = entity->getChildByIndex(i)->getComponent<ComponentTransform>();
+
+      if(childTransform)
+      {
+         invalidateWorldMatrix(childTransform->getStoreIndex());
+      }
+   }
+}
+
+void TransformStore::computeWorldMatrix(uint32_t pIndex, Matrix4* pOutWorldMatrix) const
+{
+   const uint32_t parentIndex = getPage(pIndex)->Parents[pIndex & PageIndexMask];
+   const Matrix4 localMatrix = getLocalMatrix(pIndex);
+
+   if(parentIndex != InvalidIndex)
+   {
+      const Matrix4 parentWorldMatrix = getWorldMatrix(parentIndex);
+      Matrix4Multiply(parentWorldMatrix, localMatrix, pOutWorldMatrix);
+   }
+   else
+   {
+      *pOutWorldMatrix = localMatrix;
+   }
+}
+
+void TransformStore::computeWorldTRS(uint32_t pIndex, Rotation* pOutWorldRotation, Vector3* pOutWorldScale) const
+{
+   const Matrix4 worldMatrix = getWorldMatrix(pIndex);
+
+   Vector3 worldPosition;
+   Geometry::extractTRSFromMatrix(worldMatrix, &worldPosition, pOutWorldRotation, pOutWorldScale);
+}
+
+void TransformStore::updateEntry(uint32_t pIndex)
+{
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   if(GEHasFlag(page->Flags[entry], EntryFlags::LocalDirty))
+   {
+      Geometry::createTRSMatrix(page->Positions[entry], page->Rotations[entry], page->Scales[entry],
+         &page->LocalMatrices[entry]);
+      GEResetFlag(page->Flags[entry], EntryFlags::LocalDirty);
+   }
+
+   if(GEHasFlag(page->Flags[entry], EntryFlags::WorldDirty))
+   {
+      // the parent precedes this entry in the update order, so it is already up to date
+      const uint32_t parentIndex = page->Parents[entry];
+
+      if(parentIndex != InvalidIndex)
+      {
+         const Matrix4& parentWorldMatrix = getPage(parentIndex)->WorldMatrices[parentIndex & PageIndexMask];
+         Matrix4Multiply(parentWorldMatrix, page->LocalMatrices[entry], &page->WorldMatrices[entry]);
+      }
+      else
+      {
+         page->WorldMatrices[entry] = page->LocalMatrices[entry];
+      }
+
+      GEResetFlag(page->Flags[entry], EntryFlags::WorldDirty);
+   }
+
+   if(GEHasFlag(page->Flags[entry], EntryFlags::WorldTRSDirty))
+   {
+      Vector3 worldPosition;
+      Geometry::extractTRSFromMatrix(page->WorldMatrices[entry],
+         &worldPosition, &page->WorldRotations[entry], &page->WorldScales[entry]);
+      GEResetFlag(page->Flags[entry], EntryFlags::WorldTRSDirty);
+   }
+}
+
+void TransformStore::setPosition(uint32_t pIndex, const Vector3& pPosition)
+{
+   GEValidateUpdateWriteAccess(UpdateResource::Transforms);
+
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   page->Positions[entry] = pPosition;
+   GESetFlag(page->Flags[entry], EntryFlags::LocalDirty);
+   invalidateWorldMatrix(pIndex);
+}
+
+void TransformStore::setRotation(uint32_t pIndex, const Rotation& pRotation)
+{
+   GEValidateUpdateWriteAccess(UpdateResource::Transforms);
+
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   page->Rotations[entry] = pRotation;
+   GESetFlag(page->Flags[entry], EntryFlags::LocalDirty);
+   invalidateWorldMatrix(pIndex);
+}
+
+void TransformStore::setScale(uint32_t pIndex, const Vector3& pScale)
+{
+   GEValidateUpdateWriteAccess(UpdateResource::Transforms);
+
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   page->Scales[entry] = pScale;
+   GESetFlag(page->Flags[entry], EntryFlags::LocalDirty);
+   invalidateWorldMatrix(pIndex);
+}
+
+void TransformStore::setLocalMatrix(uint32_t pIndex, const Matrix4& pLocalMatrix)
+{
+   GEValidateUpdateWriteAccess(UpdateResource::Transforms);
+
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   Geometry::extractTRSFromMatrix(pLocalMatrix,
+      &page->Positions[entry], &page->Rotations[entry], &page->Scales[entry]);
+   page->LocalMatrices[entry] = pLocalMatrix;
+   GEResetFlag(page->Flags[entry], EntryFlags::LocalDirty);
+   invalidateWorldMatrix(pIndex);
+}
+
+void TransformStore::reset(uint32_t pIndex)
+{
+   GEValidateUpdateWriteAccess(UpdateResource::Transforms);
+
+   Page* page = getPage(pIndex);
+   const uint32_t entry = pIndex & PageIndexMask;
+
+   page->Positions[entry] = Vector3::Zero;
+   page->Rotations[entry] = Rotation();
+   page->Scales[entry] = Vector3::One;
+   GESetFlag(page->Flags[entry], EntryFlags::LocalDirty);
+   invalidateWorldMatrix(pIndex);
+}
+
+void TransformStore::rebuildUpdateOrder()
+{
+   GEProfilerMarker("TransformStore::rebuildUpdateOrder()");
+
+   mUpdateOrder.clear();
+   mRootOffsets.clear();
+
+   GESTLVector(uint32_t) pendingEntries;
+
+   for(uint32_t i = 0u; i < mEntriesCount; i++)
+   {
+      Page* page = getPage(i);
+      const uint32_t entry = i & PageIndexMask;
+
+      if(!page->Owners[entry] || page->Parents[entry] != InvalidIndex)
+         continue;
+
+      mRootOffsets.push_back((uint32_t)mUpdateOrder.size());
+      pendingEntries.push_back(i);
+
+      // depth-first traversal, so that the whole subtree ends up contiguous in the update order
+      while(!pendingEntries.empty())
+      {
+         const uint32_t index = pendingEntries.back();
+         pendingEntries.pop_back();
+         mUpdateOrder.push_back(index);
+
+         Entity* entity = getPage(index)->Owners[index & PageIndexMask]->getOwner();
+
+         for(uint32_t j = entity->getChildrenCount(); j > 0u; j--)
+         {
+            ComponentTransform* childTransform = entity->getChildByIndex(j - 1u)->getComponent<ComponentTransform>();
+
+            if(childTransform)
+            {
+               pendingEntries.push_back(childTransform->getStoreIndex());
+            }
+         }
+      }
+   }
+
+   mUpdateOrderDirty = false;
+}
+
+void TransformStore::updateRootRange(uint32_t pFirstRoot, uint32_t pLastRoot)
+{
+   const uint32_t firstOffset = mRootOffsets[pFirstRoot];
+   const uint32_t lastOffset = pLastRoot < mRootOffsets.size()
+      ? mRootOffsets[pLastRoot]
+      : (uint32_t)mUpdateOrder.size();
+
+   for(uint32_t i = firstOffset; i < lastOffset; i++)
+   {
+      const uint32_t index = mUpdateOrder[i];
+
+      if(getPage(index)->Flags[index & PageIndexMask] != 0u)
+      {
+         updateEntry(index);
+      }
+   }
+}
+
+uint32_t TransformStore::queueUpdateJobs()
+{
+   GEProfilerMarker("TransformStore::queueUpdateJobs()");
+
+   if(mUpdateOrderDirty)
+   {
+      rebuildUpdateOrder();
+   }
+
+   const uint32_t rootsCount = (uint32_t)mRootOffsets.size();
+   const uint32_t entriesCount = (uint32_t)mUpdateOrder.size();
+
+   if(rootsCount == 0u)
+      return 0u;
+
+   const uint32_t workersCount = (uint32_t)GEMax(Device::getNumberOfCPUCores() - 1, 1);
+   const uint32_t entriesPerJob = GEMax(entriesCount / workersCount, MinEntriesPerJob);
+
+   if(entriesCount < entriesPerJob * 2u)
+   {
+      updateRootRange(0u, rootsCount);
+      return 0u;
+   }
+
+   // split the root subtrees into contiguous ranges, which can be updated independently
+   uint32_t jobsCount = 0u;
+   uint32_t firstRoot = 0u;
+
+   for(uint32_t i = 1u; i <= rootsCount; i++)
+   {
+      const uint32_t rangeEndOffset = i < rootsCount ? mRootOffsets[i] : entriesCount;
+
+      if(i == rootsCount || (rangeEndOffset - mRootOffsets[firstRoot]) >= entriesPerJob)
+      {
+         JobDesc jobDesc("UpdateTransforms");
+         jobDesc.Task = [this, firstRoot, i] { updateRootRange(firstRoot, i); };
+         TaskManager::getInstance()->queueJob(jobDesc, JobType::Frame);
+
+         firstRoot = i;
+         jobsCount++;
+      }
+   }
+
+   return jobsCount;
+}
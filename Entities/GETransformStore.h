@@ -0,0 +1,182 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Entities
+//
+//  --- GETransformStore.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Types/GETypes.h"
+#include "Types/GESTLTypes.h"
+#include "Core/GEGeometry.h"
+#include "Core/GEThreads.h"
+#include "Core/GEUtils.h"
+
+namespace GE { namespace Entities
+{
+   class ComponentTransform;
+
+
+   //
+   //  TransformStore
+   //
+   //  Scene-level storage for the local TRS and world matrices of all the transform components. Entries
+   //  are allocated in fixed-size pages, so their addresses never change while the transform is alive,
+   //  and the cached matrices are only written in a linear pass that walks an update order in which
+   //  parents always come before their children, so that reading them from parallel jobs is safe
+   //
+   class TransformStore : private Core::NonCopyable
+   {
+   public:
+      static const uint32_t InvalidIndex = 0xffffffffu;
+
+   private:
+      static const uint32_t PageSizeBits = 8u;
+      static const uint32_t PageSize = 1u << PageSizeBits;
+      static const uint32_t PageIndexMask = PageSize - 1u;
+      static const uint32_t MaxPages = 1024u;
+      static const uint32_t MinEntriesPerJob = 512u;
+
+      enum class EntryFlags : uint8_t
+      {
+         LocalDirty     = 1 << 0,
+         WorldDirty     = 1 << 1,
+         WorldTRSDirty  = 1 << 2,
+      };
+
+      struct Page
+      {
+         Vector3 Positions[PageSize];
+         Rotation Rotations[PageSize];
+         Vector3 Scales[PageSize];
+         Matrix4 LocalMatrices[PageSize];
+         Matrix4 WorldMatrices[PageSize];
+         // world rotation and scale, extracted from the world matrix in the update pass
+         Rotation WorldRotations[PageSize];
+         Vector3 WorldScales[PageSize];
+         ComponentTransform* Owners[PageSize];
+         uint32_t Parents[PageSize];
+         // registered entries that have this one as their parent
+         uint32_t ChildrenCounts[PageSize];
+         uint8_t Flags[PageSize];
+      };
+
+      Page* mPages[MaxPages];
+      uint32_t mPagesCount;
+      uint32_t mEntriesCount;
+      GESTLVector(uint32_t) mFreeEntries;
+
+      // entry indices sorted so that parents come before children, with each root subtree contiguous
+      GESTLVector(uint32_t) mUpdateOrder;
+      // offsets in the update order where each root subtree begins
+      GESTLVector(uint32_t) mRootOffsets;
+      bool mUpdateOrderDirty;
+
+      GEMutex mMutex;
+
+      inline Page* getPage(uint32_t pIndex) const
+      {
+         GEAssert((pIndex >> PageSizeBits) < mPagesCount);
+         return mPages[pIndex >> PageSizeBits];
+      }
+
+      uint32_t getTransformIndex(ComponentTransform* pTransform) const;
+
+      void invalidateWorldMatrix(uint32_t pIndex);
+      void computeWorldMatrix(uint32_t pIndex, Matrix4* pOutWorldMatrix) const;
+      void computeWorldTRS(uint32_t pIndex, Rotation* pOutWorldRotation, Vector3* pOutWorldScale) const;
+      void updateEntry(uint32_t pIndex);
+
+      void rebuildUpdateOrder();
+      void updateRootRange(uint32_t pFirstRoot, uint32_t pLastRoot);
+
+   public:
+      TransformStore();
+      ~TransformStore();
+
+      uint32_t add(ComponentTransform* pOwner);
+      void remove(uint32_t pIndex);
+      void setParent(uint32_t pIndex, uint32_t pParentIndex);
+
+      inline Vector3& getPosition(uint32_t pIndex)
+      {
+         return getPage(pIndex)->Positions[pIndex & PageIndexMask];
+      }
+      inline Rotation& getRotation(uint32_t pIndex)
+      {
+         return getPage(pIndex)->Rotations[pIndex & PageIndexMask];
+      }
+      inline Vector3& getScale(uint32_t pIndex)
+      {
+         return getPage(pIndex)->Scales[pIndex & PageIndexMask];
+      }
+
+      // the getters only read the store: the caches are refreshed in the update pass, and entries
+      // modified since then get their values computed on the fly without writing them back
+      inline Matrix4 getLocalMatrix(uint32_t pIndex) const
+      {
+         const Page* page = getPage(pIndex);
+         const uint32_t entry = pIndex & PageIndexMask;
+
+         if(!GEHasFlag(page->Flags[entry], EntryFlags::LocalDirty))
+            return page->LocalMatrices[entry];
+
+         Matrix4 localMatrix;
+         Core::Geometry::createTRSMatrix(page->Positions[entry], page->Rotations[entry], page->Scales[entry],
+            &localMatrix);
+         return localMatrix;
+      }
+      inline Matrix4 getWorldMatrix(uint32_t pIndex) const
+      {
+         const Page* page = getPage(pIndex);
+         const uint32_t entry = pIndex & PageIndexMask;
+
+         if(!GEHasFlag(page->Flags[entry], EntryFlags::WorldDirty))
+            return page->WorldMatrices[entry];
+
+         Matrix4 worldMatrix;
+         computeWorldMatrix(pIndex, &worldMatrix);
+         return worldMatrix;
+      }
+      inline Rotation getWorldRotation(uint32_t pIndex) const
+      {
+         const Page* page = getPage(pIndex);
+         const uint32_t entry = pIndex & PageIndexMask;
+
+         if(!GEHasFlag(page->Flags[entry], EntryFlags::WorldTRSDirty))
+            return page->WorldRotations[entry];
+
+         Rotation worldRotation;
+         Vector3 worldScale;
+         computeWorldTRS(pIndex, &worldRotation, &worldScale);
+         return worldRotation;
+      }
+      inline Vector3 getWorldScale(uint32_t pIndex) const
+      {
+         const Page* page = getPage(pIndex);
+         const uint32_t entry = pIndex & PageIndexMask;
+
+         if(!GEHasFlag(page->Flags[entry], EntryFlags::WorldTRSDirty))
+            return page->WorldScales[entry];
+
+         Rotation worldRotation;
+         Vector3 worldScale;
+         computeWorldTRS(pIndex, &worldRotation, &worldScale);
+         return worldScale;
+      }
+
+      void setPosition(uint32_t pIndex, const Vector3& pPosition);
+      void setRotation(uint32_t pIndex, const Rotation& pRotation);
+      void setScale(uint32_t pIndex, const Vector3& pScale);
+      void setLocalMatrix(uint32_t pIndex, const Matrix4& pLocalMatrix);
+      void reset(uint32_t pIndex);
+
+      uint32_t queueUpdateJobs();
+   };
+}}
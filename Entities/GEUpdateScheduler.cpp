@@ -0,0 +1,297 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Entities
+//
+//  --- GEUpdateScheduler.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "GEUpdateScheduler.h"
+#include "Core/GETaskManager.h"
+#include "Core/GEProfiler.h"
+#include "Core/GELog.h"
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+
+//
+//  UpdateScheduler
+//
+GESTLVector(UpdateScheduler*) UpdateScheduler::smStagesSchedulers;
+GESTLVector(UpdateScheduler::Stage) UpdateScheduler::smStages;
+
+#if defined (GE_DEVELOPMENT)
+bool UpdateScheduler::smStageRunning = false;
+uint32_t UpdateScheduler::smRunningStageWriteMask = 0u;
+thread_local bool UpdateScheduler::smSystemRunning = false;
+thread_local uint32_t UpdateScheduler::smRunningSystemWriteMask = 0u;
+#endif
+
+UpdateScheduler::UpdateScheduler()
+   : mStagesDirty(false)
+{
+}
+
+uint32_t UpdateScheduler::registerSystem(const ObjectName& pName, uint32_t pReadMask, uint32_t pWriteMask,
+   UpdateExecution pExecution, const SystemFunction& pFunction)
+{
+   GEAssert(pFunction);
+
+   System system;
+   system.Name = pName;
+   system.ReadMask = pReadMask;
+   system.WriteMask = pWriteMask;
+   system.Execution = pExecution;
+   system.Function = pFunction;
+   mSystems.push_back(system);
+
+   mStagesDirty = true;
+
+   return (uint32_t)mSystems.size() - 1u;
+}
+
+void UpdateScheduler::setSystemAccess(uint32_t pSystemIndex, uint32_t pReadMask, uint32_t pWriteMask)
+{
+   GEAssert(pSystemIndex < (uint32_t)mSystems.size());
+
+   System& system = mSystems[pSystemIndex];
+
+   if(system.ReadMask != pReadMask || system.WriteMask != pWriteMask)
+   {
+      system.ReadMask = pReadMask;
+      system.WriteMask = pWriteMask;
+      mStagesDirty = true;
+   }
+}
+
+bool UpdateScheduler::conflict(const System& pSystem, const System& pPreviousSystem, bool pSameScheduler)
+{
+   uint32_t readMask = pSystem.ReadMask;
+   uint32_t writeMask = pSystem.WriteMask;
+   uint32_t previousReadMask = pPreviousSystem.ReadMask;
+   uint32_t previousWriteMask = pPreviousSystem.WriteMask;
+
+   // the resources of each scene are its own, except for the shared ones. Systems that declare
+   // everything might reach other scenes, so they keep conflicting with any access
+   const uint32_t all = (uint32_t)UpdateResource::All;
+   const bool accessesEverything =
+      readMask == all || writeMask == all || previousReadMask == all || previousWriteMask == all;
+
+   if(!pSameScheduler && !accessesEverything)
+   {
+      readMask &= SharedUpdateResources;
+      writeMask &= SharedUpdateResources;
+      previousReadMask &= SharedUpdateResources;
+      previousWriteMask &= SharedUpdateResources;
+   }
+
+   // two systems conflict when one of them writes what the other one reads or writes
+   return
+      (writeMask & (previousReadMask | previousWriteMask)) != 0u ||
+      (readMask & previousWriteMask) != 0u;
+}
+
+void UpdateScheduler::buildStages(UpdateScheduler* const* pSchedulers, uint32_t pSchedulersCount)
+{
+   bool rebuild = smStagesSchedulers.size() != pSchedulersCount;
+
+   for(uint32_t i = 0u; i < pSchedulersCount && !rebuild; i++)
+   {
+      rebuild = smStagesSchedulers[i] != pSchedulers[i] || pSchedulers[i]->mStagesDirty;
+   }
+
+   if(!rebuild)
+      return;
+
+   smStagesSchedulers.assign(pSchedulers, pSchedulers + pSchedulersCount);
+   smStages.clear();
+
+   // systems are placed in the order of the schedulers, and then in registration order
+   GESTLVector(ScheduledSystem) placedSystems;
+   GESTLVector(uint32_t) placedSystemStages;
+
+   for(uint32_t i = 0u; i < pSchedulersCount; i++)
+   {
+      UpdateScheduler* scheduler = pSchedulers[i];
+
+      for(uint32_t j = 0u; j < (uint32_t)scheduler->mSystems.size(); j++)
+      {
+         const System& system = scheduler->mSystems[j];
+         uint32_t stageIndex = 0u;
+
+         for(size_t k = 0u; k < placedSystems.size(); k++)
+         {
+            const ScheduledSystem& previous = placedSystems[k];
+            const System& previousSystem = pSchedulers[previous.Scheduler]->mSystems[previous.System];
+
+            if(placedSystemStages[k] + 1u > stageIndex && conflict(system, previousSystem, previous.Scheduler == i))
+            {
+               stageIndex = placedSystemStages[k] + 1u;
+            }
+         }
+
+         ScheduledSystem scheduledSystem;
+         scheduledSystem.Scheduler = i;
+         scheduledSystem.System = j;
+         placedSystems.push_back(scheduledSystem);
+         placedSystemStages.push_back(stageIndex);
+
+         if(stageIndex >= (uint32_t)smStages.size())
+         {
+            Stage stage;
+            stage.WriteMask = 0u;
+            smStages.push_back(stage);
+         }
+
+         smStages[stageIndex].Systems.push_back(scheduledSystem);
+         smStages[stageIndex].WriteMask |= system.WriteMask;
+      }
+
+      scheduler->mStagesDirty = false;
+   }
+}
+
+uint32_t UpdateScheduler::getStagesCount()
+{
+   UpdateScheduler* scheduler = this;
+   return getStagesCount(&scheduler, 1u);
+}
+
+void UpdateScheduler::execute()
+{
+   UpdateScheduler* scheduler = this;
+   execute(&scheduler, 1u);
+}
+
+uint32_t UpdateScheduler::getStagesCount(UpdateScheduler* const* pSchedulers, uint32_t pSchedulersCount)
+{
+   buildStages(pSchedulers, pSchedulersCount);
+   return (uint32_t)smStages.size();
+}
+
+void UpdateScheduler::execute(UpdateScheduler* const* pSchedulers, uint32_t pSchedulersCount)
+{
+   GEProfilerMarker("UpdateScheduler::execute()");
+
+   buildStages(pSchedulers, pSchedulersCount);
+
+   for(uint32_t i = 0u; i < (uint32_t)smStages.size(); i++)
+   {
+      const Stage& stage = smStages[i];
+      uint32_t jobsCount = 0u;
+
+#if defined (GE_DEVELOPMENT)
+      smStageRunning = true;
+      smRunningStageWriteMask = stage.WriteMask;
+#endif
+
+      // queue the jobs first, so that the workers are busy while the main thread systems run
+      for(size_t j = 0u; j < stage.Systems.size(); j++)
+      {
+         const ScheduledSystem& scheduledSystem = stage.Systems[j];
+         const System& system = pSchedulers[scheduledSystem.Scheduler]->mSystems[scheduledSystem.System];
+
+         if(system.Execution == UpdateExecution::Jobs)
+         {
+#if defined (GE_DEVELOPMENT)
+            smSystemRunning = true;
+            smRunningSystemWriteMask = system.WriteMask;
+#endif
+            jobsCount += system.Function();
+#if defined (GE_DEVELOPMENT)
+            smSystemRunning = false;
+#endif
+         }
+      }
+
+      if(jobsCount > 0u)
+      {
+         TaskManager::getInstance()->kickFrameJobs();
+      }
+
+      for(size_t j = 0u; j < stage.Systems.size(); j++)
+      {
+         const ScheduledSystem& scheduledSystem = stage.Systems[j];
+         const System& system = pSchedulers[scheduledSystem.Scheduler]->mSystems[scheduledSystem.System];
+
+         if(system.Execution == UpdateExecution::MainThread)
+         {
+#if defined (GE_DEVELOPMENT)
+            smSystemRunning = true;
+            smRunningSystemWriteMask = system.WriteMask;
+#endif
+            system.Function();
+#if defined (GE_DEVELOPMENT)
+            smSystemRunning = false;
+#endif
+         }
+      }
+
+      if(jobsCount > 0u)
+      {
+         TaskManager::getInstance()->waitForFrameJobs();
+      }
+
+#if defined (GE_DEVELOPMENT)
+      smStageRunning = false;
+#endif
+   }
+}
+
+void UpdateScheduler::queueJob(const JobDesc& pJobDesc)
+{
+#if defined (GE_DEVELOPMENT)
+   if(smSystemRunning)
+   {
+      const uint32_t writeMask = smRunningSystemWriteMask;
+      const std::function<void()> task = pJobDesc.Task;
+
+      JobDesc jobDesc(pJobDesc.Name);
+      jobDesc.Task = [task, writeMask]
+      {
+         smSystemRunning = true;
+         smRunningSystemWriteMask = writeMask;
+         task();
+         smSystemRunning = false;
+      };
+
+      TaskManager::getInstance()->queueJob(jobDesc, JobType::Frame);
+      return;
+   }
+#endif
+
+   TaskManager::getInstance()->queueJob(pJobDesc, JobType::Frame);
+}
+
+void UpdateScheduler::validateWriteAccess(UpdateResource pResource)
+{
+#if defined (GE_DEVELOPMENT)
+   if(smSystemRunning)
+   {
+      if((smRunningSystemWriteMask & (uint32_t)pResource) == 0u)
+      {
+         Log::log(LogType::Error, "[UpdateScheduler] Resource 0x%x written by a system that does not declare it",
+            (uint32_t)pResource);
+      }
+
+      return;
+   }
+
+   // jobs not queued through the scheduler can only be checked against the whole stage
+   if(!smStageRunning)
+      return;
+
+   if((smRunningStageWriteMask & (uint32_t)pResource) == 0u)
+   {
+      Log::log(LogType::Error, "[UpdateScheduler] Resource 0x%x written in a stage that does not declare it",
+         (uint32_t)pResource);
+   }
+#else
+   (void)pResource;
+#endif
+}
@@ -0,0 +1,141 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Entities
+//
+//  --- GEUpdateScheduler.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Types/GETypes.h"
+#include "Types/GESTLTypes.h"
+#include "Core/GEObject.h"
+#include "Core/GEPlatform.h"
+#include "Core/GEUtils.h"
+
+#include <functional>
+
+namespace GE { namespace Core
+{
+   struct JobDesc;
+}}
+
+namespace GE { namespace Entities
+{
+   enum class UpdateResource : uint32_t
+   {
+      Transforms     = 1 << 0,
+      SkeletonPoses  = 1 << 1,
+      Particles      = 1 << 2,
+      Audio          = 1 << 3,
+      Scripts        = 1 << 4,
+      Sprites        = 1 << 5,
+      Cameras        = 1 << 6,
+      RenderQueues   = 1 << 7,
+
+      All            = 0xffffffff
+   };
+
+
+   // resources owned by the render and audio systems, which the updates of all the scenes share
+   const uint32_t SharedUpdateResources =
+      (uint32_t)UpdateResource::Audio | (uint32_t)UpdateResource::Cameras | (uint32_t)UpdateResource::RenderQueues;
+
+
+   enum class UpdateExecution
+   {
+      // the system does its work on the main thread
+      MainThread,
+      // the system queues frame jobs and returns how many
+      Jobs
+   };
+
+
+   //
+   //  UpdateScheduler
+   //
+   //  Runs the update systems of a scene in stages. Each system declares the resources it reads and
+   //  writes, and goes into the first stage after the last earlier system it conflicts with, so that
+   //  systems sharing a stage can run concurrently. Stages are separated by a wait on the frame jobs.
+   //  Several schedulers can run together, in which case systems of different scenes only conflict on
+   //  the shared resources, and a stage holds the systems of all the scenes that can run in it.
+   //  In development builds, writes are checked against the write mask of the system doing them.
+   //  Only transforms, skeleton poses, particles and audio have hooks for that check; the rest of
+   //  the resources are used for scheduling only, and writes to them go unchecked
+   //
+   class UpdateScheduler : private Core::NonCopyable
+   {
+   public:
+      typedef std::function<uint32_t()> SystemFunction;
+
+   private:
+      struct System
+      {
+         Core::ObjectName Name;
+         uint32_t ReadMask;
+         uint32_t WriteMask;
+         UpdateExecution Execution;
+         SystemFunction Function;
+      };
+
+      struct ScheduledSystem
+      {
+         uint32_t Scheduler;
+         uint32_t System;
+      };
+
+      struct Stage
+      {
+         GESTLVector(ScheduledSystem) Systems;
+         uint32_t WriteMask;
+      };
+
+      GESTLVector(System) mSystems;
+      bool mStagesDirty;
+
+      // stages of the last set of schedulers executed, rebuilt when the set or any of its systems change
+      static GESTLVector(UpdateScheduler*) smStagesSchedulers;
+      static GESTLVector(Stage) smStages;
+
+#if defined (GE_DEVELOPMENT)
+      // resources the running stage has declared to write, used to catch undeclared writes
+      static bool smStageRunning;
+      static uint32_t smRunningStageWriteMask;
+      // resources the system running on the calling thread has declared to write, which the jobs
+      // queued through queueJob() carry over to the worker threads
+      static thread_local bool smSystemRunning;
+      static thread_local uint32_t smRunningSystemWriteMask;
+#endif
+
+      static bool conflict(const System& pSystem, const System& pPreviousSystem, bool pSameScheduler);
+      static void buildStages(UpdateScheduler* const* pSchedulers, uint32_t pSchedulersCount);
+
+   public:
+      UpdateScheduler();
+
+      uint32_t registerSystem(const Core::ObjectName& pName, uint32_t pReadMask, uint32_t pWriteMask,
+         UpdateExecution pExecution, const SystemFunction& pFunction);
+      void setSystemAccess(uint32_t pSystemIndex, uint32_t pReadMask, uint32_t pWriteMask);
+
+      uint32_t getStagesCount();
+      void execute();
+
+      static uint32_t getStagesCount(UpdateScheduler* const* pSchedulers, uint32_t pSchedulersCount);
+      static void execute(UpdateScheduler* const* pSchedulers, uint32_t pSchedulersCount);
+
+      // queues a frame job on behalf of the system being executed
+      static void queueJob(const Core::JobDesc& pJobDesc);
+      static void validateWriteAccess(UpdateResource pResource);
+   };
+}}
+
+#if defined (GE_DEVELOPMENT)
+# define GEValidateUpdateWriteAccess(Resource)  GE::Entities::UpdateScheduler::validateWriteAccess(Resource)
+#else
+# define GEValidateUpdateWriteAccess(Resource)
+#endif
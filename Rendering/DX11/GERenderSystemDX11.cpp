@@ -10,6 +10,10 @@
 //
 //////////////////////////////////////////////////////////////////
 
+#include "Core/GEPlatform.h"
+
+#if !defined (GE_RENDERING_API_NULL)
+
 #include "GERenderSystemDX11.h"
 #include "Core/GEDevice.h"
 #include "Core/GEAllocator.h"
@@ -60,11 +64,20 @@ ID3D11Buffer* dxConstantBufferFragmentParameters = nullptr;
 ID3D11Buffer* pCurrentVertexBuffer = nullptr;
 ID3D11Buffer* pCurrentIndexBuffer = nullptr;
 
+// Queries
+const uint32_t kFrameQueriesCount = 8u;
+ID3D11Query* dxFrameQueries[kFrameQueriesCount] = { nullptr };
+ID3D11Query* dxWaitForGPUQuery = nullptr;
+uint32_t iFrameQueryIndices[kFrameQueriesCount] = { 0u };
+uint32_t iFirstPendingFrameQuery = 0u;
+uint32_t iPendingFrameQueriesCount = 0u;
+
 ShaderConstantsTransform sShaderConstantsTransform;
 ShaderConstantsMaterial sShaderConstantsMaterial;
 ShaderConstantsLighting sShaderConstantsLighting;
 
 RenderTextureDX11* cShadowMap = nullptr;
+RenderTextureDX11* cStaticShadowMap = nullptr;
 
 const ObjectName _Mesh_ = ObjectName("Mesh");
 const ObjectName _Label_ = ObjectName("Label");
@@ -92,12 +105,12 @@ RenderSystemDX11::RenderSystemDX11(HWND WindowHandle, bool Windowed)
 
    createBuffers();
    createStates();
+   createQueries();
    loadShaders();
    loadDefaultRenderingResources();
 
    // create render texture for shadow mapping
-   cShadowMap = Allocator::alloc<RenderTextureDX11>();
-   GEInvokeCtor(RenderTextureDX11, cShadowMap)(dxDevice.Get(), dxContext.Get(), kShadowMapSize, kShadowMapSize);
+   createShadowMap();
 
    // set default render target
    dxContext->OMSetRenderTargets(1, dxRenderTargetView.GetAddressOf(), dxDepthStencilView.Get());
@@ -113,6 +126,9 @@ RenderSystemDX11::RenderSystemDX11(HWND WindowHandle, bool Windowed)
 #if defined (GE_EDITOR_SUPPORT)
    EventHandlingObject::connectStaticEventCallback(Events::RenderingSurfaceChanged, "RenderSystem", [this](const EventArgs* args) -> bool
    {
+      // the render targets are about to be released, so the frames using them have to be finished
+      waitForRenderThread();
+
       calculate2DViewProjectionMatrix();
 
       ID3D11RenderTargetView* nullViews[] = { nullptr };
@@ -136,12 +152,12 @@ RenderSystemDX11::~RenderSystemDX11()
    EventHandlingObject::disconnectStaticEventCallback(Events::RenderingSurfaceChanged, "RenderSystem");
 #endif
 
-   GEInvokeDtor(RenderTextureDX11, cShadowMap);
-   Allocator::free(cShadowMap);
+   releaseShadowMap();
 
    releaseShaders();
    releaseStates();
    releaseBuffers();
+   releaseQueries();
 }
 
 void RenderSystem::loadTexture(PreloadedTexture* cPreloadedTexture)
@@ -242,30 +258,37 @@ void RenderSystem::unloadTexture(Texture* pTexture)
    pTexture->setHandler(nullptr);
 }
 
-void RenderSystem::loadRenderingData(const GeometryData* pData, GPUBufferPair& pBuffers, uint32_t)
+uint32_t RenderSystem::getStoredIndexSize(uint32_t) const
 {
-   GEProfilerMarker("RenderSystem::loadRenderingData()");
+   // indices are always 16-bit, the draws rely on the base vertex location instead
+   return (uint32_t)sizeof(ushort);
+}
+
+void RenderSystem::uploadRenderingData(const RenderCommand& pCommand)
+{
+   GEProfilerMarker("RenderSystem::uploadRenderingData()");
+
+   const GeometryData* pData = pCommand.Data;
+   const GPUBufferPair& sBuffers = sGPUBufferPairs[pCommand.Group];
 
    uint iVertexDataSize = pData->NumVertices * pData->VertexStride;
    uint iIndicesSize = pData->NumIndices * sizeof(ushort);
 
-   const D3D11_MAP dxMapType = pBuffers.CurrentVertexBufferOffset == 0u
+   // static buffers are sub-allocated, so the first block does not mean the rest of the contents can go
+   const D3D11_MAP dxMapType = pCommand.VertexOffset == 0u && sBuffers.IsDynamic
       ? D3D11_MAP_WRITE_DISCARD
       : D3D11_MAP_WRITE_NO_OVERWRITE;
 
    D3D11_MAPPED_SUBRESOURCE dxResource;
-   ID3D11Buffer* dxVertexBuffer = static_cast<ID3D11Buffer*>(pBuffers.VertexBuffer);
+   ID3D11Buffer* dxVertexBuffer = static_cast<ID3D11Buffer*>(sBuffers.VertexBuffer);
    dxContext->Map(dxVertexBuffer, 0, dxMapType, 0, &dxResource);
-   memcpy((char*)dxResource.pData + pBuffers.CurrentVertexBufferOffset, pData->VertexData, iVertexDataSize);
+   memcpy((char*)dxResource.pData + pCommand.VertexOffset, pData->VertexData, iVertexDataSize);
    dxContext->Unmap(dxVertexBuffer, 0);
 
-   ID3D11Buffer* dxIndexBuffer = static_cast<ID3D11Buffer*>(pBuffers.IndexBuffer);
+   ID3D11Buffer* dxIndexBuffer = static_cast<ID3D11Buffer*>(sBuffers.IndexBuffer);
    dxContext->Map(dxIndexBuffer, 0, dxMapType, 0, &dxResource);
-   memcpy((char*)dxResource.pData + pBuffers.CurrentIndexBufferOffset, pData->Indices, iIndicesSize);
+   memcpy((char*)dxResource.pData + pCommand.IndexOffset, pData->Indices, iIndicesSize);
    dxContext->Unmap(dxIndexBuffer, 0);
-
-   pBuffers.CurrentVertexBufferOffset += iVertexDataSize;
-   pBuffers.CurrentIndexBufferOffset += iIndicesSize;
 }
 
 void RenderSystemDX11::createDeviceResources()
@@ -485,6 +508,24 @@ void RenderSystemDX11::createStates()
    dxContext->RSSetState(dxRasterizerStateSolidCullBack);
 }
 
+void RenderSystemDX11::createQueries()
+{
+   // event queries end once the GPU has executed all the commands issued before them
+   D3D11_QUERY_DESC dxQueryDesc;
+   ZeroMemory(&dxQueryDesc, sizeof(D3D11_QUERY_DESC));
+   dxQueryDesc.Query = D3D11_QUERY_EVENT;
+
+   for(uint32_t i = 0u; i < kFrameQueriesCount; i++)
+   {
+      dxDevice->CreateQuery(&dxQueryDesc, &dxFrameQueries[i]);
+   }
+
+   dxDevice->CreateQuery(&dxQueryDesc, &dxWaitForGPUQuery);
+
+   iFirstPendingFrameQuery = 0u;
+   iPendingFrameQueriesCount = 0u;
+}
+
 void RenderSystemDX11::createWindowSizeDependentResources()
 {
    DXGI_SWAP_CHAIN_DESC1 dxSwapChainDesc;
@@ -650,6 +691,18 @@ void RenderSystemDX11::releaseBuffers()
    }
 }
 
+void RenderSystemDX11::releaseQueries()
+{
+   for(uint32_t i = 0u; i < kFrameQueriesCount; i++)
+   {
+      dxFrameQueries[i]->Release();
+      dxFrameQueries[i] = nullptr;
+   }
+
+   dxWaitForGPUQuery->Release();
+   dxWaitForGPUQuery = nullptr;
+}
+
 void RenderSystem::bindBuffers(const GPUBufferPair& sBufferPair)
 {
    ID3D11Buffer* dxVertexBuffer = reinterpret_cast<ID3D11Buffer*>(sBufferPair.VertexBuffer);
@@ -735,130 +788,167 @@ void RenderSystem::useShaderProgram(const ObjectName& cName)
    setCullingMode(cShaderProgram->getCullingMode());
 }
 
-void RenderSystem::renderShadowMap()
+void RenderSystem::createShadowMap()
+{
+   // the cascades are cells of the same texture
+   const uint32_t width = mShadowMapSize * getShadowAtlasColumns();
+   const uint32_t height = mShadowMapSize * getShadowAtlasRows();
+
+   cShadowMap = Allocator::alloc<RenderTextureDX11>();
+   GEInvokeCtor(RenderTextureDX11, cShadowMap)(dxDevice.Get(), dxContext.Get(), width, height);
+   cStaticShadowMap = Allocator::alloc<RenderTextureDX11>();
+   GEInvokeCtor(RenderTextureDX11, cStaticShadowMap)(dxDevice.Get(), dxContext.Get(), width, height);
+}
+
+void RenderSystem::releaseShadowMap()
 {
-   if(vLightsToRender.empty())
+   if(!cShadowMap)
       return;
 
-   ComponentLight* cLight = vLightsToRender[0];
+   GEInvokeDtor(RenderTextureDX11, cShadowMap);
+   Allocator::free(cShadowMap);
+   cShadowMap = nullptr;
+   GEInvokeDtor(RenderTextureDX11, cStaticShadowMap);
+   Allocator::free(cStaticShadowMap);
+   cStaticShadowMap = nullptr;
+}
 
-   if(cLight->getLightType() != LightType::Directional)
+void RenderSystem::renderShadowMap()
+{
+   if(mFrameState->Lights.empty())
       return;
 
-   CD3D11_VIEWPORT dxViewport = CD3D11_VIEWPORT(0.0f, 0.0f, (float)kShadowMapSize, (float)kShadowMapSize);
-   dxContext->RSSetViewports(1, &dxViewport);
+   if(mFrameState->Lights[0].Type != (uint32_t)LightType::Directional)
+      return;
 
    ID3D11ShaderResourceView* dxNullResourceView = nullptr;
    dxContext->PSSetShaderResources((UINT)TextureSlot::ShadowMap, 1, &dxNullResourceView);
 
-   cShadowMap->setAsRenderTarget((UINT)TextureSlot::ShadowMap);
-   cShadowMap->clear(Color(1.0f, 1.0f, 1.0f));
-
-   calculateLightViewProjectionMatrix(cLight);
+   if(mFrameState->ShadowMapResizePending)
+   {
+      releaseShadowMap();
+      createShadowMap();
+   }
 
-   if(!vShadowedMeshesToRender.empty())
+   // the static casters are kept in their own layer, which is only rendered when they change
+   if(mFrameState->StaticShadowLayerUpdatePending)
    {
-      setBlendingMode(BlendingMode::None);
-      useShaderProgram(kShadowMapSolidProgram);
+      cStaticShadowMap->setAsRenderTarget((UINT)TextureSlot::ShadowMap);
+      cStaticShadowMap->clear(Color(1.0f, 1.0f, 1.0f));
 
-      GESTLVector(RenderOperation)::const_iterator it = vShadowedMeshesToRender.begin();
+      renderShadowCasters(mFrameState->StaticShadowedMeshes, false);
+   }
 
-      for(; it != vShadowedMeshesToRender.end(); it++)
-      {
-         const RenderOperation& sRenderOperation = *it;
+   // the dynamic casters are rendered on top of a copy of the static layer, depth included
+   cShadowMap->copyFrom(cStaticShadowMap);
+   cShadowMap->setAsRenderTarget((UINT)TextureSlot::ShadowMap);
 
-         // set uniform
-         Matrix4Multiply(matLightViewProjection, sRenderOperation.mWorldTransform, &sShaderConstantsTransform.WorldViewProjectionMatrix);
-         dxContext->UpdateSubresource(dxConstantBufferTransform, 0, NULL, &sShaderConstantsTransform, 0, 0);
+   renderShadowCasters(mFrameState->DynamicShadowedMeshes, false);
+   renderShadowCasters(mFrameState->ShadowedParticles, true);
 
-         // draw
-         GESTLMap(uint, GeometryRenderInfo)* mGeometryRegistry = 0;
+   dxContext->OMSetRenderTargets(1, dxRenderTargetView.GetAddressOf(), dxDepthStencilView.Get());
 
-         if(sRenderOperation.isStatic())
-         {
-            mGeometryRegistry = &mStaticGeometryToRender;
-            bindBuffers(sGPUBufferPairs[GeometryGroup::MeshStatic]);
-         }
-         else
-         {
-            mGeometryRegistry = &mDynamicGeometryToRender;
-            bindBuffers(sGPUBufferPairs[GeometryGroup::MeshDynamic]);
-         }
+   CD3D11_VIEWPORT dxViewport = CD3D11_VIEWPORT(0.0f, 0.0f, (float)Device::ScreenWidth, (float)Device::ScreenHeight);
+   dxContext->RSSetViewports(1, &dxViewport);
 
-         GESTLMap(uint, GeometryRenderInfo)::const_iterator itInfo = mGeometryRegistry->find(sRenderOperation.mGeometryID);
-         const GeometryRenderInfo& sGeometryInfo = itInfo->second;
-         UINT iStartIndexLocation = sGeometryInfo.mIndexBufferOffset / sizeof(ushort);
-         INT iBaseVertexLocation = sGeometryInfo.mVertexBufferOffset / sRenderOperation.mData->VertexStride;
+   dxContext->PSSetSamplers(1, 1, &dxSamplerStateWrap);
+}
 
-         dxContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-         dxContext->DrawIndexed(sRenderOperation.mData->NumIndices, iStartIndexLocation, iBaseVertexLocation);
-      }
-   }
+void RenderSystem::renderShadowCasters(const GESTLVector(RenderShadowCaster)& pCasters, bool pParticles)
+{
+   if(pCasters.empty())
+      return;
 
-   if(!vShadowedParticlesToRender.empty())
+   if(pParticles)
    {
       setBlendingMode(BlendingMode::Alpha);
       useShaderProgram(kShadowMapAlphaProgram);
+   }
+   else
+   {
+      setBlendingMode(BlendingMode::None);
+      useShaderProgram(kShadowMapSolidProgram);
+   }
+
+   for(uint32_t i = 0u; i < (uint32_t)mFrameState->ShadowCascades.size(); i++)
+   {
+      const Matrix4& matCascadeViewProjection = mFrameState->ShadowCascades[i].ViewProjection;
 
-      GESTLVector(RenderOperation)::const_iterator it = vShadowedParticlesToRender.begin();
+      // the rows of the cells are counted from the bottom, as in the clip space the receivers sample with
+      uint32_t iColumn, iRow;
+      getShadowCascadeCell(i, &iColumn, &iRow);
 
-      for(; it != vShadowedParticlesToRender.end(); it++)
+      CD3D11_VIEWPORT dxViewport = CD3D11_VIEWPORT(
+         (float)(iColumn * mShadowMapSize), (float)((getShadowAtlasRows() - 1u - iRow) * mShadowMapSize),
+         (float)mShadowMapSize, (float)mShadowMapSize);
+      dxContext->RSSetViewports(1, &dxViewport);
+
+      GESTLVector(RenderShadowCaster)::const_iterator it = pCasters.begin();
+
+      for(; it != pCasters.end(); it++)
       {
-         const RenderOperation& sRenderOperation = *it;
+         const RenderOperation& sRenderOperation = it->Operation;
+
+         if(pParticles)
+         {
+            // set uniform
+            memcpy(&sShaderConstantsTransform.WorldViewProjectionMatrix, &matCascadeViewProjection, sizeof(Matrix4));
+            dxContext->UpdateSubresource(dxConstantBufferTransform, 0, NULL, &sShaderConstantsTransform, 0, 0);
 
-         // set uniform
-         memcpy(&sShaderConstantsTransform.WorldViewProjectionMatrix, &matLightViewProjection, sizeof(Matrix4));
-         dxContext->UpdateSubresource(dxConstantBufferTransform, 0, NULL, &sShaderConstantsTransform, 0, 0);
+            if(it->CasterMaterial->getDiffuseTexture())
+            {
+               bindTexture(TextureSlot::Diffuse, it->CasterMaterial->getDiffuseTexture());
+            }
 
-         if(sRenderOperation.mRenderMaterialPass->getMaterial()->getDiffuseTexture())
+            bindBuffers(sGPUBufferPairs[GeometryGroup::Particles]);
+         }
+         else
          {
-            bindTexture(TextureSlot::Diffuse, sRenderOperation.mRenderMaterialPass->getMaterial()->getDiffuseTexture());
+            // set uniform
+            Matrix4Multiply(matCascadeViewProjection, sRenderOperation.mWorldTransform, &sShaderConstantsTransform.WorldViewProjectionMatrix);
+            dxContext->UpdateSubresource(dxConstantBufferTransform, 0, NULL, &sShaderConstantsTransform, 0, 0);
+
+            if(sRenderOperation.isStatic())
+            {
+               bindBuffers(sGPUBufferPairs[GeometryGroup::MeshStatic]);
+            }
+            else
+            {
+               bindBuffers(sGPUBufferPairs[GeometryGroup::MeshDynamic]);
+            }
          }
 
          // draw
-         bindBuffers(sGPUBufferPairs[GeometryGroup::Particles]);
-
-         GESTLMap(uint, GeometryRenderInfo)::const_iterator itInfo = mDynamicGeometryToRender.find(sRenderOperation.mGeometryID);
-         const GeometryRenderInfo& sGeometryInfo = itInfo->second;
+         const GeometryRenderInfo& sGeometryInfo = it->Geometry;
          UINT iStartIndexLocation = sGeometryInfo.mIndexBufferOffset / sizeof(ushort);
-         INT iBaseVertexLocation = sGeometryInfo.mVertexBufferOffset / sRenderOperation.mData->VertexStride;
+         INT iBaseVertexLocation = sGeometryInfo.mVertexBufferOffset / it->VertexStride;
 
          dxContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-         dxContext->DrawIndexed(sRenderOperation.mData->NumIndices, iStartIndexLocation, iBaseVertexLocation);
+         dxContext->DrawIndexed(it->IndexCount, iStartIndexLocation, iBaseVertexLocation);
       }
    }
-
-   dxContext->OMSetRenderTargets(1, dxRenderTargetView.GetAddressOf(), dxDepthStencilView.Get());
-
-   dxViewport = CD3D11_VIEWPORT(0.0f, 0.0f, (float)Device::ScreenWidth, (float)Device::ScreenHeight);
-   dxContext->RSSetViewports(1, &dxViewport);
-
-   dxContext->PSSetSamplers(1, 1, &dxSamplerStateWrap);
 }
 
-void RenderSystem::renderBegin()
+void RenderSystem::beginFrame()
 {
-   GEProfilerMarker("RenderSystem::renderBegin()");
+   GEProfilerMarker("RenderSystem::beginFrame()");
 
-   dxContext->ClearRenderTargetView(dxRenderTargetView.Get(), &cBackgroundColor.Red);
+   dxContext->ClearRenderTargetView(dxRenderTargetView.Get(), &mFrameState->BackgroundColor.Red);
    dxContext->ClearDepthStencilView(dxDepthStencilView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-   iDrawCalls = 0;
-
-   sShaderConstantsLighting.AmbientLightColor = cAmbientLightColor;
 
-   if(cActiveCamera)
-   {
-      sShaderConstantsLighting.EyePosition = cActiveCamera->getTransform()->getPosition();
-   }
+   sShaderConstantsLighting.AmbientLightColor = mFrameState->AmbientLightColor;
+   sShaderConstantsLighting.EyePosition = mFrameState->CameraPosition;
 }
 
-void RenderSystem::render(const RenderOperation& sRenderOperation)
+void RenderSystem::setShaderConstants(const RenderConstants& pConstants)
 {
-   GEProfilerMarker("RenderSystem::render()");
+   GEProfilerMarker("RenderSystem::setShaderConstants()");
+
+   const RenderOperation& sRenderOperation = pConstants.Operation;
 
    const Matrix4& mViewProjection = GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::RenderThroughActiveCamera)
-      ? cActiveCamera->getViewProjectionMatrix()
-      : mat2DViewProjection;
+      ? mFrameState->CameraViewProjection
+      : mFrameState->ViewProjection2D;
    sShaderConstantsTransform.ViewProjectionMatrix = mViewProjection;
 
    // calculate the world-view-projection matrix
@@ -880,6 +970,8 @@ void RenderSystem::render(const RenderOperation& sRenderOperation)
 
       if(GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::BindShadowMap))
       {
+         const uint32_t iCascade = GEMin(sRenderOperation.mShadowCascade, (uint32_t)mFrameState->ShadowCascades.size() - 1u);
+         const Matrix4& matLightViewProjection = mFrameState->ShadowCascades[iCascade].ReceiverViewProjection;
          Matrix4Multiply(matLightViewProjection, sRenderOperation.mWorldTransform, &sShaderConstantsTransform.LightWorldViewProjection);
       }
    }
@@ -890,28 +982,25 @@ void RenderSystem::render(const RenderOperation& sRenderOperation)
    sShaderConstantsTransform.WorldViewProjectionMatrix = matModelViewProjection;
    dxContext->UpdateSubresource(dxConstantBufferTransform, 0, NULL, &sShaderConstantsTransform, 0, 0);
 
-   MaterialPass* cMaterialPass = sRenderOperation.mRenderMaterialPass;
-   sShaderConstantsMaterial.DiffuseColor = cMaterialPass->getMaterial()->getDiffuseColor() * sRenderOperation.mColor;
-   sShaderConstantsMaterial.SpecularColor = cMaterialPass->getMaterial()->getSpecularColor();
+   Material* cMaterial = pConstants.OperationMaterial;
+   sShaderConstantsMaterial.DiffuseColor = cMaterial->getDiffuseColor() * sRenderOperation.mColor;
+   sShaderConstantsMaterial.SpecularColor = cMaterial->getSpecularColor();
 
    dxContext->UpdateSubresource(dxConstantBufferMaterial, 0, NULL, &sShaderConstantsMaterial, 0, 0);
 
-   if(cMaterialPass->hasVertexParameters())
+   if(pConstants.HasVertexParameters)
    {
-      dxContext->UpdateSubresource(dxConstantBufferVertexParameters, 0, NULL, cMaterialPass->getConstantBufferDataVertex(), 0, 0);
+      dxContext->UpdateSubresource(dxConstantBufferVertexParameters, 0, NULL, pConstants.VertexParameters, 0, 0);
    }
 
-   if(cMaterialPass->hasFragmentParameters())
+   if(pConstants.HasFragmentParameters)
    {
-      dxContext->UpdateSubresource(dxConstantBufferFragmentParameters, 0, NULL, cMaterialPass->getConstantBufferDataFragment(), 0, 0);
+      dxContext->UpdateSubresource(dxConstantBufferFragmentParameters, 0, NULL, pConstants.FragmentParameters, 0, 0);
    }
 
-   // bind diffuse texture
-   bindTexture(TextureSlot::Diffuse, sRenderOperation.mDiffuseTexture);
-
    bool bRenderOncePerLight =
-      GEHasFlag(cMaterialPass->getMaterial()->getFlags(), MaterialFlagsBitMask::RenderOncePerLight) &&
-      vLightsToRender.size() > 1;
+      GEHasFlag(cMaterial->getFlags(), MaterialFlagsBitMask::RenderOncePerLight) &&
+      mFrameState->Lights.size() > 1;
 
    if(GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::LightingSupport))
    {
@@ -926,68 +1015,73 @@ void RenderSystem::render(const RenderOperation& sRenderOperation)
       // individual light
       if(!bRenderOncePerLight)
       {
-         if(vLightsToRender.empty())
+         if(mFrameState->Lights.empty())
          {
             sShaderConstantsLighting.LightType = 0;
             sShaderConstantsLighting.LightColor = Color(0.0f, 0.0f, 0.0f);
          }
          else
          {
-            ComponentLight* cLight = vLightsToRender[0];
-
-            sShaderConstantsLighting.LightType = (GE::uint)cLight->getLightType();
-            sShaderConstantsLighting.LightColor = cLight->getColor();
-            sShaderConstantsLighting.LightPosition = cLight->getTransform()->getWorldPosition();
-            sShaderConstantsLighting.LightDirection = cLight->getDirection();
-            sShaderConstantsLighting.Attenuation = cLight->getLinearAttenuation();
-            sShaderConstantsLighting.SpotAngle = cLight->getSpotAngle();
-            sShaderConstantsLighting.ShadowIntensity = cLight->getShadowIntensity();
+            const RenderLight& sLight = mFrameState->Lights[0];
+
+            sShaderConstantsLighting.LightType = (GE::uint)sLight.Type;
+            sShaderConstantsLighting.LightColor = sLight.LightColor;
+            sShaderConstantsLighting.LightPosition = sLight.Position;
+            sShaderConstantsLighting.LightDirection = sLight.Direction;
+            sShaderConstantsLighting.Attenuation = sLight.LinearAttenuation;
+            sShaderConstantsLighting.SpotAngle = sLight.SpotAngle;
+            sShaderConstantsLighting.ShadowIntensity = sLight.ShadowIntensity;
          }
 
          dxContext->UpdateSubresource(dxConstantBufferLighting, 0, NULL, &sShaderConstantsLighting, 0, 0);
       }
    }
+}
 
-   // draw
-   GESTLMap(uint, GeometryRenderInfo)* mGeometryToRenderMap = sRenderOperation.isStatic()
-      ? &mStaticGeometryToRender
-      : &mDynamicGeometryToRender;
+void RenderSystem::draw(const RenderCommand& pCommand, const RenderConstants& pConstants)
+{
+   bool bRenderOncePerLight =
+      GEHasFlag(pConstants.OperationMaterial->getFlags(), MaterialFlagsBitMask::RenderOncePerLight) &&
+      mFrameState->Lights.size() > 1;
 
-   bindBuffers(sGPUBufferPairs[sRenderOperation.mGroup]);
-   GESTLMap(uint, GeometryRenderInfo)::const_iterator it = mGeometryToRenderMap->find(sRenderOperation.mGeometryID);
-   const GeometryRenderInfo& sGeometryInfo = it->second;
-   uint iStartIndexLocation = sGeometryInfo.mIndexBufferOffset / sizeof(uint16_t);
-   uint iBaseVertexLocation = sGeometryInfo.mVertexBufferOffset / sRenderOperation.mData->VertexStride;
+   uint iStartIndexLocation = pCommand.IndexOffset / sizeof(uint16_t);
+   uint iBaseVertexLocation = pCommand.VertexOffset / pConstants.VertexStride;
 
    dxContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
    if(bRenderOncePerLight)
    {
-      for(uint i = 0; i < vLightsToRender.size(); i++)
+      for(uint i = 0; i < mFrameState->Lights.size(); i++)
       {
-         ComponentLight* cLight = vLightsToRender[i];
+         const RenderLight& sLight = mFrameState->Lights[i];
 
-         sShaderConstantsLighting.LightType = (GE::uint)cLight->getLightType();
-         sShaderConstantsLighting.LightColor = cLight->getColor();
-         sShaderConstantsLighting.LightPosition = cLight->getTransform()->getWorldPosition();
-         sShaderConstantsLighting.LightDirection = cLight->getDirection();
-         sShaderConstantsLighting.Attenuation = cLight->getLinearAttenuation();
-         sShaderConstantsLighting.SpotAngle = cLight->getSpotAngle();
-         sShaderConstantsLighting.ShadowIntensity = cLight->getShadowIntensity();
+         sShaderConstantsLighting.LightType = (GE::uint)sLight.Type;
+         sShaderConstantsLighting.LightColor = sLight.LightColor;
+         sShaderConstantsLighting.LightPosition = sLight.Position;
+         sShaderConstantsLighting.LightDirection = sLight.Direction;
+         sShaderConstantsLighting.Attenuation = sLight.LinearAttenuation;
+         sShaderConstantsLighting.SpotAngle = sLight.SpotAngle;
+         sShaderConstantsLighting.ShadowIntensity = sLight.ShadowIntensity;
 
          dxContext->UpdateSubresource(dxConstantBufferLighting, 0, NULL, &sShaderConstantsLighting, 0, 0);
-         dxContext->DrawIndexed(sRenderOperation.mData->NumIndices, iStartIndexLocation, iBaseVertexLocation);
+         dxContext->DrawIndexed(pCommand.IndexCount, iStartIndexLocation, iBaseVertexLocation);
       }
    }
    else
    {
-      dxContext->DrawIndexed(sRenderOperation.mData->NumIndices, iStartIndexLocation, iBaseVertexLocation);
+      dxContext->DrawIndexed(pCommand.IndexCount, iStartIndexLocation, iBaseVertexLocation);
    }
 }
 
-void RenderSystem::renderEnd()
+void RenderSystem::drawInstanced(const RenderCommand& pCommand, const RenderConstants& pConstants, const RenderInstance* pInstances)
 {
-   GEProfilerMarker("RenderSystem::renderEnd()");
+   // the input layouts have no per-instance elements, so the instances are drawn one by one
+   drawInstancesSeparately(pCommand, pConstants, pInstances);
+}
+
+void RenderSystem::endFrame()
+{
+   GEProfilerMarker("RenderSystem::endFrame()");
 
    HRESULT hr = dxSwapChain->Present((UINT)Settings::getInstance()->getVSync(), 0);
 
@@ -996,6 +1090,44 @@ void RenderSystem::renderEnd()
 
    CD3D11_VIEWPORT dxViewport(0.0f, 0.0f, (float)Device::ScreenWidth, (float)Device::ScreenHeight);
    dxContext->RSSetViewports(1, &dxViewport);
+
+   // the queries can only be polled from the thread that replays the frames, so the frames the GPU has
+   // finished are retired here. The oldest one is waited for when every query is still pending
+   while(iPendingFrameQueriesCount > 0u)
+   {
+      ID3D11Query* dxQuery = dxFrameQueries[iFirstPendingFrameQuery];
+      const bool bWait = iPendingFrameQueriesCount == kFrameQueriesCount;
+      HRESULT hrQuery = dxContext->GetData(dxQuery, nullptr, 0, bWait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+
+      while(bWait && hrQuery == S_FALSE)
+      {
+         hrQuery = dxContext->GetData(dxQuery, nullptr, 0, 0);
+      }
+
+      if(hrQuery != S_OK)
+         break;
+
+      mFramesCompleted = iFrameQueryIndices[iFirstPendingFrameQuery] + 1u;
+      iFirstPendingFrameQuery = (iFirstPendingFrameQuery + 1u) % kFrameQueriesCount;
+      iPendingFrameQueriesCount--;
+   }
+
+   const uint32_t iFrameQuery = (iFirstPendingFrameQuery + iPendingFrameQueriesCount) % kFrameQueriesCount;
+   dxContext->End(dxFrameQueries[iFrameQuery]);
+   iFrameQueryIndices[iFrameQuery] = mFrameState->FrameIndex;
+   iPendingFrameQueriesCount++;
+}
+
+void RenderSystem::waitForGPU()
+{
+   GEProfilerMarker("RenderSystem::waitForGPU()");
+
+   // uploads map the static buffers without waiting, so the ranges they write to must not be read anymore
+   dxContext->End(dxWaitForGPUQuery);
+
+   while(dxContext->GetData(dxWaitForGPUQuery, nullptr, 0, 0) == S_FALSE)
+   {
+   }
 }
 
 void RenderSystem::setBlendingMode(BlendingMode Mode)
@@ -1075,3 +1207,5 @@ void RenderSystem::setCullingMode(CullingMode Mode)
       break;
    }
 }
+
+#endif
@@ -66,10 +66,12 @@ namespace GE { namespace Rendering
       void createWindowSizeDependentResources();
       void createBuffers();
       void createStates();
+      void createQueries();
 
       void releaseShaders();
       void releaseStates();
       void releaseBuffers();
+      void releaseQueries();
 
    public:
       RenderSystemDX11(HWND WindowHandle, bool Windowed);
@@ -150,6 +150,13 @@ void RenderTextureDX11::clear(const Color& ClearColor)
    dxContext->ClearDepthStencilView(m_depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
 }
 
+void RenderTextureDX11::copyFrom(RenderTextureDX11* Source)
+{
+   // both textures must have the same size, and the depth is copied along with the color
+   dxContext->CopyResource(m_renderTargetTexture, Source->m_renderTargetTexture);
+   dxContext->CopyResource(m_depthStencilBuffer, Source->m_depthStencilBuffer);
+}
+
 ID3D11ShaderResourceView* RenderTextureDX11::getShaderResourceView()
 {
    return m_shaderResourceView;
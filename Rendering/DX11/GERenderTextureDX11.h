@@ -34,6 +34,7 @@ namespace GE { namespace Rendering
 
       void setAsRenderTarget(UINT Slot);
       void clear(const Color& ClearColor);
+      void copyFrom(RenderTextureDX11* Source);
       ID3D11ShaderResourceView* getShaderResourceView();
    };
 }}
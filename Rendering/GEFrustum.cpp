@@ -0,0 +1,267 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GEFrustum.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "GEFrustum.h"
+#include "Core/GEConstants.h"
+
+#include <cfloat>
+
+#if defined (GE_SIMD_SSE)
+# include <xmmintrin.h>
+#elif defined (GE_SIMD_NEON)
+# include <arm_neon.h>
+#endif
+
+using namespace GE;
+using namespace GE::Rendering;
+
+//
+//  BoundingBox
+//
+BoundingBox BoundingBox::fromMinMax(const Vector3& pMin, const Vector3& pMax)
+{
+   return BoundingBox((pMin + pMax) * 0.5f, (pMax - pMin) * 0.5f);
+}
+
+BoundingBox BoundingBox::fromVertexData(const float* pVertexData, uint32_t pVertexCount, uint32_t pVertexStride)
+{
+   if(!pVertexData || pVertexCount == 0u)
+   {
+      return BoundingBox();
+   }
+
+   // the position is always the first attribute of the vertex
+   const uint32_t floatsPerVertex = pVertexStride / sizeof(float);
+   const float* vertex = pVertexData;
+
+   Vector3 min(FLT_MAX);
+   Vector3 max(-FLT_MAX);
+
+   for(uint32_t i = 0u; i < pVertexCount; i++, vertex += floatsPerVertex)
+   {
+      min.X = vertex[0] < min.X ? vertex[0] : min.X;
+      min.Y = vertex[1] < min.Y ? vertex[1] : min.Y;
+      min.Z = vertex[2] < min.Z ? vertex[2] : min.Z;
+
+      max.X = vertex[0] > max.X ? vertex[0] : max.X;
+      max.Y = vertex[1] > max.Y ? vertex[1] : max.Y;
+      max.Z = vertex[2] > max.Z ? vertex[2] : max.Z;
+   }
+
+   return fromMinMax(min, max);
+}
+
+void BoundingBox::transform(const Matrix4& pMatrix, BoundingBox* pOutBox) const
+{
+   GEAssert(pOutBox != this);
+
+   Matrix4Transform(pMatrix, Center, &pOutBox->Center);
+
+   pOutBox->Extents.X =
+      fabsf(pMatrix.m[GE_M4_1_1]) * Extents.X + fabsf(pMatrix.m[GE_M4_1_2]) * Extents.Y + fabsf(pMatrix.m[GE_M4_1_3]) * Extents.Z;
+   pOutBox->Extents.Y =
+      fabsf(pMatrix.m[GE_M4_2_1]) * Extents.X + fabsf(pMatrix.m[GE_M4_2_2]) * Extents.Y + fabsf(pMatrix.m[GE_M4_2_3]) * Extents.Z;
+   pOutBox->Extents.Z =
+      fabsf(pMatrix.m[GE_M4_3_1]) * Extents.X + fabsf(pMatrix.m[GE_M4_3_2]) * Extents.Y + fabsf(pMatrix.m[GE_M4_3_3]) * Extents.Z;
+}
+
+
+//
+//  Frustum
+//
+Frustum::Frustum()
+{
+   // the padding planes have a null normal and a positive distance, so nothing is ever behind them
+   for(uint32_t i = 0u; i < kPaddedPlanesCount; i++)
+   {
+      setPlane(i, 0.0f, 0.0f, 0.0f, 1.0f);
+   }
+}
+
+void Frustum::setPlane(uint32_t pIndex, float pA, float pB, float pC, float pD)
+{
+   GEAssert(pIndex < kPaddedPlanesCount);
+
+   const float length = sqrtf(pA * pA + pB * pB + pC * pC);
+   const float invLength = length > GE_EPSILON ? 1.0f / length : 1.0f;
+
+   mPlaneNormalX[pIndex] = pA * invLength;
+   mPlaneNormalY[pIndex] = pB * invLength;
+   mPlaneNormalZ[pIndex] = pC * invLength;
+   mPlaneDistance[pIndex] = pD * invLength;
+}
+
+void Frustum::extractPlanes(const Matrix4& pViewProjection)
+{
+   const float* m = pViewProjection.m;
+
+   // each plane is the sum or the difference of the fourth row and one of the other rows
+   setPlane((uint32_t)Plane::Left,
+      m[GE_M4_4_1] + m[GE_M4_1_1], m[GE_M4_4_2] + m[GE_M4_1_2], m[GE_M4_4_3] + m[GE_M4_1_3], m[GE_M4_4_4] + m[GE_M4_1_4]);
+   setPlane((uint32_t)Plane::Right,
+      m[GE_M4_4_1] - m[GE_M4_1_1], m[GE_M4_4_2] - m[GE_M4_1_2], m[GE_M4_4_3] - m[GE_M4_1_3], m[GE_M4_4_4] - m[GE_M4_1_4]);
+   setPlane((uint32_t)Plane::Bottom,
+      m[GE_M4_4_1] + m[GE_M4_2_1], m[GE_M4_4_2] + m[GE_M4_2_2], m[GE_M4_4_3] + m[GE_M4_2_3], m[GE_M4_4_4] + m[GE_M4_2_4]);
+   setPlane((uint32_t)Plane::Top,
+      m[GE_M4_4_1] - m[GE_M4_2_1], m[GE_M4_4_2] - m[GE_M4_2_2], m[GE_M4_4_3] - m[GE_M4_2_3], m[GE_M4_4_4] - m[GE_M4_2_4]);
+   setPlane((uint32_t)Plane::Near,
+      m[GE_M4_4_1] + m[GE_M4_3_1], m[GE_M4_4_2] + m[GE_M4_3_2], m[GE_M4_4_3] + m[GE_M4_3_3], m[GE_M4_4_4] + m[GE_M4_3_4]);
+   setPlane((uint32_t)Plane::Far,
+      m[GE_M4_4_1] - m[GE_M4_3_1], m[GE_M4_4_2] - m[GE_M4_3_2], m[GE_M4_4_3] - m[GE_M4_3_3], m[GE_M4_4_4] - m[GE_M4_3_4]);
+}
+
+bool Frustum::intersects(const BoundingBox& pBox) const
+{
+   // the box is outside when it lies completely behind any of the planes, that is, when the signed
+   // distance from its center plus its extents projected onto the plane normal is negative
+#if defined (GE_SIMD_SSE)
+   const __m128 signMask = _mm_set1_ps(-0.0f);
+   const __m128 centerX = _mm_set1_ps(pBox.Center.X);
+   const __m128 centerY = _mm_set1_ps(pBox.Center.Y);
+   const __m128 centerZ = _mm_set1_ps(pBox.Center.Z);
+   const __m128 extentsX = _mm_set1_ps(pBox.Extents.X);
+   const __m128 extentsY = _mm_set1_ps(pBox.Extents.Y);
+   const __m128 extentsZ = _mm_set1_ps(pBox.Extents.Z);
+
+   for(uint32_t i = 0u; i < kPaddedPlanesCount; i += 4u)
+   {
+      const __m128 normalX = _mm_load_ps(&mPlaneNormalX[i]);
+      const __m128 normalY = _mm_load_ps(&mPlaneNormalY[i]);
+      const __m128 normalZ = _mm_load_ps(&mPlaneNormalZ[i]);
+
+      __m128 distance = _mm_load_ps(&mPlaneDistance[i]);
+      distance = _mm_add_ps(distance, _mm_mul_ps(normalX, centerX));
+      distance = _mm_add_ps(distance, _mm_mul_ps(normalY, centerY));
+      distance = _mm_add_ps(distance, _mm_mul_ps(normalZ, centerZ));
+
+      __m128 radius = _mm_mul_ps(_mm_andnot_ps(signMask, normalX), extentsX);
+      radius = _mm_add_ps(radius, _mm_mul_ps(_mm_andnot_ps(signMask, normalY), extentsY));
+      radius = _mm_add_ps(radius, _mm_mul_ps(_mm_andnot_ps(signMask, normalZ), extentsZ));
+
+      if(_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps())) != 0)
+      {
+         return false;
+      }
+   }
+
+   return true;
+#elif defined (GE_SIMD_NEON)
+   const float32x4_t centerX = vdupq_n_f32(pBox.Center.X);
+   const float32x4_t centerY = vdupq_n_f32(pBox.Center.Y);
+   const float32x4_t centerZ = vdupq_n_f32(pBox.Center.Z);
+   const float32x4_t extentsX = vdupq_n_f32(pBox.Extents.X);
+   const float32x4_t extentsY = vdupq_n_f32(pBox.Extents.Y);
+   const float32x4_t extentsZ = vdupq_n_f32(pBox.Extents.Z);
+
+   for(uint32_t i = 0u; i < kPaddedPlanesCount; i += 4u)
+   {
+      const float32x4_t normalX = vld1q_f32(&mPlaneNormalX[i]);
+      const float32x4_t normalY = vld1q_f32(&mPlaneNormalY[i]);
+      const float32x4_t normalZ = vld1q_f32(&mPlaneNormalZ[i]);
+
+      float32x4_t distance = vld1q_f32(&mPlaneDistance[i]);
+      distance = vmlaq_f32(distance, normalX, centerX);
+      distance = vmlaq_f32(distance, normalY, centerY);
+      distance = vmlaq_f32(distance, normalZ, centerZ);
+
+      float32x4_t radius = vmulq_f32(vabsq_f32(normalX), extentsX);
+      radius = vmlaq_f32(radius, vabsq_f32(normalY), extentsY);
+      radius = vmlaq_f32(radius, vabsq_f32(normalZ), extentsZ);
+
+      const uint32x4_t outside = vcltq_f32(vaddq_f32(distance, radius), vdupq_n_f32(0.0f));
+      const uint32x2_t outsidePairs = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+
+      if(vget_lane_u32(vpmax_u32(outsidePairs, outsidePairs), 0) != 0u)
+      {
+         return false;
+      }
+   }
+
+   return true;
+#else
+   for(uint32_t i = 0u; i < (uint32_t)Plane::Count; i++)
+   {
+      const float distance =
+         mPlaneNormalX[i] * pBox.Center.X + mPlaneNormalY[i] * pBox.Center.Y + mPlaneNormalZ[i] * pBox.Center.Z + mPlaneDistance[i];
+      const float radius =
+         fabsf(mPlaneNormalX[i]) * pBox.Extents.X + fabsf(mPlaneNormalY[i]) * pBox.Extents.Y + fabsf(mPlaneNormalZ[i]) * pBox.Extents.Z;
+
+      if(distance + radius < 0.0f)
+      {
+         return false;
+      }
+   }
+
+   return true;
+#endif
+}
+
+bool Frustum::intersects(const BoundingSphere& pSphere) const
+{
+#if defined (GE_SIMD_SSE)
+   const __m128 centerX = _mm_set1_ps(pSphere.Center.X);
+   const __m128 centerY = _mm_set1_ps(pSphere.Center.Y);
+   const __m128 centerZ = _mm_set1_ps(pSphere.Center.Z);
+   const __m128 negativeRadius = _mm_set1_ps(-pSphere.Radius);
+
+   for(uint32_t i = 0u; i < kPaddedPlanesCount; i += 4u)
+   {
+      __m128 distance = _mm_load_ps(&mPlaneDistance[i]);
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_load_ps(&mPlaneNormalX[i]), centerX));
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_load_ps(&mPlaneNormalY[i]), centerY));
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_load_ps(&mPlaneNormalZ[i]), centerZ));
+
+      if(_mm_movemask_ps(_mm_cmplt_ps(distance, negativeRadius)) != 0)
+      {
+         return false;
+      }
+   }
+
+   return true;
+#elif defined (GE_SIMD_NEON)
+   const float32x4_t centerX = vdupq_n_f32(pSphere.Center.X);
+   const float32x4_t centerY = vdupq_n_f32(pSphere.Center.Y);
+   const float32x4_t centerZ = vdupq_n_f32(pSphere.Center.Z);
+   const float32x4_t negativeRadius = vdupq_n_f32(-pSphere.Radius);
+
+   for(uint32_t i = 0u; i < kPaddedPlanesCount; i += 4u)
+   {
+      float32x4_t distance = vld1q_f32(&mPlaneDistance[i]);
+      distance = vmlaq_f32(distance, vld1q_f32(&mPlaneNormalX[i]), centerX);
+      distance = vmlaq_f32(distance, vld1q_f32(&mPlaneNormalY[i]), centerY);
+      distance = vmlaq_f32(distance, vld1q_f32(&mPlaneNormalZ[i]), centerZ);
+
+      const uint32x4_t outside = vcltq_f32(distance, negativeRadius);
+      const uint32x2_t outsidePairs = vorr_u32(vget_low_u32(outside), vget_high_u32(outside));
+
+      if(vget_lane_u32(vpmax_u32(outsidePairs, outsidePairs), 0) != 0u)
+      {
+         return false;
+      }
+   }
+
+   return true;
+#else
+   for(uint32_t i = 0u; i < (uint32_t)Plane::Count; i++)
+   {
+      const float distance =
+         mPlaneNormalX[i] * pSphere.Center.X + mPlaneNormalY[i] * pSphere.Center.Y + mPlaneNormalZ[i] * pSphere.Center.Z + mPlaneDistance[i];
+
+      if(distance < -pSphere.Radius)
+      {
+         return false;
+      }
+   }
+
+   return true;
+#endif
+}
@@ -0,0 +1,108 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GEFrustum.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Types/GETypes.h"
+
+#include <cstdint>
+
+namespace GE { namespace Rendering
+{
+   //
+   //  BoundingBox
+   //
+   //  Axis-aligned box stored as center and half extents, which is the form the frustum test uses
+   //
+   struct BoundingBox
+   {
+      Vector3 Center;
+      Vector3 Extents;
+
+      BoundingBox()
+         : Center(Vector3::Zero)
+         , Extents(Vector3::Zero)
+      {
+      }
+
+      BoundingBox(const Vector3& pCenter, const Vector3& pExtents)
+         : Center(pCenter)
+         , Extents(pExtents)
+      {
+      }
+
+      static BoundingBox fromMinMax(const Vector3& pMin, const Vector3& pMax);
+      static BoundingBox fromVertexData(const float* pVertexData, uint32_t pVertexCount, uint32_t pVertexStride);
+
+      void transform(const Matrix4& pMatrix, BoundingBox* pOutBox) const;
+   };
+
+
+   struct BoundingSphere
+   {
+      Vector3 Center;
+      float Radius;
+
+      BoundingSphere()
+         : Center(Vector3::Zero)
+         , Radius(0.0f)
+      {
+      }
+
+      BoundingSphere(const Vector3& pCenter, float pRadius)
+         : Center(pCenter)
+         , Radius(pRadius)
+      {
+      }
+   };
+
+
+   //
+   //  Frustum
+   //
+   //  View frustum planes extracted from a view-projection matrix. The planes are kept in
+   //  structure-of-arrays layout and padded to eight, so that they can be tested four at a time
+   //
+   class Frustum
+   {
+   public:
+      enum class Plane
+      {
+         Left,
+         Right,
+         Bottom,
+         Top,
+         Near,
+         Far,
+
+         Count
+      };
+
+   private:
+      static const uint32_t kPaddedPlanesCount = 8u;
+
+      alignas(16) float mPlaneNormalX[kPaddedPlanesCount];
+      alignas(16) float mPlaneNormalY[kPaddedPlanesCount];
+      alignas(16) float mPlaneNormalZ[kPaddedPlanesCount];
+      alignas(16) float mPlaneDistance[kPaddedPlanesCount];
+
+      void setPlane(uint32_t pIndex, float pA, float pB, float pC, float pD);
+
+   public:
+      Frustum();
+
+      void extractPlanes(const Matrix4& pViewProjection);
+
+      bool intersects(const BoundingBox& pBox) const;
+      bool intersects(const BoundingSphere& pSphere) const;
+   };
+}}
@@ -0,0 +1,269 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GEGPUBufferAllocator.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "GEGPUBufferAllocator.h"
+
+#include <algorithm>
+
+using namespace GE;
+using namespace GE::Rendering;
+
+static const uint32_t kInvalidIndex = 0xffffffffu;
+
+//
+//  GPUBufferAllocator
+//
+GPUBufferAllocator::GPUBufferAllocator()
+   : mCapacity(0u)
+   , mGranularity(1u)
+   , mUsedSize(0u)
+   , mAllocationsCount(0u)
+{
+}
+
+void GPUBufferAllocator::init(uint32_t pCapacity, uint32_t pGranularity)
+{
+   GEAssert(pGranularity > 0u);
+
+   // the tail that cannot hold a whole unit is never handed out
+   mGranularity = pGranularity;
+   mCapacity = (pCapacity / pGranularity) * pGranularity;
+
+   mSlots.clear();
+   mFreeSlots.clear();
+
+   reset();
+}
+
+void GPUBufferAllocator::reset()
+{
+   // handles given out so far become stale, but the slots are kept for the next allocations
+   mFreeSlots.clear();
+
+   for(uint32_t i = 0u; i < (uint32_t)mSlots.size(); i++)
+   {
+      Slot& slot = mSlots[i];
+
+      if(slot.Used)
+      {
+         const uint32_t generation = (slot.Generation + 1u) & GPUBufferHandle::GenerationMask;
+         slot.Generation = generation ? generation : 1u;
+         slot.Used = false;
+      }
+
+      mFreeSlots.push_back(i);
+   }
+
+   mFreeBlocks.clear();
+
+   if(mCapacity > 0u)
+   {
+      mFreeBlocks.push_back(GPUBufferBlock(0u, mCapacity));
+   }
+
+   mUsedSize = 0u;
+   mAllocationsCount = 0u;
+}
+
+GPUBufferHandle GPUBufferAllocator::allocate(uint32_t pSize)
+{
+   if(pSize == 0u)
+      return GPUBufferHandle();
+
+   const uint32_t size = ((pSize + mGranularity - 1u) / mGranularity) * mGranularity;
+
+   // best fit, so that the large ranges are kept for the large allocations
+   uint32_t bestFreeBlock = kInvalidIndex;
+
+   for(uint32_t i = 0u; i < (uint32_t)mFreeBlocks.size(); i++)
+   {
+      const uint32_t freeBlockSize = mFreeBlocks[i].Size;
+
+      if(freeBlockSize >= size && (bestFreeBlock == kInvalidIndex || freeBlockSize < mFreeBlocks[bestFreeBlock].Size))
+      {
+         bestFreeBlock = i;
+
+         if(freeBlockSize == size)
+            break;
+      }
+   }
+
+   if(bestFreeBlock == kInvalidIndex)
+      return GPUBufferHandle();
+
+   GPUBufferBlock& freeBlock = mFreeBlocks[bestFreeBlock];
+   const GPUBufferBlock block(freeBlock.Offset, size);
+
+   if(freeBlock.Size == size)
+   {
+      mFreeBlocks.erase(mFreeBlocks.begin() + bestFreeBlock);
+   }
+   else
+   {
+      freeBlock.Offset += size;
+      freeBlock.Size -= size;
+   }
+
+   uint32_t slotIndex = 0u;
+
+   if(mFreeSlots.empty())
+   {
+      slotIndex = (uint32_t)mSlots.size();
+      GEAssert(slotIndex <= GPUBufferHandle::IndexMask);
+      mSlots.push_back(Slot());
+   }
+   else
+   {
+      slotIndex = mFreeSlots.back();
+      mFreeSlots.pop_back();
+   }
+
+   Slot& slot = mSlots[slotIndex];
+   slot.Block = block;
+   slot.Used = true;
+
+   mUsedSize += size;
+   mAllocationsCount++;
+
+   return GPUBufferHandle(slotIndex, slot.Generation);
+}
+
+void GPUBufferAllocator::release(GPUBufferHandle pHandle)
+{
+   GEAssert(isValid(pHandle));
+
+   Slot& slot = mSlots[pHandle.getIndex()];
+   insertFreeBlock(slot.Block);
+
+   mUsedSize -= slot.Block.Size;
+   mAllocationsCount--;
+
+   const uint32_t generation = (slot.Generation + 1u) & GPUBufferHandle::GenerationMask;
+   slot.Generation = generation ? generation : 1u;
+   slot.Used = false;
+
+   mFreeSlots.push_back(pHandle.getIndex());
+}
+
+void GPUBufferAllocator::insertFreeBlock(const GPUBufferBlock& pBlock)
+{
+   GESTLVector(GPUBufferBlock)::iterator next = std::lower_bound(mFreeBlocks.begin(), mFreeBlocks.end(), pBlock,
+      [](const GPUBufferBlock& pFreeBlock, const GPUBufferBlock& pOther) { return pFreeBlock.Offset < pOther.Offset; });
+
+   const bool mergeWithPrevious = next != mFreeBlocks.begin() && (next - 1)->Offset + (next - 1)->Size == pBlock.Offset;
+   const bool mergeWithNext = next != mFreeBlocks.end() && pBlock.Offset + pBlock.Size == next->Offset;
+
+   if(mergeWithPrevious && mergeWithNext)
+   {
+      (next - 1)->Size += pBlock.Size + next->Size;
+      mFreeBlocks.erase(next);
+   }
+   else if(mergeWithPrevious)
+   {
+      (next - 1)->Size += pBlock.Size;
+   }
+   else if(mergeWithNext)
+   {
+      next->Offset = pBlock.Offset;
+      next->Size += pBlock.Size;
+   }
+   else
+   {
+      mFreeBlocks.insert(next, pBlock);
+   }
+}
+
+uint32_t GPUBufferAllocator::defragment(GESTLVector(GPUBufferMove)* pOutMoves)
+{
+   // nothing to pack when the free space is already a single range at the end
+   if(mFreeBlocks.empty() ||
+      (mFreeBlocks.size() == 1u && mFreeBlocks[0].Offset + mFreeBlocks[0].Size == mCapacity))
+   {
+      return 0u;
+   }
+
+   GESTLVector(uint32_t) usedSlots;
+   usedSlots.reserve(mAllocationsCount);
+
+   for(uint32_t i = 0u; i < (uint32_t)mSlots.size(); i++)
+   {
+      if(mSlots[i].Used)
+      {
+         usedSlots.push_back(i);
+      }
+   }
+
+   std::sort(usedSlots.begin(), usedSlots.end(),
+      [this](uint32_t pSlot1, uint32_t pSlot2) { return mSlots[pSlot1].Block.Offset < mSlots[pSlot2].Block.Offset; });
+
+   uint32_t movesCount = 0u;
+   uint32_t currentOffset = 0u;
+
+   for(size_t i = 0u; i < usedSlots.size(); i++)
+   {
+      Slot& slot = mSlots[usedSlots[i]];
+
+      if(slot.Block.Offset != currentOffset)
+      {
+         if(pOutMoves)
+         {
+            GPUBufferMove move;
+            move.Handle = GPUBufferHandle(usedSlots[i], slot.Generation);
+            move.SourceOffset = slot.Block.Offset;
+            move.DestinationOffset = currentOffset;
+            move.Size = slot.Block.Size;
+            pOutMoves->push_back(move);
+         }
+
+         slot.Block.Offset = currentOffset;
+         movesCount++;
+      }
+
+      currentOffset += slot.Block.Size;
+   }
+
+   mFreeBlocks.clear();
+
+   if(currentOffset < mCapacity)
+   {
+      mFreeBlocks.push_back(GPUBufferBlock(currentOffset, mCapacity - currentOffset));
+   }
+
+   return movesCount;
+}
+
+bool GPUBufferAllocator::isValid(GPUBufferHandle pHandle) const
+{
+   if(!pHandle.isValid() || pHandle.getIndex() >= (uint32_t)mSlots.size())
+      return false;
+
+   const Slot& slot = mSlots[pHandle.getIndex()];
+   return slot.Used && slot.Generation == pHandle.getGeneration();
+}
+
+const GPUBufferBlock& GPUBufferAllocator::getBlock(GPUBufferHandle pHandle) const
+{
+   GEAssert(isValid(pHandle));
+   return mSlots[pHandle.getIndex()].Block;
+}
+
+uint32_t GPUBufferAllocator::getLargestFreeBlockSize() const
+{
+   uint32_t largestFreeBlockSize = 0u;
+
+   for(size_t i = 0u; i < mFreeBlocks.size(); i++)
+   {
+      largestFreeBlockSize = GEMax(largestFreeBlockSize, mFreeBlocks[i].Size);
+   }
+
+   return largestFreeBlockSize;
+}
@@ -0,0 +1,111 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GEGPUBufferAllocator.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Types/GETypes.h"
+#include "Entities/GEHandle.h"
+
+#include <cstdint>
+
+namespace GE { namespace Rendering
+{
+   struct GPUBufferBlock
+   {
+      uint32_t Offset;
+      uint32_t Size;
+
+      GPUBufferBlock()
+         : Offset(0u)
+         , Size(0u)
+      {
+      }
+
+      GPUBufferBlock(uint32_t pOffset, uint32_t pSize)
+         : Offset(pOffset)
+         , Size(pSize)
+      {
+      }
+   };
+
+   typedef Entities::Handle<GPUBufferBlock> GPUBufferHandle;
+
+
+   struct GPUBufferMove
+   {
+      GPUBufferHandle Handle;
+      uint32_t SourceOffset;
+      uint32_t DestinationOffset;
+      uint32_t Size;
+   };
+
+
+   //
+   //  GPUBufferAllocator
+   //
+   //  Sub-allocates ranges of a buffer that lives elsewhere, so it only keeps offsets and never
+   //  touches the buffer itself. Free ranges are kept sorted by offset and merged with their
+   //  neighbours when released, and allocations take the smallest range they fit in. Every size
+   //  is rounded up to the granularity, so that all the offsets stay multiples of it
+   //
+   class GPUBufferAllocator
+   {
+   private:
+      struct Slot
+      {
+         GPUBufferBlock Block;
+         uint32_t Generation;
+         bool Used;
+
+         Slot()
+            : Generation(1u)
+            , Used(false)
+         {
+         }
+      };
+
+      uint32_t mCapacity;
+      uint32_t mGranularity;
+      uint32_t mUsedSize;
+      uint32_t mAllocationsCount;
+
+      GESTLVector(Slot) mSlots;
+      GESTLVector(uint32_t) mFreeSlots;
+      GESTLVector(GPUBufferBlock) mFreeBlocks;
+
+      void insertFreeBlock(const GPUBufferBlock& pBlock);
+
+   public:
+      GPUBufferAllocator();
+
+      void init(uint32_t pCapacity, uint32_t pGranularity);
+      void reset();
+
+      GPUBufferHandle allocate(uint32_t pSize);
+      void release(GPUBufferHandle pHandle);
+
+      // packs all the allocations at the beginning of the buffer and returns the number of moved ones.
+      // The moves come in ascending offset order and never overlap a range that is yet to be moved
+      uint32_t defragment(GESTLVector(GPUBufferMove)* pOutMoves = nullptr);
+
+      bool isValid(GPUBufferHandle pHandle) const;
+      const GPUBufferBlock& getBlock(GPUBufferHandle pHandle) const;
+
+      uint32_t getCapacity() const { return mCapacity; }
+      uint32_t getGranularity() const { return mGranularity; }
+      uint32_t getUsedSize() const { return mUsedSize; }
+      uint32_t getFreeSize() const { return mCapacity - mUsedSize; }
+      uint32_t getLargestFreeBlockSize() const;
+      uint32_t getAllocationsCount() const { return mAllocationsCount; }
+      uint32_t getFreeBlocksCount() const { return (uint32_t)mFreeBlocks.size(); }
+   };
+}}
@@ -0,0 +1,438 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GERenderCommandBuffer.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "GERenderCommandBuffer.h"
+#include "GEMaterial.h"
+#include "Core/GELog.h"
+
+#include <cstring>
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Rendering;
+
+//
+//  RenderConstants
+//
+void RenderConstants::record(const RenderOperation& pRenderOperation)
+{
+   MaterialPass* materialPass = pRenderOperation.mRenderMaterialPass;
+
+   Operation = pRenderOperation;
+   Operation.mRenderMaterialPass = nullptr;
+   Operation.mData = nullptr;
+
+   OperationMaterial = materialPass->getMaterial();
+   VertexStride = pRenderOperation.mData->VertexStride;
+   IndexCount = pRenderOperation.mData->NumIndices;
+   HasVertexParameters = materialPass->hasVertexParameters();
+   HasFragmentParameters = materialPass->hasFragmentParameters();
+
+   if(HasVertexParameters)
+   {
+      memcpy(VertexParameters, materialPass->getConstantBufferDataVertex(), Material::ConstantBufferSize);
+   }
+
+   if(HasFragmentParameters)
+   {
+      memcpy(FragmentParameters, materialPass->getConstantBufferDataFragment(), Material::ConstantBufferSize);
+   }
+}
+
+
+//
+//  RenderShadowCaster
+//
+void RenderShadowCaster::record(const RenderOperation& pRenderOperation, const GeometryRenderInfo& pGeometry)
+{
+   Operation = pRenderOperation;
+   Operation.mRenderMaterialPass = nullptr;
+   Operation.mData = nullptr;
+
+   CasterMaterial = pRenderOperation.mRenderMaterialPass->getMaterial();
+   VertexStride = pRenderOperation.mData->VertexStride;
+   IndexCount = pRenderOperation.mData->NumIndices;
+   Geometry = pGeometry;
+}
+
+
+//
+//  RenderCommandBuffer
+//
+RenderCommandBuffer::RenderCommandBuffer()
+   : mUploadStaging(false)
+{
+}
+
+uint32_t RenderCommandBuffer::stage(const void* pData, uint32_t pSize)
+{
+   // keep every block 4-byte aligned, since vertex data is read as floats
+   const uint32_t offset = ((uint32_t)mStagingData.size() + 3u) & ~3u;
+   mStagingData.resize(offset + pSize);
+   memcpy(&mStagingData[offset], pData, pSize);
+
+   return offset;
+}
+
+void RenderCommandBuffer::beginFrame()
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::BeginFrame;
+   mCommands.push_back(command);
+}
+
+void RenderCommandBuffer::endFrame()
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::EndFrame;
+   mCommands.push_back(command);
+}
+
+void RenderCommandBuffer::renderShadowMap()
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::RenderShadowMap;
+   mCommands.push_back(command);
+}
+
+void RenderCommandBuffer::useMaterial(Material* pMaterial)
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::UseMaterial;
+   command.MaterialToUse = pMaterial;
+   mCommands.push_back(command);
+}
+
+void RenderCommandBuffer::bindBuffers(uint16_t pGroup)
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::BindBuffers;
+   command.Group = pGroup;
+   mCommands.push_back(command);
+}
+
+void RenderCommandBuffer::bindTexture(uint8_t pSlot, const Texture* pTexture)
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::BindTexture;
+   command.Slot = pSlot;
+   command.TextureToBind = pTexture;
+   mCommands.push_back(command);
+}
+
+uint32_t RenderCommandBuffer::recordOperation(const RenderOperation& pRenderOperation)
+{
+   mOperations.emplace_back();
+   mOperations.back().record(pRenderOperation);
+
+   return (uint32_t)mOperations.size() - 1u;
+}
+
+uint32_t RenderCommandBuffer::setConstants(const RenderOperation& pRenderOperation)
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::SetConstants;
+   command.OperationIndex = recordOperation(pRenderOperation);
+   mCommands.push_back(command);
+
+   return command.OperationIndex;
+}
+
+void RenderCommandBuffer::uploadGeometry(uint16_t pGroup, const Content::GeometryData* pData,
+   uint32_t pVertexOffset, uint32_t pIndexOffset, uint16_t pIndexSize)
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::UploadGeometry;
+   command.Group = pGroup;
+   command.IndexSize = pIndexSize;
+   command.VertexOffset = pVertexOffset;
+   command.IndexOffset = pIndexOffset;
+
+   if(mUploadStaging)
+   {
+      // the staging storage may still grow, so the data pointers are resolved when the buffer is closed
+      StagedUpload stagedUpload;
+      stagedUpload.VertexDataOffset = stage(pData->VertexData, pData->NumVertices * pData->VertexStride);
+      stagedUpload.IndicesOffset = stage(pData->Indices, pData->NumIndices * sizeof(ushort));
+
+      command.OperationIndex = (uint32_t)mStagedGeometry.size();
+      mStagedGeometry.push_back(*pData);
+      mStagedUploads.push_back(stagedUpload);
+   }
+   else
+   {
+      command.Data = pData;
+   }
+
+   mCommands.push_back(command);
+}
+
+void RenderCommandBuffer::waitForGPU()
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::WaitForGPU;
+   mCommands.push_back(command);
+}
+
+void RenderCommandBuffer::draw(uint32_t pOperationIndex, uint16_t pGroup,
+   uint32_t pVertexOffset, uint32_t pIndexOffset, uint32_t pIndexCount, uint16_t pIndexSize)
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::Draw;
+   command.Group = pGroup;
+   command.IndexSize = pIndexSize;
+   command.OperationIndex = pOperationIndex;
+   command.VertexOffset = pVertexOffset;
+   command.IndexOffset = pIndexOffset;
+   command.IndexCount = pIndexCount;
+   mCommands.push_back(command);
+}
+
+void RenderCommandBuffer::drawInstanced(uint32_t pOperationIndex, uint16_t pGroup,
+   uint32_t pVertexOffset, uint32_t pIndexOffset, uint32_t pIndexCount, uint16_t pIndexSize,
+   uint32_t pFirstInstance, uint32_t pInstanceCount)
+{
+   RenderCommand command;
+   command.Type = RenderCommandType::DrawInstanced;
+   command.Group = pGroup;
+   command.IndexSize = pIndexSize;
+   command.OperationIndex = pOperationIndex;
+   command.VertexOffset = pVertexOffset;
+   command.IndexOffset = pIndexOffset;
+   command.IndexCount = pIndexCount;
+   command.FirstInstance = pFirstInstance;
+   command.InstanceCount = pInstanceCount;
+   mCommands.push_back(command);
+}
+
+uint32_t RenderCommandBuffer::pushInstance(const Matrix4& pWorldTransform, const Color& pColor)
+{
+   RenderInstance instance;
+   instance.WorldTransform = pWorldTransform;
+   instance.InstanceColor = pColor;
+   mInstances.push_back(instance);
+
+   return (uint32_t)mInstances.size() - 1u;
+}
+
+void RenderCommandBuffer::close()
+{
+   if(mStagedGeometry.empty())
+      return;
+
+   for(size_t i = 0u; i < mStagedGeometry.size(); i++)
+   {
+      mStagedGeometry[i].VertexData = (float*)&mStagingData[mStagedUploads[i].VertexDataOffset];
+      mStagedGeometry[i].Indices = (ushort*)&mStagingData[mStagedUploads[i].IndicesOffset];
+   }
+
+   for(size_t i = 0u; i < mCommands.size(); i++)
+   {
+      RenderCommand& command = mCommands[i];
+
+      if(command.Type == RenderCommandType::UploadGeometry && !command.Data)
+      {
+         command.Data = &mStagedGeometry[command.OperationIndex];
+      }
+   }
+}
+
+void RenderCommandBuffer::clear()
+{
+   mCommands.clear();
+   mOperations.clear();
+   mInstances.clear();
+
+   mFrameState.Lights.clear();
+   mFrameState.ShadowCascades.clear();
+   mFrameState.StaticShadowedMeshes.clear();
+   mFrameState.DynamicShadowedMeshes.clear();
+   mFrameState.ShadowedParticles.clear();
+   mFrameState.StaticShadowLayerUpdatePending = false;
+   mFrameState.ShadowMapResizePending = false;
+
+   mStagedGeometry.clear();
+   mStagedUploads.clear();
+   mStagingData.clear();
+}
+
+
+//
+//  RenderCommandBackendNull
+//
+RenderCommandBackendNull::RenderCommandBackendNull()
+{
+   reset();
+}
+
+void RenderCommandBackendNull::reset()
+{
+   for(uint32_t i = 0u; i < (uint32_t)RenderCommandType::Count; i++)
+   {
+      mCommandCounts[i] = 0u;
+   }
+
+   mDrawnIndices = 0u;
+   mDrawnInstances = 0u;
+   mUploadedBytes = 0u;
+   mValidationErrors = 0u;
+   mRedundantCommands = 0u;
+}
+
+bool RenderCommandBackendNull::validate(const RenderCommandBuffer& pCommandBuffer, const RenderCommand& pCommand, bool pInFrame,
+   const Material* pMaterial, uint16_t pBoundGroup, uint32_t pConstantsOperation) const
+{
+   const bool validIndexSize = pCommand.IndexSize == 2u || pCommand.IndexSize == 4u;
+
+   switch(pCommand.Type)
+   {
+   case RenderCommandType::BeginFrame:
+      return !pInFrame;
+
+   case RenderCommandType::EndFrame:
+      return pInFrame;
+
+   case RenderCommandType::RenderShadowMap:
+      return pInFrame && !pCommandBuffer.getFrameState().Lights.empty();
+
+   case RenderCommandType::UseMaterial:
+      return pCommand.MaterialToUse != nullptr;
+
+   case RenderCommandType::BindBuffers:
+      return pCommand.Group < GeometryGroup::Count;
+
+   case RenderCommandType::BindTexture:
+      return true;
+
+   case RenderCommandType::SetConstants:
+      return
+         pCommand.OperationIndex < pCommandBuffer.getOperationsCount() &&
+         pCommandBuffer.getOperation(pCommand.OperationIndex).OperationMaterial != nullptr;
+
+   case RenderCommandType::UploadGeometry:
+      return pCommand.Data != nullptr && pCommand.Group < GeometryGroup::Count && validIndexSize;
+
+   case RenderCommandType::WaitForGPU:
+      return true;
+
+   case RenderCommandType::Draw:
+   case RenderCommandType::DrawInstanced:
+      {
+         // a draw needs the material and the buffers, and a single draw the constants of its own operation as well.
+         // Instanced draws set their constants themselves
+         if(!pInFrame || !pMaterial || pBoundGroup != pCommand.Group || pCommand.OperationIndex >= pCommandBuffer.getOperationsCount())
+            return false;
+
+         if(pCommand.Type == RenderCommandType::Draw && pConstantsOperation != pCommand.OperationIndex)
+            return false;
+
+         if(pCommand.Type == RenderCommandType::DrawInstanced &&
+            (pCommand.InstanceCount == 0u || pCommand.FirstInstance + pCommand.InstanceCount > pCommandBuffer.getInstancesCount()))
+            return false;
+
+         const RenderConstants& constants = pCommandBuffer.getOperation(pCommand.OperationIndex);
+
+         return
+            constants.OperationMaterial == pMaterial &&
+            pCommand.IndexCount > 0u &&
+            validIndexSize;
+      }
+
+   default:
+      return false;
+   }
+}
+
+void RenderCommandBackendNull::execute(const RenderCommandBuffer& pCommandBuffer)
+{
+   bool inFrame = false;
+   const Material* material = nullptr;
+   uint16_t boundGroup = kNoGroup;
+   uint32_t constantsOperation = pCommandBuffer.getOperationsCount();
+   const Texture* boundTextures[kTextureSlotsCount] = { nullptr };
+   uint32_t invalidCommands = 0u;
+   uint32_t redundantCommands = 0u;
+
+   for(uint32_t i = 0u; i < pCommandBuffer.size(); i++)
+   {
+      const RenderCommand& command = pCommandBuffer[i];
+
+      if(!validate(pCommandBuffer, command, inFrame, material, boundGroup, constantsOperation))
+      {
+         invalidCommands++;
+         continue;
+      }
+
+      mCommandCounts[(uint32_t)command.Type]++;
+
+      switch(command.Type)
+      {
+      case RenderCommandType::BeginFrame:
+         inFrame = true;
+         break;
+
+      case RenderCommandType::EndFrame:
+         inFrame = false;
+         break;
+
+      case RenderCommandType::UseMaterial:
+         redundantCommands += material == command.MaterialToUse ? 1u : 0u;
+         material = command.MaterialToUse;
+         break;
+
+      case RenderCommandType::BindBuffers:
+         redundantCommands += boundGroup == command.Group ? 1u : 0u;
+         boundGroup = command.Group;
+         break;
+
+      case RenderCommandType::BindTexture:
+         // binding no texture keeps the current one, as the backends do
+         if(command.TextureToBind && command.Slot < kTextureSlotsCount)
+         {
+            redundantCommands += boundTextures[command.Slot] == command.TextureToBind ? 1u : 0u;
+            boundTextures[command.Slot] = command.TextureToBind;
+         }
+         break;
+
+      case RenderCommandType::SetConstants:
+         constantsOperation = command.OperationIndex;
+         break;
+
+      case RenderCommandType::UploadGeometry:
+         mUploadedBytes +=
+            (uint64_t)command.Data->NumVertices * command.Data->VertexStride +
+            (uint64_t)command.Data->NumIndices * command.IndexSize;
+         break;
+
+      case RenderCommandType::Draw:
+         mDrawnIndices += command.IndexCount;
+         mDrawnInstances++;
+         break;
+
+      case RenderCommandType::DrawInstanced:
+         mDrawnIndices += command.IndexCount * command.InstanceCount;
+         mDrawnInstances += command.InstanceCount;
+         break;
+
+      default:
+         break;
+      }
+   }
+
+   mRedundantCommands += redundantCommands;
+
+   if(invalidCommands > 0u)
+   {
+      Log::log(LogType::Warning, "Null render backend: %u invalid commands found in a buffer of %u", invalidCommands, pCommandBuffer.size());
+      mValidationErrors += invalidCommands;
+   }
+}
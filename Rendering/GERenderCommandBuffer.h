@@ -0,0 +1,334 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GERenderCommandBuffer.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GERenderingObjects.h"
+#include "GEMaterial.h"
+
+#include <cstdint>
+#include <atomic>
+
+namespace GE { namespace Rendering
+{
+
+   enum class RenderCommandType : uint8_t
+   {
+      BeginFrame,
+      EndFrame,
+      RenderShadowMap,
+      UseMaterial,
+      BindBuffers,
+      BindTexture,
+      SetConstants,
+      UploadGeometry,
+      WaitForGPU,
+      Draw,
+      DrawInstanced,
+
+      Count
+   };
+
+
+   //
+   //  RenderCommand
+   //
+   //  Fields are shared between command types; each type only reads the ones listed next to them
+   //
+   struct RenderCommand
+   {
+      RenderCommandType Type;
+      uint8_t Slot;              // BindTexture
+      uint16_t Group;            // BindBuffers, UploadGeometry, Draw, DrawInstanced
+      uint16_t IndexSize;        // UploadGeometry, Draw, DrawInstanced
+      uint32_t OperationIndex;   // SetConstants, Draw, DrawInstanced, UploadGeometry (staged geometry index)
+      uint32_t VertexOffset;     // UploadGeometry, Draw, DrawInstanced
+      uint32_t IndexOffset;      // UploadGeometry, Draw, DrawInstanced
+      uint32_t IndexCount;       // Draw, DrawInstanced
+      uint32_t FirstInstance;    // DrawInstanced
+      uint32_t InstanceCount;    // DrawInstanced
+
+      union
+      {
+         Material* MaterialToUse;               // UseMaterial
+         const Texture* TextureToBind;          // BindTexture
+         const Content::GeometryData* Data;     // UploadGeometry
+      };
+
+      RenderCommand()
+         : Type(RenderCommandType::Count)
+         , Slot(0u)
+         , Group(0u)
+         , IndexSize(0u)
+         , OperationIndex(0u)
+         , VertexOffset(0u)
+         , IndexOffset(0u)
+         , IndexCount(0u)
+         , FirstInstance(0u)
+         , InstanceCount(0u)
+         , Data(nullptr)
+      {
+      }
+   };
+
+
+   //
+   //  RenderInstance
+   //
+   //  Per-instance values of an instanced draw. The draw sets the constants of its operation
+   //  itself: with an identity world transform and a white color when the graphics API draws the
+   //  instances in a single call, or with the values of every instance when they are drawn one by one
+   //
+   struct RenderInstance
+   {
+      Matrix4 WorldTransform;
+      Color InstanceColor;
+   };
+
+
+   struct RenderLight
+   {
+      uint32_t Type;
+      Color LightColor;
+      Vector3 Position;
+      Vector3 Direction;
+      float LinearAttenuation;
+      float SpotAngle;
+      float ShadowIntensity;
+   };
+
+
+   //
+   //  RenderConstants
+   //
+   //  The operation of a draw, as the backends read it when the frame is replayed. The material pass
+   //  and the geometry data belong to the renderable, which can be destroyed while a render thread is
+   //  still replaying the frame, so the values read from them are copied and the operation does not
+   //  point to them. Materials and textures are only unloaded after waiting for the render thread
+   //
+   struct RenderConstants
+   {
+      RenderOperation Operation;
+      Material* OperationMaterial;
+      uint32_t VertexStride;
+      uint32_t IndexCount;
+      bool HasVertexParameters;
+      bool HasFragmentParameters;
+      char VertexParameters[Material::ConstantBufferSize];
+      char FragmentParameters[Material::ConstantBufferSize];
+
+      RenderConstants()
+         : OperationMaterial(nullptr)
+         , VertexStride(0u)
+         , IndexCount(0u)
+         , HasVertexParameters(false)
+         , HasFragmentParameters(false)
+      {
+      }
+
+      void record(const RenderOperation& pRenderOperation);
+   };
+
+
+   //
+   //  RenderShadowCaster
+   //
+   //  Casters only need the geometry and the diffuse texture of the material, which are copied
+   //  the same way as in RenderConstants
+   //
+   struct RenderShadowCaster
+   {
+      RenderOperation Operation;
+      Material* CasterMaterial;
+      uint32_t VertexStride;
+      uint32_t IndexCount;
+      GeometryRenderInfo Geometry;
+
+      RenderShadowCaster()
+         : CasterMaterial(nullptr)
+         , VertexStride(0u)
+         , IndexCount(0u)
+      {
+      }
+
+      void record(const RenderOperation& pRenderOperation, const GeometryRenderInfo& pGeometry);
+   };
+
+
+   //
+   //  RenderShadowCascade
+   //
+   //  The casters are rendered with the light view-projection into the cell of the cascade in the
+   //  shadow map, and the receivers sample it through the same matrix remapped to that cell
+   //
+   struct RenderShadowCascade
+   {
+      Matrix4 ViewProjection;
+      Matrix4 ReceiverViewProjection;
+   };
+
+
+   //
+   //  RenderFrameState
+   //
+   //  Scene values the backends read while replaying a frame. They are copied when the frame
+   //  is recorded, so that the scene can already be updated while the frame is being replayed
+   //
+   struct RenderFrameState
+   {
+      Color BackgroundColor;
+      Color AmbientLightColor;
+      Matrix4 ViewProjection2D;
+      Matrix4 CameraViewProjection;
+      Vector3 CameraPosition;
+      GESTLVector(RenderLight) Lights;
+
+      GESTLVector(RenderShadowCascade) ShadowCascades;
+      GESTLVector(RenderShadowCaster) StaticShadowedMeshes;
+      GESTLVector(RenderShadowCaster) DynamicShadowedMeshes;
+      GESTLVector(RenderShadowCaster) ShadowedParticles;
+      uint32_t FrameIndex;
+      bool StaticShadowLayerUpdatePending;
+      bool ShadowMapResizePending;
+
+      RenderFrameState()
+         : FrameIndex(0u)
+         , StaticShadowLayerUpdatePending(false)
+         , ShadowMapResizePending(false)
+      {
+      }
+   };
+
+
+   //
+   //  RenderCommandBuffer
+   //
+   //  API independent list of the commands of a frame. The constants of the render operations
+   //  are copied into the buffer, so that it can be replayed after the queues are cleared and
+   //  the renderables they come from are destroyed. With upload staging enabled, the uploaded
+   //  geometry data is copied as well and the buffer does not reference any data owned by the scene
+   //
+   class RenderCommandBuffer
+   {
+   private:
+      struct StagedUpload
+      {
+         uint32_t VertexDataOffset;
+         uint32_t IndicesOffset;
+      };
+
+      GESTLVector(RenderCommand) mCommands;
+      GESTLVector(RenderConstants) mOperations;
+      GESTLVector(RenderInstance) mInstances;
+      RenderFrameState mFrameState;
+
+      bool mUploadStaging;
+      GESTLVector(Content::GeometryData) mStagedGeometry;
+      GESTLVector(StagedUpload) mStagedUploads;
+      GESTLVector(char) mStagingData;
+
+      uint32_t stage(const void* pData, uint32_t pSize);
+
+   public:
+      RenderCommandBuffer();
+
+      void beginFrame();
+      void endFrame();
+      void renderShadowMap();
+      void useMaterial(Material* pMaterial);
+      void bindBuffers(uint16_t pGroup);
+      void bindTexture(uint8_t pSlot, const Texture* pTexture);
+      uint32_t recordOperation(const RenderOperation& pRenderOperation);
+      uint32_t setConstants(const RenderOperation& pRenderOperation);
+      void uploadGeometry(uint16_t pGroup, const Content::GeometryData* pData,
+         uint32_t pVertexOffset, uint32_t pIndexOffset, uint16_t pIndexSize);
+      void waitForGPU();
+      void draw(uint32_t pOperationIndex, uint16_t pGroup,
+         uint32_t pVertexOffset, uint32_t pIndexOffset, uint32_t pIndexCount, uint16_t pIndexSize);
+      void drawInstanced(uint32_t pOperationIndex, uint16_t pGroup,
+         uint32_t pVertexOffset, uint32_t pIndexOffset, uint32_t pIndexCount, uint16_t pIndexSize,
+         uint32_t pFirstInstance, uint32_t pInstanceCount);
+      uint32_t pushInstance(const Matrix4& pWorldTransform, const Color& pColor);
+      void close();
+      void clear();
+
+      bool getUploadStaging() const { return mUploadStaging; }
+      void setUploadStaging(bool pEnabled) { mUploadStaging = pEnabled; }
+
+      RenderFrameState& getFrameState() { return mFrameState; }
+      const RenderFrameState& getFrameState() const { return mFrameState; }
+
+      bool empty() const { return mCommands.empty(); }
+      uint32_t size() const { return (uint32_t)mCommands.size(); }
+      uint32_t getOperationsCount() const { return (uint32_t)mOperations.size(); }
+      uint32_t getInstancesCount() const { return (uint32_t)mInstances.size(); }
+
+      const RenderCommand& operator[](uint32_t pIndex) const { return mCommands[pIndex]; }
+      const RenderConstants& getOperation(uint32_t pIndex) const { return mOperations[pIndex]; }
+      const RenderInstance* getInstances(uint32_t pFirstInstance) const { return &mInstances[pFirstInstance]; }
+   };
+
+
+   //
+   //  RenderCommandBackend
+   //
+   class RenderCommandBackend
+   {
+   public:
+      virtual ~RenderCommandBackend() {}
+
+      virtual void execute(const RenderCommandBuffer& pCommandBuffer) = 0;
+   };
+
+
+   //
+   //  RenderCommandBackendNull
+   //
+   //  Replays the commands without a graphics API. Every command is counted, and draws are checked
+   //  against the state set by the previous commands, so the render path can run headless.
+   //  Commands that set the state that is already set are counted as redundant, which is what a
+   //  state cache in a graphics API backend saves. The counters are atomic, so that they can be
+   //  read while a render thread replays the frames.
+   //  Only the replay of the recorded frames is replaced: the DX11 and GL ES render systems still
+   //  create the shaders, textures and buffers on their device when they are loaded. Builds with
+   //  GE_RENDERING_API_NULL use RenderSystemNull instead, which needs no device at all
+   //
+   class RenderCommandBackendNull : public RenderCommandBackend
+   {
+   private:
+      static const uint16_t kNoGroup = 0xffffu;
+      static const uint32_t kTextureSlotsCount = 8u;
+
+      std::atomic<uint32_t> mCommandCounts[(uint32_t)RenderCommandType::Count];
+      std::atomic<uint32_t> mDrawnIndices;
+      std::atomic<uint32_t> mDrawnInstances;
+      std::atomic<uint64_t> mUploadedBytes;
+      std::atomic<uint32_t> mValidationErrors;
+      std::atomic<uint32_t> mRedundantCommands;
+
+      bool validate(const RenderCommandBuffer& pCommandBuffer, const RenderCommand& pCommand, bool pInFrame,
+         const Material* pMaterial, uint16_t pBoundGroup, uint32_t pConstantsOperation) const;
+
+   public:
+      RenderCommandBackendNull();
+
+      void execute(const RenderCommandBuffer& pCommandBuffer) override;
+      void reset();
+
+      uint32_t getCommandCount(RenderCommandType pType) const { return mCommandCounts[(uint32_t)pType]; }
+      uint32_t getDrawnIndices() const { return mDrawnIndices; }
+      uint32_t getDrawnInstances() const { return mDrawnInstances; }
+      uint64_t getUploadedBytes() const { return mUploadedBytes; }
+      uint32_t getValidationErrors() const { return mValidationErrors; }
+      uint32_t getRedundantCommands() const { return mRedundantCommands; }
+   };
+}}
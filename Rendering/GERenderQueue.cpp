@@ -0,0 +1,176 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GERenderQueue.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "GERenderQueue.h"
+
+#include <cstring>
+
+using namespace GE;
+using namespace GE::Rendering;
+
+static const uint32_t kRadixBits = 8u;
+static const uint32_t kRadixBuckets = 1u << kRadixBits;
+static const uint32_t kRadixPasses = 64u / kRadixBits;
+
+//
+//  RenderSortKey
+//
+uint64_t RenderSortKey::makeOrdered(RenderPass pPass, uint32_t pIndex)
+{
+   return ((uint64_t)pPass << 60) | (uint64_t)pIndex;
+}
+
+uint64_t RenderSortKey::makeState(RenderPass pPass, uint8_t pPriority,
+   uint32_t pShaderID, uint32_t pMaterialID, uint32_t pTextureID, uint32_t pDepth)
+{
+   // object IDs are name hashes, so their low bits are enough to group operations sharing them
+   return
+      ((uint64_t)pPass << 60) |
+      ((uint64_t)pPriority << 52) |
+      ((uint64_t)(pShaderID & 0x3ffu) << 42) |
+      ((uint64_t)(pMaterialID & 0xfffu) << 30) |
+      ((uint64_t)(pTextureID & 0x3ffu) << 20) |
+      (uint64_t)(pDepth & kDepthMax);
+}
+
+uint64_t RenderSortKey::makeDepth(RenderPass pPass, uint32_t pDepth)
+{
+   return ((uint64_t)pPass << 60) | (uint64_t)(pDepth & kDepthMax);
+}
+
+uint32_t RenderSortKey::quantizeDepth(float pDistance, float pMaxDistance)
+{
+   if(pMaxDistance <= 0.0f || pDistance <= 0.0f)
+   {
+      return 0u;
+   }
+
+   const float normalized = pDistance / pMaxDistance;
+
+   return normalized >= 1.0f
+      ? kDepthMax
+      : (uint32_t)(normalized * (float)kDepthMax);
+}
+
+
+//
+//  RenderQueue
+//
+RenderQueue::RenderQueue()
+   : mSorted(true)
+{
+}
+
+void RenderQueue::push(const RenderOperation& pRenderOperation, uint64_t pKey)
+{
+   Entry entry;
+   entry.Key = pKey;
+   entry.OperationIndex = (uint32_t)mOperations.size();
+
+   mOperations.push_back(pRenderOperation);
+   mEntries.push_back(entry);
+   mSorted = false;
+}
+
+void RenderQueue::append(RenderQueue& pOther)
+{
+   // the other queue is left empty, so its storage can be taken over when this one has nothing yet
+   if(mEntries.empty())
+   {
+      mOperations.swap(pOther.mOperations);
+      mEntries.swap(pOther.mEntries);
+      mSorted = pOther.mSorted;
+      pOther.clear();
+      return;
+   }
+
+   for(size_t i = 0u; i < pOther.mEntries.size(); i++)
+   {
+      const Entry& entry = pOther.mEntries[i];
+      push(pOther.mOperations[entry.OperationIndex], entry.Key);
+   }
+
+   pOther.clear();
+}
+
+void RenderQueue::sort()
+{
+   if(mSorted)
+      return;
+
+   mSorted = true;
+
+   const uint32_t entriesCount = (uint32_t)mEntries.size();
+
+   if(entriesCount < 2u)
+      return;
+
+   // build the histograms for all the digits in a single pass over the keys
+   uint32_t histograms[kRadixPasses][kRadixBuckets];
+   memset(histograms, 0, sizeof(histograms));
+
+   for(uint32_t i = 0u; i < entriesCount; i++)
+   {
+      const uint64_t key = mEntries[i].Key;
+
+      for(uint32_t pass = 0u; pass < kRadixPasses; pass++)
+      {
+         histograms[pass][(key >> (pass * kRadixBits)) & (kRadixBuckets - 1u)]++;
+      }
+   }
+
+   mSortBuffer.resize(entriesCount);
+
+   Entry* source = &mEntries[0];
+   Entry* destination = &mSortBuffer[0];
+
+   for(uint32_t pass = 0u; pass < kRadixPasses; pass++)
+   {
+      uint32_t* histogram = histograms[pass];
+      const uint32_t shift = pass * kRadixBits;
+
+      // all the keys share this digit, so the pass would not change the order
+      if(histogram[(source[0].Key >> shift) & (kRadixBuckets - 1u)] == entriesCount)
+         continue;
+
+      uint32_t offset = 0u;
+
+      for(uint32_t bucket = 0u; bucket < kRadixBuckets; bucket++)
+      {
+         const uint32_t count = histogram[bucket];
+         histogram[bucket] = offset;
+         offset += count;
+      }
+
+      for(uint32_t i = 0u; i < entriesCount; i++)
+      {
+         const uint32_t bucket = (uint32_t)((source[i].Key >> shift) & (kRadixBuckets - 1u));
+         destination[histogram[bucket]++] = source[i];
+      }
+
+      Entry* swap = source;
+      source = destination;
+      destination = swap;
+   }
+
+   if(source != &mEntries[0])
+   {
+      mEntries.swap(mSortBuffer);
+   }
+}
+
+void RenderQueue::clear()
+{
+   mOperations.clear();
+   mEntries.clear();
+   mSorted = true;
+}
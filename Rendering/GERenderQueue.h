@@ -0,0 +1,84 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GERenderQueue.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GERenderingObjects.h"
+
+#include <cstdint>
+
+namespace GE { namespace Rendering
+{
+   //
+   //  RenderSortKey
+   //
+   //  Packed 64-bit keys. The render pass always takes the highest bits; the rest of the layout
+   //  depends on whether the pass must keep the queueing order or can be reordered freely
+   //
+   //  Ordered:  pass (4) | unused (28) | queueing index (32)
+   //  State:    pass (4) | priority (8) | shader (10) | material (12) | texture (10) | depth (20)
+   //  Depth:    pass (4) | unused (40) | depth (20)
+   //
+   class RenderSortKey
+   {
+   public:
+      static const uint32_t kDepthBits = 20u;
+      static const uint32_t kDepthMax = (1u << kDepthBits) - 1u;
+
+      static uint64_t makeOrdered(RenderPass pPass, uint32_t pIndex);
+      static uint64_t makeState(RenderPass pPass, uint8_t pPriority,
+         uint32_t pShaderID, uint32_t pMaterialID, uint32_t pTextureID, uint32_t pDepth);
+      static uint64_t makeDepth(RenderPass pPass, uint32_t pDepth);
+
+      static uint32_t quantizeDepth(float pDistance, float pMaxDistance);
+   };
+
+
+   //
+   //  RenderQueue
+   //
+   //  Operations are stored once in a flat array and only the key/index pairs are moved around
+   //  while sorting. Keys are sorted with a least significant digit radix sort, skipping the
+   //  digits that are the same for every key
+   //
+   class RenderQueue
+   {
+   private:
+      struct Entry
+      {
+         uint64_t Key;
+         uint32_t OperationIndex;
+      };
+
+      GESTLVector(RenderOperation) mOperations;
+      GESTLVector(Entry) mEntries;
+      GESTLVector(Entry) mSortBuffer;
+      bool mSorted;
+
+   public:
+      RenderQueue();
+
+      void push(const RenderOperation& pRenderOperation, uint64_t pKey);
+      void append(RenderQueue& pOther);
+      void sort();
+      void clear();
+
+      bool empty() const { return mEntries.empty(); }
+      uint32_t size() const { return (uint32_t)mEntries.size(); }
+
+      const RenderOperation& operator[](uint32_t pIndex) const
+      {
+         GEAssert(mSorted);
+         return mOperations[mEntries[pIndex].OperationIndex];
+      }
+   };
+}}
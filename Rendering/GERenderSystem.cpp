@@ -18,6 +18,7 @@
 #include "Core/GEApplication.h"
 #include "Core/GELog.h"
 #include "Core/GEProfiler.h"
+#include "Core/GETaskManager.h"
 #include "Content/GEResourcesManager.h"
 #include "Entities/GEEntity.h"
 #include "Entities/GEComponentParticleSystem.h"
@@ -44,6 +45,33 @@ const ObjectName _Sprite_ = ObjectName("Sprite");
 const ObjectName _Label_ = ObjectName("Label");
 const ObjectName _ParticleSystem_ = ObjectName("ParticleSystem");
 
+const uint64_t kHashOffsetBasis = 14695981039346656037ull;
+const uint64_t kHashPrime = 1099511628211ull;
+
+static uint64_t hashBytes(uint64_t pHash, const void* pData, size_t pSize)
+{
+   const uint8_t* bytes = static_cast<const uint8_t*>(pData);
+
+   for(size_t i = 0u; i < pSize; i++)
+   {
+      pHash ^= (uint64_t)bytes[i];
+      pHash *= kHashPrime;
+   }
+
+   return pHash;
+}
+
+static bool canShareInstancedDraw(const RenderOperation& pRenderOperation1, const RenderOperation& pRenderOperation2)
+{
+   return
+      pRenderOperation1.mRenderMaterialPass == pRenderOperation2.mRenderMaterialPass &&
+      pRenderOperation1.mDiffuseTexture == pRenderOperation2.mDiffuseTexture &&
+      pRenderOperation1.mFlags == pRenderOperation2.mFlags &&
+      pRenderOperation1.mGroup == pRenderOperation2.mGroup &&
+      pRenderOperation1.mVertexIndexSize == pRenderOperation2.mVertexIndexSize &&
+      pRenderOperation1.mShadowCascade == pRenderOperation2.mShadowCascade;
+}
+
 RenderSystem::RenderSystem(void* Window, bool Windowed)
    : pWindow(Window)
    , bWindowed(Windowed)
@@ -61,10 +89,26 @@ RenderSystem::RenderSystem(void* Window, bool Windowed)
    , mTextRasterizer(Device::getScreenWidth(), Device::getScreenHeight())
 #endif
    , mAny3DUIElementsToRender(false)
+   , mStaticGeometryPackPending(false)
+   , mInstancingEnabled(true)
+   , mInstancedRenderables(0u)
+   , mFrustumCullingEnabled(true)
+   , mCullingFrustumValid(false)
+   , mCulledRenderables(0u)
+   , mShadowMapSize(kDefaultShadowMapSize)
+   , mShadowCascadesCount(1u)
+   , mShadowMapResizePending(false)
+   , mShadowCasterFrustumValid(false)
+   , mShadowCastersHash(0u)
+   , mStaticShadowLayerHash(0u)
+   , mDynamicShadowCastersQueued(false)
+   , mDynamicShadowCastersRendered(false)
    , mVRAMInMb(0.0f)
    , fFrameTime(Time::getElapsed())
    , fFramesPerSecond(0.0f)
-   , iDrawCalls(0)
+   , mDrawCalls(0u)
+   , mFrameDrawCalls(0u)
+   , mSkippedStateChanges(0)
 {
    memset(pBoundTexture, 0, sizeof(Texture*) * (GE::uint)TextureSlot::Count);
    
@@ -93,7 +137,42 @@ RenderSystem::RenderSystem(void* Window, bool Windowed)
    sGPUBufferPairs[GeometryGroup::SpriteStatic].IsDynamic = 0u;
    sGPUBufferPairs[GeometryGroup::MeshStatic].IsDynamic = 0u;
 
+   // vertex blocks are kept at multiples of the stride, so that their offsets translate into base vertices
+   const uint32_t staticGroups[] = { GeometryGroup::SpriteStatic, GeometryGroup::MeshStatic };
+
+   for(uint32_t i = 0u; i < sizeof(staticGroups) / sizeof(staticGroups[0]); i++)
+   {
+      GPUBufferPair& buffers = sGPUBufferPairs[staticGroups[i]];
+      buffers.VertexAllocator.init(kVertexBufferSize, buffers.VertexStride);
+      buffers.IndexAllocator.init(kIndexBufferSize, sizeof(uint32_t));
+   }
+
+   for(uint32_t i = 0u; i < kMaxShadowCascades; i++)
+   {
+      Matrix4MakeIdentity(&mShadowCascadeViewProjections[i]);
+   }
+
+   // the commands are replayed through the graphics API unless another backend is set
+   mCommandBuffer = &mCommandBuffers[0];
+   mCommandBackend = this;
+   mFrameState = nullptr;
+
+   mRenderThreadEnabled = false;
+   mRenderThreadExitPending = false;
+   mFrameLatency = 1u;
+   mFramesSubmitted = 0u;
+   mFramesRendered = 0u;
+   mFramesRecorded = 0u;
+   mFramesCompleted = 0u;
+
+   GEMutexInit(mRenderThreadMutex);
+   GEConditionVariableInit(mRenderThreadCondition);
+
+   // one queueing context per frame job
+   mQueueingContexts.resize((size_t)GEMax(Device::getNumberOfCPUCores() - 1, 1));
+
    GEMutexInit(mTextureLoadMutex);
+   GEMutexInit(mStaticGeometryReleaseMutex);
    calculate2DViewProjectionMatrix();
 
    clearRenderingQueues();
@@ -101,10 +180,16 @@ RenderSystem::RenderSystem(void* Window, bool Windowed)
 
 RenderSystem::~RenderSystem()
 {
+   stopRenderThread();
+
+   GEConditionVariableDestroy(mRenderThreadCondition);
+   GEMutexDestroy(mRenderThreadMutex);
+
    mTextures.clear();
    mFonts.clear();
    mMaterials.clear();
    GEMutexDestroy(mTextureLoadMutex);
+   GEMutexDestroy(mStaticGeometryReleaseMutex);
 }
 
 void RenderSystem::registerObjectManagers()
@@ -137,7 +222,22 @@ float RenderSystem::getFPS() const
 
 uint RenderSystem::getDrawCalls() const
 {
-   return iDrawCalls;
+   return mDrawCalls;
+}
+
+uint RenderSystem::getSkippedStateChanges() const
+{
+   return mSkippedStateChanges;
+}
+
+uint RenderSystem::getCulledRenderables() const
+{
+   return mCulledRenderables.load();
+}
+
+uint RenderSystem::getInstancedRenderables() const
+{
+   return mInstancedRenderables;
 }
 
 const Matrix4& RenderSystem::get2DViewProjectionMatrix() const
@@ -195,14 +295,12 @@ void RenderSystem::calculate2DViewProjectionMatrix()
 
 void RenderSystem::calculate2DTransformMatrix(const Matrix4& matModel)
 {
-   Matrix4Multiply(mat2DViewProjection, matModel, &matModelViewProjection);
+   Matrix4Multiply(mFrameState->ViewProjection2D, matModel, &matModelViewProjection);
 }
 
 void RenderSystem::calculate3DTransformMatrix(const Matrix4& matModel)
 {
-   GEAssert(cActiveCamera);
-   const Matrix4& matViewProjection = cActiveCamera->getViewProjectionMatrix();
-   Matrix4Multiply(matViewProjection, matModel, &matModelViewProjection);
+   Matrix4Multiply(mFrameState->CameraViewProjection, matModel, &matModelViewProjection);
 }
 
 void RenderSystem::calculate3DInverseTransposeMatrix(const Matrix4& matModel)
@@ -212,7 +310,7 @@ void RenderSystem::calculate3DInverseTransposeMatrix(const Matrix4& matModel)
    Matrix4Transpose(&matModelInverseTranspose);
 }
 
-void RenderSystem::calculateLightViewProjectionMatrix(ComponentLight* Light)
+void RenderSystem::calculateShadowCascades(ComponentLight* Light)
 {
    Scene* cActiveScene = Scene::getActiveScene();
 
@@ -222,15 +320,80 @@ void RenderSystem::calculateLightViewProjectionMatrix(ComponentLight* Light)
    float fShadowsDistance = cActiveScene->getShadowsMaxDistance();
 
    Vector3 vLightDirection = Light->getDirection();
-   Vector3 vLightPosition = Light->getTransform()->getWorldPosition();
 
+   if(mShadowCascadesCount == 1u)
+   {
+      Vector3 vLightPosition = Light->getTransform()->getWorldPosition();
+
+      Matrix4 matLightView;
+      Matrix4MakeLookAt(vLightPosition, vLightPosition + vLightDirection, Vector3::UnitY, &matLightView);
+
+      Matrix4 matLightProjection;
+      Matrix4MakeOrtho(-fShadowsDistance, fShadowsDistance, -fShadowsDistance, fShadowsDistance, -fShadowsDistance, fShadowsDistance, &matLightProjection);
+
+      Matrix4Multiply(matLightProjection, matLightView, &mShadowCascadeViewProjections[0]);
+      return;
+   }
+
+   // the cascades are centered on the camera, and each one covers half the extent of the next one. The centers
+   // are snapped to a quarter of the extent in light space, so that the static layer is not rendered again every
+   // time the camera moves, but only when it crosses to another cell
    Matrix4 matLightView;
-   Matrix4MakeLookAt(vLightPosition, vLightPosition + vLightDirection, Vector3::UnitY, &matLightView);
+   Matrix4MakeLookAt(Vector3::Zero, vLightDirection, Vector3::UnitY, &matLightView);
+
+   Vector3 vCameraPosition;
+   Matrix4Transform(matLightView, cActiveCamera->getTransform()->getWorldPosition(), &vCameraPosition);
+
+   for(uint32_t i = 0u; i < mShadowCascadesCount; i++)
+   {
+      const float extent = fShadowsDistance / (float)(1u << (mShadowCascadesCount - 1u - i));
+      const float cellSize = extent * 0.5f;
+
+      const float centerX = floorf(vCameraPosition.X / cellSize + 0.5f) * cellSize;
+      const float centerY = floorf(vCameraPosition.Y / cellSize + 0.5f) * cellSize;
+      const float centerZ = floorf(vCameraPosition.Z / cellSize + 0.5f) * cellSize;
+
+      Matrix4 matLightProjection;
+      Matrix4MakeOrtho(centerX - extent, centerX + extent, centerY - extent, centerY + extent,
+         -centerZ - fShadowsDistance, -centerZ + fShadowsDistance, &matLightProjection);
+
+      Matrix4Multiply(matLightProjection, matLightView, &mShadowCascadeViewProjections[i]);
+   }
+}
 
-   Matrix4 matLightProjection;
-   Matrix4MakeOrtho(-fShadowsDistance, fShadowsDistance, -fShadowsDistance, fShadowsDistance, -fShadowsDistance, fShadowsDistance, &matLightProjection);
+void RenderSystem::getShadowCascadeCell(uint32_t pCascade, uint32_t* pOutColumn, uint32_t* pOutRow) const
+{
+   *pOutColumn = pCascade % getShadowAtlasColumns();
+   *pOutRow = pCascade / getShadowAtlasColumns();
+}
+
+uint32_t RenderSystem::getShadowAtlasColumns() const
+{
+   return mShadowCascadesCount > 1u ? 2u : 1u;
+}
+
+uint32_t RenderSystem::getShadowAtlasRows() const
+{
+   return mShadowCascadesCount > 2u ? 2u : 1u;
+}
 
-   Matrix4Multiply(matLightProjection, matLightView, &matLightViewProjection);
+uint32_t RenderSystem::selectShadowCascade(const BoundingBox& pWorldBounds) const
+{
+   // the receiver samples the smallest cascade that contains it entirely, so that it never reads a neighbor cell
+   for(uint32_t i = 0u; i < mShadowCascadesCount - 1u; i++)
+   {
+      BoundingBox lightBounds;
+      pWorldBounds.transform(mShadowCascadeViewProjections[i], &lightBounds);
+
+      if(fabsf(lightBounds.Center.X) + lightBounds.Extents.X <= 1.0f &&
+         fabsf(lightBounds.Center.Y) + lightBounds.Extents.Y <= 1.0f &&
+         fabsf(lightBounds.Center.Z) + lightBounds.Extents.Z <= 1.0f)
+      {
+         return i;
+      }
+   }
+
+   return mShadowCascadesCount - 1u;
 }
 
 void RenderSystem::reloadTextRasterizer()
@@ -449,6 +612,8 @@ void RenderSystem::preloadTextures(const char* FileName)
 
 void RenderSystem::unloadTextures(const char* FileName)
 {
+   waitForRenderThread();
+
    char sFileName[64];
    sprintf(sFileName, "%s.textures", FileName);
 
@@ -519,6 +684,8 @@ bool RenderSystem::loadNextPreloadedTexture()
       return false;
    }
 
+   waitForRenderThread();
+
    PreloadedTexture* cPreloadedTexture = &vPreloadedTextures.back();
    loadTexture(cPreloadedTexture);
    vPreloadedTextures.pop_back();
@@ -570,6 +737,8 @@ void RenderSystem::setAmbientLightColor(const Color& Color)
 
 void RenderSystem::loadMaterials(const char* FileName)
 {
+   waitForRenderThread();
+
    char sFileName[64];
    sprintf(sFileName, "%s.materials", FileName);
 
@@ -618,6 +787,8 @@ void RenderSystem::loadMaterials(const char* FileName)
 
 void RenderSystem::unloadMaterials(const char* FileName)
 {
+   waitForRenderThread();
+
    char sFileName[64];
    sprintf(sFileName, "%s.materials", FileName);
 
@@ -673,6 +844,8 @@ void RenderSystem::requestShadersReload()
 
 void RenderSystem::loadFonts(const char* FileName)
 {
+   waitForRenderThread();
+
    ObjectName cGroupName = ObjectName(FileName);
    ContentData cFontsData;
 
@@ -727,6 +900,8 @@ void RenderSystem::loadFonts(const char* FileName)
 
 void RenderSystem::unloadFonts(const char* FileName)
 {
+   waitForRenderThread();
+
    ContentData cFontsData;
 
    if(Application::ContentType == ApplicationContentType::Xml)
@@ -775,6 +950,184 @@ TextRasterizer* RenderSystem::getTextRasterizer()
 #endif
 }
 
+bool RenderSystem::getFrustumCullingEnabled() const
+{
+   return mFrustumCullingEnabled;
+}
+
+void RenderSystem::setFrustumCullingEnabled(bool pEnabled)
+{
+   mFrustumCullingEnabled = pEnabled;
+}
+
+bool RenderSystem::getInstancingEnabled() const
+{
+   return mInstancingEnabled;
+}
+
+void RenderSystem::setInstancingEnabled(bool pEnabled)
+{
+   mInstancingEnabled = pEnabled;
+}
+
+void RenderSystem::updateCullingFrustums()
+{
+   mCulledRenderables = 0u;
+   mCullingFrustumValid = mFrustumCullingEnabled && cActiveCamera;
+
+   if(mCullingFrustumValid)
+   {
+      mCullingFrustum.extractPlanes(cActiveCamera->getViewProjectionMatrix());
+   }
+
+   // the light frustum is needed even with culling disabled, as it drives the shadow map cache
+   mShadowCasterFrustumValid = false;
+   mShadowCastersHash = kHashOffsetBasis;
+   mDynamicShadowCastersQueued = false;
+
+   if(vLightsToRender.empty() || vLightsToRender[0]->getLightType() != LightType::Directional)
+      return;
+
+   if(!Scene::getActiveScene() || !cActiveCamera)
+      return;
+
+   calculateShadowCascades(vLightsToRender[0]);
+
+   // the last cascade contains the other ones
+   mShadowCasterFrustum.extractPlanes(mShadowCascadeViewProjections[mShadowCascadesCount - 1u]);
+   mShadowCasterFrustumValid = true;
+   mShadowCastersHash = hashBytes(mShadowCastersHash, mShadowCascadeViewProjections, sizeof(Matrix4) * mShadowCascadesCount);
+}
+
+bool RenderSystem::canBeCulled(ComponentRenderable* pRenderable, ComponentUIElement* pUIElement) const
+{
+   // only world geometry rendered through the active camera is tested against its frustum
+   if(pRenderable->getRenderingMode() != RenderingMode::_3D || pUIElement)
+   {
+      return false;
+   }
+
+   return !GEHasFlag(pRenderable->getInternalFlags(), ComponentRenderable::InternalFlags::DebugGeometry);
+}
+
+bool RenderSystem::castsDynamicShadows(ComponentRenderable* pRenderable) const
+{
+   if(pRenderable->getClassName() == _Mesh_)
+   {
+      return GEHasFlag(static_cast<ComponentMesh*>(pRenderable)->getDynamicShadows(), DynamicShadowsBitMask::Cast);
+   }
+
+   if(pRenderable->getClassName() == _ParticleSystem_)
+   {
+      return GEHasFlag(static_cast<ComponentParticleSystem*>(pRenderable)->getSettings(), ParticleSystemSettingsBitMask::DynamicShadows) &&
+         pRenderable->getRenderingMode() == RenderingMode::_3D;
+   }
+
+   return false;
+}
+
+void RenderSystem::registerShadowCaster(ComponentRenderable* pRenderable, const RenderOperation& pRenderOperation, QueueingContext& pContext)
+{
+   // skinned meshes and particles change every frame, so they are rendered on top of the cached static layer
+   if(pRenderable->getClassName() == _ParticleSystem_)
+   {
+      pContext.ShadowedParticlesToRender.push_back(pRenderOperation);
+      pContext.DynamicShadowCastersQueued = true;
+      return;
+   }
+
+   const bool dynamicCaster = GEHasFlag(static_cast<ComponentMesh*>(pRenderable)->getSettings(), MeshSettingsBitMask::Skinning);
+   GESTLVector(RenderOperation)& shadowedMeshes = dynamicCaster
+      ? pContext.DynamicShadowedMeshesToRender
+      : pContext.StaticShadowedMeshesToRender;
+
+   // a mesh with several material passes is only rendered once into the shadow map
+   for(size_t i = 0u; i < shadowedMeshes.size(); i++)
+   {
+      if(shadowedMeshes[i].mGeometryID == pRenderOperation.mGeometryID)
+         return;
+   }
+
+   if(dynamicCaster)
+   {
+      shadowedMeshes.push_back(pRenderOperation);
+      pContext.DynamicShadowCastersQueued = true;
+      return;
+   }
+
+   registerStaticShadowCaster(pRenderOperation, pContext);
+}
+
+void RenderSystem::registerStaticShadowCaster(const RenderOperation& pRenderOperation, QueueingContext& pContext)
+{
+   pContext.StaticShadowedMeshesToRender.push_back(pRenderOperation);
+
+   const uint32_t materialID = pRenderOperation.mRenderMaterialPass->getMaterial()->getName().getID();
+   const uint32_t textureID = pRenderOperation.mDiffuseTexture ? pRenderOperation.mDiffuseTexture->getName().getID() : 0u;
+
+   // the signature of the static casters does not depend on the order in which they are queued
+   uint64_t casterHash = kHashOffsetBasis;
+   casterHash = hashBytes(casterHash, &pRenderOperation.mGeometryID, sizeof(pRenderOperation.mGeometryID));
+   casterHash = hashBytes(casterHash, &pRenderOperation.mData->NumIndices, sizeof(pRenderOperation.mData->NumIndices));
+   casterHash = hashBytes(casterHash, pRenderOperation.mWorldTransform.m, sizeof(pRenderOperation.mWorldTransform.m));
+   casterHash = hashBytes(casterHash, &materialID, sizeof(materialID));
+   casterHash = hashBytes(casterHash, &textureID, sizeof(textureID));
+   pContext.ShadowCastersHash += casterHash;
+}
+
+uint32_t RenderSystem::getShadowMapSize() const
+{
+   return mShadowMapSize;
+}
+
+void RenderSystem::setShadowMapSize(uint32_t pSize)
+{
+   GEAssert(pSize > 0u);
+
+   if(pSize == mShadowMapSize)
+      return;
+
+   // the shadow map is recreated by the backend with this size
+   waitForRenderThread();
+
+   mShadowMapSize = pSize;
+   mShadowMapResizePending = true;
+   mStaticShadowLayerHash = 0u;
+}
+
+uint32_t RenderSystem::getShadowCascadesCount() const
+{
+   return mShadowCascadesCount;
+}
+
+void RenderSystem::setShadowCascadesCount(uint32_t pCount)
+{
+   GEAssert(pCount > 0u && pCount <= kMaxShadowCascades);
+
+   if(pCount == mShadowCascadesCount)
+      return;
+
+   // the cascades are cells of the shadow map, so it is recreated by the backend with the new layout
+   waitForRenderThread();
+
+   mShadowCascadesCount = pCount;
+   mShadowMapResizePending = true;
+   mStaticShadowLayerHash = 0u;
+}
+
+bool RenderSystem::isShadowMapUpdatePending() const
+{
+   if(!mShadowCasterFrustumValid)
+      return false;
+
+   // the dynamic casters rendered in the previous frame have to be removed from the map as well
+   return
+      mShadowMapResizePending ||
+      mDynamicShadowCastersQueued ||
+      mDynamicShadowCastersRendered ||
+      mShadowCastersHash != mStaticShadowLayerHash;
+}
+
 void RenderSystem::setup3DUICanvas(uint32_t pCanvasIndex, const Vector3& pWorldPosition, uint16_t pSettings)
 {
    GEAssert(pCanvasIndex < k3DUICanvasCount);
@@ -783,10 +1136,68 @@ void RenderSystem::setup3DUICanvas(uint32_t pCanvasIndex, const Vector3& pWorldP
    s3DUICanvasEntries[pCanvasIndex].Settings = pSettings;
 }
 
-void RenderSystem::queueForRendering(ComponentRenderable* Renderable, uint RequestIndex)
+void RenderSystem::queueForRendering(const GESTLVector(Component*)& pRenderables)
 {
    GEProfilerMarker("RenderSystem::queueForRendering()");
 
+   const uint32_t renderablesCount = (uint32_t)pRenderables.size();
+
+   if(renderablesCount == 0u)
+      return;
+
+   // no lock is taken here: the background texture loads only touch the preloaded textures list and textures
+   // no material refers to yet, which are handed over in loadNextPreloadedTexture, under the lock, on this thread
+   const uint32_t contextsCount = (uint32_t)mQueueingContexts.size();
+   const uint32_t renderablesPerJob = GEMax((renderablesCount + contextsCount - 1u) / contextsCount, kMinRenderablesPerQueueingJob);
+
+   if(renderablesCount < renderablesPerJob * 2u)
+   {
+      QueueingContext& context = mQueueingContexts[0];
+
+      for(uint32_t i = 0u; i < renderablesCount; i++)
+      {
+         queueForRendering(static_cast<ComponentRenderable*>(pRenderables[i]), i, context);
+      }
+
+      mergeQueueingContext(context);
+   }
+   else
+   {
+      uint32_t jobsCount = 0u;
+
+      for(uint32_t first = 0u; first < renderablesCount; first += renderablesPerJob)
+      {
+         const uint32_t last = GEMin(first + renderablesPerJob, renderablesCount);
+         QueueingContext* context = &mQueueingContexts[jobsCount++];
+
+         JobDesc jobDesc("QueueForRendering");
+         jobDesc.Task = [this, &pRenderables, first, last, context]
+         {
+            for(uint32_t i = first; i < last; i++)
+            {
+               queueForRendering(static_cast<ComponentRenderable*>(pRenderables[i]), i, *context);
+            }
+         };
+         TaskManager::getInstance()->queueJob(jobDesc, JobType::Frame);
+      }
+
+      TaskManager::getInstance()->kickFrameJobs();
+      TaskManager::getInstance()->waitForFrameJobs();
+
+      // merging in job order keeps the result identical to queueing serially
+      for(uint32_t i = 0u; i < jobsCount; i++)
+      {
+         mergeQueueingContext(mQueueingContexts[i]);
+      }
+   }
+}
+
+void RenderSystem::queueForRendering(ComponentRenderable* Renderable, uint32_t RequestIndex, QueueingContext& pContext)
+{
+   // static batch members are queued along with their batch
+   if(GEHasFlag(Renderable->getInternalFlags(), ComponentRenderable::InternalFlags::StaticBatched))
+      return;
+
    Renderable->setRenderPass(RenderPass::None);
 
    if(!Renderable->getVisible() ||
@@ -804,37 +1215,59 @@ void RenderSystem::queueForRendering(ComponentRenderable* Renderable, uint Reque
       return;
    }
 
-   for(uint i = 0; i < Renderable->getMaterialPassCount(); i++)
-   {
-      MaterialPass* materialPass = Renderable->getMaterialPass(i);
+   uint8_t queueingFlags = (uint8_t)QueueingFlags::View;
 
-      if(!materialPass->getMaterial() || !materialPass->getActive())
-         continue;
+   if(castsDynamicShadows(Renderable))
+   {
+      GESetFlag(queueingFlags, QueueingFlags::ShadowCaster);
+   }
 
-      if(GEHasFlag(materialPass->getMaterial()->getFlags(), MaterialFlagsBitMask::BatchRendering))
-      {
-         GEMutexLock(mTextureLoadMutex);
+   const bool cullView = mCullingFrustumValid && canBeCulled(Renderable, cUIElement);
+   const bool cullShadowCaster =
+      mFrustumCullingEnabled && mShadowCasterFrustumValid && GEHasFlag(queueingFlags, QueueingFlags::ShadowCaster);
 
-         const uint32_t materialID = materialPass->getMaterial()->getName().getID();
-         RenderOperation& batch = mBatches.find(materialID)->second;
-         batch.mRenderMaterialPass = materialPass;
+   if(cullView || cullShadowCaster)
+   {
+      BoundingBox worldBounds;
 
-         if(Renderable->getClassName() == _Mesh_)
-         {
-            batch.mGroup = GeometryGroup::MeshBatch;
-         }
-         else if(Renderable->getClassName() == _Sprite_)
+      if(Renderable->getWorldBounds(&worldBounds))
+      {
+         if(cullView && !mCullingFrustum.intersects(worldBounds))
          {
-            batch.mGroup = GeometryGroup::SpriteBatch;
+            GEResetFlag(queueingFlags, QueueingFlags::View);
+            mCulledRenderables++;
          }
-         else if(Renderable->getClassName() == _Label_)
+
+         if(cullShadowCaster && !mShadowCasterFrustum.intersects(worldBounds))
          {
-            batch.mGroup = GeometryGroup::LabelBatch;
+            GEResetFlag(queueingFlags, QueueingFlags::ShadowCaster);
          }
+      }
+   }
 
-         queueForRenderingBatch(Renderable, batch);
+   if(queueingFlags == 0u)
+   {
+      return;
+   }
 
-         GEMutexUnlock(mTextureLoadMutex);
+   for(uint i = 0; i < Renderable->getMaterialPassCount(); i++)
+   {
+      MaterialPass* materialPass = Renderable->getMaterialPass(i);
+
+      if(!materialPass->getMaterial() || !materialPass->getActive())
+         continue;
+
+      if(GEHasFlag(materialPass->getMaterial()->getFlags(), MaterialFlagsBitMask::BatchRendering))
+      {
+         // batches are not rendered into the shadow map
+         if(!GEHasFlag(queueingFlags, QueueingFlags::View))
+            continue;
+
+         // batches share their vertex data, so they are filled in order when the contexts are merged
+         BatchRequest batchRequest;
+         batchRequest.Renderable = Renderable;
+         batchRequest.RenderMaterialPass = materialPass;
+         pContext.BatchRequests.push_back(batchRequest);
       }
       else
       {
@@ -859,11 +1292,7 @@ void RenderSystem::queueForRendering(ComponentRenderable* Renderable, uint Reque
             renderOperation.mGroup = GeometryGroup::Particles;
          }
 
-         GEMutexLock(mTextureLoadMutex);
-
-         queueForRenderingSingle(Renderable, renderOperation);
-
-         GEMutexUnlock(mTextureLoadMutex);
+         queueForRenderingSingle(Renderable, renderOperation, queueingFlags, pContext);
       }
    }
 }
@@ -876,16 +1305,84 @@ void RenderSystem::queueForRendering(ComponentLight* Light)
    }
 }
 
-void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, RenderOperation& sRenderOperation)
+void RenderSystem::queueForRendering(const StaticBatchSet& pStaticBatches)
 {
-   GEProfilerMarker("RenderSystem::queueForRenderingSingle()");
+   GEProfilerMarker("RenderSystem::queueForRendering(StaticBatchSet)");
+
+   if(pStaticBatches.empty() || !cActiveCamera)
+      return;
+
+   QueueingContext& context = mQueueingContexts[0];
+   const Vector3& cameraPosition = cActiveCamera->getTransform()->getWorldPosition();
+
+   for(uint32_t i = 0u; i < pStaticBatches.size(); i++)
+   {
+      const StaticBatch& batch = pStaticBatches[i];
+
+      if(!batch.Active)
+         continue;
+
+      const bool castsShadows = GEHasFlag(batch.DynamicShadows, DynamicShadowsBitMask::Cast);
+      bool inView = true;
+      bool inShadowCasterFrustum = castsShadows;
+
+      if(mCullingFrustumValid && !mCullingFrustum.intersects(batch.WorldBounds))
+      {
+         inView = false;
+         mCulledRenderables++;
+      }
+
+      if(castsShadows && mFrustumCullingEnabled && mShadowCasterFrustumValid && !mShadowCasterFrustum.intersects(batch.WorldBounds))
+      {
+         inShadowCasterFrustum = false;
+      }
+
+      const RenderPass renderPass = inView ? RenderPass::_02_OpaqueMeshes : RenderPass::None;
+
+      for(size_t j = 0u; j < batch.Members.size(); j++)
+      {
+         batch.Members[j].Renderable->setRenderPass(renderPass);
+      }
+
+      if(!inView && !inShadowCasterFrustum)
+         continue;
 
+      RenderOperation renderOperation = batch.Operation;
+      renderOperation.mDiffuseTexture = const_cast<Texture*>(renderOperation.mRenderMaterialPass->getMaterial()->getDiffuseTexture());
+
+      if(inShadowCasterFrustum)
+      {
+         registerStaticShadowCaster(renderOperation, context);
+      }
+
+      if(GEHasFlag(renderOperation.mFlags, RenderOperationFlags::BindShadowMap))
+      {
+         renderOperation.mShadowCascade = selectShadowCascade(batch.WorldBounds);
+      }
+
+      if(inView)
+      {
+         // the operation has no transform, so the depth is taken from the center of the batch
+         const float distance = (batch.WorldBounds.Center - cameraPosition).getLength();
+         const uint32_t depth = RenderSortKey::quantizeDepth(distance, cActiveCamera->getFarZ());
+
+         context.OpaqueMeshesToRender.push(renderOperation,
+            getStateSortKey(RenderPass::_02_OpaqueMeshes, batch.RenderPriority, renderOperation, depth));
+      }
+
+      queueGeometryUpload(renderOperation, context);
+   }
+
+   mergeQueueingContext(context);
+}
+
+void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, RenderOperation& sRenderOperation, uint8_t pQueueingFlags,
+   QueueingContext& pContext)
+{
 #if defined (GE_EDITOR_SUPPORT)
    if(pRenderable->getRenderingMode() == RenderingMode::_3D && !cActiveCamera)
    {
-      Entity* owner = pRenderable->getOwner();
-      Log::log(LogType::Warning, "There is no active camera. The entity '%s' will be deactivated.", owner->getFullName().getString());
-      owner->setActive(false);
+      pContext.EntitiesToDeactivate.push_back(pRenderable->getOwner());
       return;
    }
 #endif
@@ -920,23 +1417,9 @@ void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, Ren
       ComponentMesh* cMesh = static_cast<ComponentMesh*>(pRenderable);
       MaterialPass* cMaterialPass = sRenderOperation.mRenderMaterialPass;
 
-      if(GEHasFlag(cMesh->getDynamicShadows(), DynamicShadowsBitMask::Cast))
+      if(GEHasFlag(pQueueingFlags, QueueingFlags::ShadowCaster))
       {
-         bool bAlreadyQueued = false;
-
-         for(uint i = 0; i < vShadowedMeshesToRender.size(); i++)
-         {
-            if(vShadowedMeshesToRender[i].mGeometryID == renderableID)
-            {
-               bAlreadyQueued = true;
-               break;
-            }
-         }
-
-         if(!bAlreadyQueued)
-         {
-            vShadowedMeshesToRender.push_back(sRenderOperation);
-         }
+         registerShadowCaster(pRenderable, sRenderOperation, pContext);
       }
 
       GESetFlag(sRenderOperation.mFlags, RenderOperationFlags::LightingSupport);
@@ -944,50 +1427,48 @@ void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, Ren
       if(GEHasFlag(cMesh->getDynamicShadows(), DynamicShadowsBitMask::Receive))
       {
          GESetFlag(sRenderOperation.mFlags, RenderOperationFlags::BindShadowMap);
-      }
 
-#if defined (GE_EDITOR_SUPPORT)
-      if(GEHasFlag(pRenderable->getInternalFlags(), ComponentRenderable::InternalFlags::DebugGeometry))
-      {
-         vDebugGeometryToRender.push(sRenderOperation);
-         pRenderable->setRenderPass(RenderPass::_09_DebugGeometry);
-      }
-      else
-#endif
-      {
-         if(uiElement)
+         if(mShadowCascadesCount > 1u)
          {
-            queueForRendering3DUI(pRenderable, sRenderOperation);
+            BoundingBox worldBounds;
+            sRenderOperation.mShadowCascade = pRenderable->getWorldBounds(&worldBounds)
+               ? selectShadowCascade(worldBounds)
+               : mShadowCascadesCount - 1u;
          }
-         else if(GEHasFlag(cMesh->getSettings(), MeshSettingsBitMask::Transparency))
+      }
+
+      // casters out of view are only rendered into the shadow map
+      if(GEHasFlag(pQueueingFlags, QueueingFlags::View))
+      {
+#if defined (GE_EDITOR_SUPPORT)
+         if(GEHasFlag(pRenderable->getInternalFlags(), ComponentRenderable::InternalFlags::DebugGeometry))
          {
-            vTransparentMeshesToRender.push_back(sRenderOperation);
-            pRenderable->setRenderPass(RenderPass::_04_TransparentMeshes);
+            pContext.DebugGeometryToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_09_DebugGeometry, sRenderOperation.mIndex));
+            pRenderable->setRenderPass(RenderPass::_09_DebugGeometry);
          }
          else
+#endif
          {
-            vOpaqueMeshesToRender.push(sRenderOperation);
-            pRenderable->setRenderPass(RenderPass::_02_OpaqueMeshes);
+            if(uiElement)
+            {
+               queueForRendering3DUI(pRenderable, sRenderOperation, pContext);
+            }
+            else if(GEHasFlag(cMesh->getSettings(), MeshSettingsBitMask::Transparency))
+            {
+               pContext.TransparentMeshesToRender.push(sRenderOperation,
+                  RenderSortKey::makeDepth(RenderPass::_04_TransparentMeshes, RenderSortKey::kDepthMax - getCameraDepth(sRenderOperation)));
+               pRenderable->setRenderPass(RenderPass::_04_TransparentMeshes);
+            }
+            else
+            {
+               pContext.OpaqueMeshesToRender.push(sRenderOperation,
+                  getStateSortKey(RenderPass::_02_OpaqueMeshes, pRenderable->getRenderPriority(), sRenderOperation, getCameraDepth(sRenderOperation)));
+               pRenderable->setRenderPass(RenderPass::_02_OpaqueMeshes);
+            }
          }
       }
 
-      if(cMesh->getGeometryType() == GeometryType::Static)
-      {
-         GESTLMap(uint, GeometryRenderInfo)::const_iterator it = mStaticGeometryToRender.find(renderableID);
-
-         if(it == mStaticGeometryToRender.end())
-         {
-            GPUBufferPair& sBuffers = sGPUBufferPairs[GeometryGroup::MeshStatic];
-            mStaticGeometryToRender[renderableID] = GeometryRenderInfo(sBuffers.CurrentVertexBufferOffset, sBuffers.CurrentIndexBufferOffset);
-            loadRenderingData(sRenderOperation.mData, sBuffers, 4u);
-         }
-      }
-      else
-      {
-         GPUBufferPair& sBuffers = sGPUBufferPairs[GeometryGroup::MeshDynamic];
-         mDynamicGeometryToRender[renderableID] = GeometryRenderInfo(sBuffers.CurrentVertexBufferOffset, sBuffers.CurrentIndexBufferOffset);
-         loadRenderingData(sRenderOperation.mData, sBuffers, 4u);
-      }
+      queueGeometryUpload(sRenderOperation, pContext);
    }
    else if(pRenderable->getClassName() == _Sprite_)
    {
@@ -996,7 +1477,7 @@ void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, Ren
 #if defined (GE_EDITOR_SUPPORT)
       if(GEHasFlag(pRenderable->getInternalFlags(), ComponentRenderable::InternalFlags::DebugGeometry))
       {
-         vDebugGeometryToRender.push(sRenderOperation);
+         pContext.DebugGeometryToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_09_DebugGeometry, sRenderOperation.mIndex));
          pRenderable->setRenderPass(RenderPass::_09_DebugGeometry);
       }
       else
@@ -1006,43 +1487,27 @@ void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, Ren
          {
             if(!uiElement || uiElement->getClassName() == ComponentUI2DElement::ClassName)
             {
-               vUIElementsToRender.push(sRenderOperation);
+               pContext.UIElementsToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_06_UI2D, sRenderOperation.mIndex));
                pRenderable->setRenderPass(RenderPass::_06_UI2D);
             }
             else
             {
-               queueForRendering3DUI(pRenderable, sRenderOperation);
+               queueForRendering3DUI(pRenderable, sRenderOperation, pContext);
             }
          }
          else if(sprite->getLayer() == SpriteLayer::Pre3D)
          {
-            vPre3DSpritesToRender.push(sRenderOperation);
+            pContext.Pre3DSpritesToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_01_Pre3D, sRenderOperation.mIndex));
             pRenderable->setRenderPass(RenderPass::_01_Pre3D);
          }
          else
          {
-            vPostUISpritesToRender.push(sRenderOperation);
+            pContext.PostUISpritesToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_08_PostUI, sRenderOperation.mIndex));
             pRenderable->setRenderPass(RenderPass::_08_PostUI);
          }
       }
 
-      if(sprite->getGeometryType() == GeometryType::Static)
-      {
-         GESTLMap(uint, GeometryRenderInfo)::const_iterator it = mStaticGeometryToRender.find(renderableID);
-
-         if(it == mStaticGeometryToRender.end())
-         {
-            GPUBufferPair& sBuffers = sGPUBufferPairs[GeometryGroup::SpriteStatic];
-            mStaticGeometryToRender[renderableID] = GeometryRenderInfo(sBuffers.CurrentVertexBufferOffset, sBuffers.CurrentIndexBufferOffset);
-            loadRenderingData(sRenderOperation.mData, sBuffers);
-         }
-      }
-      else
-      {
-         GPUBufferPair& sBuffers = sGPUBufferPairs[GeometryGroup::SpriteDynamic];
-         mDynamicGeometryToRender[renderableID] = GeometryRenderInfo(sBuffers.CurrentVertexBufferOffset, sBuffers.CurrentIndexBufferOffset);
-         loadRenderingData(sRenderOperation.mData, sBuffers);
-      }
+      queueGeometryUpload(sRenderOperation, pContext);
    }
    else if(pRenderable->getClassName() == _Label_)
    {
@@ -1052,7 +1517,7 @@ void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, Ren
 #if defined (GE_EDITOR_SUPPORT)
       if(GEHasFlag(pRenderable->getInternalFlags(), ComponentRenderable::InternalFlags::DebugGeometry))
       {
-         vDebugGeometryToRender.push(sRenderOperation);
+         pContext.DebugGeometryToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_09_DebugGeometry, sRenderOperation.mIndex));
          pRenderable->setRenderPass(RenderPass::_09_DebugGeometry);
       }
       else
@@ -1064,35 +1529,33 @@ void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, Ren
             {
                if(uiElement->getClassName() == ComponentUI2DElement::ClassName)
                {
-                  vUIElementsToRender.push(sRenderOperation);
+                  pContext.UIElementsToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_06_UI2D, sRenderOperation.mIndex));
                   pRenderable->setRenderPass(RenderPass::_06_UI2D);
                }
                else
                {
-                  queueForRendering3DUI(pRenderable, sRenderOperation);
+                  queueForRendering3DUI(pRenderable, sRenderOperation, pContext);
                }
             }
             else
             {
-               v3DLabelsToRender.push(sRenderOperation);
+               pContext.Labels3DToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_03_Labels3D, sRenderOperation.mIndex));
                pRenderable->setRenderPass(RenderPass::_03_Labels3D);
             }
          }
          else if(label->getLayer() == SpriteLayer::Pre3D)
          {
-            vPre3DSpritesToRender.push(sRenderOperation);
+            pContext.Pre3DSpritesToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_01_Pre3D, sRenderOperation.mIndex));
             pRenderable->setRenderPass(RenderPass::_01_Pre3D);
          }
          else
          {
-            vPostUISpritesToRender.push(sRenderOperation);
+            pContext.PostUISpritesToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_08_PostUI, sRenderOperation.mIndex));
             pRenderable->setRenderPass(RenderPass::_08_PostUI);
          }
       }
 
-      GPUBufferPair& buffers = sGPUBufferPairs[GeometryGroup::Label];
-      mDynamicGeometryToRender[renderableID] = GeometryRenderInfo(buffers.CurrentVertexBufferOffset, buffers.CurrentIndexBufferOffset);
-      loadRenderingData(sRenderOperation.mData, buffers);
+      queueGeometryUpload(sRenderOperation, pContext);
    }
    else if(pRenderable->getClassName() == _ParticleSystem_)
    {
@@ -1100,10 +1563,9 @@ void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, Ren
       {
          ComponentParticleSystem* cParticleSystem = static_cast<ComponentParticleSystem*>(pRenderable);
 
-         if(GEHasFlag(cParticleSystem->getSettings(), ParticleSystemSettingsBitMask::DynamicShadows) &&
-            pRenderable->getRenderingMode() == RenderingMode::_3D)
+         if(GEHasFlag(pQueueingFlags, QueueingFlags::ShadowCaster))
          {
-            vShadowedParticlesToRender.push_back(sRenderOperation);
+            registerShadowCaster(pRenderable, sRenderOperation, pContext);
          }
 
          if(cParticleSystem->getParticleType() == ParticleType::TextBillboard ||
@@ -1113,37 +1575,39 @@ void RenderSystem::queueForRenderingSingle(ComponentRenderable* pRenderable, Ren
                const_cast<Texture*>(cParticleSystem->getParticleTextFont()->getTexture());
          }
 
-         if(uiElement)
+         if(GEHasFlag(pQueueingFlags, QueueingFlags::View))
          {
-            if(uiElement->getClassName() == ComponentUI2DElement::ClassName)
+            if(uiElement)
             {
-               vUIElementsToRender.push(sRenderOperation);
+               if(uiElement->getClassName() == ComponentUI2DElement::ClassName)
+               {
+                  pContext.UIElementsToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_06_UI2D, sRenderOperation.mIndex));
+                  pRenderable->setRenderPass(RenderPass::_06_UI2D);
+               }
+               else
+               {
+                  queueForRendering3DUI(pRenderable, sRenderOperation, pContext);
+               }
+            }
+            else if(pRenderable->getRenderingMode() == RenderingMode::_2D)
+            {
+               pContext.UIElementsToRender.push(sRenderOperation, RenderSortKey::makeOrdered(RenderPass::_06_UI2D, sRenderOperation.mIndex));
                pRenderable->setRenderPass(RenderPass::_06_UI2D);
             }
             else
             {
-               queueForRendering3DUI(pRenderable, sRenderOperation);
+               pContext.TransparentMeshesToRender.push(sRenderOperation,
+                  RenderSortKey::makeDepth(RenderPass::_04_TransparentMeshes, RenderSortKey::kDepthMax - getCameraDepth(sRenderOperation)));
+               pRenderable->setRenderPass(RenderPass::_04_TransparentMeshes);
             }
          }
-         else if(pRenderable->getRenderingMode() == RenderingMode::_2D)
-         {
-            vUIElementsToRender.push(sRenderOperation);
-            pRenderable->setRenderPass(RenderPass::_06_UI2D);
-         }
-         else
-         {
-            vTransparentMeshesToRender.push_back(sRenderOperation);
-            pRenderable->setRenderPass(RenderPass::_04_TransparentMeshes);
-         }
 
-         GPUBufferPair& sBuffers = sGPUBufferPairs[GeometryGroup::Particles];
-         mDynamicGeometryToRender[renderableID] = GeometryRenderInfo(sBuffers.CurrentVertexBufferOffset, sBuffers.CurrentIndexBufferOffset);
-         loadRenderingData(sRenderOperation.mData, sBuffers, 4u);
+         queueGeometryUpload(sRenderOperation, pContext);
       }
    }
 }
 
-void RenderSystem::queueForRendering3DUI(ComponentRenderable* pRenderable, RenderOperation& pRenderOperation)
+void RenderSystem::queueForRendering3DUI(ComponentRenderable* pRenderable, RenderOperation& pRenderOperation, QueueingContext& pContext)
 {
    ComponentUI3DElement* uiElement = pRenderable->getOwner()->getComponent<ComponentUI3DElement>();
    GEAssert(uiElement);
@@ -1154,10 +1618,343 @@ void RenderSystem::queueForRendering3DUI(ComponentRenderable* pRenderable, Rende
    const uint16_t canvasSettings = s3DUICanvasEntries[canvasIndex].Settings;
    const bool firstPass = !GEHasFlag(canvasSettings, CanvasSettingsBitMask::RenderAfter2DElements);
 
-   v3DUIElementsToRender[uiElement->getCanvasIndex()].push(pRenderOperation);
-   pRenderable->setRenderPass(firstPass ? RenderPass::_05_UI3DFirst : RenderPass::_07_UI3DSecond);
+   const RenderPass renderPass = firstPass ? RenderPass::_05_UI3DFirst : RenderPass::_07_UI3DSecond;
+   pContext.UI3DElementsToRender[canvasIndex].push(pRenderOperation, RenderSortKey::makeOrdered(renderPass, pRenderOperation.mIndex));
+   pRenderable->setRenderPass(renderPass);
+
+   pContext.Any3DUIElementsToRender = true;
+}
+
+void RenderSystem::queueGeometryUpload(const RenderOperation& pRenderOperation, QueueingContext& pContext)
+{
+   GeometryUpload upload;
+   upload.GeometryID = pRenderOperation.mGeometryID;
+   upload.Group = pRenderOperation.mGroup;
+   upload.IndexSize = pRenderOperation.mVertexIndexSize;
+   upload.Data = pRenderOperation.mData;
+   pContext.GeometryUploads.push_back(upload);
+}
+
+void RenderSystem::loadRenderingData(const GeometryData* pData, uint32_t pGroup, uint32_t pIndexSize)
+{
+   GPUBufferPair& buffers = sGPUBufferPairs[pGroup];
+   GEAssert(pData->VertexStride == buffers.VertexStride);
+
+   const uint32_t indexSize = getStoredIndexSize(pIndexSize);
+
+   mCommandBuffer->uploadGeometry((uint16_t)pGroup, pData,
+      buffers.CurrentVertexBufferOffset, buffers.CurrentIndexBufferOffset, (uint16_t)indexSize);
+
+   buffers.CurrentVertexBufferOffset += pData->NumVertices * pData->VertexStride;
+   buffers.CurrentIndexBufferOffset += pData->NumIndices * indexSize;
+}
+
+void RenderSystem::loadGeometry(const GeometryUpload& pUpload)
+{
+   if(pUpload.Group == GeometryGroup::MeshStatic || pUpload.Group == GeometryGroup::SpriteStatic)
+   {
+      if(mStaticGeometryToRender.find(pUpload.GeometryID) == mStaticGeometryToRender.end())
+      {
+         loadStaticGeometry(pUpload);
+      }
+
+      return;
+   }
+
+   GPUBufferPair& buffers = sGPUBufferPairs[pUpload.Group];
+   mDynamicGeometryToRender[pUpload.GeometryID] = GeometryRenderInfo(buffers.CurrentVertexBufferOffset, buffers.CurrentIndexBufferOffset);
+
+   loadRenderingData(pUpload.Data, pUpload.Group, pUpload.IndexSize);
+}
+
+bool RenderSystem::loadStaticGeometry(const GeometryUpload& pUpload)
+{
+   GEAssert(pUpload.Data->VertexStride == sGPUBufferPairs[pUpload.Group].VertexStride);
+
+   StaticGeometryEntry entry;
+
+   if(!allocateStaticGeometry(pUpload, &entry))
+   {
+      // there may be enough space, only too fragmented to hold the geometry in one piece
+      packStaticGeometry();
+
+      if(!allocateStaticGeometry(pUpload, &entry))
+      {
+         Log::log(LogType::Error, "Out of static geometry buffer space (%u vertices and %u indices requested)",
+            pUpload.Data->NumVertices, pUpload.Data->NumIndices);
+         GEAssert(false);
+         return false;
+      }
+   }
+
+   mStaticGeometryToRender[pUpload.GeometryID] = entry;
+
+   mCommandBuffer->uploadGeometry(pUpload.Group, pUpload.Data,
+      entry.RenderInfo.mVertexBufferOffset, entry.RenderInfo.mIndexBufferOffset, (uint16_t)getStoredIndexSize(pUpload.IndexSize));
+
+   return true;
+}
+
+bool RenderSystem::allocateStaticGeometry(const GeometryUpload& pUpload, StaticGeometryEntry* pOutEntry)
+{
+   GPUBufferPair& buffers = sGPUBufferPairs[pUpload.Group];
+
+   const uint32_t vertexDataSize = pUpload.Data->NumVertices * pUpload.Data->VertexStride;
+   const uint32_t indicesSize = pUpload.Data->NumIndices * getStoredIndexSize(pUpload.IndexSize);
+
+   const GPUBufferHandle vertexBlock = buffers.VertexAllocator.allocate(vertexDataSize);
+
+   if(!vertexBlock.isValid())
+      return false;
+
+   const GPUBufferHandle indexBlock = buffers.IndexAllocator.allocate(indicesSize);
+
+   if(!indexBlock.isValid())
+   {
+      buffers.VertexAllocator.release(vertexBlock);
+      return false;
+   }
+
+   pOutEntry->VertexBlock = vertexBlock;
+   pOutEntry->IndexBlock = indexBlock;
+   pOutEntry->Group = pUpload.Group;
+   pOutEntry->IndexSize = pUpload.IndexSize;
+   pOutEntry->Data = pUpload.Data;
+   pOutEntry->RenderInfo = GeometryRenderInfo(
+      buffers.VertexAllocator.getBlock(vertexBlock).Offset, buffers.IndexAllocator.getBlock(indexBlock).Offset);
+
+   return true;
+}
+
+void RenderSystem::releaseStaticGeometry(uint32_t pGeometryID)
+{
+   // removals may come from any thread, so the entries are only looked up at the end of the frame
+   GEMutexLock(mStaticGeometryReleaseMutex);
+   mStaticGeometryToRelease.push_back(pGeometryID);
+   GEMutexUnlock(mStaticGeometryReleaseMutex);
+}
+
+void RenderSystem::defragmentStaticGeometry()
+{
+   mStaticGeometryPackPending = true;
+}
+
+void RenderSystem::collectStaticGeometryReleases()
+{
+   GEMutexLock(mStaticGeometryReleaseMutex);
+
+   for(size_t i = 0u; i < mStaticGeometryToRelease.size(); i++)
+   {
+      GESTLMap(uint, StaticGeometryEntry)::iterator it = mStaticGeometryToRender.find(mStaticGeometryToRelease[i]);
+
+      if(it == mStaticGeometryToRender.end())
+         continue;
+
+      StaticGeometryRelease release;
+      release.VertexBlock = it->second.VertexBlock;
+      release.IndexBlock = it->second.IndexBlock;
+      release.Group = it->second.Group;
+      // the frame being recorded may still draw from the blocks, but none of the following ones
+      release.LastFrame = mFramesRecorded;
+      mStaticGeometryReleases.push_back(release);
+
+      mStaticGeometryToRender.erase(it);
+   }
+
+   mStaticGeometryToRelease.clear();
+
+   GEMutexUnlock(mStaticGeometryReleaseMutex);
+}
+
+void RenderSystem::updateStaticGeometryReleases()
+{
+   collectStaticGeometryReleases();
+
+   const uint32_t framesCompleted = mFramesCompleted;
+
+   for(size_t i = 0u; i < mStaticGeometryReleases.size(); )
+   {
+      const StaticGeometryRelease& release = mStaticGeometryReleases[i];
+
+      if((int32_t)(framesCompleted - release.LastFrame) <= 0)
+      {
+         i++;
+         continue;
+      }
+
+      sGPUBufferPairs[release.Group].VertexAllocator.release(release.VertexBlock);
+      sGPUBufferPairs[release.Group].IndexAllocator.release(release.IndexBlock);
+
+      mStaticGeometryReleases[i] = mStaticGeometryReleases.back();
+      mStaticGeometryReleases.pop_back();
+   }
+}
+
+void RenderSystem::packStaticGeometry()
+{
+   GEProfilerMarker("RenderSystem::packStaticGeometry()");
+
+   // released entries may no longer have source data to upload from
+   collectStaticGeometryReleases();
+
+   // the uploads from now on wait for the GPU to finish the frames recorded so far, which are the only
+   // ones that can draw from the released blocks, so the blocks can be packed over right away
+   const bool blocksReleased = !mStaticGeometryReleases.empty();
+
+   for(size_t i = 0u; i < mStaticGeometryReleases.size(); i++)
+   {
+      const StaticGeometryRelease& release = mStaticGeometryReleases[i];
+      sGPUBufferPairs[release.Group].VertexAllocator.release(release.VertexBlock);
+      sGPUBufferPairs[release.Group].IndexAllocator.release(release.IndexBlock);
+   }
+
+   mStaticGeometryReleases.clear();
+
+   const uint32_t staticGroups[] = { GeometryGroup::SpriteStatic, GeometryGroup::MeshStatic };
+   uint32_t movedBlocks = 0u;
+
+   for(uint32_t i = 0u; i < sizeof(staticGroups) / sizeof(staticGroups[0]); i++)
+   {
+      GPUBufferPair& buffers = sGPUBufferPairs[staticGroups[i]];
+      movedBlocks += buffers.VertexAllocator.defragment();
+      movedBlocks += buffers.IndexAllocator.defragment();
+   }
+
+   if(movedBlocks == 0u && !blocksReleased)
+      return;
+
+   // the uploads are replayed after the draws already recorded from the old offsets, but the GPU
+   // may not have executed those draws yet, and the uploads do not wait for it
+   mCommandBuffer->waitForGPU();
+
+   if(movedBlocks == 0u)
+      return;
+
+   // the geometry is uploaded again from its source data, since not every backend can copy within a buffer
+
+   uint32_t reloadedEntries = 0u;
+
+   for(GESTLMap(uint, StaticGeometryEntry)::iterator it = mStaticGeometryToRender.begin(); it != mStaticGeometryToRender.end(); it++)
+   {
+      StaticGeometryEntry& entry = it->second;
+      const GPUBufferPair& buffers = sGPUBufferPairs[entry.Group];
+      const GeometryRenderInfo renderInfo(
+         buffers.VertexAllocator.getBlock(entry.VertexBlock).Offset, buffers.IndexAllocator.getBlock(entry.IndexBlock).Offset);
+
+      if(renderInfo.mVertexBufferOffset == entry.RenderInfo.mVertexBufferOffset &&
+         renderInfo.mIndexBufferOffset == entry.RenderInfo.mIndexBufferOffset)
+      {
+         continue;
+      }
+
+      entry.RenderInfo = renderInfo;
+      mCommandBuffer->uploadGeometry(entry.Group, entry.Data,
+         renderInfo.mVertexBufferOffset, renderInfo.mIndexBufferOffset, (uint16_t)getStoredIndexSize(entry.IndexSize));
+      reloadedEntries++;
+   }
+
+   Log::log(LogType::Info, "Static geometry defragmented: %u blocks moved, %u entries uploaded again", movedBlocks, reloadedEntries);
+}
+
+const GPUBufferAllocator& RenderSystem::getStaticVertexAllocator(uint32_t pGroup) const
+{
+   GEAssert(pGroup == GeometryGroup::SpriteStatic || pGroup == GeometryGroup::MeshStatic);
+   return sGPUBufferPairs[pGroup].VertexAllocator;
+}
+
+const GPUBufferAllocator& RenderSystem::getStaticIndexAllocator(uint32_t pGroup) const
+{
+   GEAssert(pGroup == GeometryGroup::SpriteStatic || pGroup == GeometryGroup::MeshStatic);
+   return sGPUBufferPairs[pGroup].IndexAllocator;
+}
+
+void RenderSystem::mergeQueueingContext(QueueingContext& pContext)
+{
+   GEProfilerMarker("RenderSystem::mergeQueueingContext()");
+
+#if defined (GE_EDITOR_SUPPORT)
+   for(size_t i = 0u; i < pContext.EntitiesToDeactivate.size(); i++)
+   {
+      Entity* entity = pContext.EntitiesToDeactivate[i];
+      Log::log(LogType::Warning, "There is no active camera. The entity '%s' will be deactivated.", entity->getFullName().getString());
+      entity->setActive(false);
+   }
+
+   pContext.EntitiesToDeactivate.clear();
+#endif
+
+   // entries of removed renderables are dropped first, so that a renderable added again under the
+   // same name uploads its own geometry instead of drawing the one of the removed renderable
+   if(!pContext.GeometryUploads.empty())
+   {
+      collectStaticGeometryReleases();
+   }
+
+   // uploads go through the graphics API, which is only used from this thread
+   for(size_t i = 0u; i < pContext.GeometryUploads.size(); i++)
+   {
+      loadGeometry(pContext.GeometryUploads[i]);
+   }
+
+   pContext.GeometryUploads.clear();
+
+   for(size_t i = 0u; i < pContext.BatchRequests.size(); i++)
+   {
+      const BatchRequest& batchRequest = pContext.BatchRequests[i];
+      ComponentRenderable* renderable = batchRequest.Renderable;
+
+      const uint32_t materialID = batchRequest.RenderMaterialPass->getMaterial()->getName().getID();
+      RenderOperation& batch = mBatches.find(materialID)->second;
+      batch.mRenderMaterialPass = batchRequest.RenderMaterialPass;
 
-   mAny3DUIElementsToRender = true;
+      if(renderable->getClassName() == _Mesh_)
+      {
+         batch.mGroup = GeometryGroup::MeshBatch;
+      }
+      else if(renderable->getClassName() == _Sprite_)
+      {
+         batch.mGroup = GeometryGroup::SpriteBatch;
+      }
+      else if(renderable->getClassName() == _Label_)
+      {
+         batch.mGroup = GeometryGroup::LabelBatch;
+      }
+
+      queueForRenderingBatch(renderable, batch);
+   }
+
+   pContext.BatchRequests.clear();
+
+   vUIElementsToRender.append(pContext.UIElementsToRender);
+   vPre3DSpritesToRender.append(pContext.Pre3DSpritesToRender);
+   vPostUISpritesToRender.append(pContext.PostUISpritesToRender);
+   v3DLabelsToRender.append(pContext.Labels3DToRender);
+   vOpaqueMeshesToRender.append(pContext.OpaqueMeshesToRender);
+   vTransparentMeshesToRender.append(pContext.TransparentMeshesToRender);
+   vDebugGeometryToRender.append(pContext.DebugGeometryToRender);
+
+   for(uint32_t i = 0u; i < k3DUICanvasCount; i++)
+   {
+      v3DUIElementsToRender[i].append(pContext.UI3DElementsToRender[i]);
+   }
+
+   mAny3DUIElementsToRender |= pContext.Any3DUIElementsToRender;
+   pContext.Any3DUIElementsToRender = false;
+
+   vStaticShadowedMeshesToRender.insert(vStaticShadowedMeshesToRender.end(),
+      pContext.StaticShadowedMeshesToRender.begin(), pContext.StaticShadowedMeshesToRender.end());
+   vDynamicShadowedMeshesToRender.insert(vDynamicShadowedMeshesToRender.end(),
+      pContext.DynamicShadowedMeshesToRender.begin(), pContext.DynamicShadowedMeshesToRender.end());
+   vShadowedParticlesToRender.insert(vShadowedParticlesToRender.end(),
+      pContext.ShadowedParticlesToRender.begin(), pContext.ShadowedParticlesToRender.end());
+   pContext.StaticShadowedMeshesToRender.clear();
+   pContext.DynamicShadowedMeshesToRender.clear();
+   pContext.ShadowedParticlesToRender.clear();
+
+   mShadowCastersHash += pContext.ShadowCastersHash;
+   mDynamicShadowCastersQueued |= pContext.DynamicShadowCastersQueued;
+   pContext.ShadowCastersHash = 0u;
+   pContext.DynamicShadowCastersQueued = false;
 }
 
 void RenderSystem::queueForRenderingBatch(ComponentRenderable* pRenderable, RenderOperation& sBatch)
@@ -1214,6 +2011,32 @@ void RenderSystem::queueForRenderingBatch(ComponentRenderable* pRenderable, Rend
    sBatch.mData->NumIndices += iRenderableNumIndices;
 }
 
+uint32_t RenderSystem::getCameraDepth(const RenderOperation& pRenderOperation) const
+{
+   if(!cActiveCamera)
+      return 0u;
+
+   const Vector3 worldPosition = Vector3
+   (
+      pRenderOperation.mWorldTransform.m[GE_M4_1_4],
+      pRenderOperation.mWorldTransform.m[GE_M4_2_4],
+      pRenderOperation.mWorldTransform.m[GE_M4_3_4]
+   );
+   Vector3 toCamera = cActiveCamera->getTransform()->getWorldPosition() - worldPosition;
+
+   return RenderSortKey::quantizeDepth(toCamera.getLength(), cActiveCamera->getFarZ());
+}
+
+uint64_t RenderSystem::getStateSortKey(RenderPass pPass, uint8_t pPriority, const RenderOperation& pRenderOperation, uint32_t pDepth) const
+{
+   const Material* material = pRenderOperation.mRenderMaterialPass->getMaterial();
+   const uint32_t textureID = pRenderOperation.mDiffuseTexture ? pRenderOperation.mDiffuseTexture->getName().getID() : 0u;
+
+   // front to back within the same state, so that the depth test rejects as many fragments as possible
+   return RenderSortKey::makeState(pPass, pPriority,
+      material->getShaderProgram().getID(), material->getName().getID(), textureID, pDepth);
+}
+
 void RenderSystem::prepareBatchForRendering(const RenderOperation& sBatch)
 {
    GEProfilerMarker("RenderSystem::prepareBatchForRendering()");
@@ -1221,21 +2044,31 @@ void RenderSystem::prepareBatchForRendering(const RenderOperation& sBatch)
    GPUBufferPair& sBuffers = sGPUBufferPairs[sBatch.mGroup];
    mDynamicGeometryToRender[sBatch.mGeometryID] = GeometryRenderInfo(sBuffers.CurrentVertexBufferOffset, sBuffers.CurrentIndexBufferOffset);
 
-   loadRenderingData(sBatch.mData, sBuffers, sBatch.mVertexIndexSize);
+   loadRenderingData(sBatch.mData, sBatch.mGroup, sBatch.mVertexIndexSize);
 
    //TODO: push the batch into the corresponding queue
-   vUIElementsToRender.push(sBatch);
+   vUIElementsToRender.push(sBatch, RenderSortKey::makeOrdered(RenderPass::_06_UI2D, sBatch.mIndex));
 }
 
 void RenderSystem::clearRenderingQueues()
 {
-   vShadowedMeshesToRender.clear();
+   vStaticShadowedMeshesToRender.clear();
+   vDynamicShadowedMeshesToRender.clear();
    vShadowedParticlesToRender.clear();
-   vTransparentMeshesToRender.clear();
    vLightsToRender.clear();
 
+   vUIElementsToRender.clear();
+   vPre3DSpritesToRender.clear();
+   vPostUISpritesToRender.clear();
+   v3DLabelsToRender.clear();
+   vOpaqueMeshesToRender.clear();
+   vTransparentMeshesToRender.clear();
+   vDebugGeometryToRender.clear();
+
    for(uint32_t i = 0u; i < k3DUICanvasCount; i++)
    {
+      v3DUIElementsToRender[i].clear();
+
       s3DUICanvasEntries[i].Index = (uint16_t)i;
       s3DUICanvasEntries[i].Settings = 0u;
       s3DUICanvasEntries[i].WorldPosition = Vector3::Zero;
@@ -1290,6 +2123,161 @@ int canvasSortComparer(const void* pCanvas1, const void* pCanvas2)
       : -1;
 }
 
+const GeometryRenderInfo& RenderSystem::getGeometryRenderInfo(const RenderOperation& pRenderOperation) const
+{
+   if(pRenderOperation.isStatic())
+   {
+      return mStaticGeometryToRender.find(pRenderOperation.mGeometryID)->second.RenderInfo;
+   }
+
+   return mDynamicGeometryToRender.find(pRenderOperation.mGeometryID)->second;
+}
+
+void RenderSystem::render(const RenderOperation& sRenderOperation)
+{
+   const uint32_t operationIndex = mCommandBuffer->setConstants(sRenderOperation);
+   mCommandBuffer->bindTexture((uint8_t)TextureSlot::Diffuse, sRenderOperation.mDiffuseTexture);
+
+   // the offsets are resolved while recording, so the backends do not need the geometry registries
+   const GeometryRenderInfo& geometryInfo = getGeometryRenderInfo(sRenderOperation);
+
+   mCommandBuffer->bindBuffers(sRenderOperation.mGroup);
+   mCommandBuffer->draw(operationIndex, sRenderOperation.mGroup,
+      geometryInfo.mVertexBufferOffset, geometryInfo.mIndexBufferOffset,
+      sRenderOperation.mData->NumIndices, sRenderOperation.mVertexIndexSize);
+}
+
+void RenderSystem::render(RenderQueue& pRenderQueue)
+{
+   pRenderQueue.sort();
+
+   for(uint32_t i = 0u; i < pRenderQueue.size(); i++)
+   {
+      const RenderOperation& sRenderOperation = pRenderQueue[i];
+      mCommandBuffer->useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
+      render(sRenderOperation);
+   }
+
+   pRenderQueue.clear();
+}
+
+void RenderSystem::renderInstanced(RenderQueue& pRenderQueue)
+{
+   if(!mInstancingEnabled)
+   {
+      render(pRenderQueue);
+      return;
+   }
+
+   pRenderQueue.sort();
+
+   uint32_t first = 0u;
+
+   while(first < pRenderQueue.size())
+   {
+      // operations sharing the same state are next to each other once the queue is sorted
+      uint32_t end = first + 1u;
+
+      while(end < pRenderQueue.size() && canShareInstancedDraw(pRenderQueue[first], pRenderQueue[end]))
+      {
+         end++;
+      }
+
+      renderInstanced(pRenderQueue, first, end);
+      first = end;
+   }
+
+   pRenderQueue.clear();
+}
+
+void RenderSystem::renderInstanced(const RenderQueue& pRenderQueue, uint32_t pFirst, uint32_t pEnd)
+{
+   mCommandBuffer->useMaterial(pRenderQueue[pFirst].mRenderMaterialPass->getMaterial());
+
+   if(pEnd - pFirst < kMinInstancesPerDraw)
+   {
+      for(uint32_t i = pFirst; i < pEnd; i++)
+      {
+         render(pRenderQueue[i]);
+      }
+
+      return;
+   }
+
+   // the whole range shares the state, so the operations can be regrouped by the geometry they draw
+   mInstanceCandidates.clear();
+
+   for(uint32_t i = pFirst; i < pEnd; i++)
+   {
+      InstanceCandidate candidate;
+      candidate.VertexData = pRenderQueue[i].mData->VertexData;
+      candidate.QueueIndex = i;
+      mInstanceCandidates.push_back(candidate);
+   }
+
+   std::sort(mInstanceCandidates.begin(), mInstanceCandidates.end(),
+      [](const InstanceCandidate& pCandidate1, const InstanceCandidate& pCandidate2) -> bool
+      {
+         return pCandidate1.VertexData != pCandidate2.VertexData
+            ? (uintptr_t)pCandidate1.VertexData < (uintptr_t)pCandidate2.VertexData
+            : pCandidate1.QueueIndex < pCandidate2.QueueIndex;
+      });
+
+   const uint32_t candidatesCount = (uint32_t)mInstanceCandidates.size();
+   uint32_t groupFirst = 0u;
+
+   while(groupFirst < candidatesCount)
+   {
+      const RenderOperation& groupOperation = pRenderQueue[mInstanceCandidates[groupFirst].QueueIndex];
+      uint32_t groupEnd = groupFirst + 1u;
+
+      while(groupEnd < candidatesCount &&
+         mInstanceCandidates[groupEnd].VertexData == groupOperation.mData->VertexData &&
+         pRenderQueue[mInstanceCandidates[groupEnd].QueueIndex].mData->NumIndices == groupOperation.mData->NumIndices)
+      {
+         groupEnd++;
+      }
+
+      if(groupEnd - groupFirst >= kMinInstancesPerDraw)
+      {
+         renderInstances(pRenderQueue, &mInstanceCandidates[groupFirst], groupEnd - groupFirst);
+      }
+      else
+      {
+         render(groupOperation);
+      }
+
+      groupFirst = groupEnd;
+   }
+}
+
+void RenderSystem::renderInstances(const RenderQueue& pRenderQueue, const InstanceCandidate* pCandidates, uint32_t pCount)
+{
+   const RenderOperation& firstOperation = pRenderQueue[pCandidates[0].QueueIndex];
+   const uint32_t firstInstance = mCommandBuffer->getInstancesCount();
+
+   for(uint32_t i = 0u; i < pCount; i++)
+   {
+      const RenderOperation& renderOperation = pRenderQueue[pCandidates[i].QueueIndex];
+      mCommandBuffer->pushInstance(renderOperation.mWorldTransform, renderOperation.mColor);
+   }
+
+   // the backend sets the constants along with the draw, since they depend on how it draws the instances
+   const uint32_t operationIndex = mCommandBuffer->recordOperation(firstOperation);
+   mCommandBuffer->bindTexture((uint8_t)TextureSlot::Diffuse, firstOperation.mDiffuseTexture);
+
+   // all the instances have the same vertex data, so the copy uploaded for the first one is drawn
+   const GeometryRenderInfo& geometryInfo = getGeometryRenderInfo(firstOperation);
+
+   mCommandBuffer->bindBuffers(firstOperation.mGroup);
+   mCommandBuffer->drawInstanced(operationIndex, firstOperation.mGroup,
+      geometryInfo.mVertexBufferOffset, geometryInfo.mIndexBufferOffset,
+      firstOperation.mData->NumIndices, firstOperation.mVertexIndexSize,
+      firstInstance, pCount);
+
+   mInstancedRenderables += pCount;
+}
+
 void RenderSystem::renderFrame()
 {
    if(!mBatches.empty())
@@ -1307,81 +2295,40 @@ void RenderSystem::renderFrame()
       }
    }
 
-   while(!vPre3DSpritesToRender.empty())
-   {
-      const RenderOperation& sRenderOperation = vPre3DSpritesToRender.top();
-      useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
-      render(sRenderOperation);
-      vPre3DSpritesToRender.pop();
-      iDrawCalls++;
-   }
+   render(vPre3DSpritesToRender);
 
    if(!vOpaqueMeshesToRender.empty() ||
       !v3DLabelsToRender.empty() ||
       !vTransparentMeshesToRender.empty() ||
       mAny3DUIElementsToRender)
    {
-      if(!vShadowedMeshesToRender.empty() || !vShadowedParticlesToRender.empty())
+      if(isShadowMapUpdatePending())
       {
-         renderShadowMap();
-      }
+         // the static casters are only recorded when the cached layer has to be rendered again
+         RenderFrameState& frameState = mCommandBuffer->getFrameState();
+         frameState.StaticShadowLayerUpdatePending = mShadowMapResizePending || mShadowCastersHash != mStaticShadowLayerHash;
+         frameState.ShadowMapResizePending = mShadowMapResizePending;
 
-      while(!vOpaqueMeshesToRender.empty())
-      {
-         const RenderOperation& sRenderOperation = vOpaqueMeshesToRender.top();
-         useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
-         render(sRenderOperation);
-         vOpaqueMeshesToRender.pop();
-         iDrawCalls++;
-      }
+         if(frameState.StaticShadowLayerUpdatePending)
+         {
+            recordShadowCasters(vStaticShadowedMeshesToRender, &frameState.StaticShadowedMeshes);
+         }
 
-      while(!v3DLabelsToRender.empty())
-      {
-         const RenderOperation& sRenderOperation = v3DLabelsToRender.top();
-         useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
-         render(sRenderOperation);
-         v3DLabelsToRender.pop();
-         iDrawCalls++;
+         recordShadowCasters(vDynamicShadowedMeshesToRender, &frameState.DynamicShadowedMeshes);
+         recordShadowCasters(vShadowedParticlesToRender, &frameState.ShadowedParticles);
+         mCommandBuffer->renderShadowMap();
+
+         mShadowMapResizePending = false;
+         mStaticShadowLayerHash = mShadowCastersHash;
+         mDynamicShadowCastersRendered = mDynamicShadowCastersQueued;
       }
 
+      renderInstanced(vOpaqueMeshesToRender);
+      render(v3DLabelsToRender);
+
       if(cActiveCamera)
       {
-         if(!vTransparentMeshesToRender.empty())
-         {
-            std::sort(vTransparentMeshesToRender.begin(), vTransparentMeshesToRender.end(),
-            [this](const RenderOperation& sRO1, const RenderOperation& sRO2) -> bool
-            {
-               const Vector3& vCameraWorldPosition = cActiveCamera->getTransform()->getWorldPosition();
-
-               const Vector3 p1WorldPosition = Vector3
-               (
-                  sRO1.mWorldTransform.m[GE_M4_1_4],
-                  sRO1.mWorldTransform.m[GE_M4_2_4],
-                  sRO1.mWorldTransform.m[GE_M4_3_4]
-               );
-               const Vector3 p2WorldPosition = Vector3
-               (
-                  sRO2.mWorldTransform.m[GE_M4_1_4],
-                  sRO2.mWorldTransform.m[GE_M4_2_4],
-                  sRO2.mWorldTransform.m[GE_M4_3_4]
-               );
-
-               const Vector3 vP1ToCamera = vCameraWorldPosition - p1WorldPosition;
-               const Vector3 vP2ToCamera = vCameraWorldPosition - p2WorldPosition;
-
-               return vP1ToCamera.getSquaredLength() > vP2ToCamera.getSquaredLength();
-            });
-
-            GESTLVector(RenderOperation)::const_iterator it = vTransparentMeshesToRender.begin();
-
-            for(; it != vTransparentMeshesToRender.end(); it++)
-            {
-               const RenderOperation& sRenderOperation = *it;
-               useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
-               render(sRenderOperation);
-               iDrawCalls++;
-            }
-         }
+         render(vTransparentMeshesToRender);
 
          qsort(s3DUICanvasEntries, k3DUICanvasCount, sizeof(_3DUICanvasEntry), canvasSortComparer);
 
@@ -1389,61 +2336,32 @@ void RenderSystem::renderFrame()
          {
             if(!GEHasFlag(s3DUICanvasEntries[i].Settings, CanvasSettingsBitMask::RenderAfter2DElements))
             {
-               uint iIndex = s3DUICanvasEntries[i].Index;
-
-               while(!v3DUIElementsToRender[iIndex].empty())
-               {
-                  const RenderOperation& sRenderOperation = v3DUIElementsToRender[iIndex].top();
-                  useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
-                  render(sRenderOperation);
-                  v3DUIElementsToRender[iIndex].pop();
-                  iDrawCalls++;
-               }
+               render(v3DUIElementsToRender[s3DUICanvasEntries[i].Index]);
             }
          }
       }
    }
 
-   while(!vUIElementsToRender.empty())
-   {
-      const RenderOperation& sRenderOperation = vUIElementsToRender.top();
-      useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
-      render(sRenderOperation);
-      vUIElementsToRender.pop();
-      iDrawCalls++;
-   }
+   render(vUIElementsToRender);
 
    for(uint32_t i = 0u; i < k3DUICanvasCount; i++)
    {
-      const uint32_t index = s3DUICanvasEntries[i].Index;
-
-      while(!v3DUIElementsToRender[index].empty())
-      {
-         const RenderOperation& sRenderOperation = v3DUIElementsToRender[index].top();
-         useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
-         render(sRenderOperation);
-         v3DUIElementsToRender[index].pop();
-         iDrawCalls++;
-      }
+      render(v3DUIElementsToRender[s3DUICanvasEntries[i].Index]);
    }
 
-   while(!vPostUISpritesToRender.empty())
-   {
-      const RenderOperation& sRenderOperation = vPostUISpritesToRender.top();
-      useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
-      render(sRenderOperation);
-      vPostUISpritesToRender.pop();
-      iDrawCalls++;
-   }
+   render(vPostUISpritesToRender);
 
 #if defined (GE_EDITOR_SUPPORT)
-   while(!vDebugGeometryToRender.empty())
+   vDebugGeometryToRender.sort();
+
+   for(uint32_t i = 0u; i < vDebugGeometryToRender.size(); i++)
    {
-      const RenderOperation& sRenderOperation = vDebugGeometryToRender.top();
-      useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
+      const RenderOperation& sRenderOperation = vDebugGeometryToRender[i];
+      mCommandBuffer->useMaterial(sRenderOperation.mRenderMaterialPass->getMaterial());
       render(sRenderOperation);
-      vDebugGeometryToRender.pop();
    }
+
+   vDebugGeometryToRender.clear();
 #endif
 
    float fCurrentTime = Time::getElapsed();
@@ -1455,16 +2373,34 @@ void RenderSystem::renderFrame()
       mStaticGeometryToRender.clear();
       mDynamicGeometryToRender.clear();
 
+      // the blocks waiting to be released go away along with everything else
+      GEMutexLock(mStaticGeometryReleaseMutex);
+      mStaticGeometryToRelease.clear();
+      GEMutexUnlock(mStaticGeometryReleaseMutex);
+      mStaticGeometryReleases.clear();
+
       for(uint i = 0; i < GeometryGroup::Count; i++)
       {
          sGPUBufferPairs[i].clear();
       }
 
       bClearGeometryRenderInfoEntriesPending = false;
+      mStaticGeometryPackPending = false;
+   }
+   else
+   {
+      updateStaticGeometryReleases();
+
+      if(mStaticGeometryPackPending)
+      {
+         packStaticGeometry();
+         mStaticGeometryPackPending = false;
+      }
    }
 
    if(bShaderReloadPending)
    {
+      waitForRenderThread();
       loadShaders();
 
       if(Scene::getActiveScene())
@@ -1486,3 +2422,353 @@ void RenderSystem::renderFrame()
       bShaderReloadPending = false;
    }
 }
+
+void RenderSystem::renderBegin()
+{
+   mInstancedRenderables = 0u;
+
+   recordFrameState();
+   mCommandBuffer->beginFrame();
+}
+
+void RenderSystem::renderEnd()
+{
+   mCommandBuffer->endFrame();
+   submitCommands();
+}
+
+void RenderSystem::recordFrameState()
+{
+   RenderFrameState& frameState = mCommandBuffer->getFrameState();
+   frameState.FrameIndex = mFramesRecorded++;
+   frameState.BackgroundColor = cBackgroundColor;
+   frameState.AmbientLightColor = cAmbientLightColor;
+   frameState.ViewProjection2D = mat2DViewProjection;
+   frameState.ShadowCascades.resize(mShadowCascadesCount);
+
+   for(uint32_t i = 0u; i < mShadowCascadesCount; i++)
+   {
+      uint32_t column, row;
+      getShadowCascadeCell(i, &column, &row);
+
+      // maps the light clip space of the cascade to its cell in the shadow map
+      const float columns = (float)getShadowAtlasColumns();
+      const float rows = (float)getShadowAtlasRows();
+
+      Matrix4 matCell;
+      Matrix4MakeIdentity(&matCell);
+      matCell.m[GE_M4_1_1] = 1.0f / columns;
+      matCell.m[GE_M4_2_2] = 1.0f / rows;
+      matCell.m[GE_M4_1_4] = ((float)(2u * column + 1u) / columns) - 1.0f;
+      matCell.m[GE_M4_2_4] = ((float)(2u * row + 1u) / rows) - 1.0f;
+
+      frameState.ShadowCascades[i].ViewProjection = mShadowCascadeViewProjections[i];
+      Matrix4Multiply(matCell, mShadowCascadeViewProjections[i], &frameState.ShadowCascades[i].ReceiverViewProjection);
+   }
+
+   if(cActiveCamera)
+   {
+      frameState.CameraViewProjection = cActiveCamera->getViewProjectionMatrix();
+      frameState.CameraPosition = cActiveCamera->getTransform()->getPosition();
+   }
+
+   frameState.Lights.resize(vLightsToRender.size());
+
+   for(size_t i = 0u; i < vLightsToRender.size(); i++)
+   {
+      ComponentLight* light = vLightsToRender[i];
+      RenderLight& renderLight = frameState.Lights[i];
+
+      renderLight.Type = (uint32_t)light->getLightType();
+      renderLight.LightColor = light->getColor();
+      renderLight.Position = light->getTransform()->getWorldPosition();
+      renderLight.Direction = light->getDirection();
+      renderLight.LinearAttenuation = light->getLinearAttenuation();
+      renderLight.SpotAngle = light->getSpotAngle();
+      renderLight.ShadowIntensity = light->getShadowIntensity();
+   }
+}
+
+void RenderSystem::recordShadowCasters(const GESTLVector(RenderOperation)& pRenderOperations, GESTLVector(RenderShadowCaster)* pOutCasters) const
+{
+   pOutCasters->resize(pRenderOperations.size());
+
+   for(size_t i = 0u; i < pRenderOperations.size(); i++)
+   {
+      (*pOutCasters)[i].record(pRenderOperations[i], getGeometryRenderInfo(pRenderOperations[i]));
+   }
+}
+
+void RenderSystem::submitCommands()
+{
+   if(mCommandBuffer->empty())
+      return;
+
+   if(!mRenderThreadEnabled)
+   {
+      replayCommands(*mCommandBuffer);
+      return;
+   }
+
+   mCommandBuffer->close();
+
+   GEMutexLock(mRenderThreadMutex);
+
+   mFramesSubmitted++;
+   GEConditionVariableSignal(mRenderThreadCondition);
+
+   // the next frame can be recorded as soon as no more than the allowed frames are waiting to be rendered
+   GEConditionVariableWait(mRenderThreadCondition, mRenderThreadMutex, mFramesSubmitted - mFramesRendered <= mFrameLatency);
+
+   GEMutexUnlock(mRenderThreadMutex);
+
+   mCommandBuffer = &mCommandBuffers[mFramesSubmitted % kCommandBuffersCount];
+}
+
+void RenderSystem::replayCommands(RenderCommandBuffer& pCommandBuffer)
+{
+   mCommandBackend->execute(pCommandBuffer);
+
+   // the graphics API backends tell when the GPU is done with the frame, and the other ones do not use it
+   if(mCommandBackend != this)
+   {
+      mFramesCompleted = pCommandBuffer.getFrameState().FrameIndex + 1u;
+   }
+
+   pCommandBuffer.clear();
+}
+
+void RenderSystem::execute(const RenderCommandBuffer& pCommandBuffer)
+{
+   GEProfilerMarker("RenderSystem::execute()");
+
+   mFrameState = &pCommandBuffer.getFrameState();
+
+   for(uint32_t i = 0u; i < pCommandBuffer.size(); i++)
+   {
+      const RenderCommand& command = pCommandBuffer[i];
+
+      switch(command.Type)
+      {
+      case RenderCommandType::BeginFrame:
+         mFrameDrawCalls = 0u;
+         beginFrame();
+         break;
+
+      case RenderCommandType::EndFrame:
+         endFrame();
+         mDrawCalls = mFrameDrawCalls;
+         break;
+
+      case RenderCommandType::RenderShadowMap:
+         renderShadowMap();
+         break;
+
+      case RenderCommandType::UseMaterial:
+         useMaterial(command.MaterialToUse);
+         break;
+
+      case RenderCommandType::BindBuffers:
+         bindBuffers(sGPUBufferPairs[command.Group]);
+         break;
+
+      case RenderCommandType::BindTexture:
+         bindTexture((TextureSlot)command.Slot, command.TextureToBind);
+         break;
+
+      case RenderCommandType::SetConstants:
+         setShaderConstants(pCommandBuffer.getOperation(command.OperationIndex));
+         break;
+
+      case RenderCommandType::UploadGeometry:
+         uploadRenderingData(command);
+         break;
+
+      case RenderCommandType::WaitForGPU:
+         waitForGPU();
+         break;
+
+      case RenderCommandType::Draw:
+         draw(command, pCommandBuffer.getOperation(command.OperationIndex));
+         mFrameDrawCalls++;
+         break;
+
+      case RenderCommandType::DrawInstanced:
+         drawInstanced(command, pCommandBuffer.getOperation(command.OperationIndex), pCommandBuffer.getInstances(command.FirstInstance));
+         break;
+
+      default:
+         break;
+      }
+   }
+
+   mFrameState = nullptr;
+}
+
+void RenderSystem::drawInstancesSeparately(const RenderCommand& pCommand, const RenderConstants& pConstants, const RenderInstance* pInstances)
+{
+   RenderConstants instanceConstants = pConstants;
+
+   for(uint32_t i = 0u; i < pCommand.InstanceCount; i++)
+   {
+      instanceConstants.Operation.mWorldTransform = pInstances[i].WorldTransform;
+      instanceConstants.Operation.mColor = pInstances[i].InstanceColor;
+
+      setShaderConstants(instanceConstants);
+      draw(pCommand, instanceConstants);
+   }
+
+   mFrameDrawCalls += pCommand.InstanceCount;
+}
+
+RenderCommandBackend* RenderSystem::getCommandBackend() const
+{
+   return mCommandBackend;
+}
+
+void RenderSystem::setCommandBackend(RenderCommandBackend* pBackend)
+{
+   waitForRenderThread();
+
+   mCommandBackend = pBackend ? pBackend : this;
+
+   if(mRenderThreadEnabled && !canUseRenderThread())
+   {
+      Log::log(LogType::Warning, "The render thread is not supported by the graphics API backend; it will be disabled");
+      setRenderThreadEnabled(false);
+   }
+}
+
+bool RenderSystem::getRenderThreadEnabled() const
+{
+   return mRenderThreadEnabled;
+}
+
+void RenderSystem::setRenderThreadEnabled(bool pEnabled)
+{
+   if(pEnabled == mRenderThreadEnabled)
+      return;
+
+   if(pEnabled && !canUseRenderThread())
+   {
+      Log::log(LogType::Warning, "The render thread is not supported by the graphics API backend");
+      return;
+   }
+
+   if(pEnabled)
+   {
+      startRenderThread();
+   }
+   else
+   {
+      stopRenderThread();
+   }
+}
+
+uint32_t RenderSystem::getFrameLatency() const
+{
+   return mFrameLatency;
+}
+
+void RenderSystem::setFrameLatency(uint32_t pFrameLatency)
+{
+   GEAssert(pFrameLatency > 0u && pFrameLatency <= kMaxFrameLatency);
+
+   GEMutexLock(mRenderThreadMutex);
+   mFrameLatency = GEMin(GEMax(pFrameLatency, 1u), kMaxFrameLatency);
+   GEMutexUnlock(mRenderThreadMutex);
+}
+
+void RenderSystem::waitForRenderThread()
+{
+   if(!mRenderThreadEnabled)
+      return;
+
+   GEMutexLock(mRenderThreadMutex);
+   GEConditionVariableWait(mRenderThreadCondition, mRenderThreadMutex, mFramesRendered == mFramesSubmitted);
+   GEMutexUnlock(mRenderThreadMutex);
+}
+
+bool RenderSystem::canUseRenderThread() const
+{
+#if defined (GE_RENDERING_API_OPENGL) && !defined (GE_RENDERING_API_NULL)
+   // the context is current on the main thread only, so the commands can only be replayed
+   // from the render thread by a backend that does not use the API
+   return mCommandBackend != this;
+#else
+   return true;
+#endif
+}
+
+void RenderSystem::startRenderThread()
+{
+   mRenderThreadExitPending = false;
+
+   // the recorded geometry data has to outlive the frame in which it was recorded
+   for(uint32_t i = 0u; i < kCommandBuffersCount; i++)
+   {
+      mCommandBuffers[i].setUploadStaging(true);
+   }
+
+   mRenderThreadEnabled = true;
+   GEThreadCreate(mRenderThread, renderThreadFunction, this);
+}
+
+void RenderSystem::stopRenderThread()
+{
+   if(!mRenderThreadEnabled)
+      return;
+
+   GEMutexLock(mRenderThreadMutex);
+   mRenderThreadExitPending = true;
+   GEConditionVariableSignal(mRenderThreadCondition);
+   GEMutexUnlock(mRenderThreadMutex);
+
+   GEThreadWait(mRenderThread);
+   GEThreadClose(mRenderThread);
+
+   mRenderThreadEnabled = false;
+
+   for(uint32_t i = 0u; i < kCommandBuffersCount; i++)
+   {
+      mCommandBuffers[i].setUploadStaging(false);
+   }
+}
+
+void RenderSystem::processRenderThreadFrames()
+{
+   GEMutexLock(mRenderThreadMutex);
+
+   while(true)
+   {
+      GEConditionVariableWait(mRenderThreadCondition, mRenderThreadMutex,
+         mFramesRendered != mFramesSubmitted || mRenderThreadExitPending);
+
+      // pending frames are still rendered before exiting
+      if(mFramesRendered == mFramesSubmitted)
+         break;
+
+      RenderCommandBuffer& commandBuffer = mCommandBuffers[mFramesRendered % kCommandBuffersCount];
+
+      GEMutexUnlock(mRenderThreadMutex);
+
+      replayCommands(commandBuffer);
+
+      GEMutexLock(mRenderThreadMutex);
+
+      mFramesRendered++;
+      GEConditionVariableSignal(mRenderThreadCondition);
+   }
+
+   GEMutexUnlock(mRenderThreadMutex);
+}
+
+GEThreadFunction(RenderSystem::renderThreadFunction)
+{
+   GEProfilerThreadID("Render");
+
+   RenderSystem* renderSystem = static_cast<RenderSystem*>(pData);
+   renderSystem->processRenderThreadFrames();
+
+   return 0;
+}
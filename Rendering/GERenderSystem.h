@@ -22,6 +22,11 @@
 #include "Rendering/GEShaderProgram.h"
 #include "Rendering/GEFont.h"
 #include "Rendering/GETextRasterizer.h"
+#include "Rendering/GEFrustum.h"
+#include "Rendering/GERenderQueue.h"
+#include "Rendering/GERenderCommandBuffer.h"
+#include "Rendering/GEStaticBatching.h"
+#include "Rendering/GEGPUBufferAllocator.h"
 
 #include "Entities/GEComponentCamera.h"
 #include "Entities/GEComponentLight.h"
@@ -33,6 +38,7 @@
 #include <vector>
 #include <set>
 #include <map>
+#include <atomic>
 
 namespace GE { namespace Rendering
 {
@@ -45,6 +51,10 @@ namespace GE { namespace Rendering
       uint CurrentIndexBufferOffset;
       uint IsDynamic;
 
+      // static buffers are sub-allocated, so that the geometry can be released one entry at a time
+      GPUBufferAllocator VertexAllocator;
+      GPUBufferAllocator IndexAllocator;
+
       GPUBufferPair()
          : VertexBuffer(nullptr)
          , IndexBuffer(nullptr)
@@ -59,6 +69,27 @@ namespace GE { namespace Rendering
       {
          CurrentVertexBufferOffset = 0u;
          CurrentIndexBufferOffset = 0u;
+
+         VertexAllocator.reset();
+         IndexAllocator.reset();
+      }
+   };
+
+
+   struct StaticGeometryEntry
+   {
+      GPUBufferHandle VertexBlock;
+      GPUBufferHandle IndexBlock;
+      uint16_t Group;
+      uint16_t IndexSize;
+      const Content::GeometryData* Data;
+      GeometryRenderInfo RenderInfo;
+
+      StaticGeometryEntry()
+         : Group(0u)
+         , IndexSize(0u)
+         , Data(nullptr)
+      {
       }
    };
 
@@ -71,7 +102,7 @@ namespace GE { namespace Rendering
    };
 
 
-   class RenderSystem : public Core::Singleton<RenderSystem>
+   class RenderSystem : public Core::Singleton<RenderSystem>, public RenderCommandBackend
    {
    protected:
       static const uint32_t kVertexBufferSize = 1024u * 1024u * 16u;
@@ -79,7 +110,8 @@ namespace GE { namespace Rendering
 
       static const uint32_t k3DUICanvasCount = 32u;
 
-      static const uint32_t kShadowMapSize = 1024u;
+      static const uint32_t kDefaultShadowMapSize = 1024u;
+      static const uint32_t kMaxShadowCascades = 4u;
       static const Core::ObjectName kShadowMapSolidProgram;
       static const Core::ObjectName kShadowMapAlphaProgram;
 
@@ -91,6 +123,91 @@ namespace GE { namespace Rendering
          Count
       };
 
+      static const uint32_t kMinRenderablesPerQueueingJob = 256u;
+
+      static const uint32_t kMinInstancesPerDraw = 2u;
+
+      static const uint32_t kMaxFrameLatency = 3u;
+      static const uint32_t kCommandBuffersCount = kMaxFrameLatency + 1u;
+
+      enum class QueueingFlags
+      {
+         View           = 1 << 0,
+         ShadowCaster   = 1 << 1
+      };
+
+      struct GeometryUpload
+      {
+         uint32_t GeometryID;
+         uint16_t Group;
+         uint16_t IndexSize;
+         const Content::GeometryData* Data;
+      };
+
+      //
+      //  StaticGeometryRelease
+      //
+      //  Blocks of released static geometry are only handed out again once the GPU has finished
+      //  every frame that may still draw from them, since the uploads do not wait for the GPU
+      //
+      struct StaticGeometryRelease
+      {
+         GPUBufferHandle VertexBlock;
+         GPUBufferHandle IndexBlock;
+         uint16_t Group;
+         uint32_t LastFrame;
+      };
+
+      struct BatchRequest
+      {
+         Entities::ComponentRenderable* Renderable;
+         MaterialPass* RenderMaterialPass;
+      };
+
+      struct InstanceCandidate
+      {
+         const float* VertexData;
+         uint32_t QueueIndex;
+      };
+
+      //
+      //  QueueingContext
+      //
+      //  Everything a queueing job produces. The jobs only write to their own context, and the contexts
+      //  are merged into the render queues on the calling thread, which also uploads the geometry
+      //
+      struct QueueingContext
+      {
+         RenderQueue UIElementsToRender;
+         RenderQueue Pre3DSpritesToRender;
+         RenderQueue PostUISpritesToRender;
+         RenderQueue Labels3DToRender;
+         RenderQueue OpaqueMeshesToRender;
+         RenderQueue TransparentMeshesToRender;
+         RenderQueue DebugGeometryToRender;
+         RenderQueue UI3DElementsToRender[k3DUICanvasCount];
+         bool Any3DUIElementsToRender;
+
+         GESTLVector(RenderOperation) StaticShadowedMeshesToRender;
+         GESTLVector(RenderOperation) DynamicShadowedMeshesToRender;
+         GESTLVector(RenderOperation) ShadowedParticlesToRender;
+         uint64_t ShadowCastersHash;
+         bool DynamicShadowCastersQueued;
+
+         GESTLVector(GeometryUpload) GeometryUploads;
+         GESTLVector(BatchRequest) BatchRequests;
+#if defined (GE_EDITOR_SUPPORT)
+         GESTLVector(Entities::Entity*) EntitiesToDeactivate;
+#endif
+
+         QueueingContext()
+            : Any3DUIElementsToRender(false)
+            , ShadowCastersHash(0u)
+            , DynamicShadowCastersQueued(false)
+         {
+         }
+      };
+
       void* pDevice;
       void* pWindow;
       bool bWindowed;
@@ -101,7 +218,6 @@ namespace GE { namespace Rendering
       Matrix4 matModelView;
       Matrix4 matModelViewProjection;
       Matrix4 matModelInverseTranspose;
-      Matrix4 matLightViewProjection;
       Matrix4 mat2DViewProjection;
 
       GEMutex mTextureLoadMutex;
@@ -124,17 +240,18 @@ namespace GE { namespace Rendering
       TextRasterizer mTextRasterizer;
 #endif
 
-      GESTLPriorityQueue(RenderOperation) vUIElementsToRender;
-      GESTLPriorityQueue(RenderOperation) vPre3DSpritesToRender;
-      GESTLPriorityQueue(RenderOperation) vPostUISpritesToRender;
-      GESTLPriorityQueue(RenderOperation) v3DLabelsToRender;
-      GESTLVector(RenderOperation) vShadowedMeshesToRender;
+      RenderQueue vUIElementsToRender;
+      RenderQueue vPre3DSpritesToRender;
+      RenderQueue vPostUISpritesToRender;
+      RenderQueue v3DLabelsToRender;
+      GESTLVector(RenderOperation) vStaticShadowedMeshesToRender;
+      GESTLVector(RenderOperation) vDynamicShadowedMeshesToRender;
       GESTLVector(RenderOperation) vShadowedParticlesToRender;
-      GESTLPriorityQueue(RenderOperation) vOpaqueMeshesToRender;
-      GESTLVector(RenderOperation) vTransparentMeshesToRender;
-      GESTLPriorityQueue(RenderOperation) vDebugGeometryToRender;
+      RenderQueue vOpaqueMeshesToRender;
+      RenderQueue vTransparentMeshesToRender;
+      RenderQueue vDebugGeometryToRender;
 
-      GESTLPriorityQueue(RenderOperation) v3DUIElementsToRender[k3DUICanvasCount];
+      RenderQueue v3DUIElementsToRender[k3DUICanvasCount];
       _3DUICanvasEntry s3DUICanvasEntries[k3DUICanvasCount];
       bool mAny3DUIElementsToRender;
 
@@ -142,19 +259,64 @@ namespace GE { namespace Rendering
 
       GPUBufferPair sGPUBufferPairs[GeometryGroup::Count];
 
-      GESTLMap(uint, GeometryRenderInfo) mStaticGeometryToRender;
+      GESTLMap(uint, StaticGeometryEntry) mStaticGeometryToRender;
       GESTLMap(uint, GeometryRenderInfo) mDynamicGeometryToRender;
 
       GESTLMap(uint, RenderOperation) mBatches;
+
+      GEMutex mStaticGeometryReleaseMutex;
+      GESTLVector(uint32_t) mStaticGeometryToRelease;
+      GESTLVector(StaticGeometryRelease) mStaticGeometryReleases;
+      bool mStaticGeometryPackPending;
+
+      GESTLVector(QueueingContext) mQueueingContexts;
+
+      bool mInstancingEnabled;
+      uint32_t mInstancedRenderables;
+      GESTLVector(InstanceCandidate) mInstanceCandidates;
+
+      RenderCommandBuffer mCommandBuffers[kCommandBuffersCount];
+      RenderCommandBuffer* mCommandBuffer;
+      RenderCommandBackend* mCommandBackend;
+      const RenderFrameState* mFrameState;
+
+      GEThread mRenderThread;
+      GEMutex mRenderThreadMutex;
+      GEConditionVariable mRenderThreadCondition;
+      bool mRenderThreadEnabled;
+      bool mRenderThreadExitPending;
+      uint32_t mFrameLatency;
+      uint32_t mFramesSubmitted;
+      uint32_t mFramesRendered;
+      uint32_t mFramesRecorded;
+      std::atomic<uint32_t> mFramesCompleted;
     
       Color cAmbientLightColor;
       bool bClearGeometryRenderInfoEntriesPending;
       bool bShaderReloadPending;
 
+      Frustum mCullingFrustum;
+      bool mFrustumCullingEnabled;
+      bool mCullingFrustumValid;
+      std::atomic<uint32_t> mCulledRenderables;
+
+      uint32_t mShadowMapSize;
+      uint32_t mShadowCascadesCount;
+      bool mShadowMapResizePending;
+      Matrix4 mShadowCascadeViewProjections[kMaxShadowCascades];
+      Frustum mShadowCasterFrustum;
+      bool mShadowCasterFrustumValid;
+      uint64_t mShadowCastersHash;
+      uint64_t mStaticShadowLayerHash;
+      bool mDynamicShadowCastersQueued;
+      bool mDynamicShadowCastersRendered;
+
       float mVRAMInMb;
       float fFrameTime;
       float fFramesPerSecond;
-      uint iDrawCalls;
+      std::atomic<uint32_t> mDrawCalls;
+      uint32_t mFrameDrawCalls;
+      std::atomic<uint32_t> mSkippedStateChanges;
 
       void loadDefaultRenderingResources();
       void loadShaders();
@@ -170,23 +332,79 @@ namespace GE { namespace Rendering
       void calculate3DTransformMatrix(const Matrix4& matModel);
       void calculate3DInverseTransposeMatrix(const Matrix4& matModel);
 
-      void calculateLightViewProjectionMatrix(Entities::ComponentLight* Light);
+      void calculateShadowCascades(Entities::ComponentLight* Light);
+      void getShadowCascadeCell(uint32_t pCascade, uint32_t* pOutColumn, uint32_t* pOutRow) const;
+      uint32_t getShadowAtlasColumns() const;
+      uint32_t getShadowAtlasRows() const;
+      uint32_t selectShadowCascade(const BoundingBox& pWorldBounds) const;
+
+      void createShadowMap();
+      void releaseShadowMap();
+      bool isShadowMapUpdatePending() const;
 
       void reloadTextRasterizer();
 
       void loadMaterial(Material* cMaterial);
       void unloadMaterial(const Core::ObjectName& cMaterialName);
 
-      void loadRenderingData(const Content::GeometryData* pData, GPUBufferPair& pBuffers, uint32_t pIndexSize = 2u);
+      uint32_t getStoredIndexSize(uint32_t pIndexSize) const;
+      void loadRenderingData(const Content::GeometryData* pData, uint32_t pGroup, uint32_t pIndexSize = 2u);
+      void uploadRenderingData(const RenderCommand& pCommand);
+
+      bool canBeCulled(Entities::ComponentRenderable* pRenderable, Entities::ComponentUIElement* pUIElement) const;
+      bool castsDynamicShadows(Entities::ComponentRenderable* pRenderable) const;
+      void registerShadowCaster(Entities::ComponentRenderable* pRenderable, const RenderOperation& pRenderOperation, QueueingContext& pContext);
+      void registerStaticShadowCaster(const RenderOperation& pRenderOperation, QueueingContext& pContext);
 
-      void queueForRenderingSingle(Entities::ComponentRenderable* pRenderable, RenderOperation& sRenderOperation);
-      void queueForRendering3DUI(Entities::ComponentRenderable* pRenderable, RenderOperation& pRenderOperation);
+      void queueForRendering(Entities::ComponentRenderable* pRenderable, uint32_t pRequestIndex, QueueingContext& pContext);
+      void queueForRenderingSingle(Entities::ComponentRenderable* pRenderable, RenderOperation& sRenderOperation, uint8_t pQueueingFlags,
+         QueueingContext& pContext);
+      void queueForRendering3DUI(Entities::ComponentRenderable* pRenderable, RenderOperation& pRenderOperation, QueueingContext& pContext);
       void queueForRenderingBatch(Entities::ComponentRenderable* pRenderable, RenderOperation& sBatch);
+      void queueGeometryUpload(const RenderOperation& pRenderOperation, QueueingContext& pContext);
+
+      void loadGeometry(const GeometryUpload& pUpload);
+      bool loadStaticGeometry(const GeometryUpload& pUpload);
+      bool allocateStaticGeometry(const GeometryUpload& pUpload, StaticGeometryEntry* pOutEntry);
+      void collectStaticGeometryReleases();
+      void updateStaticGeometryReleases();
+      void packStaticGeometry();
+      void mergeQueueingContext(QueueingContext& pContext);
+
+      uint32_t getCameraDepth(const RenderOperation& pRenderOperation) const;
+      uint64_t getStateSortKey(RenderPass pPass, uint8_t pPriority, const RenderOperation& pRenderOperation, uint32_t pDepth) const;
 
       void prepareBatchForRendering(const RenderOperation& sBatch);
 
+      const GeometryRenderInfo& getGeometryRenderInfo(const RenderOperation& pRenderOperation) const;
+
       void render(const RenderOperation& sRenderOperation);
+      void render(RenderQueue& pRenderQueue);
+      void renderInstanced(RenderQueue& pRenderQueue);
+      void renderInstanced(const RenderQueue& pRenderQueue, uint32_t pFirst, uint32_t pEnd);
+      void renderInstances(const RenderQueue& pRenderQueue, const InstanceCandidate* pCandidates, uint32_t pCount);
       void renderShadowMap();
+      void renderShadowCasters(const GESTLVector(RenderShadowCaster)& pCasters, bool pParticles);
+
+      void beginFrame();
+      void endFrame();
+      void waitForGPU();
+      void setShaderConstants(const RenderConstants& pConstants);
+      void draw(const RenderCommand& pCommand, const RenderConstants& pConstants);
+      void drawInstanced(const RenderCommand& pCommand, const RenderConstants& pConstants, const RenderInstance* pInstances);
+      void drawInstancesSeparately(const RenderCommand& pCommand, const RenderConstants& pConstants, const RenderInstance* pInstances);
+
+      void recordFrameState();
+      void recordShadowCasters(const GESTLVector(RenderOperation)& pRenderOperations, GESTLVector(RenderShadowCaster)* pOutCasters) const;
+      void submitCommands();
+      void replayCommands(RenderCommandBuffer& pCommandBuffer);
+
+      bool canUseRenderThread() const;
+      void startRenderThread();
+      void stopRenderThread();
+      void processRenderThreadFrames();
+
+      static GEThreadFunction(renderThreadFunction);
 
    public:
       std::function<bool(const _3DUICanvasEntry*, const _3DUICanvasEntry*)> _3DUICanvasSortFunction;
@@ -205,6 +423,9 @@ namespace GE { namespace Rendering
       float getVRAMInMb() const;
       float getFPS() const;
       uint getDrawCalls() const;
+      uint getSkippedStateChanges() const;
+      uint getCulledRenderables() const;
+      uint getInstancedRenderables() const;
 
       // internal data
       const Matrix4& get2DViewProjectionMatrix() const;
@@ -263,16 +484,50 @@ namespace GE { namespace Rendering
       // culling mode
       void setCullingMode(CullingMode Mode);
 
+      // frustum culling
+      bool getFrustumCullingEnabled() const;
+      void setFrustumCullingEnabled(bool pEnabled);
+      void updateCullingFrustums();
+
+      // instancing
+      bool getInstancingEnabled() const;
+      void setInstancingEnabled(bool pEnabled);
+
+      // shadows
+      uint32_t getShadowMapSize() const;
+      void setShadowMapSize(uint32_t pSize);
+      uint32_t getShadowCascadesCount() const;
+      void setShadowCascadesCount(uint32_t pCount);
+
       // components to render
       void setup3DUICanvas(uint32_t pCanvasIndex, const Vector3& pWorldPosition, uint16_t pSettings);
-      void queueForRendering(Entities::ComponentRenderable* Renderable, uint RequestIndex);
+      void queueForRendering(const GESTLVector(Entities::Component*)& pRenderables);
       void queueForRendering(Entities::ComponentLight* Light);
+      void queueForRendering(const StaticBatchSet& pStaticBatches);
       void clearRenderingQueues();
       void clearGeometryRenderInfoEntries();
 
+      // static geometry
+      void releaseStaticGeometry(uint32_t pGeometryID);
+      void defragmentStaticGeometry();
+      const GPUBufferAllocator& getStaticVertexAllocator(uint32_t pGroup) const;
+      const GPUBufferAllocator& getStaticIndexAllocator(uint32_t pGroup) const;
+
       // rendering
       void renderBegin();
       void renderFrame();
       void renderEnd();
+
+      // command replay
+      RenderCommandBackend* getCommandBackend() const;
+      void setCommandBackend(RenderCommandBackend* pBackend);
+      void execute(const RenderCommandBuffer& pCommandBuffer) override;
+
+      // render thread
+      bool getRenderThreadEnabled() const;
+      void setRenderThreadEnabled(bool pEnabled);
+      uint32_t getFrameLatency() const;
+      void setFrameLatency(uint32_t pFrameLatency);
+      void waitForRenderThread();
    };
 }}
@@ -91,6 +91,7 @@ namespace GE { namespace Rendering
       uint32_t mGeometryID;
       uint16_t mGroup;
       uint16_t mVertexIndexSize;
+      uint32_t mShadowCascade;
 
       MaterialPass* mRenderMaterialPass;
       Texture* mDiffuseTexture;
@@ -104,6 +105,7 @@ namespace GE { namespace Rendering
          , mGeometryID(0u)
          , mGroup(0u)
          , mVertexIndexSize(2u)
+         , mShadowCascade(0u)
          , mRenderMaterialPass(nullptr)
          , mDiffuseTexture(nullptr)
          , mData(nullptr)
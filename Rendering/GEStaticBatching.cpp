@@ -0,0 +1,526 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GEStaticBatching.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "GEStaticBatching.h"
+#include "GEMaterial.h"
+#include "GERenderSystem.h"
+#include "Core/GEProfiler.h"
+#include "Entities/GEEntity.h"
+#include "Entities/GEComponentMesh.h"
+#include "Entities/GEComponentTransform.h"
+#include "Entities/GEComponentUIElement.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Content;
+using namespace GE::Entities;
+using namespace GE::Rendering;
+
+static const uint32_t kFloatsPerVertex = 3u + 3u + 2u;
+
+static MaterialPass* getBatchedMaterialPass(ComponentRenderable* pRenderable)
+{
+   MaterialPass* batchedMaterialPass = nullptr;
+
+   for(uint32_t i = 0u; i < pRenderable->getMaterialPassCount(); i++)
+   {
+      MaterialPass* materialPass = pRenderable->getMaterialPass(i);
+
+      if(!materialPass->getMaterial() || !materialPass->getActive())
+         continue;
+
+      // every pass would need its own copy of the merged geometry
+      if(batchedMaterialPass)
+         return nullptr;
+
+      batchedMaterialPass = materialPass;
+   }
+
+   return batchedMaterialPass;
+}
+
+static void transformNormal(const Matrix4& pMatrix, const float* pNormal, float* pOutNormal)
+{
+   Vector3 normal
+   (
+      pMatrix.m[GE_M4_1_1] * pNormal[0] + pMatrix.m[GE_M4_1_2] * pNormal[1] + pMatrix.m[GE_M4_1_3] * pNormal[2],
+      pMatrix.m[GE_M4_2_1] * pNormal[0] + pMatrix.m[GE_M4_2_2] * pNormal[1] + pMatrix.m[GE_M4_2_3] * pNormal[2],
+      pMatrix.m[GE_M4_3_1] * pNormal[0] + pMatrix.m[GE_M4_3_2] * pNormal[1] + pMatrix.m[GE_M4_3_3] * pNormal[2]
+   );
+   normal.normalize();
+
+   pOutNormal[0] = normal.X;
+   pOutNormal[1] = normal.Y;
+   pOutNormal[2] = normal.Z;
+}
+
+
+//
+//  StaticBatchSet
+//
+GESTLVector(uint32_t) StaticBatchSet::smFreeSlots;
+uint32_t StaticBatchSet::smSlotsCount = 0u;
+
+StaticBatchSet::StaticBatchSet()
+{
+}
+
+uint32_t StaticBatchSet::acquireSlot()
+{
+   if(smFreeSlots.empty())
+      return smSlotsCount++;
+
+   const uint32_t slot = smFreeSlots.back();
+   smFreeSlots.pop_back();
+   return slot;
+}
+
+void StaticBatchSet::releaseSlot(uint32_t pSlot)
+{
+   smFreeSlots.push_back(pSlot);
+}
+
+bool StaticBatchSet::canBeBatched(ComponentRenderable* pRenderable)
+{
+   if(pRenderable->getClassName() != ComponentMesh::ClassName ||
+      pRenderable->getGeometryType() != GeometryType::Static ||
+      pRenderable->getRenderingMode() != RenderingMode::_3D)
+   {
+      return false;
+   }
+
+   ComponentMesh* mesh = static_cast<ComponentMesh*>(pRenderable);
+
+   if(GEHasFlag(mesh->getSettings(), MeshSettingsBitMask::Transparency) ||
+      GEHasFlag(mesh->getSettings(), MeshSettingsBitMask::Skinning))
+   {
+      return false;
+   }
+
+   if(!pRenderable->getVisible() ||
+      !pRenderable->getOwner()->isActiveInHierarchy() ||
+      pRenderable->getOwner()->getComponent<ComponentUIElement>() ||
+      GEHasFlag(pRenderable->getInternalFlags(), ComponentRenderable::InternalFlags::DebugGeometry))
+   {
+      return false;
+   }
+
+   const GeometryData& geometryData = pRenderable->getGeometryData();
+
+   if(geometryData.NumIndices == 0u ||
+      geometryData.NumVertices > kMaxVerticesPerBatch ||
+      geometryData.VertexStride != (int)(kFloatsPerVertex * sizeof(float)))
+   {
+      return false;
+   }
+
+   MaterialPass* materialPass = getBatchedMaterialPass(pRenderable);
+
+   // sprite batches are filled every frame, so they cannot be merged in advance
+   return
+      materialPass &&
+      !GEHasFlag(materialPass->getMaterial()->getFlags(), MaterialFlagsBitMask::BatchRendering);
+}
+
+bool StaticBatchSet::canShareBatch(ComponentRenderable* pRenderable, ComponentRenderable* pOther)
+{
+   MaterialPass* materialPass = getBatchedMaterialPass(pRenderable);
+   MaterialPass* otherMaterialPass = getBatchedMaterialPass(pOther);
+
+   if(materialPass->getMaterial() != otherMaterialPass->getMaterial())
+      return false;
+
+   // the batch is drawn with the constants of its first member
+   if(materialPass->hasVertexParameters() &&
+      memcmp(materialPass->getConstantBufferDataVertex(), otherMaterialPass->getConstantBufferDataVertex(), Material::ConstantBufferSize) != 0)
+   {
+      return false;
+   }
+
+   if(materialPass->hasFragmentParameters() &&
+      memcmp(materialPass->getConstantBufferDataFragment(), otherMaterialPass->getConstantBufferDataFragment(), Material::ConstantBufferSize) != 0)
+   {
+      return false;
+   }
+
+   const Color& color = pRenderable->getColor();
+   const Color& otherColor = pOther->getColor();
+
+   return
+      color.Red == otherColor.Red &&
+      color.Green == otherColor.Green &&
+      color.Blue == otherColor.Blue &&
+      color.Alpha == otherColor.Alpha &&
+      pRenderable->getRenderPriority() == pOther->getRenderPriority() &&
+      static_cast<ComponentMesh*>(pRenderable)->getDynamicShadows() == static_cast<ComponentMesh*>(pOther)->getDynamicShadows();
+}
+
+void StaticBatchSet::merge(StaticBatch& pBatch)
+{
+   uint32_t verticesCount = 0u;
+   uint32_t indicesCount = 0u;
+
+   for(size_t i = 0u; i < pBatch.Members.size(); i++)
+   {
+      verticesCount += pBatch.Members[i].Renderable->getGeometryData().NumVertices;
+      indicesCount += pBatch.Members[i].Renderable->getGeometryData().NumIndices;
+   }
+
+   pBatch.VertexData.clear();
+   pBatch.VertexData.reserve(verticesCount * kFloatsPerVertex);
+   pBatch.Indices.clear();
+   pBatch.Indices.reserve(indicesCount);
+
+   for(size_t i = 0u; i < pBatch.Members.size(); i++)
+   {
+      StaticBatch::Member& member = pBatch.Members[i];
+      const GeometryData& geometryData = member.Renderable->getGeometryData();
+      const uint32_t baseVertex = (uint32_t)pBatch.VertexData.size() / kFloatsPerVertex;
+
+      member.WorldTransform = member.Renderable->getTransform()->getGlobalWorldMatrix();
+
+      // normals are transformed with the inverse transpose, so that non-uniform scaling keeps them perpendicular
+      Matrix4 normalTransform = member.WorldTransform;
+      Matrix4Invert(&normalTransform);
+      Matrix4Transpose(&normalTransform);
+
+      const float* sourceVertex = geometryData.VertexData;
+      pBatch.VertexData.resize(pBatch.VertexData.size() + geometryData.NumVertices * kFloatsPerVertex);
+      float* vertex = &pBatch.VertexData[baseVertex * kFloatsPerVertex];
+
+      for(uint32_t j = 0u; j < geometryData.NumVertices; j++, sourceVertex += kFloatsPerVertex, vertex += kFloatsPerVertex)
+      {
+         Vector3 position(sourceVertex[0], sourceVertex[1], sourceVertex[2]);
+         Matrix4Transform(member.WorldTransform, &position);
+
+         vertex[0] = position.X;
+         vertex[1] = position.Y;
+         vertex[2] = position.Z;
+
+         transformNormal(normalTransform, sourceVertex + 3, vertex + 3);
+
+         vertex[6] = sourceVertex[6];
+         vertex[7] = sourceVertex[7];
+      }
+
+      for(uint32_t j = 0u; j < geometryData.NumIndices; j++)
+      {
+         pBatch.Indices.push_back((ushort)(geometryData.Indices[j] + baseVertex));
+      }
+   }
+
+   pBatch.Data.NumVertices = (uint)pBatch.VertexData.size() / kFloatsPerVertex;
+   pBatch.Data.VertexData = &pBatch.VertexData[0];
+   pBatch.Data.VertexStride = (int)(kFloatsPerVertex * sizeof(float));
+   pBatch.Data.NumIndices = (uint)pBatch.Indices.size();
+   pBatch.Data.Indices = &pBatch.Indices[0];
+
+   pBatch.WorldBounds = BoundingBox::fromVertexData(pBatch.Data.VertexData, pBatch.Data.NumVertices, (uint32_t)pBatch.Data.VertexStride);
+
+   ComponentMesh* firstMesh = static_cast<ComponentMesh*>(pBatch.Members[0].Renderable);
+   pBatch.DynamicShadows = firstMesh->getDynamicShadows();
+   pBatch.RenderPriority = firstMesh->getRenderPriority();
+
+   // batches get IDs of their own, so that their geometry never collides with the one of an entity
+   char geometryName[32];
+   snprintf(geometryName, sizeof(geometryName), "_StaticBatch%u_", pBatch.Slot);
+
+   RenderOperation& renderOperation = pBatch.Operation;
+   renderOperation = RenderOperation();
+   renderOperation.mIndex = (uint32_t)pBatch.RenderPriority << 24;
+   renderOperation.mGeometryID = ObjectName(geometryName).getID();
+   renderOperation.mGroup = GeometryGroup::MeshStatic;
+   renderOperation.mVertexIndexSize = 4u;
+   renderOperation.mRenderMaterialPass = getBatchedMaterialPass(firstMesh);
+   renderOperation.mData = &pBatch.Data;
+   renderOperation.mColor = firstMesh->getColor();
+
+   GESetFlag(renderOperation.mFlags, RenderOperationFlags::RenderThroughActiveCamera);
+   GESetFlag(renderOperation.mFlags, RenderOperationFlags::LightingSupport);
+
+   if(GEHasFlag(pBatch.DynamicShadows, DynamicShadowsBitMask::Receive))
+   {
+      GESetFlag(renderOperation.mFlags, RenderOperationFlags::BindShadowMap);
+   }
+}
+
+void StaticBatchSet::activate(StaticBatch& pBatch)
+{
+   for(size_t i = 0u; i < pBatch.Members.size(); i++)
+   {
+      ComponentRenderable* renderable = pBatch.Members[i].Renderable;
+      uint8_t internalFlags = renderable->getInternalFlags();
+      GESetFlag(internalFlags, ComponentRenderable::InternalFlags::StaticBatched);
+      renderable->setInternalFlags(internalFlags);
+   }
+
+   pBatch.Active = true;
+   pBatch.StableFrames = 0u;
+
+   mReport.DrawCallsSaved += (uint32_t)pBatch.Members.size() - 1u;
+}
+
+void StaticBatchSet::dissolve(StaticBatch& pBatch)
+{
+   if(!pBatch.Active)
+      return;
+
+   for(size_t i = 0u; i < pBatch.Members.size(); i++)
+   {
+      ComponentRenderable* renderable = pBatch.Members[i].Renderable;
+      uint8_t internalFlags = renderable->getInternalFlags();
+      GEResetFlag(internalFlags, ComponentRenderable::InternalFlags::StaticBatched);
+      renderable->setInternalFlags(internalFlags);
+   }
+
+   pBatch.Active = false;
+   pBatch.StableFrames = 0u;
+
+   mReport.DrawCallsSaved -= (uint32_t)pBatch.Members.size() - 1u;
+   mReport.BatchesDissolved++;
+
+   // the members are kept, so that the batch can be merged again once they stop changing
+   RenderSystem::getInstance()->releaseStaticGeometry(pBatch.Operation.mGeometryID);
+}
+
+bool StaticBatchSet::canReform(StaticBatch& pBatch)
+{
+   if(pBatch.Members.size() < kMinRenderablesPerBatch)
+      return false;
+
+   ComponentRenderable* firstRenderable = pBatch.Members[0].Renderable;
+   uint32_t verticesCount = 0u;
+   bool stable = true;
+
+   for(size_t i = 0u; i < pBatch.Members.size(); i++)
+   {
+      StaticBatch::Member& member = pBatch.Members[i];
+
+      if(!canBeBatched(member.Renderable) || (i > 0u && !canShareBatch(firstRenderable, member.Renderable)))
+      {
+         pBatch.StableFrames = 0u;
+         return false;
+      }
+
+      verticesCount += member.Renderable->getGeometryData().NumVertices;
+
+      const Matrix4& worldTransform = member.Renderable->getTransform()->getGlobalWorldMatrix();
+
+      if(memcmp(worldTransform.m, member.WorldTransform.m, sizeof(member.WorldTransform.m)) != 0)
+      {
+         member.WorldTransform = worldTransform;
+         stable = false;
+      }
+   }
+
+   if(!stable || verticesCount > kMaxVerticesPerBatch)
+   {
+      pBatch.StableFrames = 0u;
+      return false;
+   }
+
+   return ++pBatch.StableFrames >= kFramesToReform;
+}
+
+void StaticBatchSet::releaseBatches(GESTLVector(uint32_t)* pOutSlots)
+{
+   if(mBatches.empty())
+      return;
+
+   // frames still being replayed may reference the merged geometry
+   RenderSystem::getInstance()->waitForRenderThread();
+
+   for(size_t i = 0u; i < mBatches.size(); i++)
+   {
+      StaticBatch& batch = mBatches[i];
+      dissolve(batch);
+
+      for(size_t j = 0u; j < batch.Members.size(); j++)
+      {
+         ComponentRenderable* renderable = batch.Members[j].Renderable;
+         uint8_t internalFlags = renderable->getInternalFlags();
+         GEResetFlag(internalFlags, ComponentRenderable::InternalFlags::StaticBatchMember);
+         renderable->setInternalFlags(internalFlags);
+      }
+
+      pOutSlots->push_back(batch.Slot);
+   }
+
+   mBatches.clear();
+}
+
+void StaticBatchSet::build(const GESTLVector(Component*)& pRenderables)
+{
+   GEProfilerMarker("StaticBatchSet::build()");
+
+   GESTLVector(uint32_t) previousSlots;
+   releaseBatches(&previousSlots);
+   mReport = StaticBatchingReport();
+
+   // group the candidates by everything the merged draw has to share
+   GESTLVector(GESTLVector(ComponentRenderable*)) groups;
+
+   for(size_t i = 0u; i < pRenderables.size(); i++)
+   {
+      ComponentRenderable* renderable = static_cast<ComponentRenderable*>(pRenderables[i]);
+
+      if(!canBeBatched(renderable))
+         continue;
+
+      size_t groupIndex = 0u;
+
+      for(; groupIndex < groups.size(); groupIndex++)
+      {
+         if(canShareBatch(groups[groupIndex][0], renderable))
+            break;
+      }
+
+      if(groupIndex == groups.size())
+      {
+         groups.push_back(GESTLVector(ComponentRenderable*)());
+      }
+
+      groups[groupIndex].push_back(renderable);
+   }
+
+   for(size_t i = 0u; i < groups.size(); i++)
+   {
+      const GESTLVector(ComponentRenderable*)& group = groups[i];
+
+      if(group.size() < kMinRenderablesPerBatch)
+         continue;
+
+      size_t first = 0u;
+
+      while(first < group.size())
+      {
+         // take as many members as fit into the 16-bit indices
+         size_t last = first;
+         uint32_t verticesCount = 0u;
+
+         while(last < group.size() && verticesCount + group[last]->getGeometryData().NumVertices <= kMaxVerticesPerBatch)
+         {
+            verticesCount += group[last]->getGeometryData().NumVertices;
+            last++;
+         }
+
+         if(last - first >= kMinRenderablesPerBatch)
+         {
+            mBatches.push_back(StaticBatch());
+            StaticBatch& batch = mBatches.back();
+
+            for(size_t j = first; j < last; j++)
+            {
+               StaticBatch::Member member;
+               member.Renderable = group[j];
+               batch.Members.push_back(member);
+
+               uint8_t internalFlags = group[j]->getInternalFlags();
+               GESetFlag(internalFlags, ComponentRenderable::InternalFlags::StaticBatchMember);
+               group[j]->setInternalFlags(internalFlags);
+            }
+         }
+
+         first = last;
+      }
+   }
+
+   // the operations point to the batch storage, which does not move anymore
+   for(size_t i = 0u; i < mBatches.size(); i++)
+   {
+      StaticBatch& batch = mBatches[i];
+      batch.Slot = acquireSlot();
+      merge(batch);
+      activate(batch);
+
+      mReport.BatchesCreated++;
+      mReport.RenderablesBatched += (uint32_t)batch.Members.size();
+      mReport.VerticesBatched += batch.Data.NumVertices;
+   }
+
+   // the geometry of the previous batches is still being released, so their slots are only taken by later builds
+   for(size_t i = 0u; i < previousSlots.size(); i++)
+   {
+      releaseSlot(previousSlots[i]);
+   }
+}
+
+void StaticBatchSet::validate()
+{
+   for(size_t i = 0u; i < mBatches.size(); i++)
+   {
+      StaticBatch& batch = mBatches[i];
+
+      if(!batch.Active)
+      {
+         if(canReform(batch))
+         {
+            merge(batch);
+            activate(batch);
+            mReport.BatchesReformed++;
+         }
+
+         continue;
+      }
+
+      for(size_t j = 0u; j < batch.Members.size(); j++)
+      {
+         const StaticBatch::Member& member = batch.Members[j];
+
+         if(!member.Renderable->getVisible() ||
+            !member.Renderable->getOwner()->isActiveInHierarchy() ||
+            memcmp(member.Renderable->getTransform()->getGlobalWorldMatrix().m, member.WorldTransform.m, sizeof(member.WorldTransform.m)) != 0)
+         {
+            dissolve(batch);
+            break;
+         }
+      }
+   }
+}
+
+void StaticBatchSet::remove(ComponentRenderable* pRenderable)
+{
+   for(size_t i = 0u; i < mBatches.size(); i++)
+   {
+      StaticBatch& batch = mBatches[i];
+
+      for(size_t j = 0u; j < batch.Members.size(); j++)
+      {
+         if(batch.Members[j].Renderable == pRenderable)
+         {
+            dissolve(batch);
+            batch.Members.erase(batch.Members.begin() + j);
+
+            uint8_t internalFlags = pRenderable->getInternalFlags();
+            GEResetFlag(internalFlags, ComponentRenderable::InternalFlags::StaticBatchMember);
+            pRenderable->setInternalFlags(internalFlags);
+            return;
+         }
+      }
+   }
+}
+
+void StaticBatchSet::clear()
+{
+   GESTLVector(uint32_t) slots;
+   releaseBatches(&slots);
+
+   for(size_t i = 0u; i < slots.size(); i++)
+   {
+      releaseSlot(slots[i]);
+   }
+
+   mReport = StaticBatchingReport();
+}
@@ -0,0 +1,139 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering
+//
+//  --- GEStaticBatching.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GERenderingObjects.h"
+#include "GEFrustum.h"
+#include "Content/GEGeometryData.h"
+
+#include <cstdint>
+
+namespace GE { namespace Entities
+{
+   class Component;
+   class ComponentRenderable;
+}}
+
+namespace GE { namespace Rendering
+{
+   struct StaticBatchingReport
+   {
+      uint32_t BatchesCreated;
+      uint32_t RenderablesBatched;
+      uint32_t DrawCallsSaved;
+      uint32_t VerticesBatched;
+      uint32_t BatchesDissolved;
+      uint32_t BatchesReformed;
+
+      StaticBatchingReport()
+         : BatchesCreated(0u)
+         , RenderablesBatched(0u)
+         , DrawCallsSaved(0u)
+         , VerticesBatched(0u)
+         , BatchesDissolved(0u)
+         , BatchesReformed(0u)
+      {
+      }
+   };
+
+
+   //
+   //  StaticBatch
+   //
+   //  Static meshes sharing a material, merged into a single vertex and index buffer with the
+   //  vertices already in world space. The operation refers to the merged geometry, so the whole
+   //  batch is culled and drawn as a single renderable
+   //
+   struct StaticBatch
+   {
+      struct Member
+      {
+         Entities::ComponentRenderable* Renderable;
+         Matrix4 WorldTransform;
+      };
+
+      RenderOperation Operation;
+      BoundingBox WorldBounds;
+      uint32_t Slot;
+      uint32_t StableFrames;
+      uint8_t DynamicShadows;
+      uint8_t RenderPriority;
+      bool Active;
+
+      Content::GeometryData Data;
+      GESTLVector(float) VertexData;
+      GESTLVector(ushort) Indices;
+      GESTLVector(Member) Members;
+
+      StaticBatch()
+         : Slot(0u)
+         , StableFrames(0u)
+         , DynamicShadows(0u)
+         , RenderPriority(0u)
+         , Active(false)
+      {
+      }
+   };
+
+
+   //
+   //  StaticBatchSet
+   //
+   //  Batches built once from the renderables of a scene. A batch is dissolved as soon as any of its
+   //  members is hidden, moved or removed, and its members are rendered on their own from then on.
+   //  Once the remaining members have stayed still for a while, the batch is merged again from their
+   //  new transforms. Every batch takes a slot, which names its geometry, and the slots are reused
+   //  by later builds, so that rebuilding does not keep creating new names
+   //
+   class StaticBatchSet
+   {
+   public:
+      // indices are stored in 16 bits before the base vertex is added
+      static const uint32_t kMaxVerticesPerBatch = 65536u;
+      static const uint32_t kMinRenderablesPerBatch = 2u;
+      static const uint32_t kFramesToReform = 30u;
+
+   private:
+      static GESTLVector(uint32_t) smFreeSlots;
+      static uint32_t smSlotsCount;
+
+      GESTLVector(StaticBatch) mBatches;
+      StaticBatchingReport mReport;
+
+      static bool canBeBatched(Entities::ComponentRenderable* pRenderable);
+      static bool canShareBatch(Entities::ComponentRenderable* pRenderable, Entities::ComponentRenderable* pOther);
+
+      static uint32_t acquireSlot();
+      static void releaseSlot(uint32_t pSlot);
+
+      void merge(StaticBatch& pBatch);
+      void activate(StaticBatch& pBatch);
+      void dissolve(StaticBatch& pBatch);
+      bool canReform(StaticBatch& pBatch);
+      void releaseBatches(GESTLVector(uint32_t)* pOutSlots);
+
+   public:
+      StaticBatchSet();
+
+      void build(const GESTLVector(Entities::Component*)& pRenderables);
+      void validate();
+      void remove(Entities::ComponentRenderable* pRenderable);
+      void clear();
+
+      bool empty() const { return mBatches.empty(); }
+      uint32_t size() const { return (uint32_t)mBatches.size(); }
+      const StaticBatch& operator[](uint32_t pIndex) const { return mBatches[pIndex]; }
+
+      const StaticBatchingReport& getReport() const { return mReport; }
+   };
+}}
@@ -0,0 +1,250 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering Engine (Null)
+//
+//  --- GERenderSystemNull.cpp ---
+//
+//////////////////////////////////////////////////////////////////
+
+#include "Core/GEPlatform.h"
+
+#if defined (GE_RENDERING_API_NULL)
+
+#include "GERenderSystemNull.h"
+#include "Core/GEDevice.h"
+#include "Core/GELog.h"
+#include "Core/GEAllocator.h"
+#include "Core/GEApplication.h"
+#include "Core/GEValue.h"
+#include "Content/GEImageData.h"
+#include "pugixml/pugixml.hpp"
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Content;
+using namespace GE::Rendering;
+
+RenderSystemNull::RenderSystemNull()
+   : RenderSystem(nullptr, true)
+{
+   Log::log(LogType::Info, "Graphics Card: none (null render system)");
+
+   pDevice = nullptr;
+
+   loadShaders();
+   loadDefaultRenderingResources();
+   createShadowMap();
+}
+
+RenderSystemNull::~RenderSystemNull()
+{
+   releaseShadowMap();
+   mShaderPrograms.clear();
+}
+
+void RenderSystem::loadTexture(PreloadedTexture* cPreloadedTexture)
+{
+   // there is nothing to create the texture on, so the image data is only released
+   cPreloadedTexture->Data->unload();
+
+   GEInvokeDtor(ImageData, cPreloadedTexture->Data);
+   Allocator::free(cPreloadedTexture->Data);
+
+   cPreloadedTexture->Data = nullptr;
+   cPreloadedTexture->Tex->setHandler(nullptr);
+}
+
+void RenderSystem::unloadTexture(Texture* pTexture)
+{
+   pTexture->setHandler(nullptr);
+}
+
+uint32_t RenderSystem::getStoredIndexSize(uint32_t) const
+{
+   // the draws are taken as having a base vertex location, as in DX11, so the indices stay 16-bit
+   return (uint32_t)sizeof(ushort);
+}
+
+void RenderSystem::uploadRenderingData(const RenderCommand&)
+{
+   // there are no GPU buffers to write the geometry to
+}
+
+void RenderSystem::loadShaders()
+{
+   ContentData cShadersData;
+
+   if(Application::ContentType == ApplicationContentType::Xml)
+   {
+      Device::readContentFile(ContentType::GenericTextData, "Shaders", "Shaders", "xml", &cShadersData);
+
+      pugi::xml_document xml;
+      xml.load_buffer(cShadersData.getData(), cShadersData.getDataSize());
+      const pugi::xml_node& xmlShaders = xml.child("ShaderProgramList");
+
+      for(const pugi::xml_node& xmlShader : xmlShaders.children("ShaderProgram"))
+      {
+         const char* sShaderProgramName = xmlShader.attribute("name").value();
+         ShaderProgram* cShaderProgram = mShaderPrograms.get(sShaderProgramName);
+         bool bReload = cShaderProgram != 0;
+
+         if(bReload)
+         {
+            GEInvokeDtor(ShaderProgram, cShaderProgram);
+         }
+         else
+         {
+            cShaderProgram = Allocator::alloc<ShaderProgram>();
+         }
+
+         GEInvokeCtor(ShaderProgram, cShaderProgram)(sShaderProgramName);
+
+         cShaderProgram->loadFromXml(xmlShader);
+
+         if(!bReload)
+         {
+            mShaderPrograms.add(cShaderProgram);
+         }
+      }
+   }
+   else
+   {
+      // the packaged shaders of the platform API are read, and their code is skipped
+#if defined (GE_RENDERING_API_DIRECTX)
+      Device::readContentFile(ContentType::GenericBinaryData, "Shaders", "Shaders.hlsl", "ge", &cShadersData);
+#else
+      Device::readContentFile(ContentType::GenericBinaryData, "Shaders", "Shaders.glsl", "ge", &cShadersData);
+#endif
+      ContentDataMemoryBuffer sMemoryBuffer(cShadersData);
+      std::istream sStream(&sMemoryBuffer);
+
+      uint iShadersCount = (uint)Value::fromStream(ValueType::Byte, sStream).getAsByte();
+
+      for(uint i = 0; i < iShadersCount; i++)
+      {
+         ObjectName cShaderProgramName = Value::fromStream(ValueType::ObjectName, sStream).getAsObjectName();
+
+         ShaderProgram* cShaderProgram = Allocator::alloc<ShaderProgram>();
+         GEInvokeCtor(ShaderProgram, cShaderProgram)(cShaderProgramName);
+
+         cShaderProgram->loadFromStream(sStream);
+
+         // vertex and fragment shader code
+         for(uint j = 0; j < 2; j++)
+         {
+            const uint iShaderCodeSize = Value::fromStream(ValueType::UInt, sStream).getAsUInt();
+            sStream.ignore(iShaderCodeSize);
+         }
+
+         mShaderPrograms.add(cShaderProgram);
+      }
+   }
+
+   iActiveProgram = 0;
+}
+
+void RenderSystem::bindBuffers(const GPUBufferPair&)
+{
+}
+
+void RenderSystem::bindTexture(TextureSlot eSlot, const Texture* cTexture)
+{
+   GEAssert((GE::uint)eSlot < (GE::uint)TextureSlot::Count);
+
+   pBoundTexture[(GE::uint)eSlot] = const_cast<Texture*>(cTexture);
+}
+
+void RenderSystem::useShaderProgram(const ObjectName& cName)
+{
+   if(iActiveProgram == cName.getID())
+      return;
+
+   iActiveProgram = cName.getID();
+
+   const ShaderProgram* cShaderProgram = mShaderPrograms.get(cName);
+   GEAssert(cShaderProgram);
+
+   setDepthBufferMode(cShaderProgram->getDepthBufferMode());
+   setCullingMode(cShaderProgram->getCullingMode());
+}
+
+void RenderSystem::createShadowMap()
+{
+   // the shadow casters are recorded as usual, but there is no render target to draw them to
+}
+
+void RenderSystem::releaseShadowMap()
+{
+}
+
+void RenderSystem::renderShadowMap()
+{
+}
+
+void RenderSystem::renderShadowCasters(const GESTLVector(RenderShadowCaster)&, bool)
+{
+}
+
+void RenderSystem::beginFrame()
+{
+}
+
+void RenderSystem::setShaderConstants(const RenderConstants&)
+{
+}
+
+void RenderSystem::draw(const RenderCommand&, const RenderConstants&)
+{
+}
+
+void RenderSystem::drawInstanced(const RenderCommand& pCommand, const RenderConstants& pConstants, const RenderInstance* pInstances)
+{
+   // counted as the instances drawn one by one, as the graphics API backends without instancing do
+   drawInstancesSeparately(pCommand, pConstants, pInstances);
+}
+
+void RenderSystem::endFrame()
+{
+   // nothing is left for a GPU to finish
+   mFramesCompleted = mFrameState->FrameIndex + 1u;
+}
+
+void RenderSystem::waitForGPU()
+{
+}
+
+void RenderSystem::createBitmapTexture(const Core::ObjectName& pName, size_t pWidth, size_t pHeight)
+{
+   waitForRenderThread();
+
+   Texture* bitmapTexture = Allocator::alloc<Texture>();
+   GEInvokeCtor(Texture, bitmapTexture)(pName, "Bitmaps");
+   bitmapTexture->setWidth((uint32_t)pWidth);
+   bitmapTexture->setHeight((uint32_t)pHeight);
+   mTextures.add(bitmapTexture);
+}
+
+void RenderSystem::updateBitmapTexture(const Core::ObjectName&, const char*)
+{
+}
+
+void RenderSystem::setBlendingMode(BlendingMode Mode)
+{
+   eBlendingMode = Mode;
+}
+
+void RenderSystem::setDepthBufferMode(DepthBufferMode Mode)
+{
+   eDepthBufferMode = Mode;
+}
+
+void RenderSystem::setCullingMode(CullingMode Mode)
+{
+   eCullingMode = Mode;
+}
+
+#endif
@@ -0,0 +1,33 @@
+
+//////////////////////////////////////////////////////////////////
+//
+//  Arturo Cepeda Pérez
+//  Game Engine
+//
+//  Rendering Engine (Null)
+//
+//  --- GERenderSystemNull.h ---
+//
+//////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Rendering/GERenderSystem.h"
+
+namespace GE { namespace Rendering
+{
+   //
+   //  RenderSystemNull
+   //
+   //  Render system that needs no graphics device, built instead of the DX11 or GL ES one when
+   //  GE_RENDERING_API_NULL is defined. Shader programs and textures are registered without creating
+   //  anything on a GPU, and replaying a frame only keeps track of the state it sets, so the render
+   //  path can run headless, with RenderCommandBackendNull set to check what it records
+   //
+   class RenderSystemNull : public RenderSystem
+   {
+   public:
+      RenderSystemNull();
+      ~RenderSystemNull();
+   };
+}}
@@ -25,6 +25,11 @@
 # include "Externals/glew/include/GL/glew.h"
 #endif
 
+// instanced draws are core since OpenGL ES 3.0 and OpenGL 3.3
+#if !defined (GE_PLATFORM_IOS) && !defined (GE_PLATFORM_MACOS)
+# define GE_OPENGL_INSTANCING_SUPPORT
+#endif
+
 #if defined (GE_64_BIT)
 typedef uint64_t uintPtrSize;
 typedef GLuint64 GLuintPtrSize;
@@ -10,6 +10,10 @@
 //
 //////////////////////////////////////////////////////////////////
 
+#include "Core/GEPlatform.h"
+
+#if !defined (GE_RENDERING_API_NULL)
+
 #include "GERenderSystemES20.h"
 #include "Rendering/GERenderingObjects.h"
 #include "Core/GEDevice.h"
@@ -22,6 +26,8 @@
 #include "pugixml/pugixml.hpp"
 #include "GEOpenGLES20.h"
 
+#include <cstring>
+
 using namespace GE;
 using namespace GE::Core;
 using namespace GE::Content;
@@ -39,14 +45,82 @@ GESTLVector(uint32_t) gMappedIndices32;
 uint32_t gFrameBuffer = 0u;
 uint32_t gRenderBuffer = 0u;
 Texture* gDepthTexture = nullptr;
+uint32_t gStaticFrameBuffer = 0u;
+Texture* gStaticDepthTexture = nullptr;
+bool gRenderingStaticShadowLayer = false;
 
 // Shaders
 ShaderProgramES20* gActiveProgram = nullptr;
 
+// Instancing
+uint32_t gInstanceBuffer = 0u;
+bool gInstancingSupported = false;
+GESTLVector(float) gInstanceData;
+
+// State cache
+GLuint gActiveTextureSlot = 0u;
+uint32_t gSkippedStateChanges = 0u;
+
 const ObjectName _Mesh_ = ObjectName("Mesh");
 const ObjectName _Label_ = ObjectName("Label");
 const ObjectName _ParticleSystem_ = ObjectName("ParticleSystem");
 
+static bool isUniformUpdateNeeded(Uniforms pUniform, const void* pValue, uint32_t pValueSize)
+{
+   // uniforms missing in the active program are reported at location -1, and were never uploaded
+   if(gActiveProgram->getUniformLocation((uint)pUniform) == (uint)-1)
+      return false;
+
+   // only the uploads the value cache saves are counted
+   if(!gActiveProgram->updateUniformValue((uint)pUniform, pValue, pValueSize))
+   {
+      gSkippedStateChanges++;
+      return false;
+   }
+
+   return true;
+}
+
+static void setUniformMatrix4(Uniforms pUniform, const float* pValue)
+{
+   if(isUniformUpdateNeeded(pUniform, pValue, 16u * sizeof(float)))
+   {
+      glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)pUniform), 1, 0, pValue);
+   }
+}
+
+static void setUniform4(Uniforms pUniform, const float* pValue)
+{
+   if(isUniformUpdateNeeded(pUniform, pValue, 4u * sizeof(float)))
+   {
+      glUniform4fv(gActiveProgram->getUniformLocation((uint)pUniform), 1, pValue);
+   }
+}
+
+static void setUniform3(Uniforms pUniform, const float* pValue)
+{
+   if(isUniformUpdateNeeded(pUniform, pValue, 3u * sizeof(float)))
+   {
+      glUniform3fv(gActiveProgram->getUniformLocation((uint)pUniform), 1, pValue);
+   }
+}
+
+static void setUniform1f(Uniforms pUniform, float pValue)
+{
+   if(isUniformUpdateNeeded(pUniform, &pValue, sizeof(float)))
+   {
+      glUniform1f(gActiveProgram->getUniformLocation((uint)pUniform), pValue);
+   }
+}
+
+static void setUniform1i(Uniforms pUniform, GLint pValue)
+{
+   if(isUniformUpdateNeeded(pUniform, &pValue, sizeof(GLint)))
+   {
+      glUniform1i(gActiveProgram->getUniformLocation((uint)pUniform), pValue);
+   }
+}
+
 RenderSystemES20::RenderSystemES20()
    : RenderSystem(nullptr, false)
 {
@@ -74,6 +148,26 @@ RenderSystemES20::RenderSystemES20()
    glEnableVertexAttribArray((GLuint)VertexAttributes::Normal);
    glEnableVertexAttribArray((GLuint)VertexAttributes::TextureCoord0);
    glEnableVertexAttribArray((GLuint)VertexAttributes::Color);
+
+#if defined (GE_OPENGL_INSTANCING_SUPPORT)
+   // instanced draws need an OpenGL ES 3.0 or OpenGL 3.3 context, otherwise the instances are drawn one by one
+# if defined (GE_PLATFORM_ANDROID)
+   const char* glVersion = (const char*)glGetString(GL_VERSION);
+   gInstancingSupported = glVersion && strncmp(glVersion, "OpenGL ES 3", 11) == 0;
+# else
+   gInstancingSupported = glDrawElementsInstanced && glVertexAttribDivisor;
+# endif
+
+   if(gInstancingSupported)
+   {
+      for(GLuint i = (GLuint)VertexAttributes::InstanceWorld0; i <= (GLuint)VertexAttributes::InstanceColor; i++)
+      {
+         glVertexAttribDivisor(i, 1);
+      }
+   }
+#endif
+
+   Log::log(LogType::Info, "Instanced draws: %s", gInstancingSupported ? "supported" : "not supported");
    
    // load shaders
    loadShaders();
@@ -85,11 +179,7 @@ RenderSystemES20::RenderSystemES20()
 RenderSystemES20::~RenderSystemES20()
 {
    releaseBuffers();
-
-   GLuint depthTexture = (GLuint)((GLuintPtrSize)gDepthTexture->getHandler());
-   glDeleteTextures(1, &depthTexture);
-   GEInvokeDtor(Texture, gDepthTexture);
-   Allocator::free(gDepthTexture);
+   releaseShadowMap();
 }
 
 void RenderSystemES20::createBuffers()
@@ -111,33 +201,11 @@ void RenderSystemES20::createBuffers()
       glBufferData(GL_ELEMENT_ARRAY_BUFFER, kIndexBufferSize, 0, GL_STATIC_DRAW);
    }
 
-   // buffer and texture for shadow mapping
-   glGenFramebuffers(1, &gFrameBuffer);
-   glGenRenderbuffers(1, &gRenderBuffer);
-   glBindRenderbuffer(GL_RENDERBUFFER, gRenderBuffer);
-   glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, kShadowMapSize, kShadowMapSize);
-   glBindFramebuffer(GL_FRAMEBUFFER, gFrameBuffer);
+   // buffer for the per-instance data
+   glGenBuffers(1, &gInstanceBuffer);
 
-   gDepthTexture = Allocator::alloc<Texture>();
-   GEInvokeCtor(Texture, gDepthTexture)("Depth", "Texture");
-   gDepthTexture->setWidth(kShadowMapSize);
-   gDepthTexture->setHeight(kShadowMapSize);
-   
-   GLuint iDepthTexture;
-   glGenTextures(1, &iDepthTexture);
-   gDepthTexture->setHandler((void*)((uintPtrSize)iDepthTexture));
-
-   glBindTexture(GL_TEXTURE_2D, iDepthTexture);
-   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kShadowMapSize, kShadowMapSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, iDepthTexture, 0);
-   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, gRenderBuffer);
-   GEAssert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+   // buffer and texture for shadow mapping
+   createShadowMap();
 }
 
 void RenderSystemES20::releaseBuffers()
@@ -154,6 +222,7 @@ void RenderSystemES20::releaseBuffers()
       glDeleteBuffers(1, &iIndexBuffer);
    }
 
+   glDeleteBuffers(1, &gInstanceBuffer);
    glDeleteBuffers(1, &gFrameBuffer);
 }
 
@@ -177,7 +246,7 @@ void RenderSystem::loadTexture(PreloadedTexture* cPreloadedTexture)
    GLuint iTexture;
    glGenTextures(1, &iTexture);
    glBindTexture(GL_TEXTURE_2D, iTexture);
-   pBoundTexture[(uint)TextureSlot::Diffuse] = cPreloadedTexture->Tex;
+   pBoundTexture[gActiveTextureSlot] = cPreloadedTexture->Tex;
    
    // setup texture parameters
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -274,24 +343,30 @@ void RenderSystem::unloadTexture(Texture* pTexture)
 {
    GLuint iTexture = (GLuint)((GLuintPtrSize)pTexture->getHandler());
    glBindTexture(GL_TEXTURE_2D, 0);
+   pBoundTexture[gActiveTextureSlot] = nullptr;
    glDeleteTextures(1, &iTexture);
    pTexture->setHandler(nullptr);
 }
 
-void RenderSystem::loadRenderingData(const GeometryData* pData, GPUBufferPair& pBuffers, uint32_t pIndexSize)
+uint32_t RenderSystem::getStoredIndexSize(uint32_t pIndexSize) const
 {
-   GEProfilerMarker("RenderSystem::loadRenderingData()");
+   // there is no base vertex in the draws, so it gets added to the indices when they are uploaded
+   return pIndexSize;
+}
 
-   GEAssert(pData->VertexStride == pBuffers.VertexStride);
+void RenderSystem::uploadRenderingData(const RenderCommand& pCommand)
+{
+   GEProfilerMarker("RenderSystem::uploadRenderingData()");
 
+   const GeometryData* pData = pCommand.Data;
    const uint32_t vertexDataSize = pData->NumVertices * pData->VertexStride;
-   const uint32_t indicesSize = pData->NumIndices * pIndexSize;
+   const uint32_t indicesSize = pData->NumIndices * pCommand.IndexSize;
 
    void* mappedIndices = nullptr;
 
-   if(pIndexSize == 4u)
+   if(pCommand.IndexSize == 4u)
    {
-      const uint32_t baseVertexIndex = pBuffers.CurrentVertexBufferOffset / pData->VertexStride;
+      const uint32_t baseVertexIndex = pCommand.VertexOffset / pData->VertexStride;
       gMappedIndices32.clear();
 
       uint16_t* currentIndex = pData->Indices;
@@ -305,7 +380,7 @@ void RenderSystem::loadRenderingData(const GeometryData* pData, GPUBufferPair& p
    }
    else
    {
-      const uint16_t baseVertexIndex = (uint16_t)(pBuffers.CurrentVertexBufferOffset / pData->VertexStride);
+      const uint16_t baseVertexIndex = (uint16_t)(pCommand.VertexOffset / pData->VertexStride);
       gMappedIndices16.clear();
 
       uint16_t* currentIndex = pData->Indices;
@@ -318,13 +393,10 @@ void RenderSystem::loadRenderingData(const GeometryData* pData, GPUBufferPair& p
       mappedIndices = &gMappedIndices16[0];
    }
 
-   bindBuffers(pBuffers);
+   bindBuffers(sGPUBufferPairs[pCommand.Group]);
 
-   glBufferSubData(GL_ARRAY_BUFFER, pBuffers.CurrentVertexBufferOffset, vertexDataSize, pData->VertexData);
-   glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, pBuffers.CurrentIndexBufferOffset, indicesSize, mappedIndices);
-
-   pBuffers.CurrentVertexBufferOffset += vertexDataSize;
-   pBuffers.CurrentIndexBufferOffset += indicesSize;
+   glBufferSubData(GL_ARRAY_BUFFER, pCommand.VertexOffset, vertexDataSize, pData->VertexData);
+   glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, pCommand.IndexOffset, indicesSize, mappedIndices);
 }
 
 void RenderSystem::loadShaders()
@@ -427,6 +499,13 @@ void RenderSystemES20::attachShaders(ShaderProgramES20* cProgram)
 
    if(GEHasFlag(cProgram->getVertexElements(), VertexElementsBitMask::Color))
       glBindAttribLocation(cProgram->ID, (GLuint)VertexAttributes::Color, "aColor");
+
+   // per-instance attributes: the first three rows of the world matrix and the color. Instanced draws set
+   // the transform uniforms as if the world matrix was the identity, so the shader applies aInstanceWorld
+   glBindAttribLocation(cProgram->ID, (GLuint)VertexAttributes::InstanceWorld0, "aInstanceWorld0");
+   glBindAttribLocation(cProgram->ID, (GLuint)VertexAttributes::InstanceWorld1, "aInstanceWorld1");
+   glBindAttribLocation(cProgram->ID, (GLuint)VertexAttributes::InstanceWorld2, "aInstanceWorld2");
+   glBindAttribLocation(cProgram->ID, (GLuint)VertexAttributes::InstanceColor, "aInstanceColor");
    
    // link program
    linkProgram(cProgram);
@@ -450,6 +529,8 @@ void RenderSystemES20::attachShaders(ShaderProgramES20* cProgram)
    
    // get uniforms location
    getUniformsLocation(cProgram);
+
+   cProgram->SupportsInstancing = glGetAttribLocation(cProgram->ID, "aInstanceWorld0") != -1;
 }
 
 void RenderSystemES20::linkProgram(ShaderProgramES20* cProgram)
@@ -494,12 +575,12 @@ void RenderSystemES20::getUniformsLocation(ShaderProgramES20* cProgram)
    cProgram->setUniformLocation((uint)Uniforms::FragmentParameters, glGetUniformLocation(cProgram->ID, "uFragmentParameters"));
 }
 
-void RenderSystemES20::setVertexDeclaration(const RenderOperation& cRenderOperation)
+void RenderSystemES20::setVertexDeclaration(const Material* cMaterial, uint32_t iVertexStride)
 {
-   const int vertexStride = cRenderOperation.mData->VertexStride;
+   const int vertexStride = (int)iVertexStride;
 
    ShaderProgramES20* cShaderProgram =
-      static_cast<ShaderProgramES20*>(mShaderPrograms.get(cRenderOperation.mRenderMaterialPass->getMaterial()->getShaderProgram()));
+      static_cast<ShaderProgramES20*>(mShaderPrograms.get(cMaterial->getShaderProgram()));
    GEAssert(cShaderProgram);
 
    uintPtrSize offset = 0u;
@@ -530,7 +611,20 @@ void RenderSystem::bindTexture(TextureSlot eSlot, const Texture* cTexture)
 {
    GEAssert((uint)eSlot < (uint)TextureSlot::Count);
 
-   glActiveTexture(GL_TEXTURE0 + (GLuint)eSlot);
+   // nothing to bind, the slot keeps its current texture
+   if(!cTexture)
+      return;
+
+   // the active slot is kept even if the texture is already bound, since callers may update its contents
+   if(gActiveTextureSlot != (GLuint)eSlot)
+   {
+      glActiveTexture(GL_TEXTURE0 + (GLuint)eSlot);
+      gActiveTextureSlot = (GLuint)eSlot;
+   }
+   else
+   {
+      gSkippedStateChanges++;
+   }
 
    if(pBoundTexture[(uint)eSlot] != cTexture)
    {
@@ -553,129 +647,224 @@ void RenderSystem::useShaderProgram(const Core::ObjectName& cName)
    setDepthBufferMode(cShaderProgram->getDepthBufferMode());
    setCullingMode(cShaderProgram->getCullingMode());
 
-   glUniform4fv(gActiveProgram->getUniformLocation((uint)Uniforms::AmbientLightColor), 1, &cAmbientLightColor.Red);
+   setUniform4(Uniforms::AmbientLightColor, &mFrameState->AmbientLightColor.Red);
 }
 
-void RenderSystem::renderShadowMap()
+void RenderSystem::createShadowMap()
 {
-   if(vLightsToRender.empty())
+   // the cascades are cells of the same texture
+   const uint32_t iWidth = mShadowMapSize * getShadowAtlasColumns();
+   const uint32_t iHeight = mShadowMapSize * getShadowAtlasRows();
+
+   // both framebuffers share the depth buffer, which only the static layer writes
+   glGenRenderbuffers(1, &gRenderBuffer);
+   glBindRenderbuffer(GL_RENDERBUFFER, gRenderBuffer);
+   glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, iWidth, iHeight);
+
+   uint32_t* iFrameBuffers[] = { &gStaticFrameBuffer, &gFrameBuffer };
+   Texture** cDepthTextures[] = { &gStaticDepthTexture, &gDepthTexture };
+   const char* sDepthTextureNames[] = { "StaticDepth", "Depth" };
+
+   for(uint32_t i = 0u; i < 2u; i++)
+   {
+      glGenFramebuffers(1, iFrameBuffers[i]);
+      glBindFramebuffer(GL_FRAMEBUFFER, *iFrameBuffers[i]);
+
+      Texture* cDepthTexture = Allocator::alloc<Texture>();
+      GEInvokeCtor(Texture, cDepthTexture)(sDepthTextureNames[i], "Texture");
+      cDepthTexture->setWidth(iWidth);
+      cDepthTexture->setHeight(iHeight);
+      *cDepthTextures[i] = cDepthTexture;
+
+      GLuint iDepthTexture;
+      glGenTextures(1, &iDepthTexture);
+      cDepthTexture->setHandler((void*)((uintPtrSize)iDepthTexture));
+
+      glBindTexture(GL_TEXTURE_2D, iDepthTexture);
+      pBoundTexture[gActiveTextureSlot] = cDepthTexture;
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, iWidth, iHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, iDepthTexture, 0);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, gRenderBuffer);
+      GEAssert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+   }
+
+   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderSystem::releaseShadowMap()
+{
+   if(!gDepthTexture)
       return;
 
-   ComponentLight* cLight = vLightsToRender[0];
+   Texture** cDepthTextures[] = { &gStaticDepthTexture, &gDepthTexture };
+
+   for(uint32_t i = 0u; i < 2u; i++)
+   {
+      Texture* cDepthTexture = *cDepthTextures[i];
+      GLuint depthTexture = (GLuint)((GLuintPtrSize)cDepthTexture->getHandler());
+      glDeleteTextures(1, &depthTexture);
+      GEInvokeDtor(Texture, cDepthTexture);
+      Allocator::free(cDepthTexture);
+      *cDepthTextures[i] = nullptr;
+   }
 
-   if(cLight->getLightType() != LightType::Directional)
+   glDeleteRenderbuffers(1, &gRenderBuffer);
+   glDeleteFramebuffers(1, &gFrameBuffer);
+   glDeleteFramebuffers(1, &gStaticFrameBuffer);
+   gRenderBuffer = 0u;
+   gFrameBuffer = 0u;
+   gStaticFrameBuffer = 0u;
+}
+
+void RenderSystem::renderShadowMap()
+{
+   if(mFrameState->Lights.empty())
       return;
 
+   if(mFrameState->Lights[0].Type != (uint32_t)LightType::Directional)
+      return;
+
+   if(mFrameState->ShadowMapResizePending)
+   {
+      releaseShadowMap();
+      createShadowMap();
+   }
+
    GLint glDefaultFrameBuffer = 0;
    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &glDefaultFrameBuffer);
    
    GLint glDefaultViewport[4];
    glGetIntegerv(GL_VIEWPORT, glDefaultViewport);
-   
-   glBindFramebuffer(GL_FRAMEBUFFER, gFrameBuffer);
-   glViewport(0, 0, kShadowMapSize, kShadowMapSize);
-
-   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-   calculateLightViewProjectionMatrix(cLight);
+   // the static casters are kept in their own layer, which is only rendered when they change
+   glBindFramebuffer(GL_FRAMEBUFFER, gStaticFrameBuffer);
 
-   if(!vShadowedMeshesToRender.empty())
+   if(mFrameState->StaticShadowLayerUpdatePending)
    {
-      useShaderProgram(kShadowMapSolidProgram);
+      gRenderingStaticShadowLayer = true;
 
-      GESTLVector(RenderOperation)::const_iterator it = vShadowedMeshesToRender.begin();
+      setDepthBufferMode(DepthBufferMode::TestAndWrite);
+      glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-      for(; it != vShadowedMeshesToRender.end(); it++)
-      {
-         const RenderOperation& sRenderOperation = *it;
+      renderShadowCasters(mFrameState->StaticShadowedMeshes, false);
 
-         // set uniform
-         Matrix4 matLightWVP;
-         Matrix4Multiply(matLightViewProjection, sRenderOperation.mWorldTransform, &matLightWVP);
-         glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::LightWorldViewProjectionMatrix), 1, 0, matLightWVP.m);
+      gRenderingStaticShadowLayer = false;
+   }
 
-         // bind buffers
-         GESTLMap(uint, GeometryRenderInfo)* cGeometryRegistry = nullptr;
+   // the depth is stored in a color attachment, so the static layer is copied into the map from its framebuffer
+   bindTexture(TextureSlot::ShadowMap, gDepthTexture);
+   glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, (GLsizei)gDepthTexture->getWidth(), (GLsizei)gDepthTexture->getHeight());
 
-         if(sRenderOperation.isStatic())
-         {
-            cGeometryRegistry = &mStaticGeometryToRender;
-            bindBuffers(sGPUBufferPairs[GeometryGroup::MeshStatic]);
-         }
-         else
-         {
-            cGeometryRegistry = &mDynamicGeometryToRender;
-            bindBuffers(sGPUBufferPairs[GeometryGroup::MeshDynamic]);
-         }
+   glBindFramebuffer(GL_FRAMEBUFFER, gFrameBuffer);
 
-         // set vertex declaration
-         const int iVertexStride = sRenderOperation.mData->VertexStride;
-         glVertexAttribPointer((GLuint)VertexAttributes::Position, 3, GL_FLOAT, GL_FALSE, iVertexStride, 0);
+   renderShadowCasters(mFrameState->DynamicShadowedMeshes, false);
+   renderShadowCasters(mFrameState->ShadowedParticles, true);
+   
+   glBindFramebuffer(GL_FRAMEBUFFER, glDefaultFrameBuffer);
+   glViewport(glDefaultViewport[0], glDefaultViewport[1], glDefaultViewport[2], glDefaultViewport[3]);
+}
 
-         // draw
-         std::map<uint, GeometryRenderInfo>::const_iterator itInfo = cGeometryRegistry->find(sRenderOperation.mGeometryID);
-         const GeometryRenderInfo& sGeometryInfo = itInfo->second;
-         char* pOffset = (char*)((uintPtrSize)sGeometryInfo.mIndexBufferOffset);
+void RenderSystem::renderShadowCasters(const GESTLVector(RenderShadowCaster)& pCasters, bool pParticles)
+{
+   if(pCasters.empty())
+      return;
 
-         glDrawElements(GL_TRIANGLES, sRenderOperation.mData->NumIndices, GL_UNSIGNED_INT, pOffset);
-      }
+   useShaderProgram(pParticles ? kShadowMapAlphaProgram : kShadowMapSolidProgram);
+
+   // the depth buffer belongs to the static layer, so the dynamic casters are only tested against it.
+   // Where dynamic casters overlap, the last one rendered is kept
+   if(!gRenderingStaticShadowLayer)
+   {
+      setDepthBufferMode(DepthBufferMode::TestOnly);
    }
 
-   if(!vShadowedParticlesToRender.empty())
+   for(uint32_t i = 0u; i < (uint32_t)mFrameState->ShadowCascades.size(); i++)
    {
-      useShaderProgram(kShadowMapAlphaProgram);
+      const Matrix4& matCascadeViewProjection = mFrameState->ShadowCascades[i].ViewProjection;
 
-      GESTLVector(RenderOperation)::const_iterator it = vShadowedParticlesToRender.begin();
+      uint32_t iColumn, iRow;
+      getShadowCascadeCell(i, &iColumn, &iRow);
+      glViewport(iColumn * mShadowMapSize, iRow * mShadowMapSize, mShadowMapSize, mShadowMapSize);
 
-      for(; it != vShadowedParticlesToRender.end(); it++)
-      {
-         const RenderOperation& sRenderOperation = *it;
+      GESTLVector(RenderShadowCaster)::const_iterator it = pCasters.begin();
 
-         // set uniform
-         glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::LightWorldViewProjectionMatrix), 1, 0, matLightViewProjection.m);
+      for(; it != pCasters.end(); it++)
+      {
+         const RenderOperation& sRenderOperation = it->Operation;
 
-         // bind diffuse texture
-         if(sRenderOperation.mRenderMaterialPass->getMaterial()->getDiffuseTexture())
+         if(pParticles)
          {
-            bindTexture(TextureSlot::Diffuse, sRenderOperation.mRenderMaterialPass->getMaterial()->getDiffuseTexture());
-            glUniform1i(gActiveProgram->getUniformLocation((uint)Uniforms::DiffuseTexture), 0);
-         }
+            // set uniform
+            setUniformMatrix4(Uniforms::LightWorldViewProjectionMatrix, matCascadeViewProjection.m);
 
-         // bind buffers
-         bindBuffers(sGPUBufferPairs[GeometryGroup::Particles]);
+            // bind diffuse texture
+            if(it->CasterMaterial->getDiffuseTexture())
+            {
+               bindTexture(TextureSlot::Diffuse, it->CasterMaterial->getDiffuseTexture());
+               setUniform1i(Uniforms::DiffuseTexture, 0);
+            }
 
-         // set vertex declaration
-         static_cast<RenderSystemES20*>(this)->setVertexDeclaration(sRenderOperation);
+            // bind buffers
+            bindBuffers(sGPUBufferPairs[GeometryGroup::Particles]);
+
+            // set vertex declaration
+            static_cast<RenderSystemES20*>(this)->setVertexDeclaration(it->CasterMaterial, it->VertexStride);
+         }
+         else
+         {
+            // set uniform
+            Matrix4 matLightWVP;
+            Matrix4Multiply(matCascadeViewProjection, sRenderOperation.mWorldTransform, &matLightWVP);
+            setUniformMatrix4(Uniforms::LightWorldViewProjectionMatrix, matLightWVP.m);
+
+            // bind buffers
+            if(sRenderOperation.isStatic())
+            {
+               bindBuffers(sGPUBufferPairs[GeometryGroup::MeshStatic]);
+            }
+            else
+            {
+               bindBuffers(sGPUBufferPairs[GeometryGroup::MeshDynamic]);
+            }
+
+            // set vertex declaration
+            const int iVertexStride = (int)it->VertexStride;
+            glVertexAttribPointer((GLuint)VertexAttributes::Position, 3, GL_FLOAT, GL_FALSE, iVertexStride, 0);
+         }
 
          // draw
-         std::map<uint, GeometryRenderInfo>::const_iterator itInfo = mDynamicGeometryToRender.find(sRenderOperation.mGeometryID);
-         const GeometryRenderInfo& sGeometryInfo = itInfo->second;
-         char* pOffset = (char*)((uintPtrSize)sGeometryInfo.mIndexBufferOffset);
+         char* pOffset = (char*)((uintPtrSize)it->Geometry.mIndexBufferOffset);
 
-         glDrawElements(GL_TRIANGLES, sRenderOperation.mData->NumIndices, GL_UNSIGNED_INT, pOffset);
+         glDrawElements(GL_TRIANGLES, it->IndexCount, GL_UNSIGNED_INT, pOffset);
       }
    }
-   
-   glBindFramebuffer(GL_FRAMEBUFFER, glDefaultFrameBuffer);
-   glViewport(glDefaultViewport[0], glDefaultViewport[1], glDefaultViewport[2], glDefaultViewport[3]);
 }
 
-void RenderSystem::renderBegin()
+void RenderSystem::beginFrame()
 {
+   const Color& backgroundColor = mFrameState->BackgroundColor;
+
    glDepthMask(GL_TRUE);
-   glClearColor(cBackgroundColor.Red, cBackgroundColor.Green, cBackgroundColor.Blue, 1.0f);
+   glClearColor(backgroundColor.Red, backgroundColor.Green, backgroundColor.Blue, 1.0f);
    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-   iDrawCalls = 0u;
+   gSkippedStateChanges = 0u;
 }
 
-void RenderSystem::render(const RenderOperation& sRenderOperation)
+void RenderSystem::setShaderConstants(const RenderConstants& pConstants)
 {
+   const RenderOperation& sRenderOperation = pConstants.Operation;
+
    // set uniform values for the shaders
    const Matrix4& mViewProjection = GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::RenderThroughActiveCamera)
-      ? cActiveCamera->getViewProjectionMatrix()
-      : mat2DViewProjection;
-   glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::ViewProjectionMatrix), 1, 0, mViewProjection.m);
+      ? mFrameState->CameraViewProjection
+      : mFrameState->ViewProjection2D;
+   setUniformMatrix4(Uniforms::ViewProjectionMatrix, mViewProjection.m);
 
    if(GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::RenderThroughActiveCamera))
    {
@@ -686,105 +875,179 @@ void RenderSystem::render(const RenderOperation& sRenderOperation)
       calculate2DTransformMatrix(sRenderOperation.mWorldTransform);
    }
 
-   glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::WorldMatrix), 1, 0, sRenderOperation.mWorldTransform.m);
+   setUniformMatrix4(Uniforms::WorldMatrix, sRenderOperation.mWorldTransform.m);
 
    if(GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::LightingSupport))
    {
       calculate3DInverseTransposeMatrix(sRenderOperation.mWorldTransform);
 
-      glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::InverseTransposeWorldMatrix), 1, 0, matModelInverseTranspose.m);
+      setUniformMatrix4(Uniforms::InverseTransposeWorldMatrix, matModelInverseTranspose.m);
 
       if(GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::BindShadowMap))
       {
          Matrix4 matLightWVP;
-         Matrix4Multiply(matLightViewProjection, sRenderOperation.mWorldTransform, &matLightWVP);
-         glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::LightWorldViewProjectionMatrix), 1, 0, matLightWVP.m);
+         const uint32_t iCascade = GEMin(sRenderOperation.mShadowCascade, (uint32_t)mFrameState->ShadowCascades.size() - 1u);
+         Matrix4Multiply(mFrameState->ShadowCascades[iCascade].ReceiverViewProjection, sRenderOperation.mWorldTransform, &matLightWVP);
+         setUniformMatrix4(Uniforms::LightWorldViewProjectionMatrix, matLightWVP.m);
       }
 
-      glUniform4fv(gActiveProgram->getUniformLocation((uint)Uniforms::AmbientLightColor), 1, &cAmbientLightColor.Red);
-      glUniform3fv(gActiveProgram->getUniformLocation((uint)Uniforms::EyePosition), 1, &cActiveCamera->getTransform()->getPosition().X);
+      setUniform4(Uniforms::AmbientLightColor, &mFrameState->AmbientLightColor.Red);
+      setUniform3(Uniforms::EyePosition, &mFrameState->CameraPosition.X);
    }
 
-   glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::WorldViewProjectionMatrix), 1, 0, matModelViewProjection.m);
+   setUniformMatrix4(Uniforms::WorldViewProjectionMatrix, matModelViewProjection.m);
 
-   MaterialPass* cMaterialPass = sRenderOperation.mRenderMaterialPass;
-   Material* cMaterial = cMaterialPass->getMaterial();
+   Material* cMaterial = pConstants.OperationMaterial;
    Color cDiffuseColor = cMaterial->getDiffuseColor() * sRenderOperation.mColor;
 
-   glUniform4fv(gActiveProgram->getUniformLocation((uint)Uniforms::DiffuseColor), 1, &cDiffuseColor.Red);
-   glUniform4fv(gActiveProgram->getUniformLocation((uint)Uniforms::SpecularColor), 1, &cMaterial->getSpecularColor().Red);
+   setUniform4(Uniforms::DiffuseColor, &cDiffuseColor.Red);
+   setUniform4(Uniforms::SpecularColor, &cMaterial->getSpecularColor().Red);
 
    if(GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::LightingSupport))
    {
-      if(vLightsToRender.empty())
+      if(mFrameState->Lights.empty())
       {
-         glUniform1i(gActiveProgram->getUniformLocation((uint)Uniforms::LightType), 0);
-         glUniform4f(gActiveProgram->getUniformLocation((uint)Uniforms::LightColor), 0.0f, 0.0f, 0.0f, 1.0f);
+         const Color noLightColor(0.0f, 0.0f, 0.0f, 1.0f);
+         setUniform1i(Uniforms::LightType, 0);
+         setUniform4(Uniforms::LightColor, &noLightColor.Red);
       }
       else
       {
-         ComponentLight* cLight = vLightsToRender[0];
-         Vector3 vLightPosition = cLight->getTransform()->getWorldPosition();
-         Vector3 vLightDirection = cLight->getDirection();
-
-         glUniform1i(gActiveProgram->getUniformLocation((uint)Uniforms::LightType), (GE::uint)cLight->getLightType());
-         glUniform4fv(gActiveProgram->getUniformLocation((uint)Uniforms::LightColor), 1, &cLight->getColor().Red);
-         glUniform3fv(gActiveProgram->getUniformLocation((uint)Uniforms::LightPosition), 1, &vLightPosition.X);
-         glUniform3fv(gActiveProgram->getUniformLocation((uint)Uniforms::LightDirection), 1, &vLightDirection.X);
-         glUniform1f(gActiveProgram->getUniformLocation((uint)Uniforms::Attenuation), cLight->getLinearAttenuation());
-         glUniform1f(gActiveProgram->getUniformLocation((uint)Uniforms::SpotAngle), cLight->getSpotAngle());
-         glUniform1f(gActiveProgram->getUniformLocation((uint)Uniforms::ShadowIntensity), cLight->getShadowIntensity());
+         const RenderLight& sLight = mFrameState->Lights[0];
+
+         setUniform1i(Uniforms::LightType, (GLint)sLight.Type);
+         setUniform4(Uniforms::LightColor, &sLight.LightColor.Red);
+         setUniform3(Uniforms::LightPosition, &sLight.Position.X);
+         setUniform3(Uniforms::LightDirection, &sLight.Direction.X);
+         setUniform1f(Uniforms::Attenuation, sLight.LinearAttenuation);
+         setUniform1f(Uniforms::SpotAngle, sLight.SpotAngle);
+         setUniform1f(Uniforms::ShadowIntensity, sLight.ShadowIntensity);
       }
    }
 
    if(sRenderOperation.mDiffuseTexture)
    {
-      bindTexture(TextureSlot::Diffuse, sRenderOperation.mDiffuseTexture);
-      glUniform1i(gActiveProgram->getUniformLocation((uint)Uniforms::DiffuseTexture), (uint)TextureSlot::Diffuse);
+      setUniform1i(Uniforms::DiffuseTexture, (uint)TextureSlot::Diffuse);
    }
 
    if(GEHasFlag(sRenderOperation.mFlags, RenderOperationFlags::BindShadowMap))
    {
       bindTexture(TextureSlot::ShadowMap, gDepthTexture);
-      glUniform1i(gActiveProgram->getUniformLocation((uint)Uniforms::ShadowTexture), (uint)TextureSlot::ShadowMap);
+      setUniform1i(Uniforms::ShadowTexture, (uint)TextureSlot::ShadowMap);
    }
 
-   if(cMaterialPass->hasVertexParameters())
+   if(pConstants.HasVertexParameters)
    {
-      glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::VertexParameters), 1, 0, (const GLfloat*)cMaterialPass->getConstantBufferDataVertex());
+      setUniformMatrix4(Uniforms::VertexParameters, (const GLfloat*)pConstants.VertexParameters);
    }
 
-   if(cMaterialPass->hasFragmentParameters())
+   if(pConstants.HasFragmentParameters)
    {
-      glUniformMatrix4fv(gActiveProgram->getUniformLocation((uint)Uniforms::FragmentParameters), 1, 0, (const GLfloat*)cMaterialPass->getConstantBufferDataFragment());
+      setUniformMatrix4(Uniforms::FragmentParameters, (const GLfloat*)pConstants.FragmentParameters);
    }
 
-   // bind buffers and get index offset
-   GESTLMap(uint, GeometryRenderInfo)* mGeometryToRenderMap = sRenderOperation.isStatic()
-      ? &mStaticGeometryToRender
-      : &mDynamicGeometryToRender;
-
-   bindBuffers(sGPUBufferPairs[sRenderOperation.mGroup]);
-   std::map<uint, GeometryRenderInfo>::const_iterator it = mGeometryToRenderMap->find(sRenderOperation.mGeometryID);
-   const GeometryRenderInfo& sGeometryInfo = it->second;
-   char* pOffset = (char*)((uintPtrSize)sGeometryInfo.mIndexBufferOffset);
+}
 
+void RenderSystem::draw(const RenderCommand& pCommand, const RenderConstants& pConstants)
+{
    // set vertex declaration
-   static_cast<RenderSystemES20*>(this)->setVertexDeclaration(sRenderOperation);
+   static_cast<RenderSystemES20*>(this)->setVertexDeclaration(pConstants.OperationMaterial, pConstants.VertexStride);
 
    // draw
-   const GLenum glIndexType = sRenderOperation.mVertexIndexSize == 4u
+   char* pOffset = (char*)((uintPtrSize)pCommand.IndexOffset);
+   const GLenum glIndexType = pCommand.IndexSize == 4u
       ? GL_UNSIGNED_INT
       : GL_UNSIGNED_SHORT;
-   glDrawElements(GL_TRIANGLES, sRenderOperation.mData->NumIndices, glIndexType, pOffset);
+   glDrawElements(GL_TRIANGLES, pCommand.IndexCount, glIndexType, pOffset);
 }
 
-void RenderSystem::renderEnd()
+void RenderSystem::drawInstanced(const RenderCommand& pCommand, const RenderConstants& pConstants, const RenderInstance* pInstances)
 {
+#if defined (GE_OPENGL_INSTANCING_SUPPORT)
+   if(gInstancingSupported && gActiveProgram->SupportsInstancing)
+   {
+      // the world transforms and the colors come from the instances
+      RenderConstants instancedConstants = pConstants;
+      Matrix4MakeIdentity(&instancedConstants.Operation.mWorldTransform);
+      instancedConstants.Operation.mColor = Color(1.0f, 1.0f, 1.0f, 1.0f);
+      setShaderConstants(instancedConstants);
+
+      // three rows of the world matrix (the fourth one is always the same) and the color
+      const uint32_t instanceFloats = 16u;
+      gInstanceData.resize(pCommand.InstanceCount * instanceFloats);
+      float* instanceData = &gInstanceData[0];
+
+      for(uint32_t i = 0u; i < pCommand.InstanceCount; i++)
+      {
+         const Matrix4& worldTransform = pInstances[i].WorldTransform;
+
+         *instanceData++ = worldTransform.m[GE_M4_1_1];
+         *instanceData++ = worldTransform.m[GE_M4_1_2];
+         *instanceData++ = worldTransform.m[GE_M4_1_3];
+         *instanceData++ = worldTransform.m[GE_M4_1_4];
+         *instanceData++ = worldTransform.m[GE_M4_2_1];
+         *instanceData++ = worldTransform.m[GE_M4_2_2];
+         *instanceData++ = worldTransform.m[GE_M4_2_3];
+         *instanceData++ = worldTransform.m[GE_M4_2_4];
+         *instanceData++ = worldTransform.m[GE_M4_3_1];
+         *instanceData++ = worldTransform.m[GE_M4_3_2];
+         *instanceData++ = worldTransform.m[GE_M4_3_3];
+         *instanceData++ = worldTransform.m[GE_M4_3_4];
+
+         memcpy(instanceData, &pInstances[i].InstanceColor.Red, 4u * sizeof(float));
+         instanceData += 4;
+      }
+
+      glBindBuffer(GL_ARRAY_BUFFER, gInstanceBuffer);
+      glBufferData(GL_ARRAY_BUFFER, gInstanceData.size() * sizeof(float), &gInstanceData[0], GL_STREAM_DRAW);
+
+      for(GLuint i = (GLuint)VertexAttributes::InstanceWorld0; i <= (GLuint)VertexAttributes::InstanceColor; i++)
+      {
+         const uintPtrSize offset = (i - (GLuint)VertexAttributes::InstanceWorld0) * 4u * sizeof(float);
+         glEnableVertexAttribArray(i);
+         glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, instanceFloats * sizeof(float), (void*)offset);
+      }
+
+      // the vertex declaration refers to the geometry buffer, which has to be bound again
+      glBindBuffer(GL_ARRAY_BUFFER, (GLuint)((uintPtrSize)gCurrentVertexBuffer));
+      static_cast<RenderSystemES20*>(this)->setVertexDeclaration(pConstants.OperationMaterial, pConstants.VertexStride);
+
+      char* pOffset = (char*)((uintPtrSize)pCommand.IndexOffset);
+      const GLenum glIndexType = pCommand.IndexSize == 4u
+         ? GL_UNSIGNED_INT
+         : GL_UNSIGNED_SHORT;
+      glDrawElementsInstanced(GL_TRIANGLES, pCommand.IndexCount, glIndexType, pOffset, (GLsizei)pCommand.InstanceCount);
+      mFrameDrawCalls++;
+
+      for(GLuint i = (GLuint)VertexAttributes::InstanceWorld0; i <= (GLuint)VertexAttributes::InstanceColor; i++)
+      {
+         glDisableVertexAttribArray(i);
+      }
+
+      return;
+   }
+#endif
+
+   drawInstancesSeparately(pCommand, pConstants, pInstances);
+}
+
+void RenderSystem::endFrame()
+{
+   mSkippedStateChanges = gSkippedStateChanges;
+
+   // buffer updates are ordered after the draws already issued, so uploads never have to wait for the frame
+   mFramesCompleted = mFrameState->FrameIndex + 1u;
+}
+
+void RenderSystem::waitForGPU()
+{
+   // glBufferSubData does not overwrite data that the draws already issued still have to read
 }
 
 void RenderSystem::createBitmapTexture(const Core::ObjectName& pName, size_t pWidth, size_t pHeight)
 {
+   waitForRenderThread();
+
    Texture* bitmapTexture = Allocator::alloc<Texture>();
    GEInvokeCtor(Texture, bitmapTexture)(pName, "Bitmaps");
    bitmapTexture->setWidth((uint32_t)pWidth);
@@ -796,6 +1059,7 @@ void RenderSystem::createBitmapTexture(const Core::ObjectName& pName, size_t pWi
    bitmapTexture->setHandler((void*)((uintPtrSize)glBitmapTexture));
 
    glBindTexture(GL_TEXTURE_2D, glBitmapTexture);
+   pBoundTexture[gActiveTextureSlot] = bitmapTexture;
    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
       (GLsizei)pWidth, (GLsizei)pHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -806,6 +1070,8 @@ void RenderSystem::createBitmapTexture(const Core::ObjectName& pName, size_t pWi
 
 void RenderSystem::updateBitmapTexture(const Core::ObjectName& pName, const char* pBitmapData)
 {
+   waitForRenderThread();
+
    Texture* bitmapTexture = mTextures.get(pName);
 
    if(bitmapTexture)
@@ -903,3 +1169,5 @@ void RenderSystem::setCullingMode(CullingMode Mode)
       break;
    }
 }
+
+#endif
@@ -34,7 +34,7 @@ namespace GE { namespace Rendering
       RenderSystemES20();
       ~RenderSystemES20();
 
-      void setVertexDeclaration(const RenderOperation& cRenderOperation);
+      void setVertexDeclaration(const Material* cMaterial, uint32_t iVertexStride);
       void attachShaders(ShaderProgramES20* cProgram);
    };
 }}
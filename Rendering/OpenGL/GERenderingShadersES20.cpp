@@ -181,9 +181,11 @@ ShaderProgramES20::ShaderProgramES20(const ObjectName& Name)
    : ShaderProgram(Name)
    , ID(0)
    , Status(0)
+   , SupportsInstancing(false)
    , VS(0)
    , FS(0)
 {
+   clearUniformValues();
 }
 
 ShaderProgramES20::~ShaderProgramES20()
@@ -202,4 +204,24 @@ uint ShaderProgramES20::getUniformLocation(uint UniformIndex) const
 void ShaderProgramES20::setUniformLocation(uint UniformIndex, uint UniformLocation)
 {
    iUniforms[UniformIndex] = UniformLocation;
+   bUniformValueSet[UniformIndex] = false;
+}
+
+bool ShaderProgramES20::updateUniformValue(uint UniformIndex, const void* Value, uint ValueSize)
+{
+   GEAssert(UniformIndex < (uint)Uniforms::Count);
+   GEAssert(ValueSize <= kUniformValueMaxSize);
+
+   if(bUniformValueSet[UniformIndex] && memcmp(cUniformValues[UniformIndex], Value, ValueSize) == 0)
+      return false;
+
+   memcpy(cUniformValues[UniformIndex], Value, ValueSize);
+   bUniformValueSet[UniformIndex] = true;
+
+   return true;
+}
+
+void ShaderProgramES20::clearUniformValues()
+{
+   memset(bUniformValueSet, 0, sizeof(bUniformValueSet));
 }
@@ -27,6 +27,12 @@ namespace GE { namespace Rendering
       Normal,
       Color,
 
+      // Instancing
+      InstanceWorld0,
+      InstanceWorld1,
+      InstanceWorld2,
+      InstanceColor,
+
       Count
    };
 
@@ -106,11 +112,18 @@ namespace GE { namespace Rendering
    class ShaderProgramES20 : public ShaderProgram
    {
    private:
+      static const uint kUniformValueMaxSize = 16u * sizeof(float);
+
       uint iUniforms[(int)Uniforms::Count];
 
+      // last value set for each uniform, since uniform values are part of the program state
+      char cUniformValues[(int)Uniforms::Count][kUniformValueMaxSize];
+      bool bUniformValueSet[(int)Uniforms::Count];
+
    public:
       GE::uint ID;
       int Status;
+      bool SupportsInstancing;
 
       VertexShader* VS;
       FragmentShader* FS;
@@ -120,5 +133,8 @@ namespace GE { namespace Rendering
 
       uint getUniformLocation(uint UniformIndex) const;
       void setUniformLocation(uint UniformIndex, uint UniformLocation);
+
+      bool updateUniformValue(uint UniformIndex, const void* Value, uint ValueSize);
+      void clearUniformValues();
    };
 }}
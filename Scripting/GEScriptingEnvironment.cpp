@@ -1103,6 +1103,19 @@ void Environment::registerTypes()
    //
    //  GE::Entities
    //
+   mLua.new_enum
+   (
+      "UpdateResource"
+      , "Transforms", UpdateResource::Transforms
+      , "SkeletonPoses", UpdateResource::SkeletonPoses
+      , "Particles", UpdateResource::Particles
+      , "Audio", UpdateResource::Audio
+      , "Scripts", UpdateResource::Scripts
+      , "Sprites", UpdateResource::Sprites
+      , "Cameras", UpdateResource::Cameras
+      , "RenderQueues", UpdateResource::RenderQueues
+      , "All", UpdateResource::All
+   );
    mLua.new_simple_usertype<Scene>
    (
       "Scene"
@@ -1118,6 +1131,9 @@ void Environment::registerTypes()
       , "sendComponentToBack", &Scene::sendComponentToBack
       , "getComponents", (const GESTLVector(Component*)& (Scene::*)(ComponentType))&Scene::getComponents
       , "setupEntityFromPrefab", &Scene::setupEntityFromPrefab
+      , "acquirePooledPrefab", &Scene::acquirePooledPrefab
+      , "releasePooledEntity", &Scene::releasePooledEntity
+      , "prewarmEntityPool", &Scene::prewarmEntityPool
       , sol::base_classes, sol::bases<Serializable>()
    );
    mLua.new_simple_usertype<Entity>
@@ -1162,12 +1178,16 @@ void Environment::registerTypes()
       , "getChildByName", &Entity::getChildByName
       , "getParent", &Entity::getParent
       , "init", &Entity::init
+      , "getHandle", [](Entity* pEntity) { return pEntity->getHandle().getValue(); }
+      , "fromHandle", [](uint32_t pHandle) { return Entity::fromHandle(EntityHandle(pHandle)); }
       , sol::base_classes, sol::bases<Serializable>()
    );
    mLua.new_simple_usertype<Component>
    (
       "Component"
       , "getOwner", &Component::getOwner
+      , "getHandle", [](Component* pComponent) { return pComponent->getHandle().getValue(); }
+      , "fromHandle", [](uint32_t pHandle) { return Component::fromHandle(ComponentHandle(pHandle)); }
       , sol::base_classes, sol::bases<Serializable>()
    );
    mLua.new_simple_usertype<ComponentTransform>
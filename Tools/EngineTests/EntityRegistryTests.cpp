@@ -0,0 +1,191 @@
+
+#include "main.h"
+
+#include "Core/GEThreads.h"
+#include "Entities/GEEntityRegistry.h"
+
+#include <thread>
+#include <chrono>
+#include <map>
+#include <vector>
+#include <cstdio>
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+
+//
+//  The registry never dereferences the entities, so any distinct non-null addresses can stand for them
+//
+static char vFakeEntities[4096];
+
+static Entity* getFakeEntity(uint32_t iIndex)
+{
+   return reinterpret_cast<Entity*>(&vFakeEntities[iIndex % sizeof(vFakeEntities)]);
+}
+
+static uint32_t getKey(uint32_t iIndex)
+{
+   // odd keys, so that the zero key is only ever tested on its own
+   return (iIndex * 2654435761u) | 1u;
+}
+
+void testEntityRegistry()
+{
+   const uint32_t iEntriesCount = 1000u;
+
+   EntityRegistry cRegistry;
+
+   for(uint32_t i = 0u; i < iEntriesCount; i++)
+   {
+      cRegistry.add(getKey(i), getFakeEntity(i));
+   }
+
+   GETestCheck(cRegistry.getEntriesCount() == iEntriesCount);
+
+   uint32_t iMismatchesCount = 0u;
+
+   for(uint32_t i = 0u; i < iEntriesCount; i++)
+   {
+      if(cRegistry.find(getKey(i)) != getFakeEntity(i))
+      {
+         iMismatchesCount++;
+      }
+   }
+
+   GETestCheck(iMismatchesCount == 0u);
+   GETestCheck(cRegistry.find(getKey(iEntriesCount)) == nullptr);
+
+   // missing and already removed keys leave the count untouched
+   GETestCheck(!cRegistry.remove(getKey(iEntriesCount)));
+   GETestCheck(cRegistry.remove(getKey(0u)));
+   GETestCheck(!cRegistry.remove(getKey(0u)));
+   GETestCheck(cRegistry.getEntriesCount() == iEntriesCount - 1u);
+   GETestCheck(cRegistry.find(getKey(0u)) == nullptr);
+
+   // a removed key can be added again, and the released slots are reclaimed by the garbage collection
+   cRegistry.add(getKey(0u), getFakeEntity(0u));
+   GETestCheck(cRegistry.find(getKey(0u)) == getFakeEntity(0u));
+
+   for(uint32_t i = 0u; i < iEntriesCount; i += 2u)
+   {
+      cRegistry.remove(getKey(i));
+   }
+
+   cRegistry.collectGarbage();
+   GETestCheck(cRegistry.getEntriesCount() == iEntriesCount / 2u);
+
+   iMismatchesCount = 0u;
+
+   for(uint32_t i = 0u; i < iEntriesCount; i++)
+   {
+      if(cRegistry.find(getKey(i)) != ((i & 1u) ? getFakeEntity(i) : nullptr))
+      {
+         iMismatchesCount++;
+      }
+   }
+
+   GETestCheck(iMismatchesCount == 0u);
+
+   // zero is the empty slot marker, but a name hashing to zero can still be registered
+   const uint32_t iEntriesCountBeforeZeroKey = cRegistry.getEntriesCount();
+   GETestCheck(cRegistry.find(0u) == nullptr);
+   GETestCheck(!cRegistry.remove(0u));
+
+   cRegistry.add(0u, getFakeEntity(iEntriesCount));
+   GETestCheck(cRegistry.find(0u) == getFakeEntity(iEntriesCount));
+   GETestCheck(cRegistry.getEntriesCount() == iEntriesCountBeforeZeroKey + 1u);
+   GETestCheck(cRegistry.find(getKey(1u)) == getFakeEntity(1u));
+
+   GETestCheck(cRegistry.remove(0u));
+   GETestCheck(!cRegistry.remove(0u));
+   GETestCheck(cRegistry.find(0u) == nullptr);
+   GETestCheck(cRegistry.getEntriesCount() == iEntriesCountBeforeZeroKey);
+}
+
+void benchmarkEntityRegistryLookups()
+{
+   const uint32_t iEntriesCount = 10000u;
+   const uint32_t iLookupsPerThread = 1000000u;
+   const uint32_t iThreadsCount = GEMax(std::thread::hardware_concurrency(), 2u);
+
+   EntityRegistry cRegistry;
+   std::map<uint32_t, Entity*> mEntityMap;
+   GEMutex mEntityMapMutex;
+   GEMutexInit(mEntityMapMutex);
+
+   for(uint32_t i = 0u; i < iEntriesCount; i++)
+   {
+      cRegistry.add(getKey(i), getFakeEntity(i));
+      mEntityMap[getKey(i)] = getFakeEntity(i);
+   }
+
+   std::vector<std::thread> vThreads;
+   std::atomic<uint32_t> iFound(0u);
+   char sDetails[64];
+   sprintf(sDetails, "%u threads, %u lookups each", iThreadsCount, iLookupsPerThread);
+
+   // previous approach: a map guarded by the scene mutex
+   std::chrono::high_resolution_clock::time_point cStart = std::chrono::high_resolution_clock::now();
+
+   for(uint32_t i = 0u; i < iThreadsCount; i++)
+   {
+      vThreads.push_back(std::thread([&, i]
+      {
+         uint32_t iThreadFound = 0u;
+
+         for(uint32_t j = 0u; j < iLookupsPerThread; j++)
+         {
+            GEMutexLock(mEntityMapMutex);
+            std::map<uint32_t, Entity*>::const_iterator it = mEntityMap.find(getKey((i * 7919u + j) % iEntriesCount));
+            iThreadFound += it != mEntityMap.end() ? 1u : 0u;
+            GEMutexUnlock(mEntityMapMutex);
+         }
+
+         iFound += iThreadFound;
+      }));
+   }
+
+   for(size_t i = 0u; i < vThreads.size(); i++)
+   {
+      vThreads[i].join();
+   }
+
+   std::chrono::duration<double, std::milli> cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+   reportBenchmark("Locked map lookups", cElapsed.count(), sDetails);
+
+   const uint32_t iFoundInMap = iFound;
+   iFound = 0u;
+   vThreads.clear();
+
+   // lock-free registry
+   cStart = std::chrono::high_resolution_clock::now();
+
+   for(uint32_t i = 0u; i < iThreadsCount; i++)
+   {
+      vThreads.push_back(std::thread([&, i]
+      {
+         uint32_t iThreadFound = 0u;
+
+         for(uint32_t j = 0u; j < iLookupsPerThread; j++)
+         {
+            iThreadFound += cRegistry.find(getKey((i * 7919u + j) % iEntriesCount)) ? 1u : 0u;
+         }
+
+         iFound += iThreadFound;
+      }));
+   }
+
+   for(size_t i = 0u; i < vThreads.size(); i++)
+   {
+      vThreads[i].join();
+   }
+
+   cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+   reportBenchmark("Registry lookups", cElapsed.count(), sDetails);
+
+   GETestCheck(iFoundInMap == iThreadsCount * iLookupsPerThread);
+   GETestCheck(iFound == iThreadsCount * iLookupsPerThread);
+
+   GEMutexDestroy(mEntityMapMutex);
+}
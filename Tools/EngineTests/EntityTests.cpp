@@ -0,0 +1,154 @@
+
+#include "main.h"
+
+#include "Entities/GEScene.h"
+#include "Entities/GEEntity.h"
+#include "Entities/GEComponentTransform.h"
+
+#include <random>
+#include <cstdio>
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+
+//
+//  Active state computed by walking up the parent chain, the way isActiveInHierarchy() did before it was cached
+//
+static bool computeReferenceActiveInHierarchy(const Entity* cEntity)
+{
+   for(const Entity* cCurrent = cEntity; cCurrent; cCurrent = cCurrent->getParent())
+   {
+      if(!cCurrent->getActive())
+         return false;
+   }
+
+   return true;
+}
+
+static uint32_t checkAgainstReference(Scene& cScene)
+{
+   uint32_t iMismatchesCount = 0u;
+
+   for(uint32_t i = 0u; i < cScene.getEntitiesCount(); i++)
+   {
+      const Entity* cEntity = cScene.getEntityByIndex(i);
+
+      if(cEntity->isActiveInHierarchy() != computeReferenceActiveInHierarchy(cEntity))
+      {
+         iMismatchesCount++;
+      }
+   }
+
+   return iMismatchesCount;
+}
+
+static bool isDescendantOf(const Entity* cEntity, const Entity* cAncestor)
+{
+   for(const Entity* cCurrent = cEntity; cCurrent; cCurrent = cCurrent->getParent())
+   {
+      if(cCurrent == cAncestor)
+         return true;
+   }
+
+   return false;
+}
+
+void testActiveInHierarchy()
+{
+   const uint32_t iRootsCount = 4u;
+   const uint32_t iEntitiesCount = 200u;
+
+   std::mt19937 cRandomEngine(28u);
+
+   Scene cScene(ObjectName("ActiveInHierarchyTest"));
+   GESTLVector(Entity*) vEntities;
+   char sEntityName[32];
+
+   for(uint32_t i = 0u; i < iEntitiesCount; i++)
+   {
+      Entity* cParent = i < iRootsCount ? nullptr : vEntities[cRandomEngine() % i];
+
+      sprintf(sEntityName, "Entity%u", i);
+      Entity* cEntity = cScene.addEntity(ObjectName(sEntityName), cParent);
+      cEntity->addComponent<ComponentTransform>();
+      vEntities.push_back(cEntity);
+   }
+
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   // a node in the middle of the tree, with descendants of its own
+   Entity* cMidTreeEntity = nullptr;
+
+   for(uint32_t i = iRootsCount; i < iEntitiesCount && !cMidTreeEntity; i++)
+   {
+      if(vEntities[i]->getParent() && vEntities[i]->getChildrenCount() > 0u)
+      {
+         cMidTreeEntity = vEntities[i];
+      }
+   }
+
+   GETestCheck(cMidTreeEntity != nullptr);
+
+   if(!cMidTreeEntity)
+      return;
+
+   cMidTreeEntity->setActive(false);
+   GETestCheck(!cMidTreeEntity->isActiveInHierarchy());
+   GETestCheck(!cMidTreeEntity->getChildByIndex(0u)->isActiveInHierarchy());
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   // descendants toggled while an ancestor is inactive keep their own flag, but stay inactive
+   for(uint32_t i = 0u; i < iEntitiesCount; i += 5u)
+   {
+      if(vEntities[i] != cMidTreeEntity && isDescendantOf(vEntities[i], cMidTreeEntity))
+      {
+         vEntities[i]->setActive(!vEntities[i]->getActive());
+      }
+   }
+
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   cMidTreeEntity->setActive(true);
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   // reparenting a subtree under an inactive parent deactivates it, and moving it back restores it
+   Entity* cInactiveParent = vEntities[0];
+   Entity* cSubtree = nullptr;
+
+   for(uint32_t i = iRootsCount; i < iEntitiesCount && !cSubtree; i++)
+   {
+      if(vEntities[i]->getChildrenCount() > 0u && !isDescendantOf(vEntities[i], cInactiveParent) && vEntities[i]->getActive())
+      {
+         cSubtree = vEntities[i];
+      }
+   }
+
+   GETestCheck(cSubtree != nullptr);
+
+   if(!cSubtree)
+      return;
+
+   Entity* cOriginalParent = cSubtree->getParent();
+   const bool bWasActiveInHierarchy = cSubtree->isActiveInHierarchy();
+
+   cInactiveParent->setActive(false);
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   cScene.setEntityParent(cSubtree, cInactiveParent);
+   GETestCheck(!cSubtree->isActiveInHierarchy());
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   cScene.setEntityParent(cSubtree, cOriginalParent);
+   GETestCheck(cSubtree->isActiveInHierarchy() == bWasActiveInHierarchy);
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   // and detaching it from any parent makes it depend on its own flag only
+   cScene.setEntityParent(cSubtree, cInactiveParent);
+   cScene.setEntityParent(cSubtree, nullptr);
+   GETestCheck(cSubtree->isActiveInHierarchy());
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   cInactiveParent->setActive(true);
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+}
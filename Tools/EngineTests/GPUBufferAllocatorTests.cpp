@@ -0,0 +1,147 @@
+
+#include "main.h"
+
+#include "Rendering/GEGPUBufferAllocator.h"
+
+using namespace GE;
+using namespace GE::Rendering;
+
+void testGPUBufferAllocator()
+{
+   const uint32_t iGranularity = 16u;
+
+   GPUBufferAllocator cAllocator;
+   cAllocator.init(1024u + 8u, iGranularity);
+
+   // the tail that cannot hold a whole unit is left out
+   GETestCheck(cAllocator.getCapacity() == 1024u);
+   GETestCheck(cAllocator.getFreeBlocksCount() == 1u);
+   GETestCheck(!cAllocator.allocate(0u).isValid());
+
+   // sizes are rounded up to the granularity, and the blocks are laid out one after the other
+   GPUBufferHandle hBlocks[6];
+
+   for(uint32_t i = 0u; i < 6u; i++)
+   {
+      hBlocks[i] = cAllocator.allocate(100u);
+      GETestCheck(cAllocator.isValid(hBlocks[i]));
+      GETestCheck(cAllocator.getBlock(hBlocks[i]).Offset == i * 112u);
+      GETestCheck(cAllocator.getBlock(hBlocks[i]).Size == 112u);
+   }
+
+   GETestCheck(cAllocator.getAllocationsCount() == 6u);
+   GETestCheck(cAllocator.getUsedSize() == 6u * 112u);
+   GETestCheck(cAllocator.getFreeSize() == 1024u - 6u * 112u);
+
+   // the space left cannot hold a block larger than itself
+   GETestCheck(!cAllocator.allocate(cAllocator.getFreeSize() + 1u).isValid());
+
+   // released blocks leave holes, and their handles become stale
+   cAllocator.release(hBlocks[1]);
+   cAllocator.release(hBlocks[3]);
+   GETestCheck(!cAllocator.isValid(hBlocks[1]));
+   GETestCheck(!cAllocator.isValid(hBlocks[3]));
+   GETestCheck(cAllocator.getFreeBlocksCount() == 3u);
+   GETestCheck(cAllocator.getLargestFreeBlockSize() == 1024u - 6u * 112u);
+
+   // the smallest range that fits is taken, which is the first hole
+   const GPUBufferHandle hSmall = cAllocator.allocate(50u);
+   GETestCheck(cAllocator.getBlock(hSmall).Offset == 112u);
+   GETestCheck(cAllocator.getBlock(hSmall).Size == 64u);
+   GETestCheck(cAllocator.getFreeBlocksCount() == 3u);
+
+   // a released slot is reused with a new generation, so the old handle does not resolve to it
+   GETestCheck(hSmall.getIndex() == hBlocks[1].getIndex() || hSmall.getIndex() == hBlocks[3].getIndex());
+   GETestCheck(!cAllocator.isValid(hBlocks[1]));
+
+   // releasing the blocks around a hole merges the three ranges into one
+   cAllocator.release(hBlocks[2]);
+   GETestCheck(cAllocator.getFreeBlocksCount() == 2u);
+
+   // and a block released right after a range is merged with it
+   cAllocator.release(hBlocks[4]);
+   GETestCheck(cAllocator.getFreeBlocksCount() == 2u);
+   GETestCheck(cAllocator.getLargestFreeBlockSize() == 4u * 112u - 64u);
+
+   const uint32_t iMergedOffset = 112u + 64u;
+   const GPUBufferHandle hMerged = cAllocator.allocate(4u * 112u - 64u);
+   GETestCheck(cAllocator.isValid(hMerged));
+   GETestCheck(cAllocator.getBlock(hMerged).Offset == iMergedOffset);
+   cAllocator.release(hMerged);
+
+   // a block between a range and the free tail joins them
+   cAllocator.release(hBlocks[5]);
+   GETestCheck(cAllocator.getFreeBlocksCount() == 1u);
+   GETestCheck(cAllocator.getLargestFreeBlockSize() == 1024u - 112u - 64u);
+
+   // fragment the buffer again: keep every other block
+   GPUBufferHandle hFragments[8];
+
+   for(uint32_t i = 0u; i < 8u; i++)
+   {
+      hFragments[i] = cAllocator.allocate(48u);
+   }
+
+   for(uint32_t i = 0u; i < 8u; i += 2u)
+   {
+      cAllocator.release(hFragments[i]);
+   }
+
+   const uint32_t iUsedSize = cAllocator.getUsedSize();
+   const uint32_t iAllocationsCount = cAllocator.getAllocationsCount();
+   GETestCheck(cAllocator.getFreeBlocksCount() > 1u);
+   GETestCheck(cAllocator.getLargestFreeBlockSize() < cAllocator.getFreeSize());
+
+   // defragmenting packs the blocks at the beginning in the same order, and the handles stay valid
+   GESTLVector(GPUBufferMove) vMoves;
+   const uint32_t iMovesCount = cAllocator.defragment(&vMoves);
+
+   GETestCheck(iMovesCount > 0u);
+   GETestCheck(vMoves.size() == iMovesCount);
+   GETestCheck(cAllocator.getUsedSize() == iUsedSize);
+   GETestCheck(cAllocator.getAllocationsCount() == iAllocationsCount);
+   GETestCheck(cAllocator.getFreeBlocksCount() == 1u);
+   GETestCheck(cAllocator.getLargestFreeBlockSize() == cAllocator.getFreeSize());
+
+   for(size_t i = 0u; i < vMoves.size(); i++)
+   {
+      const GPUBufferMove& sMove = vMoves[i];
+
+      GETestCheck(cAllocator.isValid(sMove.Handle));
+      GETestCheck(cAllocator.getBlock(sMove.Handle).Offset == sMove.DestinationOffset);
+      GETestCheck(sMove.DestinationOffset < sMove.SourceOffset);
+
+      // ascending order, and never over a range that is yet to be moved
+      if(i > 0u)
+      {
+         GETestCheck(sMove.DestinationOffset >= vMoves[i - 1u].DestinationOffset + vMoves[i - 1u].Size);
+      }
+
+      for(size_t j = i + 1u; j < vMoves.size(); j++)
+      {
+         GETestCheck(sMove.DestinationOffset + sMove.Size <= vMoves[j].SourceOffset);
+      }
+   }
+
+   const GPUBufferHandle hKept[] = { hBlocks[0], hSmall, hFragments[1], hFragments[3], hFragments[5], hFragments[7] };
+   uint32_t iExpectedOffset = 0u;
+
+   for(uint32_t i = 0u; i < sizeof(hKept) / sizeof(hKept[0]); i++)
+   {
+      GETestCheck(cAllocator.isValid(hKept[i]));
+      GETestCheck(cAllocator.getBlock(hKept[i]).Offset == iExpectedOffset);
+      iExpectedOffset += cAllocator.getBlock(hKept[i]).Size;
+   }
+
+   GETestCheck(iExpectedOffset == iUsedSize);
+
+   // a packed buffer has nothing to move
+   GETestCheck(cAllocator.defragment() == 0u);
+
+   // resetting frees everything and makes every handle stale
+   cAllocator.reset();
+   GETestCheck(!cAllocator.isValid(hSmall));
+   GETestCheck(cAllocator.getUsedSize() == 0u);
+   GETestCheck(cAllocator.getFreeBlocksCount() == 1u);
+   GETestCheck(cAllocator.getLargestFreeBlockSize() == 1024u);
+}
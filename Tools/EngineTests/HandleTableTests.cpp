@@ -0,0 +1,143 @@
+
+#include "main.h"
+
+#include "Entities/GEHandle.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace GE;
+using namespace GE::Entities;
+
+struct HandleTableTestObject
+{
+   Handle<HandleTableTestObject> Self;
+};
+
+typedef Handle<HandleTableTestObject> TestObjectHandle;
+
+void testHandleTable()
+{
+   HandleTable<HandleTableTestObject> cTable;
+   HandleTableTestObject sObjects[4];
+
+   for(uint32_t i = 0u; i < 4u; i++)
+   {
+      sObjects[i].Self = cTable.add(&sObjects[i]);
+      GETestCheck(cTable.resolve(sObjects[i].Self) == &sObjects[i]);
+   }
+
+   GETestCheck(cTable.getObjectsCount() == 4u);
+   GETestCheck(!cTable.resolve(TestObjectHandle()));
+
+   const TestObjectHandle hRemoved = sObjects[1].Self;
+   cTable.remove(hRemoved);
+   GETestCheck(!cTable.resolve(hRemoved));
+   GETestCheck(cTable.getObjectsCount() == 3u);
+
+   // a released slot is not handed out again right away
+   sObjects[1].Self = cTable.add(&sObjects[1]);
+   GETestCheck(sObjects[1].Self.getIndex() != hRemoved.getIndex());
+   GETestCheck(!cTable.resolve(hRemoved));
+
+   // with a single object added and removed over and over, a 12-bit generation would wrap
+   // around after 4096 cycles if the same slot was reused every time
+   const uint32_t iCyclesCount = 3u * (TestObjectHandle::GenerationMask + 1u);
+   uint32_t iStaleResolvesCount = 0u;
+   TestObjectHandle hFirstCycle;
+
+   for(uint32_t i = 0u; i < iCyclesCount; i++)
+   {
+      HandleTableTestObject sObject;
+      sObject.Self = cTable.add(&sObject);
+
+      if(i == 0u)
+      {
+         hFirstCycle = sObject.Self;
+      }
+      else if(cTable.resolve(hFirstCycle) || cTable.resolve(hRemoved))
+      {
+         iStaleResolvesCount++;
+      }
+
+      if(cTable.resolve(sObject.Self) != &sObject)
+      {
+         iStaleResolvesCount++;
+      }
+
+      cTable.remove(sObject.Self);
+   }
+
+   GETestCheck(iStaleResolvesCount == 0u);
+   GETestCheck(cTable.getObjectsCount() == 4u);
+
+   // released slots come back in the order they were released
+   for(uint32_t i = 0u; i < 4u; i++)
+   {
+      cTable.remove(sObjects[i].Self);
+   }
+
+   for(uint32_t i = 0u; i < 4u; i++)
+   {
+      const TestObjectHandle hPrevious = sObjects[i].Self;
+      sObjects[i].Self = cTable.add(&sObjects[i]);
+      GETestCheck(!cTable.resolve(hPrevious));
+      GETestCheck(cTable.resolve(sObjects[i].Self) == &sObjects[i]);
+   }
+
+   // handles resolved while another thread keeps releasing and reusing slots never
+   // give an object that belongs to another handle
+   const uint32_t iReadersCount = 3u;
+   const uint32_t iChurnObjectsCount = 64u;
+
+   HandleTableTestObject sChurnObjects[iChurnObjectsCount];
+   std::atomic<uint32_t> sPublishedHandles[iChurnObjectsCount];
+
+   for(uint32_t i = 0u; i < iChurnObjectsCount; i++)
+   {
+      sChurnObjects[i].Self = cTable.add(&sChurnObjects[i]);
+      sPublishedHandles[i].store(sChurnObjects[i].Self.getValue());
+   }
+
+   std::atomic<bool> bChurning(true);
+   std::atomic<uint32_t> iMismatchesCount(0u);
+   std::vector<std::thread> vReaders;
+
+   for(uint32_t i = 0u; i < iReadersCount; i++)
+   {
+      vReaders.push_back(std::thread([&, i]()
+      {
+         uint32_t iIndex = i;
+
+         while(bChurning.load())
+         {
+            iIndex = (iIndex + 1u) % iChurnObjectsCount;
+            const TestObjectHandle hObject(sPublishedHandles[iIndex].load());
+            const HandleTableTestObject* cObject = cTable.resolve(hObject);
+
+            if(cObject && cObject != &sChurnObjects[iIndex])
+            {
+               iMismatchesCount++;
+            }
+         }
+      }));
+   }
+
+   for(uint32_t iCycle = 0u; iCycle < 200000u; iCycle++)
+   {
+      const uint32_t iIndex = iCycle % iChurnObjectsCount;
+      cTable.remove(sChurnObjects[iIndex].Self);
+      sChurnObjects[iIndex].Self = cTable.add(&sChurnObjects[iIndex]);
+      sPublishedHandles[iIndex].store(sChurnObjects[iIndex].Self.getValue());
+   }
+
+   bChurning.store(false);
+
+   for(size_t i = 0u; i < vReaders.size(); i++)
+   {
+      vReaders[i].join();
+   }
+
+   GETestCheck(iMismatchesCount.load() == 0u);
+}
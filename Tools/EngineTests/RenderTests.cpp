@@ -0,0 +1,540 @@
+
+#include "main.h"
+
+#include "Core/GETaskManager.h"
+#include "Content/GEMesh.h"
+#include "Entities/GEScene.h"
+#include "Entities/GEEntity.h"
+#include "Entities/GEComponentTransform.h"
+#include "Entities/GEComponentCamera.h"
+#include "Entities/GEComponentMesh.h"
+#include "Entities/GEComponentLight.h"
+#include "Rendering/GERenderSystem.h"
+#include "Rendering/GEMaterial.h"
+#include "Rendering/GEPrimitives.h"
+
+#include <cstdio>
+#include <chrono>
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Content;
+using namespace GE::Entities;
+using namespace GE::Rendering;
+
+//
+//  Resources the render tests share: a cube mesh and a material from the default shader programs.
+//  While it exists, the frames are replayed by the null backend instead of the graphics API
+//
+class RenderTestSetup
+{
+public:
+   Mesh* cMesh;
+   Material* cMaterial;
+   RenderCommandBackendNull cBackend;
+
+   RenderTestSetup()
+   {
+      cMesh = Allocator::alloc<Mesh>();
+      GEInvokeCtor(Mesh, cMesh)(Cube(1.0f), ObjectName("RenderTestCube"));
+
+      cMaterial = Allocator::alloc<Material>();
+      GEInvokeCtor(Material, cMaterial)(ObjectName("RenderTestMaterial"), ObjectName("RenderTests"));
+      cMaterial->setShaderProgram(ObjectName("MeshColorUnlit"));
+
+      RenderSystem::getInstance()->setCommandBackend(&cBackend);
+   }
+
+   ~RenderTestSetup()
+   {
+      RenderSystem* cRender = RenderSystem::getInstance();
+
+      // the geometry of the test entities does not outlive the test
+      cRender->clearGeometryRenderInfoEntries();
+      cRender->renderBegin();
+      cRender->renderFrame();
+      cRender->renderEnd();
+      cRender->clearRenderingQueues();
+
+      cRender->setCommandBackend(nullptr);
+
+      GEInvokeDtor(Material, cMaterial)
+      Allocator::free(cMaterial);
+      GEInvokeDtor(Mesh, cMesh)
+      Allocator::free(cMesh);
+   }
+
+   Entity* addCamera(Scene& cScene, const Vector3& vPosition, const Vector3& vLookAt)
+   {
+      Entity* cEntity = cScene.addEntity(ObjectName("Camera"));
+      ComponentTransform* cTransform = cEntity->addComponent<ComponentTransform>();
+      cTransform->setPosition(vPosition);
+      ComponentCamera* cCamera = cEntity->addComponent<ComponentCamera>();
+      cCamera->lookAt(vLookAt);
+      cEntity->init();
+
+      RenderSystem::getInstance()->setActiveCamera(cCamera);
+
+      return cEntity;
+   }
+
+   Entity* addMesh(Scene& cScene, const char* sName, const Vector3& vPosition)
+   {
+      Entity* cEntity = cScene.addEntity(ObjectName(sName));
+      ComponentTransform* cTransform = cEntity->addComponent<ComponentTransform>();
+      cTransform->setPosition(vPosition);
+      ComponentMesh* cMeshComponent = cEntity->addComponent<ComponentMesh>();
+      cMeshComponent->loadMesh(cMesh);
+      cMeshComponent->addMaterialPass()->setMaterial(cMaterial);
+      cEntity->init();
+
+      return cEntity;
+   }
+
+   void renderFrame(Scene& cScene)
+   {
+      RenderSystem* cRender = RenderSystem::getInstance();
+
+      if(cScene.queueTransformUpdateJobs() > 0u)
+      {
+         TaskManager::getInstance()->kickFrameJobs();
+         TaskManager::getInstance()->waitForFrameJobs();
+      }
+
+      if(cRender->getActiveCamera())
+      {
+         cRender->getActiveCamera()->update();
+      }
+
+      cRender->updateCullingFrustums();
+      cScene.queueForRendering();
+
+      cRender->renderBegin();
+      cRender->renderFrame();
+      cRender->renderEnd();
+      cRender->clearRenderingQueues();
+   }
+};
+
+void testFrustumCulling()
+{
+   const uint32_t iVisibleCount = 8u;
+   const uint32_t iHiddenCount = 24u;
+
+   RenderSystem* cRender = RenderSystem::getInstance();
+   const bool bCullingEnabled = cRender->getFrustumCullingEnabled();
+   const bool bInstancingEnabled = cRender->getInstancingEnabled();
+
+   // one draw per visible mesh, so that the draws can be counted
+   cRender->setFrustumCullingEnabled(true);
+   cRender->setInstancingEnabled(false);
+
+   {
+      RenderTestSetup cSetup;
+      Scene cScene(ObjectName("FrustumCullingTest"));
+      char sEntityName[32];
+
+      cSetup.addCamera(cScene, Vector3(0.0f, 0.0f, -20.0f), Vector3::Zero);
+
+      for(uint32_t i = 0u; i < iVisibleCount; i++)
+      {
+         sprintf(sEntityName, "CullingVisible%u", i);
+         cSetup.addMesh(cScene, sEntityName, Vector3((float)i - 4.0f, 0.0f, 0.0f));
+      }
+
+      // behind the camera, and far away to the sides
+      for(uint32_t i = 0u; i < iHiddenCount; i++)
+      {
+         sprintf(sEntityName, "CullingHidden%u", i);
+         const float fOffset = (float)(i / 3u);
+         const Vector3 vPositions[] =
+         {
+            Vector3(fOffset, 0.0f, -60.0f),
+            Vector3(1000.0f, fOffset, 0.0f),
+            Vector3(-1000.0f, 0.0f, fOffset)
+         };
+         cSetup.addMesh(cScene, sEntityName, vPositions[i % 3u]);
+      }
+
+      cSetup.renderFrame(cScene);
+
+      GETestCheck(cSetup.cBackend.getValidationErrors() == 0u);
+      GETestCheck(cRender->getCulledRenderables() == iHiddenCount);
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::Draw) == iVisibleCount);
+      GETestCheck(cSetup.cBackend.getDrawnIndices() == iVisibleCount * cSetup.cMesh->getGeometryData().NumIndices);
+
+      // without culling, the same scene draws everything
+      cSetup.cBackend.reset();
+      cRender->setFrustumCullingEnabled(false);
+      cSetup.renderFrame(cScene);
+
+      GETestCheck(cRender->getCulledRenderables() == 0u);
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::Draw) == iVisibleCount + iHiddenCount);
+   }
+
+   cRender->setFrustumCullingEnabled(bCullingEnabled);
+   cRender->setInstancingEnabled(bInstancingEnabled);
+}
+
+void testRenderThread()
+{
+   const uint32_t iMeshesCount = 16u;
+   const uint32_t iFramesCount = 12u;
+
+   RenderSystem* cRender = RenderSystem::getInstance();
+   const bool bInstancingEnabled = cRender->getInstancingEnabled();
+   const uint32_t iFrameLatency = cRender->getFrameLatency();
+
+   // one draw per mesh, so that every frame can be told apart by its draws
+   cRender->setInstancingEnabled(false);
+
+   {
+      RenderTestSetup cSetup;
+      char sEntityName[32];
+
+      for(uint32_t iLatency = 1u; iLatency <= 3u; iLatency++)
+      {
+         Scene cScene(ObjectName("RenderThreadTest"));
+         cSetup.addCamera(cScene, Vector3(0.0f, 0.0f, -40.0f), Vector3::Zero);
+
+         for(uint32_t i = 0u; i < iMeshesCount; i++)
+         {
+            sprintf(sEntityName, "RenderThread%u_%u", iLatency, i);
+            cSetup.addMesh(cScene, sEntityName, Vector3((float)i * 2.0f - 16.0f, 0.0f, 0.0f));
+         }
+
+         cSetup.cBackend.reset();
+         cRender->setFrameLatency(iLatency);
+         cRender->setRenderThreadEnabled(true);
+
+         // every frame draws one mesh less, and the removed one is destroyed while its last
+         // frame may still be waiting to be replayed
+         uint32_t iExpectedDraws = 0u;
+
+         for(uint32_t i = 0u; i < iFramesCount; i++)
+         {
+            cSetup.renderFrame(cScene);
+            iExpectedDraws += iMeshesCount - i;
+
+            sprintf(sEntityName, "RenderThread%u_%u", iLatency, i);
+            cScene.removeEntityImmediately(ObjectName(sEntityName));
+         }
+
+         // the pending frames are replayed before the thread exits
+         cRender->setRenderThreadEnabled(false);
+
+         GETestCheck(cSetup.cBackend.getValidationErrors() == 0u);
+         GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::BeginFrame) == iFramesCount);
+         GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::EndFrame) == iFramesCount);
+         GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::Draw) == iExpectedDraws);
+         GETestCheck(cSetup.cBackend.getDrawnIndices() == iExpectedDraws * cSetup.cMesh->getGeometryData().NumIndices);
+      }
+   }
+
+   cRender->setFrameLatency(iFrameLatency);
+   cRender->setInstancingEnabled(bInstancingEnabled);
+}
+
+void testStaticBatching()
+{
+   const uint32_t iMeshesCount = 8u;
+
+   RenderSystem* cRender = RenderSystem::getInstance();
+   const bool bInstancingEnabled = cRender->getInstancingEnabled();
+   const bool bStaticBatchingEnabled = Scene::getStaticBatchingEnabled();
+
+   // one draw per mesh rendered on its own, so that the draws saved by the batch can be counted
+   cRender->setInstancingEnabled(false);
+   Scene::setStaticBatchingEnabled(true);
+
+   {
+      RenderTestSetup cSetup;
+      Scene cScene(ObjectName("StaticBatchingTest"));
+      Entity* cMeshes[iMeshesCount];
+      char sEntityName[32];
+
+      cSetup.addCamera(cScene, Vector3(0.0f, 0.0f, -20.0f), Vector3::Zero);
+
+      for(uint32_t i = 0u; i < iMeshesCount; i++)
+      {
+         sprintf(sEntityName, "StaticBatchMesh%u", i);
+         cMeshes[i] = cSetup.addMesh(cScene, sEntityName, Vector3((float)i - 4.0f, 0.0f, 0.0f));
+         cMeshes[i]->getComponent<ComponentMesh>()->setGeometryType(GeometryType::Static);
+      }
+
+      const GeometryData& sGeometryData = cSetup.cMesh->getGeometryData();
+
+      // meshes sharing their material go into a single batch, drawn once
+      cScene.requestStaticBatchesBuild();
+      cSetup.renderFrame(cScene);
+
+      const StaticBatchingReport& sReport = cScene.getStaticBatchingReport();
+
+      GETestCheck(cSetup.cBackend.getValidationErrors() == 0u);
+      GETestCheck(sReport.BatchesCreated == 1u);
+      GETestCheck(sReport.RenderablesBatched == iMeshesCount);
+      GETestCheck(sReport.VerticesBatched == iMeshesCount * sGeometryData.NumVertices);
+      GETestCheck(sReport.DrawCallsSaved == iMeshesCount - 1u);
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::Draw) == iMeshesCount - sReport.DrawCallsSaved);
+      GETestCheck(cSetup.cBackend.getDrawnIndices() == iMeshesCount * sGeometryData.NumIndices);
+
+      // a still frame keeps the batch
+      cSetup.cBackend.reset();
+      cSetup.renderFrame(cScene);
+
+      GETestCheck(sReport.BatchesDissolved == 0u);
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::Draw) == 1u);
+
+      // moving one member dissolves the batch, and every mesh is drawn on its own again
+      cSetup.cBackend.reset();
+      cMeshes[0]->getComponent<ComponentTransform>()->setPosition(-4.0f, 1.0f, 0.0f);
+      cSetup.renderFrame(cScene);
+
+      GETestCheck(cSetup.cBackend.getValidationErrors() == 0u);
+      GETestCheck(sReport.BatchesDissolved == 1u);
+      GETestCheck(sReport.DrawCallsSaved == 0u);
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::Draw) == iMeshesCount);
+      GETestCheck(cSetup.cBackend.getDrawnIndices() == iMeshesCount * sGeometryData.NumIndices);
+   }
+
+   cRender->setInstancingEnabled(bInstancingEnabled);
+   Scene::setStaticBatchingEnabled(bStaticBatchingEnabled);
+}
+
+void testShadowMapCache()
+{
+   const uint32_t iCastersCount = 4u;
+
+   RenderSystem* cRender = RenderSystem::getInstance();
+   Scene* cPreviousActiveScene = Scene::getActiveScene();
+
+   Material* cOtherMaterial = Allocator::alloc<Material>();
+   GEInvokeCtor(Material, cOtherMaterial)(ObjectName("RenderTestOtherMaterial"), ObjectName("RenderTests"));
+   cOtherMaterial->setShaderProgram(ObjectName("MeshColorUnlit"));
+
+   {
+      RenderTestSetup cSetup;
+      Scene cScene(ObjectName("ShadowMapCacheTest"));
+      Entity* cCasters[iCastersCount];
+      char sEntityName[32];
+
+      Scene::setActiveScene(&cScene);
+      cSetup.addCamera(cScene, Vector3(0.0f, 5.0f, -20.0f), Vector3::Zero);
+
+      // a light pointing straight down would make the light view degenerate
+      Entity* cLightEntity = cScene.addEntity(ObjectName("ShadowCacheLight"));
+      cLightEntity->addComponent<ComponentTransform>()->setRotation(Rotation(Vector3(0.6f, 0.4f, 0.0f)));
+      ComponentLight* cLight = cLightEntity->addComponent<ComponentLight>();
+      cLight->setLightType(LightType::Directional);
+      cLightEntity->init();
+
+      for(uint32_t i = 0u; i < iCastersCount; i++)
+      {
+         sprintf(sEntityName, "ShadowCacheCaster%u", i);
+         cCasters[i] = cSetup.addMesh(cScene, sEntityName, Vector3((float)i * 2.0f - 3.0f, 0.0f, 0.0f));
+         cCasters[i]->getComponent<ComponentMesh>()->setDynamicShadows(
+            (uint8_t)DynamicShadowsBitMask::Cast | (uint8_t)DynamicShadowsBitMask::Receive);
+      }
+
+      // the lights are queued by the scene update, which the tests do not run
+      const auto renderShadowedFrame = [&]()
+      {
+         cRender->queueForRendering(cLight);
+         cSetup.renderFrame(cScene);
+      };
+
+      renderShadowedFrame();
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::RenderShadowMap) == 1u);
+
+      // nothing changed, so the cached shadow map is kept
+      renderShadowedFrame();
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::RenderShadowMap) == 1u);
+
+      cCasters[0]->getComponent<ComponentTransform>()->move(0.0f, 1.0f, 0.0f);
+      renderShadowedFrame();
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::RenderShadowMap) == 2u);
+
+      cCasters[1]->getComponent<ComponentMesh>()->getMaterialPass(0)->setMaterial(cOtherMaterial);
+      renderShadowedFrame();
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::RenderShadowMap) == 3u);
+
+      renderShadowedFrame();
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::RenderShadowMap) == 3u);
+
+      // the cascades change the layout of the map, and stay cached while the camera does not move
+      cRender->setShadowCascadesCount(2u);
+      renderShadowedFrame();
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::RenderShadowMap) == 4u);
+
+      renderShadowedFrame();
+      GETestCheck(cSetup.cBackend.getCommandCount(RenderCommandType::RenderShadowMap) == 4u);
+      GETestCheck(cSetup.cBackend.getValidationErrors() == 0u);
+
+      cRender->setShadowCascadesCount(1u);
+      Scene::setActiveScene(cPreviousActiveScene);
+   }
+
+   GEInvokeDtor(Material, cOtherMaterial)
+   Allocator::free(cOtherMaterial);
+}
+
+void benchmarkInstancedDraws()
+{
+   const uint32_t iMeshesCount = 1024u;
+   const uint32_t iFramesCount = 32u;
+
+   RenderSystem* cRender = RenderSystem::getInstance();
+   const bool bInstancingEnabled = cRender->getInstancingEnabled();
+
+   {
+      RenderTestSetup cSetup;
+      Scene cScene(ObjectName("InstancedDrawsBenchmark"));
+      char sEntityName[32];
+
+      cSetup.addCamera(cScene, Vector3(0.0f, 0.0f, -80.0f), Vector3::Zero);
+
+      for(uint32_t i = 0u; i < iMeshesCount; i++)
+      {
+         sprintf(sEntityName, "InstancedDraws%u", i);
+         cSetup.addMesh(cScene, sEntityName, Vector3((float)(i % 32u) * 2.0f - 32.0f, (float)(i / 32u) * 2.0f - 32.0f, 0.0f));
+      }
+
+      // the first frame uploads the geometry
+      cSetup.renderFrame(cScene);
+
+      const bool bInstancingModes[] = { false, true };
+      const char* sBenchmarkNames[] = { "Frames of 1024 meshes, one draw each", "Frames of 1024 meshes, instanced" };
+      uint32_t iDrawCommands[2];
+
+      for(uint32_t iMode = 0u; iMode < 2u; iMode++)
+      {
+         cRender->setInstancingEnabled(bInstancingModes[iMode]);
+         cSetup.cBackend.reset();
+
+         const auto cStart = std::chrono::high_resolution_clock::now();
+
+         for(uint32_t i = 0u; i < iFramesCount; i++)
+         {
+            cSetup.renderFrame(cScene);
+         }
+
+         std::chrono::duration<double, std::milli> cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+
+         iDrawCommands[iMode] =
+            (cSetup.cBackend.getCommandCount(RenderCommandType::Draw) +
+            cSetup.cBackend.getCommandCount(RenderCommandType::DrawInstanced)) / iFramesCount;
+
+         char sDetails[64];
+         sprintf(sDetails, "%u frames, %u draw commands per frame", iFramesCount, iDrawCommands[iMode]);
+         reportBenchmark(sBenchmarkNames[iMode], cElapsed.count(), sDetails);
+
+         GETestCheck(cSetup.cBackend.getValidationErrors() == 0u);
+         GETestCheck(cSetup.cBackend.getDrawnInstances() == iMeshesCount * iFramesCount);
+      }
+
+      GETestCheck(iDrawCommands[1] < iDrawCommands[0]);
+   }
+
+   cRender->setInstancingEnabled(bInstancingEnabled);
+}
+
+void benchmarkQueueForRendering()
+{
+   const uint32_t iMeshesCount = 20000u;
+   const uint32_t iFramesCount = 16u;
+
+   RenderSystem* cRender = RenderSystem::getInstance();
+
+   {
+      RenderTestSetup cSetup;
+      Scene cScene(ObjectName("QueueForRenderingBenchmark"));
+      char sEntityName[32];
+
+      cSetup.addCamera(cScene, Vector3(0.0f, 0.0f, -300.0f), Vector3::Zero);
+
+      for(uint32_t i = 0u; i < iMeshesCount; i++)
+      {
+         sprintf(sEntityName, "Queueing%u", i);
+         cSetup.addMesh(cScene, sEntityName, Vector3((float)(i % 200u) * 2.0f - 200.0f, (float)(i / 200u) * 2.0f - 100.0f, 0.0f));
+      }
+
+      // the first frame uploads the geometry
+      cSetup.renderFrame(cScene);
+
+      // only the queueing is timed, the rest of the frame is not
+      std::chrono::duration<double, std::milli> cElapsed(0.0);
+
+      for(uint32_t i = 0u; i < iFramesCount; i++)
+      {
+         cRender->updateCullingFrustums();
+
+         const auto cStart = std::chrono::high_resolution_clock::now();
+         cScene.queueForRendering();
+         cElapsed += std::chrono::high_resolution_clock::now() - cStart;
+
+         cRender->renderBegin();
+         cRender->renderFrame();
+         cRender->renderEnd();
+         cRender->clearRenderingQueues();
+      }
+
+      char sDetails[64];
+      sprintf(sDetails, "%u frames", iFramesCount);
+      reportBenchmark("Queueing of 20000 renderables", cElapsed.count(), sDetails);
+
+      GETestCheck(cSetup.cBackend.getValidationErrors() == 0u);
+   }
+}
+
+void benchmarkRedundantStateChanges()
+{
+   const uint32_t iMeshesCount = 1024u;
+   const uint32_t iFramesCount = 32u;
+
+   RenderSystem* cRender = RenderSystem::getInstance();
+   const bool bInstancingEnabled = cRender->getInstancingEnabled();
+
+   // one draw per mesh, so that every draw goes through the state commands
+   cRender->setInstancingEnabled(false);
+
+   {
+      RenderTestSetup cSetup;
+      Scene cScene(ObjectName("RedundantStateChangesBenchmark"));
+      char sEntityName[32];
+
+      cSetup.addCamera(cScene, Vector3(0.0f, 0.0f, -80.0f), Vector3::Zero);
+
+      for(uint32_t i = 0u; i < iMeshesCount; i++)
+      {
+         sprintf(sEntityName, "RedundantState%u", i);
+         cSetup.addMesh(cScene, sEntityName, Vector3((float)(i % 32u) * 2.0f - 32.0f, (float)(i / 32u) * 2.0f - 32.0f, 0.0f));
+      }
+
+      // the first frame uploads the geometry
+      cSetup.renderFrame(cScene);
+      cSetup.cBackend.reset();
+
+      const auto cStart = std::chrono::high_resolution_clock::now();
+
+      for(uint32_t i = 0u; i < iFramesCount; i++)
+      {
+         cSetup.renderFrame(cScene);
+      }
+
+      std::chrono::duration<double, std::milli> cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+
+      const uint32_t iStateCommands =
+         cSetup.cBackend.getCommandCount(RenderCommandType::UseMaterial) +
+         cSetup.cBackend.getCommandCount(RenderCommandType::BindBuffers) +
+         cSetup.cBackend.getCommandCount(RenderCommandType::BindTexture);
+
+      char sDetails[128];
+      sprintf(sDetails, "%u frames, %u of %u state commands per frame are redundant",
+         iFramesCount, cSetup.cBackend.getRedundantCommands() / iFramesCount, iStateCommands / iFramesCount);
+      reportBenchmark("Frames of 1024 draws", cElapsed.count(), sDetails);
+
+      GETestCheck(cSetup.cBackend.getValidationErrors() == 0u);
+   }
+
+   cRender->setInstancingEnabled(bInstancingEnabled);
+}
@@ -0,0 +1,565 @@
+
+#include "main.h"
+
+#include "Entities/GEScene.h"
+#include "Entities/GEEntity.h"
+#include "Entities/GEComponentTransform.h"
+#include "Entities/GEComponentMesh.h"
+#include "Entities/GEComponentSprite.h"
+#include "Entities/GEComponentLabel.h"
+#include "Entities/GEComponentParticleSystem.h"
+#include "Entities/GEComponentCamera.h"
+#include "Entities/GEComponentDataContainer.h"
+#include "Rendering/GERenderSystem.h"
+#include "Core/GETime.h"
+#include "Core/GEEvents.h"
+
+#include <chrono>
+#include <sstream>
+#include <cstdio>
+#include <algorithm>
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+using namespace GE::Rendering;
+
+void testSceneListOrder()
+{
+   const uint32_t iEntitiesCount = 32u;
+
+   Scene cScene(ObjectName("SceneListOrderTest"));
+   GESTLVector(Entity*) vEntities;
+   char sEntityName[32];
+
+   for(uint32_t i = 0u; i < iEntitiesCount; i++)
+   {
+      sprintf(sEntityName, "Entity%u", i);
+      Entity* cEntity = cScene.addEntity(ObjectName(sEntityName));
+      cEntity->addComponent<ComponentTransform>();
+      cEntity->init();
+      vEntities.push_back(cEntity);
+   }
+
+   // swap-and-pop removals break the order until the lists are sorted again
+   for(uint32_t i = 0u; i < iEntitiesCount; i += 3u)
+   {
+      cScene.removeEntity(vEntities[i]->getFullName());
+      vEntities[i] = nullptr;
+   }
+
+   cScene.flushPendingRemovals();
+
+   GESTLVector(Entity*) vRemainingEntities;
+
+   for(uint32_t i = 0u; i < iEntitiesCount; i++)
+   {
+      if(vEntities[i])
+      {
+         vRemainingEntities.push_back(vEntities[i]);
+      }
+   }
+
+   GETestCheck(cScene.getEntitiesCount() == (uint32_t)vRemainingEntities.size());
+
+   uint32_t iOutOfOrderCount = 0u;
+
+   for(uint32_t i = 0u; i < cScene.getEntitiesCount(); i++)
+   {
+      if(cScene.getEntityByIndex(i) != vRemainingEntities[i])
+      {
+         iOutOfOrderCount++;
+      }
+   }
+
+   GETestCheck(iOutOfOrderCount == 0u);
+
+   const GESTLVector(Component*)& vTransforms = cScene.getComponents<ComponentTransform>();
+   iOutOfOrderCount = 0u;
+
+   for(uint32_t i = 0u; i < (uint32_t)vTransforms.size(); i++)
+   {
+      if(vTransforms[i]->getOwner() != vRemainingEntities[i])
+      {
+         iOutOfOrderCount++;
+      }
+   }
+
+   GETestCheck(vTransforms.size() == vRemainingEntities.size());
+   GETestCheck(iOutOfOrderCount == 0u);
+
+   // explicit reordering
+   Component* cLastTransform = vRemainingEntities.back()->getComponent<ComponentTransform>();
+   cScene.bringComponentToFront(ComponentType::Transform, cLastTransform);
+   GETestCheck(vTransforms.front() == cLastTransform);
+
+   cScene.sendComponentToBack(ComponentType::Transform, cLastTransform);
+   GETestCheck(vTransforms.back() == cLastTransform);
+}
+
+static uint32_t countComponentsOfOtherClasses(const GESTLVector(Component*)& vComponents, const ObjectName& cClassName)
+{
+   uint32_t iCount = 0u;
+
+   for(size_t i = 0u; i < vComponents.size(); i++)
+   {
+      if(vComponents[i]->getClassName() != cClassName)
+      {
+         iCount++;
+      }
+   }
+
+   return iCount;
+}
+
+void testComponentClassLists()
+{
+   const uint32_t iEntitiesPerClassCount = 16u;
+   const uint32_t iClassesCount = 4u;
+
+   Scene cScene(ObjectName("ComponentClassListsTest"));
+   GESTLVector(Entity*) vEntities;
+   char sEntityName[32];
+
+   // the renderable classes interleaved, so that every class list is built from scattered entities
+   for(uint32_t i = 0u; i < iEntitiesPerClassCount * iClassesCount; i++)
+   {
+      sprintf(sEntityName, "Entity%u", i);
+      Entity* cEntity = cScene.addEntity(ObjectName(sEntityName));
+      cEntity->addComponent<ComponentTransform>();
+
+      switch(i % iClassesCount)
+      {
+      case 0u:
+         cEntity->addComponent<ComponentMesh>();
+         break;
+      case 1u:
+         cEntity->addComponent<ComponentSprite>();
+         break;
+      case 2u:
+         cEntity->addComponent<ComponentLabel>();
+         break;
+      default:
+         cEntity->addComponent<ComponentParticleSystem>();
+         break;
+      }
+
+      cEntity->init();
+      vEntities.push_back(cEntity);
+   }
+
+   const GESTLVector(Component*)& vSprites = cScene.getComponentsOfClass<ComponentSprite>();
+   const GESTLVector(Component*)& vParticleSystems = cScene.getComponentsOfClass<ComponentParticleSystem>();
+
+   GETestCheck(cScene.getComponents<ComponentRenderable>().size() == iEntitiesPerClassCount * iClassesCount);
+   GETestCheck(vSprites.size() == iEntitiesPerClassCount);
+   GETestCheck(vParticleSystems.size() == iEntitiesPerClassCount);
+   GETestCheck(cScene.getComponentsOfClass<ComponentMesh>().size() == iEntitiesPerClassCount);
+   GETestCheck(cScene.getComponentsOfClass<ComponentLabel>().size() == iEntitiesPerClassCount);
+   GETestCheck(countComponentsOfOtherClasses(vSprites, ComponentSprite::ClassName) == 0u);
+   GETestCheck(countComponentsOfOtherClasses(vParticleSystems, ComponentParticleSystem::ClassName) == 0u);
+
+   // removing a component takes it out of its class list only
+   vEntities[1]->removeComponent(ComponentSprite::ClassName);
+   vEntities[3]->removeComponent(ComponentParticleSystem::ClassName);
+
+   GETestCheck(vSprites.size() == iEntitiesPerClassCount - 1u);
+   GETestCheck(vParticleSystems.size() == iEntitiesPerClassCount - 1u);
+   GETestCheck(cScene.getComponentsOfClass<ComponentMesh>().size() == iEntitiesPerClassCount);
+   GETestCheck(std::find(vSprites.begin(), vSprites.end(), nullptr) == vSprites.end());
+   GETestCheck(countComponentsOfOtherClasses(vSprites, ComponentSprite::ClassName) == 0u);
+   GETestCheck(countComponentsOfOtherClasses(vParticleSystems, ComponentParticleSystem::ClassName) == 0u);
+
+   // removing entities moves the last components of each list into the freed positions
+   uint32_t iSpritesRemovedCount = 1u;
+   uint32_t iParticleSystemsRemovedCount = 1u;
+
+   for(uint32_t i = 4u; i < (uint32_t)vEntities.size(); i += 3u)
+   {
+      if(i % iClassesCount == 1u)
+      {
+         iSpritesRemovedCount++;
+      }
+      else if(i % iClassesCount == 3u)
+      {
+         iParticleSystemsRemovedCount++;
+      }
+
+      cScene.removeEntity(vEntities[i]->getFullName());
+      vEntities[i] = nullptr;
+   }
+
+   cScene.flushPendingRemovals();
+
+   GETestCheck(vSprites.size() == iEntitiesPerClassCount - iSpritesRemovedCount);
+   GETestCheck(vParticleSystems.size() == iEntitiesPerClassCount - iParticleSystemsRemovedCount);
+   GETestCheck(countComponentsOfOtherClasses(vSprites, ComponentSprite::ClassName) == 0u);
+   GETestCheck(countComponentsOfOtherClasses(vParticleSystems, ComponentParticleSystem::ClassName) == 0u);
+
+   // and the lists still follow the order of the entities that own the components
+   uint32_t iOutOfOrderCount = 0u;
+   size_t iSpriteIndex = 0u;
+
+   for(uint32_t i = 0u; i < (uint32_t)vEntities.size(); i++)
+   {
+      if(vEntities[i] && vEntities[i]->getComponent<ComponentRenderable>() &&
+         vEntities[i]->getComponent<ComponentRenderable>()->getClassName() == ComponentSprite::ClassName)
+      {
+         if(iSpriteIndex >= vSprites.size() || vSprites[iSpriteIndex]->getOwner() != vEntities[i])
+         {
+            iOutOfOrderCount++;
+         }
+
+         iSpriteIndex++;
+      }
+   }
+
+   GETestCheck(iSpriteIndex == vSprites.size());
+   GETestCheck(iOutOfOrderCount == 0u);
+}
+
+static Entity* addEntityTree(Scene& cScene, const char* sRootName, uint32_t iChildrenCount)
+{
+   char sEntityName[32];
+
+   Entity* cRoot = cScene.addEntity(ObjectName(sRootName));
+   cRoot->addComponent<ComponentTransform>()->setPosition(1.0f, 2.0f, 3.0f);
+
+   for(uint32_t i = 0u; i < iChildrenCount; i++)
+   {
+      sprintf(sEntityName, "Child%u", i);
+      Entity* cChild = cScene.addEntity(ObjectName(sEntityName), cRoot);
+      cChild->addComponent<ComponentTransform>()->setScale((float)(i + 1u));
+   }
+
+   return cRoot;
+}
+
+void testEntityBatchInstantiation()
+{
+   const uint32_t iInstancesCount = 100u;
+   const uint32_t iChildrenCount = 3u;
+
+   Scene cScene(ObjectName("EntityBatchTest"));
+   Entity* cSource = addEntityTree(cScene, "Source", iChildrenCount);
+   cSource->init();
+
+   uint32_t iEntityAddedCount = 0u;
+   uint32_t iEntitiesAddedCount = 0u;
+   size_t iEntitiesInBatchEvent = 0u;
+
+   cScene.connectEventCallback(Events::EntityAdded, ObjectName("Test"), [&](const EventArgs*) -> bool
+   {
+      iEntityAddedCount++;
+      return false;
+   });
+   cScene.connectEventCallback(Events::EntitiesAdded, ObjectName("Test"), [&](const EventArgs* sArgs) -> bool
+   {
+      iEntitiesAddedCount++;
+      iEntitiesInBatchEvent += static_cast<GESTLVector(Entity*)*>(sArgs->Data)->size();
+      return false;
+   });
+
+   GESTLVector(Matrix4) vTransforms(iInstancesCount);
+
+   for(uint32_t i = 0u; i < iInstancesCount; i++)
+   {
+      Matrix4MakeIdentity(&vTransforms[i]);
+      vTransforms[i].m[GE_M4_1_4] = (float)i;
+   }
+
+   GESTLVector(Entity*) vInstances;
+   cScene.cloneEntityBatch(cSource, iInstancesCount, &vTransforms[0], nullptr, &vInstances);
+
+   // one notification carrying every entity of the batch, children included
+   GETestCheck(vInstances.size() == iInstancesCount);
+   GETestCheck(iEntityAddedCount == 0u);
+   GETestCheck(iEntitiesAddedCount == 1u);
+   GETestCheck(iEntitiesInBatchEvent == iInstancesCount * (iChildrenCount + 1u));
+
+   GETestCheck(cScene.getEntitiesCount() == (iInstancesCount + 1u) * (iChildrenCount + 1u));
+   GETestCheck(cScene.getComponents<ComponentTransform>().size() == (iInstancesCount + 1u) * (iChildrenCount + 1u));
+
+   uint32_t iMismatchesCount = 0u;
+
+   for(uint32_t i = 0u; i < iInstancesCount; i++)
+   {
+      Entity* cInstance = vInstances[i];
+
+      if(cScene.getEntity(cInstance->getFullName()) != cInstance ||
+         cInstance->getChildrenCount() != iChildrenCount ||
+         !nearlyEqual(cInstance->getComponent<ComponentTransform>()->getLocalWorldMatrix(), vTransforms[i]))
+      {
+         iMismatchesCount++;
+         continue;
+      }
+
+      for(uint32_t j = 0u; j < iChildrenCount; j++)
+      {
+         Entity* cChild = cInstance->getChildByIndex(j);
+
+         if(cScene.getEntity(cChild->getFullName()) != cChild ||
+            !nearlyEqual(cChild->getComponent<ComponentTransform>()->getScale().X, (float)(j + 1u)))
+         {
+            iMismatchesCount++;
+         }
+      }
+   }
+
+   GETestCheck(iMismatchesCount == 0u);
+
+   // entities added one by one after a batch are still notified
+   cScene.addEntity(ObjectName("AfterBatch"));
+   GETestCheck(iEntityAddedCount == 1u);
+}
+
+static void registerPrefab(Entity* cPrefabRoot, const char* sPrefabName)
+{
+   std::ostringstream cPrefabStream;
+   Scene::saveEntity(cPrefabStream, cPrefabRoot);
+   const std::string sPrefabData = cPrefabStream.str();
+   Scene::registerPrefabData(sPrefabName, sPrefabData.c_str(), (uint32_t)sPrefabData.size());
+}
+
+void testEntityPool()
+{
+   const char* sPrefabName = "EntityPoolTestPrefab";
+   const char* sInactivePrefabName = "EntityPoolTestInactivePrefab";
+   const uint32_t iChildrenCount = 2u;
+
+   Scene cScene(ObjectName("EntityPoolTest"));
+
+   // the same tree registered twice, the second time saved inactive
+   Entity* cPrefabRoot = addEntityTree(cScene, "PoolPrefabRoot", iChildrenCount);
+   registerPrefab(cPrefabRoot, sPrefabName);
+   cPrefabRoot->setActive(false);
+   registerPrefab(cPrefabRoot, sInactivePrefabName);
+
+   // an empty pool instantiates a new entity
+   Entity* cEntity = cScene.acquirePooledPrefab(sPrefabName);
+   EntityPoolStats sStats = cScene.getEntityPoolStats(sPrefabName);
+
+   GETestCheck(cEntity->getActive());
+   GETestCheck(cEntity->getChildrenCount() == iChildrenCount);
+   GETestCheck(sStats.Hits == 0u);
+   GETestCheck(sStats.Misses == 1u);
+   GETestCheck(sStats.Available == 0u);
+
+   // changes made while the entity is in use
+   cEntity->getComponent<ComponentTransform>()->setPosition(10.0f, 10.0f, 10.0f);
+   cEntity->getChildByName(ObjectName("Child0"))->getComponent<ComponentTransform>()->setScale(5.0f);
+   cEntity->addComponent<ComponentDataContainer>();
+   cScene.addEntity(ObjectName("RuntimeChild"), cEntity)->init();
+
+   GETestCheck(cScene.releasePooledEntity(cEntity));
+   GETestCheck(!cEntity->getActive());
+   GETestCheck(cScene.getEntityPoolStats(sPrefabName).Available == 1u);
+
+   // a second release is rejected, and so is an entity that was not instantiated from a prefab
+   GETestCheck(!cScene.releasePooledEntity(cEntity));
+   GETestCheck(cScene.getEntityPoolStats(sPrefabName).Available == 1u);
+   GETestCheck(!cScene.releasePooledEntity(cScene.addEntity(ObjectName("PlainEntity"))));
+
+   // the pooled entity is handed out again, back to the prefab state
+   Entity* cReusedEntity = cScene.acquirePooledPrefab(sPrefabName);
+   sStats = cScene.getEntityPoolStats(sPrefabName);
+
+   GETestCheck(cReusedEntity == cEntity);
+   GETestCheck(sStats.Hits == 1u);
+   GETestCheck(sStats.Misses == 1u);
+   GETestCheck(sStats.Available == 0u);
+   GETestCheck(cReusedEntity->getActive());
+   GETestCheck(nearlyEqual(cReusedEntity->getComponent<ComponentTransform>()->getPosition().X, 1.0f));
+   GETestCheck(nearlyEqual(cReusedEntity->getChildByName(ObjectName("Child0"))->getComponent<ComponentTransform>()->getScale().X, 1.0f));
+   GETestCheck(!cReusedEntity->getComponent<ComponentDataContainer>());
+
+   // children added at runtime go away at the next safe point
+   cScene.flushPendingRemovals();
+   GETestCheck(cReusedEntity->getChildrenCount() == iChildrenCount);
+   GETestCheck(!cReusedEntity->getChildByName(ObjectName("RuntimeChild")));
+
+   // the active flag comes from the prefab as well
+   Entity* cInactiveEntity = cScene.acquirePooledPrefab(sInactivePrefabName);
+   GETestCheck(!cInactiveEntity->getActive());
+   GETestCheck(cScene.releasePooledEntity(cInactiveEntity));
+   GETestCheck(cScene.acquirePooledPrefab(sInactivePrefabName) == cInactiveEntity);
+   GETestCheck(!cInactiveEntity->getActive());
+   GETestCheck(cScene.getEntityPoolStats(sInactivePrefabName).Hits == 1u);
+
+   // prewarmed entities count as available, and are handed out as hits
+   cScene.prewarmEntityPool(sPrefabName, 3u);
+   GETestCheck(cScene.getEntityPoolStats(sPrefabName).Available == 3u);
+
+   cScene.acquirePooledPrefab(sPrefabName);
+   sStats = cScene.getEntityPoolStats(sPrefabName);
+   GETestCheck(sStats.Hits == 2u);
+   GETestCheck(sStats.Misses == 1u);
+   GETestCheck(sStats.Available == 2u);
+}
+
+//
+//  Prefab files are not part of the repository, so the benchmark registers an entity tree saved the
+//  way prefabs are stored, and sets instances up from it with and without templates
+//
+void benchmarkPrefabInstantiation()
+{
+   const uint32_t iInstancesCount = 10000u;
+   const uint32_t iChildrenCount = 4u;
+   const char* sPrefabName = "BenchmarkPrefab";
+
+   Scene cScene(ObjectName("PrefabInstantiationBenchmark"));
+   Entity* cPrefabRoot = addEntityTree(cScene, "PrefabRoot", iChildrenCount);
+   char sEntityName[32];
+
+   registerPrefab(cPrefabRoot, sPrefabName);
+
+   char sDetails[64];
+   sprintf(sDetails, "%u instances, %u entities each", iInstancesCount, iChildrenCount + 1u);
+
+   const bool bPrefabTemplatesEnabled = Scene::getPrefabTemplatesEnabled();
+
+   // previous approach: the prefab data is parsed for every instance
+   Scene::setPrefabTemplatesEnabled(false);
+   std::chrono::high_resolution_clock::time_point cStart = std::chrono::high_resolution_clock::now();
+
+   for(uint32_t i = 0u; i < iInstancesCount; i++)
+   {
+      sprintf(sEntityName, "Parsed%u", i);
+      cScene.setupEntityFromPrefab(cScene.addEntity(ObjectName(sEntityName)), sPrefabName);
+   }
+
+   std::chrono::duration<double, std::milli> cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+   reportBenchmark("Parsed instances", cElapsed.count(), sDetails);
+
+   // templates: the data is parsed once, and the template is copied for every instance
+   Scene::setPrefabTemplatesEnabled(true);
+   cStart = std::chrono::high_resolution_clock::now();
+
+   for(uint32_t i = 0u; i < iInstancesCount; i++)
+   {
+      sprintf(sEntityName, "Copied%u", i);
+      cScene.setupEntityFromPrefab(cScene.addEntity(ObjectName(sEntityName)), sPrefabName);
+   }
+
+   cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+   reportBenchmark("Template instances", cElapsed.count(), sDetails);
+
+   Scene::setPrefabTemplatesEnabled(bPrefabTemplatesEnabled);
+
+   GETestCheck(cScene.getEntitiesCount() == (2u * iInstancesCount + 1u) * (iChildrenCount + 1u));
+}
+
+void benchmarkEntityBatchInstantiation()
+{
+   const uint32_t iInstancesCount = 10000u;
+   const uint32_t iChildrenCount = 4u;
+
+   Scene cScene(ObjectName("EntityBatchBenchmark"));
+   Entity* cSource = addEntityTree(cScene, "Source", iChildrenCount);
+   cSource->init();
+
+   char sEntityName[32];
+   char sDetails[64];
+   sprintf(sDetails, "%u instances, %u entities each", iInstancesCount, iChildrenCount + 1u);
+
+   // one by one: every entity and component takes the scene lock and is notified on its own
+   std::chrono::high_resolution_clock::time_point cStart = std::chrono::high_resolution_clock::now();
+
+   for(uint32_t i = 0u; i < iInstancesCount; i++)
+   {
+      sprintf(sEntityName, "Single%u", i);
+      cScene.cloneEntity(cSource, ObjectName(sEntityName), nullptr)->init();
+   }
+
+   std::chrono::duration<double, std::milli> cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+   reportBenchmark("Instances added one by one", cElapsed.count(), sDetails);
+
+   cStart = std::chrono::high_resolution_clock::now();
+
+   cScene.cloneEntityBatch(cSource, iInstancesCount);
+
+   cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+   reportBenchmark("Instances added in a batch", cElapsed.count(), sDetails);
+
+   GETestCheck(cScene.getEntitiesCount() == (2u * iInstancesCount + 1u) * (iChildrenCount + 1u));
+}
+
+//
+//  A crowd of particle systems around the camera, half of them behind it, updated with the update LOD
+//  disabled and then enabled with distance tiers and a longer interval for the ones off screen
+//
+void benchmarkUpdateLOD()
+{
+   const uint32_t iRowsCount = 40u;
+   const uint32_t iFramesCount = 120u;
+   const float fSpacing = 5.0f;
+
+   RenderSystem* cRender = RenderSystem::getInstance();
+   ComponentCamera* cPreviousCamera = cRender->getActiveCamera();
+
+   Scene cScene(ObjectName("UpdateLODBenchmark"));
+
+   Entity* cCameraEntity = cScene.addEntity(ObjectName("Camera"));
+   cCameraEntity->addComponent<ComponentTransform>()->setPosition(Vector3(0.0f, 2.0f, 0.0f));
+   ComponentCamera* cCamera = cCameraEntity->addComponent<ComponentCamera>();
+   cCamera->lookAt(Vector3(0.0f, 2.0f, 100.0f));
+   cCameraEntity->init();
+
+   cRender->setActiveCamera(cCamera);
+   cCamera->update();
+
+   char sEntityName[32];
+
+   for(uint32_t i = 0u; i < iRowsCount; i++)
+   {
+      for(uint32_t j = 0u; j < iRowsCount; j++)
+      {
+         sprintf(sEntityName, "Emitter%u_%u", i, j);
+         Entity* cEntity = cScene.addEntity(ObjectName(sEntityName));
+         cEntity->addComponent<ComponentTransform>()->setPosition(Vector3(
+            ((float)j - (float)iRowsCount * 0.5f) * fSpacing, 0.0f, ((float)i - (float)iRowsCount * 0.5f) * fSpacing));
+
+         ComponentParticleSystem* cParticleSystem = cEntity->addComponent<ComponentParticleSystem>();
+         cParticleSystem->setMaxParticles(64u);
+         cParticleSystem->setEmissionRate(30.0f);
+         cParticleSystem->setParticleLifeTimeMin(1.0f);
+         cParticleSystem->setParticleLifeTimeMax(2.0f);
+         cEntity->init();
+      }
+   }
+
+   // every entity uses the default clock, which is not ticked by the test runner
+   cCameraEntity->getClock()->setDelta(1.0f / 60.0f);
+
+   char sDetails[64];
+   sprintf(sDetails, "%u particle systems, %u frames", iRowsCount * iRowsCount, iFramesCount);
+
+   std::chrono::high_resolution_clock::time_point cStart = std::chrono::high_resolution_clock::now();
+
+   for(uint32_t i = 0u; i < iFramesCount; i++)
+   {
+      cScene.update();
+   }
+
+   std::chrono::duration<double, std::milli> cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+   reportBenchmark("Every component every frame", cElapsed.count(), sDetails);
+
+   UpdateLODSettings sSettings;
+   sSettings.Enabled = true;
+   sSettings.OffscreenFrameInterval = 16u;
+   cScene.setUpdateLODSettings(UpdateLODGroup::ParticleSystems, sSettings);
+
+   cStart = std::chrono::high_resolution_clock::now();
+
+   for(uint32_t i = 0u; i < iFramesCount; i++)
+   {
+      cScene.update();
+   }
+
+   cElapsed = std::chrono::high_resolution_clock::now() - cStart;
+   reportBenchmark("Update LOD with distance and visibility", cElapsed.count(), sDetails);
+
+   GETestCheck(cScene.getComponentsOfClass<ComponentParticleSystem>().size() == iRowsCount * iRowsCount);
+
+   cRender->setActiveCamera(cPreviousCamera);
+}
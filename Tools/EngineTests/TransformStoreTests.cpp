@@ -0,0 +1,151 @@
+
+#include "main.h"
+
+#include "Core/GEGeometry.h"
+#include "Entities/GEScene.h"
+#include "Entities/GEEntity.h"
+#include "Entities/GEComponentTransform.h"
+
+#include <random>
+#include <cstdio>
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+
+//
+//  World values computed the way ComponentTransform did before the transform store existed:
+//  the local TRS matrix multiplied by the parent world matrix, recursively up to the root
+//
+static Matrix4 computeReferenceWorldMatrix(Entity* cEntity)
+{
+   ComponentTransform* cTransform = cEntity->getComponent<ComponentTransform>();
+
+   Matrix4 mLocalMatrix;
+   Geometry::createTRSMatrix(cTransform->getPosition(), cTransform->getRotation(), cTransform->getScale(), &mLocalMatrix);
+
+   if(!cEntity->getParent())
+      return mLocalMatrix;
+
+   const Matrix4 mParentWorldMatrix = computeReferenceWorldMatrix(cEntity->getParent());
+
+   Matrix4 mWorldMatrix;
+   Matrix4Multiply(mParentWorldMatrix, mLocalMatrix, &mWorldMatrix);
+   return mWorldMatrix;
+}
+
+static Vector3 computeReferenceWorldScale(const Matrix4& mWorldMatrix)
+{
+   const Vector3 vScalingFactorX = Vector3(mWorldMatrix.m[GE_M4_1_1], mWorldMatrix.m[GE_M4_2_1], mWorldMatrix.m[GE_M4_3_1]);
+   const Vector3 vScalingFactorY = Vector3(mWorldMatrix.m[GE_M4_1_2], mWorldMatrix.m[GE_M4_2_2], mWorldMatrix.m[GE_M4_3_2]);
+   const Vector3 vScalingFactorZ = Vector3(mWorldMatrix.m[GE_M4_1_3], mWorldMatrix.m[GE_M4_2_3], mWorldMatrix.m[GE_M4_3_3]);
+
+   return Vector3(vScalingFactorX.getLength(), vScalingFactorY.getLength(), vScalingFactorZ.getLength());
+}
+
+static Rotation computeReferenceWorldRotation(const Matrix4& mWorldMatrix)
+{
+   const Vector3 vWorldScale = computeReferenceWorldScale(mWorldMatrix);
+
+   Matrix4 mWorldRotation = mWorldMatrix;
+   mWorldRotation.m[GE_M4_1_4] = 0.0f;
+   mWorldRotation.m[GE_M4_2_4] = 0.0f;
+   mWorldRotation.m[GE_M4_3_4] = 0.0f;
+   Matrix4Scale(&mWorldRotation, Vector3(1.0f / vWorldScale.X, 1.0f / vWorldScale.Y, 1.0f / vWorldScale.Z));
+
+   return Rotation(mWorldRotation);
+}
+
+static uint32_t checkAgainstReference(Scene& cScene)
+{
+   uint32_t iMismatchesCount = 0u;
+
+   for(uint32_t i = 0u; i < cScene.getEntitiesCount(); i++)
+   {
+      Entity* cEntity = cScene.getEntityByIndex(i);
+      ComponentTransform* cTransform = cEntity->getComponent<ComponentTransform>();
+
+      const Matrix4 mReferenceWorldMatrix = computeReferenceWorldMatrix(cEntity);
+      const Vector3 vReferenceWorldScale = computeReferenceWorldScale(mReferenceWorldMatrix);
+      const Rotation cReferenceWorldRotation = computeReferenceWorldRotation(mReferenceWorldMatrix);
+
+      const Vector3 vWorldScale = cTransform->getWorldScale();
+
+      if(!nearlyEqual(cTransform->getGlobalWorldMatrix(), mReferenceWorldMatrix) ||
+         !nearlyEqual(cTransform->getWorldRotation().getRotationMatrix(), cReferenceWorldRotation.getRotationMatrix()) ||
+         !nearlyEqual(vWorldScale.X, vReferenceWorldScale.X) ||
+         !nearlyEqual(vWorldScale.Y, vReferenceWorldScale.Y) ||
+         !nearlyEqual(vWorldScale.Z, vReferenceWorldScale.Z))
+      {
+         iMismatchesCount++;
+      }
+   }
+
+   return iMismatchesCount;
+}
+
+void testTransformHierarchy()
+{
+   const uint32_t iRootsCount = 8u;
+   const uint32_t iEntitiesCount = 400u;
+
+   std::mt19937 cRandomEngine(26u);
+   std::uniform_real_distribution<float> cRandomPosition(-10.0f, 10.0f);
+   std::uniform_real_distribution<float> cRandomAngle(-GE_PI, GE_PI);
+   std::uniform_real_distribution<float> cRandomScale(0.5f, 2.0f);
+
+   Scene cScene(ObjectName("TransformHierarchyTest"));
+   GESTLVector(Entity*) vEntities;
+   char sEntityName[32];
+
+   for(uint32_t i = 0u; i < iEntitiesCount; i++)
+   {
+      // the first entities are roots, and every other one hangs from a random entity created before it
+      Entity* cParent = i < iRootsCount ? nullptr : vEntities[cRandomEngine() % i];
+
+      sprintf(sEntityName, "Entity%u", i);
+      Entity* cEntity = cScene.addEntity(ObjectName(sEntityName), cParent);
+      ComponentTransform* cTransform = cEntity->addComponent<ComponentTransform>();
+
+      cTransform->setPosition(cRandomPosition(cRandomEngine), cRandomPosition(cRandomEngine), cRandomPosition(cRandomEngine));
+      cTransform->setRotation(Rotation(Vector3(cRandomAngle(cRandomEngine), cRandomAngle(cRandomEngine), cRandomAngle(cRandomEngine))));
+      // uniform scales, since reparenting decomposes the new local matrix and shear cannot be kept
+      cTransform->setScale(cRandomScale(cRandomEngine));
+
+      vEntities.push_back(cEntity);
+   }
+
+   // dirty entries, read before the update pass
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   cScene.queueTransformUpdateJobs();
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   // local changes in the middle of the hierarchy
+   for(uint32_t i = 0u; i < iEntitiesCount; i += 7u)
+   {
+      vEntities[i]->getComponent<ComponentTransform>()->move(1.0f, -2.0f, 0.5f);
+      vEntities[i]->getComponent<ComponentTransform>()->scale(1.5f);
+   }
+
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   cScene.queueTransformUpdateJobs();
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+
+   // reparenting keeps the world transform, so the local values change
+   for(uint32_t i = iRootsCount; i < iEntitiesCount; i += 11u)
+   {
+      Entity* cNewParent = vEntities[cRandomEngine() % iRootsCount];
+
+      if(cNewParent != vEntities[i]->getParent())
+      {
+         const Matrix4 mWorldMatrixBefore = computeReferenceWorldMatrix(vEntities[i]);
+         cScene.setEntityParent(vEntities[i], cNewParent);
+         GETestCheck(nearlyEqual(computeReferenceWorldMatrix(vEntities[i]), mWorldMatrixBefore));
+      }
+   }
+
+   cScene.queueTransformUpdateJobs();
+   GETestCheck(checkAgainstReference(cScene) == 0u);
+}
@@ -0,0 +1,56 @@
+
+#include "main.h"
+
+#include "Entities/GEScene.h"
+#include "Entities/GEEntity.h"
+#include "Entities/GEComponentTransform.h"
+#include "Entities/GEComponentUIElement.h"
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+
+static Entity* addUIEntity(Scene& cScene, const char* sName, Entity* cParent, float fAlpha)
+{
+   Entity* cEntity = cScene.addEntity(ObjectName(sName), cParent);
+   cEntity->addComponent<ComponentTransform>();
+   cEntity->addComponent<ComponentUI2DElement>()->setAlpha(fAlpha);
+   return cEntity;
+}
+
+void testUIAlphaHierarchy()
+{
+   Scene cScene(ObjectName("UIAlphaHierarchyTest"));
+
+   Entity* cRoot = addUIEntity(cScene, "Root", nullptr, 0.5f);
+   Entity* cPanel = cScene.addEntity(ObjectName("Panel"), cRoot);
+   cPanel->addComponent<ComponentTransform>();
+   Entity* cButton = addUIEntity(cScene, "Button", cPanel, 0.5f);
+   Entity* cOtherRoot = addUIEntity(cScene, "OtherRoot", nullptr, 0.8f);
+
+   ComponentUIElement* cButtonElement = cButton->getComponent<ComponentUIElement>();
+
+   // inherited through an entity without UI element
+   GETestCheck(nearlyEqual(cButtonElement->getAlphaInHierarchy(), 0.25f));
+
+   cRoot->getComponent<ComponentUIElement>()->setAlpha(0.2f);
+   GETestCheck(nearlyEqual(cButtonElement->getAlphaInHierarchy(), 0.1f));
+
+   // UI element added to an ancestor after its descendants
+   cPanel->addComponent<ComponentUI2DElement>()->setAlpha(0.5f);
+   GETestCheck(nearlyEqual(cButtonElement->getAlphaInHierarchy(), 0.05f));
+
+   // UI element removed from an ancestor
+   cPanel->removeComponent(ComponentUI2DElement::ClassName);
+   GETestCheck(nearlyEqual(cButtonElement->getAlphaInHierarchy(), 0.1f));
+
+   cRoot->removeComponent(ComponentUI2DElement::ClassName);
+   GETestCheck(nearlyEqual(cButtonElement->getAlphaInHierarchy(), 0.5f));
+
+   // reparented under a different UI element, and back to the root of the scene
+   cScene.setEntityParent(cPanel, cOtherRoot);
+   GETestCheck(nearlyEqual(cButtonElement->getAlphaInHierarchy(), 0.4f));
+
+   cScene.setEntityParent(cPanel, nullptr);
+   GETestCheck(nearlyEqual(cButtonElement->getAlphaInHierarchy(), 0.5f));
+}
@@ -0,0 +1,122 @@
+
+#include "main.h"
+
+#include "Entities/GEUpdateScheduler.h"
+#include "Core/GELog.h"
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Entities;
+
+static const uint32_t kTransforms = (uint32_t)UpdateResource::Transforms;
+static const uint32_t kParticles = (uint32_t)UpdateResource::Particles;
+static const uint32_t kScripts = (uint32_t)UpdateResource::Scripts;
+static const uint32_t kCameras = (uint32_t)UpdateResource::Cameras;
+static const uint32_t kAll = (uint32_t)UpdateResource::All;
+
+static uint32_t registerSystems(UpdateScheduler& cScheduler, uint32_t iSceneIndex, GESTLVector(uint32_t)& vOrder)
+{
+   // the scene index goes in the tens, the system index in the units
+   cScheduler.registerSystem(ObjectName("Transforms"), 0u, kTransforms, UpdateExecution::MainThread,
+      [iSceneIndex, &vOrder] { vOrder.push_back(iSceneIndex * 10u); return 0u; });
+   cScheduler.registerSystem(ObjectName("Particles"), kTransforms | kCameras, kParticles, UpdateExecution::MainThread,
+      [iSceneIndex, &vOrder] { vOrder.push_back(iSceneIndex * 10u + 1u); return 0u; });
+   return cScheduler.registerSystem(ObjectName("Scripts"), kAll, kAll, UpdateExecution::MainThread,
+      [iSceneIndex, &vOrder] { vOrder.push_back(iSceneIndex * 10u + 2u); return 0u; });
+}
+
+#if defined (GE_DEVELOPMENT)
+class ErrorsCounter : public LogListener
+{
+public:
+   uint32_t Count;
+
+   ErrorsCounter()
+      : Count(0u)
+   {
+      Log::addListener(this);
+   }
+
+   virtual void onLog(LogType pType, const char*) override
+   {
+      if(pType == LogType::Error)
+      {
+         Count++;
+      }
+   }
+};
+#endif
+
+static uint32_t getPosition(const GESTLVector(uint32_t)& vOrder, uint32_t iEntry)
+{
+   for(uint32_t i = 0u; i < (uint32_t)vOrder.size(); i++)
+   {
+      if(vOrder[i] == iEntry)
+         return i;
+   }
+
+   return 0xffffffffu;
+}
+
+void testUpdateScheduler()
+{
+   GESTLVector(uint32_t) vOrder;
+
+   UpdateScheduler cScheduler1;
+   UpdateScheduler cScheduler2;
+   const uint32_t iScriptsSystem1 = registerSystems(cScheduler1, 1u, vOrder);
+   const uint32_t iScriptsSystem2 = registerSystems(cScheduler2, 2u, vOrder);
+   UpdateScheduler* cSchedulers[] = { &cScheduler1, &cScheduler2 };
+
+   // scripts that access anything are serialized against every other system, in any scene
+   GETestCheck(cScheduler1.getStagesCount() == 3u);
+   GETestCheck(UpdateScheduler::getStagesCount(cSchedulers, 2u) == 6u);
+
+   // scripts that declare their access only conflict with the systems of their own scene
+   cScheduler1.setSystemAccess(iScriptsSystem1, kTransforms, kScripts);
+   cScheduler2.setSystemAccess(iScriptsSystem2, kTransforms, kScripts);
+   GETestCheck(cScheduler1.getStagesCount() == 2u);
+   GETestCheck(UpdateScheduler::getStagesCount(cSchedulers, 2u) == 2u);
+
+   UpdateScheduler::execute(cSchedulers, 2u);
+   GETestCheck(vOrder.size() == 6u);
+   GETestCheck(getPosition(vOrder, 10u) < getPosition(vOrder, 11u));
+   GETestCheck(getPosition(vOrder, 10u) < getPosition(vOrder, 12u));
+   GETestCheck(getPosition(vOrder, 20u) < getPosition(vOrder, 21u));
+   GETestCheck(getPosition(vOrder, 20u) < getPosition(vOrder, 22u));
+   // the transforms of the second scene do not wait for the systems of the first one
+   GETestCheck(getPosition(vOrder, 20u) < getPosition(vOrder, 11u));
+
+   // shared resources keep conflicting across scenes
+   cScheduler2.setSystemAccess(iScriptsSystem2, kTransforms, kScripts | kCameras);
+   GETestCheck(UpdateScheduler::getStagesCount(cSchedulers, 2u) == 3u);
+
+   vOrder.clear();
+   UpdateScheduler::execute(cSchedulers, 2u);
+   GETestCheck(vOrder.size() == 6u);
+   GETestCheck(getPosition(vOrder, 11u) < getPosition(vOrder, 22u));
+
+   // stages built for a different set of schedulers are not reused
+   GETestCheck(UpdateScheduler::getStagesCount(cSchedulers, 1u) == 2u);
+   GETestCheck(UpdateScheduler::getStagesCount(cSchedulers, 2u) == 3u);
+
+#if defined (GE_DEVELOPMENT)
+   // writes are checked against the system doing them, not against everything its stage declares
+   static ErrorsCounter cErrorsCounter;
+
+   UpdateScheduler cScheduler3;
+   cScheduler3.registerSystem(ObjectName("Particles"), 0u, kParticles, UpdateExecution::MainThread,
+      [] { UpdateScheduler::validateWriteAccess(UpdateResource::Particles); return 0u; });
+   cScheduler3.registerSystem(ObjectName("Cameras"), 0u, kCameras, UpdateExecution::MainThread,
+      [] { UpdateScheduler::validateWriteAccess(UpdateResource::Particles); return 0u; });
+   GETestCheck(cScheduler3.getStagesCount() == 1u);
+
+   const uint32_t iErrorsCount = cErrorsCounter.Count;
+   cScheduler3.execute();
+   GETestCheck(cErrorsCounter.Count == iErrorsCount + 1u);
+
+   // and nothing is checked outside of the systems
+   UpdateScheduler::validateWriteAccess(UpdateResource::Particles);
+   GETestCheck(cErrorsCounter.Count == iErrorsCount + 1u);
+#endif
+}
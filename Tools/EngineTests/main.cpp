@@ -0,0 +1,198 @@
+
+#undef UNICODE
+
+#include <windows.h>
+
+#include "main.h"
+
+#include "Core/GEPlatform.h"
+#include "Core/GEApplication.h"
+#include "Core/GEAllocator.h"
+#include "Core/GEDevice.h"
+#include "Core/GETaskManager.h"
+#if defined (GE_RENDERING_API_NULL)
+# include "Rendering/Null/GERenderSystemNull.h"
+#else
+# include "Rendering/DX11/GERenderSystemDX11.h"
+#endif
+#include "Audio/GEAudioSystem.h"
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+
+#pragma comment(lib, "./../GameEngine.DX11.lib")
+
+#pragma comment(lib, "D3D11.lib")
+#pragma comment(lib, "DXGI.lib")
+
+#if defined (_M_X64)
+# pragma comment(lib, "./../../Externals/OpenAL/lib/Win64/OpenAL32.lib")
+#else
+# pragma comment(lib, "./../../Externals/OpenAL/lib/Win32/OpenAL32.lib")
+#endif
+
+#if defined (_M_X64)
+# pragma comment(lib, "./../../Externals/Brofiler/ProfilerCore64.lib")
+#else
+# pragma comment(lib, "./../../Externals/Brofiler/ProfilerCore32.lib")
+#endif
+
+using namespace GE;
+using namespace GE::Core;
+using namespace GE::Rendering;
+using namespace GE::Audio;
+
+//
+//  The render system needs a device, so the tests create it on a window that is never shown, unless the
+//  engine is built with GE_RENDERING_API_NULL, in which case RenderSystemNull runs without one. The tests
+//  that render replace the backend with RenderCommandBackendNull, so no draw reaches the GPU. Benchmarks
+//  only run when requested with "-benchmarks", since their timings are meant to be compared by hand
+//
+const TestEntry Tests[] =
+{
+   { "Entity: active state through toggling and reparenting", testActiveInHierarchy },
+   { "EntityRegistry: add, find and remove", testEntityRegistry },
+   { "GPUBufferAllocator: allocate, release, merge and defragment", testGPUBufferAllocator },
+   { "HandleTable: stale handles and slot reuse", testHandleTable },
+   { "RenderSystem: culled renderables produce no draws", testFrustumCulling },
+   { "RenderSystem: render thread replays every frame once", testRenderThread },
+   { "RenderSystem: shadow map rendered only on changes", testShadowMapCache },
+   { "RenderSystem: static batches built and dissolved", testStaticBatching },
+   { "Scene: batch instantiation", testEntityBatchInstantiation },
+   { "Scene: component class lists after removals", testComponentClassLists },
+   { "Scene: entity pool reuse and statistics", testEntityPool },
+   { "Scene: list order after removals", testSceneListOrder },
+   { "TransformStore: hierarchy propagation", testTransformHierarchy },
+   { "UIElement: alpha in hierarchy", testUIAlphaHierarchy },
+   { "UpdateScheduler: stages across scenes", testUpdateScheduler },
+};
+
+const TestEntry Benchmarks[] =
+{
+   { "EntityRegistry: multithreaded lookups", benchmarkEntityRegistryLookups },
+   { "RenderSystem: instanced draws", benchmarkInstancedDraws },
+   { "RenderSystem: queueing of renderables", benchmarkQueueForRendering },
+   { "RenderSystem: redundant state changes", benchmarkRedundantStateChanges },
+   { "Scene: batch instantiation", benchmarkEntityBatchInstantiation },
+   { "Scene: prefab instantiation", benchmarkPrefabInstantiation },
+   { "Scene: update LOD in a crowd", benchmarkUpdateLOD },
+};
+
+static uint32_t iChecksCount = 0u;
+static uint32_t iFailedChecksCount = 0u;
+
+void reportCheck(bool bPassed, const char* sExpression, const char* sFileName, int iLine)
+{
+   iChecksCount++;
+
+   if(!bPassed)
+   {
+      iFailedChecksCount++;
+      std::cout << "\n   FAILED: " << sExpression << " (" << sFileName << ":" << iLine << ")";
+   }
+}
+
+void reportBenchmark(const char* sName, double dMilliseconds, const char* sDetails)
+{
+   std::cout << "\n   " << sName << ": " << dMilliseconds << " ms";
+
+   if(sDetails)
+   {
+      std::cout << " (" << sDetails << ")";
+   }
+}
+
+bool nearlyEqual(float fValue1, float fValue2, float fEpsilon)
+{
+   return fabsf(fValue1 - fValue2) <= fEpsilon * GEMax(1.0f, GEMax(fabsf(fValue1), fabsf(fValue2)));
+}
+
+bool nearlyEqual(const Matrix4& mMatrix1, const Matrix4& mMatrix2, float fEpsilon)
+{
+   for(uint32_t i = 0u; i < 16u; i++)
+   {
+      if(!nearlyEqual(mMatrix1.m[i], mMatrix2.m[i], fEpsilon))
+         return false;
+   }
+
+   return true;
+}
+
+static uint32_t runTests(const TestEntry* sEntries, uint32_t iEntriesCount)
+{
+   uint32_t iFailedTestsCount = 0u;
+
+   for(uint32_t i = 0u; i < iEntriesCount; i++)
+   {
+      std::cout << "\n " << sEntries[i].Name << "...";
+
+      const uint32_t iFailedChecksSoFar = iFailedChecksCount;
+      sEntries[i].Function();
+
+      if(iFailedChecksCount == iFailedChecksSoFar)
+      {
+         std::cout << "\n   OK";
+      }
+      else
+      {
+         iFailedTestsCount++;
+      }
+   }
+
+   return iFailedTestsCount;
+}
+
+int main(int argc, char* argv[])
+{
+   std::cout << "\n Game Engine\n Arturo Cepeda\n Engine Tests\n";
+
+   bool bRunBenchmarks = false;
+
+   for(int i = 1; i < argc; i++)
+   {
+      if(strcmp(argv[i], "-benchmarks") == 0)
+      {
+         bRunBenchmarks = true;
+      }
+   }
+
+   Application::startUp(nullptr);
+
+   Device::ScreenWidth = 640;
+   Device::ScreenHeight = 480;
+   Device::AspectRatio = (float)Device::ScreenHeight / (float)Device::ScreenWidth;
+
+#if defined (GE_RENDERING_API_NULL)
+   RenderSystem* cRender = Allocator::alloc<RenderSystemNull>();
+   GEInvokeCtor(RenderSystemNull, cRender);
+#else
+   HWND hWnd = CreateWindowExA(NULL, "STATIC", "EngineTests", WS_CAPTION,
+      0, 0, Device::ScreenWidth, Device::ScreenHeight, NULL, NULL, GetModuleHandle(NULL), NULL);
+
+   RenderSystem* cRender = Allocator::alloc<RenderSystemDX11>();
+   GEInvokeCtor(RenderSystemDX11, cRender)(hWnd, true);
+#endif
+   AudioSystem* cAudio = Allocator::alloc<AudioSystem>();
+   GEInvokeCtor(AudioSystem, cAudio);
+   cAudio->init();
+   TaskManager* cTaskManager = Allocator::alloc<TaskManager>();
+   GEInvokeCtor(TaskManager, cTaskManager);
+
+   uint32_t iFailedTestsCount = runTests(Tests, (uint32_t)(sizeof(Tests) / sizeof(TestEntry)));
+
+   if(bRunBenchmarks)
+   {
+      std::cout << "\n\n Benchmarks";
+      iFailedTestsCount += runTests(Benchmarks, (uint32_t)(sizeof(Benchmarks) / sizeof(TestEntry)));
+   }
+
+   Application::shutDown();
+#if !defined (GE_RENDERING_API_NULL)
+   DestroyWindow(hWnd);
+#endif
+
+   std::cout << "\n\n " << iChecksCount << " checks, " << iFailedChecksCount << " failed\n\n";
+
+   return iFailedTestsCount > 0u ? 1 : 0;
+}
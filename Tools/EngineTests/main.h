@@ -0,0 +1,44 @@
+
+#pragma once
+
+#include "Types/GETypes.h"
+
+#include <cstdint>
+
+struct TestEntry
+{
+   const char* Name;
+   void (*Function)();
+};
+
+void reportCheck(bool bPassed, const char* sExpression, const char* sFileName, int iLine);
+void reportBenchmark(const char* sName, double dMilliseconds, const char* sDetails = nullptr);
+
+bool nearlyEqual(float fValue1, float fValue2, float fEpsilon = 0.001f);
+bool nearlyEqual(const GE::Matrix4& mMatrix1, const GE::Matrix4& mMatrix2, float fEpsilon = 0.001f);
+
+#define GETestCheck(Condition)  reportCheck((Condition), #Condition, __FILE__, __LINE__)
+
+void testActiveInHierarchy();
+void testComponentClassLists();
+void testEntityBatchInstantiation();
+void testEntityPool();
+void testEntityRegistry();
+void testFrustumCulling();
+void testGPUBufferAllocator();
+void testHandleTable();
+void testRenderThread();
+void testSceneListOrder();
+void testShadowMapCache();
+void testStaticBatching();
+void testTransformHierarchy();
+void testUIAlphaHierarchy();
+void testUpdateScheduler();
+
+void benchmarkEntityBatchInstantiation();
+void benchmarkEntityRegistryLookups();
+void benchmarkInstancedDraws();
+void benchmarkPrefabInstantiation();
+void benchmarkQueueForRendering();
+void benchmarkRedundantStateChanges();
+void benchmarkUpdateLOD();
@@ -965,7 +965,7 @@ void packEntity(const ObjectName& cName, const pugi::xml_node& xmlNode, std::ofs
    }
 
    cDummyScene.removeEntity(cName);
-   cDummyScene.queueUpdateJobs();
+   cDummyScene.flushPendingRemovals();
 }
 
 void packPrefabs()